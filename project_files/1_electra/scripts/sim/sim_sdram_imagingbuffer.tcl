@@ -18,15 +18,24 @@ vcom -2008 -explicit ../../../vhdl/subsystems/vnir/vnir_pkg.vhd
 vcom -2008 -explicit ../../../vhdl/subsystems/sdram/pkg/sdram_types.vhd
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/imaging_buffer_pkg.vhd}
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/custom_master_pkg.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/ccsds123_pkg.vhd}
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/IP/VNIR_ROW_FIFO.vhd}
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/IP/SWIR_Row_FIFO.vhd}
 
 # sdram submodules
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/row_fifo.vhd}
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/imaging_buffer.vhd}
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/header_creator.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/ccsds123_compressor.vhd}
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/command_creator.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/read_back_engine.vhd}
 
 vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/imaging_buffer_tb.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/imaging_buffer_stall_tb.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/imaging_buffer_swir_tb.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/command_creator_idle_tb.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/ccsds123_compressor_tb.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/read_back_engine_tb.vhd}
 
 vsim -gui work.imaging_buffer_tb(sim)
 add wave -position end sim:/imaging_buffer_tb/imaging_buffer/*
@@ -0,0 +1,42 @@
+# Runs vnir_bands_tb with vnir.N_WINDOWS set to vnir.MAX_WINDOWS (8), from a copy of vnir_pkg.vhd
+
+# util 
+vcom -2008 -explicit ../../../vhdl/util/types.vhd
+vcom -2008 -explicit ../../../vhdl/util/edge_detector.vhd
+
+vcom -2008 -explicit ../../../vhdl/subsystems/swir/swir_types.vhd
+vcom -2008 -explicit ../../../vhdl/subsystems/fpga/fpga_types.vhd
+
+# vnir packages, with every window
+vcom -2008 -explicit ../../../vhdl/subsystems/vnir/base/vnir_base_pkg.vhd
+vcom -2008 -explicit ../../../vhdl/subsystems/vnir/base/sensor_configurer/sensor_configurer_pkg.vhd
+vcom -2008 -explicit ../../../vhdl/subsystems/vnir/base/pixel_integrator/pixel_integrator_pkg.vhd
+vcom -2008 -explicit ../../../vhdl/subsystems/vnir/base/lvds_decoder/lvds_decoder_pkg.vhd
+vcom -2008 -explicit ../../../vhdl/subsystems/vnir/base/frame_requester/frame_requester_pkg.vhd
+
+set pkg_file [open ../../../vhdl/subsystems/vnir/vnir_pkg.vhd r]
+set pkg [read $pkg_file]
+close $pkg_file
+if {![regsub {constant N_WINDOWS : integer := [0-9]+;} $pkg {constant N_WINDOWS : integer := 8;} pkg]} {
+    error "N_WINDOWS not found in vnir_pkg.vhd"
+}
+set pkg_file [open vnir_pkg_all_windows.vhd w]
+puts -nonewline $pkg_file $pkg
+close $pkg_file
+vcom -2008 -explicit vnir_pkg_all_windows.vhd
+
+# sdram packages 
+vcom -2008 -explicit ../../../vhdl/subsystems/sdram/pkg/sdram_types.vhd
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/imaging_buffer_pkg.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/pkg/ccsds123_pkg.vhd}
+
+# sdram submodules
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/mm_address_counter.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/mm_partition_register.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/mm_memory_map.vhd}
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/submodules/header_creator.vhd}
+
+vcom -2008 -explicit {../../../vhdl/subsystems/sdram/testbenches/vnir_bands_tb.vhd}
+
+vsim work.vnir_bands_tb(sim)
+run -all
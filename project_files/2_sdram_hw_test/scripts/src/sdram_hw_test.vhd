@@ -106,8 +106,9 @@ architecture rtl of sdram_hw_test is
   signal h2f_reset      : std_logic;
 
   -- Data inputs
-  signal vnir_row       : vnir.row_t      := (others => "1111111111");
-  signal vnir_row_rdy   : vnir.row_type_t := vnir.ROW_NONE;
+  signal vnir_fragment  : vnir.row_fragment_t := (others => "1111111111");
+  signal vnir_frag_rdy  : vnir.row_type_t := vnir.ROW_NONE;
+  signal vnir_frag_last : std_logic       := '0';
   signal swir_pixel     : swir_pixel_t    := "1010101010101010";
   signal swir_pxl_rdy   : std_logic       := '0';
   signal swir_pxl_count : integer range 0 to 512;
@@ -170,8 +171,11 @@ begin
     imaging_buffer_component : entity work.imaging_buffer port map(
       clock            => clock,          -- external input
       reset_n          => reset_n,        -- external input
-      vnir_row         => vnir_row,       -- external input
-      vnir_row_ready   => vnir_row_rdy,   -- external input
+      vnir_fragment       => vnir_fragment,  -- external input
+      vnir_fragment_available => vnir_frag_rdy, -- external input
+      vnir_fragment_first => '0',            -- external input
+      vnir_fragment_last  => vnir_frag_last, -- external input
+      vnir_fragment_ready => open,           -- external output
       swir_pixel       => swir_pixel,     -- external input
       swir_pixel_ready => swir_pxl_rdy,   -- external input
       row_request      => row_req,        -- imaging_buffer <==  command_creator
@@ -67,13 +67,17 @@ set_global_assignment -name VHDL_FILE ../../../vhdl/subsystems/vnir/vnir_pkg.vhd
 set_global_assignment -name VHDL_FILE ../../../vhdl/subsystems/sdram/pkg/sdram_types.vhd
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/pkg/imaging_buffer_pkg.vhd}
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/pkg/custom_master_pkg.vhd}
+set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/pkg/ccsds123_pkg.vhd}
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/pkg/IP/VNIR_ROW_FIFO.vhd}
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/pkg/IP/SWIR_Row_FIFO.vhd}
 
 # sdram submodules
+set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/submodules/row_fifo.vhd}
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/submodules/imaging_buffer.vhd}
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/submodules/header_creator.vhd}
+set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/submodules/ccsds123_compressor.vhd}
 set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/submodules/command_creator.vhd}
+set_global_assignment -name VHDL_FILE {../../../vhdl/subsystems/sdram/submodules/read_back_engine.vhd}
 
 # get pin assignments  
 source $pins_file
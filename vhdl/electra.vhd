@@ -19,7 +19,6 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.spi_types.all;
-use work.avalonmm;
 use work.vnir;
 use work.swir_types.all;
 use work.sdram;
@@ -41,10 +40,13 @@ port (
 
     -- SWIR external ports
     swir_control            : out swir_control_t;
-    swir_sdi                : out std_logic;
-    swir_sdo                : in std_logic;
+    swir_sdi_even           : out std_logic;
+    swir_sdo_even           : in std_logic;
+    swir_cnv_even           : out std_logic;
+    swir_sdi_odd            : out std_logic;
+    swir_sdo_odd            : in std_logic;
+    swir_cnv_odd            : out std_logic;
     swir_sck                : out std_logic;
-    swir_cnv                : out std_logic;
     swir_sensor_clock_even  : out std_logic;
     swir_sensor_clock_odd   : out std_logic;
     swir_sensor_reset_even  : out std_logic;
@@ -56,10 +58,6 @@ port (
     swir_AD_trig_even       : in std_logic;
     swir_AD_trig_odd        : in std_logic;
 
-    -- SDRAM external ports
-    sdram_avalon_out        : out avalonmm.from_master_t;
-    sdram_avalon_in         : in avalonmm.to_master_t;
-
     -- HPS to DDR3
     HPS_DDR3_ADDR           : out std_logic_vector(14 downto 0);
     HPS_DDR3_BA             : out std_logic_vector(2 downto 0);
@@ -99,10 +97,13 @@ architecture rtl of electra is
         vnir_lvds               : in vnir.lvds_t;
 
         swir_control            : out swir_control_t;
-        swir_sdi                : out std_logic;
-        swir_sdo                : in std_logic;
+        swir_sdi_even           : out std_logic;
+        swir_sdo_even           : in std_logic;
+        swir_cnv_even           : out std_logic;
+        swir_sdi_odd            : out std_logic;
+        swir_sdo_odd            : in std_logic;
+        swir_cnv_odd            : out std_logic;
         swir_sck                : out std_logic;
-        swir_cnv                : out std_logic;
         swir_sensor_clock_even  : out std_logic;
         swir_sensor_clock_odd   : out std_logic;
         swir_sensor_reset_even  : out std_logic;
@@ -114,9 +115,6 @@ architecture rtl of electra is
         swir_AD_trig_even       : in std_logic;
         swir_AD_trig_odd        : in std_logic;
 
-        sdram_avalon_out        : out avalonmm.from_master_t;
-        sdram_avalon_in         : in avalonmm.to_master_t;
-
         HPS_DDR3_ADDR           : out std_logic_vector(14 downto 0);
         HPS_DDR3_BA             : out std_logic_vector(2 downto 0);
         HPS_DDR3_CK_P           : out std_logic;
@@ -169,10 +167,13 @@ begin
         vnir_exposure_start     => vnir_exposure_start,
         vnir_lvds               => vnir_lvds,
         swir_control            => swir_control,
-        swir_sdi                => swir_sdi,
-        swir_sdo                => swir_sdo,
+        swir_sdi_even           => swir_sdi_even,
+        swir_sdo_even           => swir_sdo_even,
+        swir_cnv_even           => swir_cnv_even,
+        swir_sdi_odd            => swir_sdi_odd,
+        swir_sdo_odd            => swir_sdo_odd,
+        swir_cnv_odd            => swir_cnv_odd,
         swir_sck                => swir_sck,
-        swir_cnv                => swir_cnv,
         swir_sensor_clock_even  => swir_sensor_clock_even,
         swir_sensor_clock_odd   => swir_sensor_clock_odd,
         swir_sensor_reset_even  => swir_sensor_reset_even,
@@ -183,8 +184,6 @@ begin
         swir_AD_sp_odd          => swir_AD_sp_odd,
         swir_AD_trig_even       => swir_AD_trig_even,
         swir_AD_trig_odd        => swir_AD_trig_odd,
-        sdram_avalon_out        => sdram_avalon_out,
-        sdram_avalon_in         => sdram_avalon_in,
         HPS_DDR3_ADDR           => HPS_DDR3_ADDR,
         HPS_DDR3_BA             => HPS_DDR3_BA,
         HPS_DDR3_CK_P           => HPS_DDR3_CK_P,
@@ -22,10 +22,25 @@ use work.vnir;  -- Gives outputs to the VNIR subsystem
 use work.swir_types.all;  -- Gives outputs from SWIR subsystem
 use work.sdram;  -- Gives output to sdram subsystem
 use work.fpga.timestamp_t;
-use work.avalonmm;
 use work.spi_types.all;
+use work.custom_master_pkg.all;
+use work.pixel_integrator_pkg;
+use work.img_buffer_pkg.FIFO_WORD_LENGTH;
 
 entity fpga_subsystem is
+    generic (
+        -- When false, the VNIR subsystem's parallel `row` output isn't
+        -- built. The SDRAM subsystem has no parallel-row input and always
+        -- takes VNIR rows as a stream of fragments, so setting this only
+        -- keeps `row` for other consumers; it doesn't change what's
+        -- written to SDRAM
+        VNIR_PARALLEL_ROW       : boolean := false;
+        -- "SPILL" keeps the VNIR running sums in SDRAM, in scratch space
+        -- the memory map sets aside below the catalog (see
+        -- `vnir_subsystem` and `pixel_integrator_spill`). "DUAL" sums
+        -- fragments two at a time with `pixel_integrator_dual`
+        VNIR_INTEGRATOR         : string := "SINGLE"
+    );
     port (
         clock                   : in std_logic;
         pll_ref_clock           : in std_logic;
@@ -43,10 +58,13 @@ entity fpga_subsystem is
 
         -- SWIR external ports
         swir_control            : out swir_control_t;
-        swir_sdi                : out std_logic;
-        swir_sdo                : in std_logic;
+        swir_sdi_even           : out std_logic;
+        swir_sdo_even           : in std_logic;
+        swir_cnv_even           : out std_logic;
+        swir_sdi_odd            : out std_logic;
+        swir_sdo_odd            : in std_logic;
+        swir_cnv_odd            : out std_logic;
         swir_sck                : out std_logic;
-        swir_cnv                : out std_logic;
         swir_sensor_clock_even  : out std_logic;
         swir_sensor_clock_odd   : out std_logic;
         swir_sensor_reset_even  : out std_logic;
@@ -58,10 +76,6 @@ entity fpga_subsystem is
         swir_AD_trig_even       : in std_logic;
         swir_AD_trig_odd        : in std_logic;
 
-        -- SDRAM external ports
-        sdram_avalon_out        : out avalonmm.from_master_t;
-        sdram_avalon_in         : in avalonmm.to_master_t;
-
         -- HPS to DDR3
         HPS_DDR3_ADDR           : out std_logic_vector(14 downto 0);
         HPS_DDR3_BA             : out std_logic_vector(2 downto 0);
@@ -85,6 +99,10 @@ end entity fpga_subsystem;
 architecture rtl of fpga_subsystem is
 
     component vnir_subsystem_avalonmm is
+    generic (
+        PARALLEL_ROW        : boolean;
+        INTEGRATOR          : string
+    );
     port (
         clock               : in std_logic;
         reset_n             : in std_logic;
@@ -103,13 +121,26 @@ architecture rtl of fpga_subsystem is
 
         row                 : out vnir.row_t;
         row_available       : out vnir.row_type_t;
+
+        row_fragment            : out vnir.row_fragment_t;
+        row_fragment_available  : out vnir.row_type_t;
+        row_fragment_first      : out std_logic;
+        row_fragment_last       : out std_logic;
+        row_fragment_ready      : in std_logic;
+        row_widths              : out vnir.crop_widths_t;
         
         spi_out             : out spi_from_master_t;
         spi_in              : in spi_to_master_t;
         
         frame_request       : out std_logic;
         exposure_start      : out std_logic;
-        lvds                : in vnir.lvds_t
+        lvds                : in vnir.lvds_t;
+
+        scratch_base        : in sdram.address_t;
+        read_master_in      : in from_read_master_t;
+        read_master_out     : out to_read_master_t;
+        write_master_in     : in from_master_t;
+        write_master_out    : out to_master_t
     );
     end component vnir_subsystem_avalonmm;
 
@@ -129,11 +160,16 @@ architecture rtl of fpga_subsystem is
         
         pixel               : out swir_pixel_t;
         pxl_available       : out std_logic;
+        row_width           : out integer;
+        coadd_rows          : out integer range 1 to swir_max_coadd_rows;
         
-        sdi                 : out std_logic;
-        sdo                 : in std_logic;
+        sdi_even            : out std_logic;
+        sdo_even            : in std_logic;
+        cnv_even            : out std_logic;
+        sdi_odd             : out std_logic;
+        sdo_odd             : in std_logic;
+        cnv_odd             : out std_logic;
         sck                 : out std_logic;
-        cnv                 : out std_logic;
 
         sensor_clock_even   : out std_logic;
         sensor_clock_odd    : out std_logic;
@@ -149,6 +185,9 @@ architecture rtl of fpga_subsystem is
     end component swir_subsystem_avalonmm;
 
     component sdram_subsystem_avalonmm is
+    generic (
+        SCRATCH_ADDRESSES   : natural
+    );
     port (
         clock               : in std_logic;
         reset_n             : in std_logic;
@@ -160,13 +199,23 @@ architecture rtl of fpga_subsystem is
         avs_writedata       : in  std_logic_vector(31 downto 0);
         avs_irq             : out std_logic;
 
-        sdram_avalon_out    : out avalonmm.from_master_t;
-        sdram_avalon_in     : in avalonmm.to_master_t;
+        read_master_in      : in from_read_master_t;
+        read_master_out     : out to_read_master_t;
+        write_master_in     : in from_master_t;
+        write_master_out    : out to_master_t;
+
+        scratch_base        : out sdram.address_t;
 
-        vnir_row_available  : in vnir.row_type_t;
-        vnir_row            : in vnir.row_t;
+        vnir_fragment_available : in vnir.row_type_t;
+        vnir_fragment       : in vnir.row_fragment_t;
+        vnir_fragment_first : in std_logic;
+        vnir_fragment_last  : in std_logic;
+        vnir_fragment_ready : out std_logic;
+        vnir_image_row_widths : in vnir.crop_widths_t;
         swir_pxl_available  : in std_logic;
-        swir_pixel          : in swir_pixel_t
+        swir_pixel          : in swir_pixel_t;
+        swir_image_row_pixels : in integer;
+        swir_image_coadd_rows : in integer range 1 to swir_max_coadd_rows
     );
     end component sdram_subsystem_avalonmm;
 
@@ -214,12 +263,56 @@ architecture rtl of fpga_subsystem is
         fpga_controller_avm_write      : out   std_logic;                                        -- write
         fpga_controller_avm_writedata  : out   std_logic_vector(31 downto 0);                    -- writedata
         fpga_controller_avm_irq_irq    : in    std_logic                     := 'X';             -- irq
+        sdram_read_master_control_fixed_location  : in    std_logic                      := 'X';             -- export
+        sdram_read_master_control_read_base       : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        sdram_read_master_control_read_length     : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        sdram_read_master_control_go              : in    std_logic                      := 'X';             -- export
+        sdram_read_master_control_done            : out   std_logic;                                         -- export
+        sdram_read_master_control_early_done      : out   std_logic;                                         -- export
+        sdram_read_master_user_read_buffer        : in    std_logic                      := 'X';             -- export
+        sdram_read_master_user_buffer_output_data : out   std_logic_vector(127 downto 0);                    -- export
+        sdram_read_master_user_data_available     : out   std_logic;                                         -- export
+        sdram_write_master_control_fixed_location : in    std_logic                      := 'X';             -- export
+        sdram_write_master_control_write_base     : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        sdram_write_master_control_write_length   : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        sdram_write_master_control_go             : in    std_logic                      := 'X';             -- export
+        sdram_write_master_control_done           : out   std_logic;                                         -- export
+        sdram_write_master_user_write_buffer      : in    std_logic                      := 'X';             -- export
+        sdram_write_master_user_buffer_input_data : in    std_logic_vector(127 downto 0) := (others => 'X'); -- export
+        sdram_write_master_user_buffer_full       : out   std_logic;                                         -- export
+        vnir_read_master_control_fixed_location   : in    std_logic                      := 'X';             -- export
+        vnir_read_master_control_read_base        : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        vnir_read_master_control_read_length      : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        vnir_read_master_control_go               : in    std_logic                      := 'X';             -- export
+        vnir_read_master_control_done             : out   std_logic;                                         -- export
+        vnir_read_master_control_early_done       : out   std_logic;                                         -- export
+        vnir_read_master_user_read_buffer         : in    std_logic                      := 'X';             -- export
+        vnir_read_master_user_buffer_output_data  : out   std_logic_vector(127 downto 0);                    -- export
+        vnir_read_master_user_data_available      : out   std_logic;                                         -- export
+        vnir_write_master_control_fixed_location  : in    std_logic                      := 'X';             -- export
+        vnir_write_master_control_write_base      : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        vnir_write_master_control_write_length    : in    std_logic_vector(31 downto 0)  := (others => 'X'); -- export
+        vnir_write_master_control_go              : in    std_logic                      := 'X';             -- export
+        vnir_write_master_control_done            : out   std_logic;                                         -- export
+        vnir_write_master_user_write_buffer       : in    std_logic                      := 'X';             -- export
+        vnir_write_master_user_buffer_input_data  : in    std_logic_vector(127 downto 0) := (others => 'X'); -- export
+        vnir_write_master_user_buffer_full        : out   std_logic;                                         -- export
         pll_0_refclk_clk               : in    std_logic                     := 'X';             -- clk
         pll_0_locked_export            : out   std_logic;                                        -- export
         vnir_sensor_clock_clk          : out   std_logic                                         -- clk
     );
     end component interconnect;
 
+    -- SDRAM the memory map sets aside for the VNIR running sums, if they're kept there
+    pure function vnir_scratch_addresses return natural is
+    begin
+        if VNIR_INTEGRATOR = "SPILL" then
+            return pixel_integrator_pkg.spill_scratch_addresses(vnir.ROW_WIDTH, vnir.FRAGMENT_WIDTH, vnir.PIXEL_BITS,
+                                                               vnir.N_WINDOWS, vnir.SPILL_MAX_WINDOW_SIZE, FIFO_WORD_LENGTH);
+        end if;
+        return 0;
+    end function vnir_scratch_addresses;
+
     -- Subsystem reset -- held low until plls are locked
     signal subsystem_reset_n    : std_logic;
 
@@ -250,6 +343,20 @@ architecture rtl of fpga_subsystem is
     signal sdram_av_writedata   : std_logic_vector(31 downto 0);
     signal sdram_av_irq         : std_logic;
 
+    -- SDRAM subsystem <=> read and write masters in the interconnect
+    signal sdram_read_master_in     : from_read_master_t;
+    signal sdram_read_master_out    : to_read_master_t;
+    signal sdram_write_master_in    : from_master_t;
+    signal sdram_write_master_out   : to_master_t;
+
+    -- VNIR subsystem <=> its read and write masters in the interconnect, and the
+    -- scratch space they use
+    signal vnir_read_master_in      : from_read_master_t;
+    signal vnir_read_master_out     : to_read_master_t;
+    signal vnir_write_master_in     : from_master_t;
+    signal vnir_write_master_out    : to_master_t;
+    signal vnir_scratch_base        : sdram.address_t;
+
     -- For connecting FPGA subsystem with AvalonMM interface
     signal fpga_av_address     : std_logic_vector(7 downto 0);
     signal fpga_av_read        : std_logic;
@@ -261,6 +368,12 @@ architecture rtl of fpga_subsystem is
     -- VNIR subsystem => SDRAM subsystem
     signal vnir_row             : vnir.row_t;
     signal vnir_row_available   : vnir.row_type_t;
+    signal vnir_fragment            : vnir.row_fragment_t;
+    signal vnir_fragment_available  : vnir.row_type_t;
+    signal vnir_fragment_first      : std_logic;
+    signal vnir_fragment_last       : std_logic;
+    signal vnir_fragment_ready      : std_logic;
+    signal vnir_row_widths          : vnir.crop_widths_t;
 
     -- VNIR sensor clock signals
     signal vnir_sensor_clock_ungated : std_logic;
@@ -269,6 +382,8 @@ architecture rtl of fpga_subsystem is
     -- SWIR subsystem => SDRAM subsystem
     signal swir_pixel           : swir_pixel_t;
     signal swir_pxl_available   : std_logic;
+    signal swir_row_width       : integer;
+    signal swir_coadd_rows      : integer range 1 to swir_max_coadd_rows;
 
     attribute keep: boolean;
     attribute keep of subsystem_reset_n     : signal is true;
@@ -289,7 +404,10 @@ begin
         end if;
     end process;
 
-    vnir_cmp : vnir_subsystem_avalonmm port map (
+    vnir_cmp : vnir_subsystem_avalonmm generic map (
+        PARALLEL_ROW        => VNIR_PARALLEL_ROW,
+        INTEGRATOR          => VNIR_INTEGRATOR
+    ) port map (
         clock               => clock,
         reset_n             => subsystem_reset_n,
 
@@ -308,12 +426,25 @@ begin
         row                 => vnir_row,
         row_available       => vnir_row_available,
 
+        row_fragment            => vnir_fragment,
+        row_fragment_available  => vnir_fragment_available,
+        row_fragment_first      => vnir_fragment_first,
+        row_fragment_last       => vnir_fragment_last,
+        row_fragment_ready      => vnir_fragment_ready,
+        row_widths              => vnir_row_widths,
+
         spi_out             => vnir_spi_out,
         spi_in              => vnir_spi_in,
 
         frame_request       => vnir_frame_request,
         exposure_start      => vnir_exposure_start,
-        lvds                => vnir_lvds
+        lvds                => vnir_lvds,
+
+        scratch_base        => vnir_scratch_base,
+        read_master_in      => vnir_read_master_in,
+        read_master_out     => vnir_read_master_out,
+        write_master_in     => vnir_write_master_in,
+        write_master_out    => vnir_write_master_out
     );
 
     vnir_sensor_clock <= vnir_sensor_clock_ungated and vnir_sensor_clock_enable;
@@ -330,10 +461,15 @@ begin
         control             => swir_control,
         pixel               => swir_pixel,
         pxl_available       => swir_pxl_available,
-        sdi                 => swir_sdi,
-        sdo                 => swir_sdo,
+        row_width           => swir_row_width,
+        coadd_rows          => swir_coadd_rows,
+        sdi_even            => swir_sdi_even,
+        sdo_even            => swir_sdo_even,
+        cnv_even            => swir_cnv_even,
+        sdi_odd             => swir_sdi_odd,
+        sdo_odd             => swir_sdo_odd,
+        cnv_odd             => swir_cnv_odd,
         sck                 => swir_sck,
-        cnv                 => swir_cnv,
         sensor_clock_even   => swir_sensor_clock_even,
         sensor_clock_odd    => swir_sensor_clock_odd,
         sensor_reset_even   => swir_sensor_reset_even,
@@ -346,6 +482,38 @@ begin
         AD_trig_odd         => swir_AD_trig_odd
     );
 
+    sdram_cmp : sdram_subsystem_avalonmm generic map (
+        SCRATCH_ADDRESSES   => vnir_scratch_addresses
+    ) port map (
+        clock               => clock,
+        reset_n             => subsystem_reset_n,
+
+        avs_address         => sdram_av_address,
+        avs_read            => sdram_av_read,
+        avs_readdata        => sdram_av_readdata,
+        avs_write           => sdram_av_write,
+        avs_writedata       => sdram_av_writedata,
+        avs_irq             => sdram_av_irq,
+
+        read_master_in      => sdram_read_master_in,
+        read_master_out     => sdram_read_master_out,
+        write_master_in     => sdram_write_master_in,
+        write_master_out    => sdram_write_master_out,
+
+        scratch_base        => vnir_scratch_base,
+
+        vnir_fragment_available => vnir_fragment_available,
+        vnir_fragment       => vnir_fragment,
+        vnir_fragment_first => vnir_fragment_first,
+        vnir_fragment_last  => vnir_fragment_last,
+        vnir_fragment_ready => vnir_fragment_ready,
+        vnir_image_row_widths => vnir_row_widths,
+        swir_pxl_available  => swir_pxl_available,
+        swir_pixel          => swir_pixel,
+        swir_image_row_pixels => swir_row_width,
+        swir_image_coadd_rows => swir_coadd_rows
+    );
+
     interconnect_cmp : interconnect port map (
         clock_clk                       => clock,
         reset_reset_n                   => reset_n,
@@ -395,6 +563,44 @@ begin
         fpga_controller_avm_writedata   => fpga_av_writedata,
         fpga_controller_avm_irq_irq     => fpga_av_irq,
 
+        sdram_read_master_control_fixed_location  => sdram_read_master_out.control_fixed_location,
+        sdram_read_master_control_read_base       => sdram_read_master_out.control_read_base,
+        sdram_read_master_control_read_length     => sdram_read_master_out.control_read_length,
+        sdram_read_master_control_go              => sdram_read_master_out.control_go,
+        sdram_read_master_control_done            => sdram_read_master_in.control_done,
+        sdram_read_master_control_early_done      => open,
+        sdram_read_master_user_read_buffer        => sdram_read_master_out.user_read_buffer,
+        sdram_read_master_user_buffer_output_data => sdram_read_master_in.user_buffer_data,
+        sdram_read_master_user_data_available     => sdram_read_master_in.user_data_available,
+
+        sdram_write_master_control_fixed_location => sdram_write_master_out.control_fixed_location,
+        sdram_write_master_control_write_base     => sdram_write_master_out.control_write_base,
+        sdram_write_master_control_write_length   => sdram_write_master_out.control_write_length,
+        sdram_write_master_control_go             => sdram_write_master_out.control_go,
+        sdram_write_master_control_done           => sdram_write_master_in.control_done,
+        sdram_write_master_user_write_buffer      => sdram_write_master_out.user_write_buffer,
+        sdram_write_master_user_buffer_input_data => sdram_write_master_out.user_buffer_data,
+        sdram_write_master_user_buffer_full       => sdram_write_master_in.user_buffer_full,
+
+        vnir_read_master_control_fixed_location   => vnir_read_master_out.control_fixed_location,
+        vnir_read_master_control_read_base        => vnir_read_master_out.control_read_base,
+        vnir_read_master_control_read_length      => vnir_read_master_out.control_read_length,
+        vnir_read_master_control_go               => vnir_read_master_out.control_go,
+        vnir_read_master_control_done             => vnir_read_master_in.control_done,
+        vnir_read_master_control_early_done       => open,
+        vnir_read_master_user_read_buffer         => vnir_read_master_out.user_read_buffer,
+        vnir_read_master_user_buffer_output_data  => vnir_read_master_in.user_buffer_data,
+        vnir_read_master_user_data_available      => vnir_read_master_in.user_data_available,
+
+        vnir_write_master_control_fixed_location  => vnir_write_master_out.control_fixed_location,
+        vnir_write_master_control_write_base      => vnir_write_master_out.control_write_base,
+        vnir_write_master_control_write_length    => vnir_write_master_out.control_write_length,
+        vnir_write_master_control_go              => vnir_write_master_out.control_go,
+        vnir_write_master_control_done            => vnir_write_master_in.control_done,
+        vnir_write_master_user_write_buffer       => vnir_write_master_out.user_write_buffer,
+        vnir_write_master_user_buffer_input_data  => vnir_write_master_out.user_buffer_data,
+        vnir_write_master_user_buffer_full        => vnir_write_master_in.user_buffer_full,
+
         pll_0_refclk_clk                => pll_ref_clock,
         pll_0_locked_export             => pll_locked,
         vnir_sensor_clock_clk           => vnir_sensor_clock_ungated
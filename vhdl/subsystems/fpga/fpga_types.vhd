@@ -19,5 +19,11 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 package fpga is
-    subtype timestamp_t is unsigned(63 downto 0);  -- TODO: define this
+    --The time an image was taken, as written by the MCU (see sdram_controller, x04 and x05) before
+    --it's started. The FPGA doesn't interpret it, only copies it into the image's header and catalog entry
+    subtype timestamp_t is unsigned(63 downto 0);
+
+    --Clock cycles of the SDRAM subsystem's clock since reset, from a free-running counter (see
+    --imaging_buffer). Rows are timed with it relative to each other
+    subtype capture_time_t is unsigned(63 downto 0);
 end package fpga;
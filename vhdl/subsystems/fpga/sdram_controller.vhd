@@ -19,6 +19,9 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.sdram;
+use work.vnir;
+use work.swir_types.swir_row_width;
+use work.swir_types.swir_max_coadd_rows;
 use work.fpga.timestamp_t;
 
 entity sdram_controller is
@@ -35,6 +38,26 @@ entity sdram_controller is
 
         swir_num_rows       : out integer;
         vnir_num_rows       : out integer;
+        vnir_row_widths     : out sdram.vnir_row_widths_t;
+        vnir_image_row_widths : in vnir.crop_widths_t := (others => vnir.ROW_WIDTH);  -- from the VNIR subsystem, latched with the row counts
+        swir_row_pixels     : out integer;
+        swir_image_row_pixels : in integer := swir_row_width;   -- from the SWIR subsystem, latched with the row counts
+        swir_coadd_rows     : out integer range 1 to swir_max_coadd_rows;
+        swir_image_coadd_rows : in integer range 1 to swir_max_coadd_rows := 1;  -- from the SWIR subsystem, latched with the row counts
+        compress            : out std_logic;
+        compress_overflow   : in  std_logic;
+        vnir_compress_overflow : in std_logic := '0';
+        swir_compress_overflow : in std_logic := '0';
+
+        readback_base       : out sdram.address_t;
+        readback_end        : out sdram.address_t;
+        readback_start      : out std_logic;
+        readback_catalog_index : out natural;
+        readback_catalog_start : out std_logic;
+        readback_data       : in  std_logic_vector(31 downto 0);
+        readback_valid      : in  std_logic;
+        readback_read       : out std_logic;
+        readback_busy       : in  std_logic;
 
         timestamp           : out timestamp_t;
         mpu_memory_change   : out sdram.address_block_t;
@@ -42,10 +65,15 @@ entity sdram_controller is
         start_config        : out std_logic;
         config_from_sdram   : in  sdram.memory_state_t;
         config_done         : in  std_logic;
-        img_config_done     : in  std_logic;
+        vnir_img_config_done : in std_logic := '0';   -- high while each sensor's image is configured
+        swir_img_config_done : in std_logic := '0';
 
         sdram_busy          : in std_logic;
-        sdram_error         : in sdram.error_t
+        sdram_error         : in sdram.error_t;
+
+        perf_clear          : out std_logic;
+        perf_counters       : in  sdram.perf_counters_t;
+        master_waitrequest  : in  std_logic := '0'
     );
 end entity sdram_controller;
 
@@ -85,6 +113,11 @@ architecture rtl of sdram_controller is
         return std_logic_vector(to_signed(i, 32));
     end function to_l32;
 
+    pure function to_l32(u : unsigned) return std_logic_vector is
+    begin
+        return std_logic_vector(resize(u, 32));
+    end function to_l32;
+
     pure function to_l32(e : sdram.error_t) return std_logic_vector is
     begin
         case e is
@@ -100,28 +133,68 @@ begin
         variable config_done_reg : std_logic;
         variable config_done_irq : std_logic;
 
-        variable image_config_done_reg : std_logic;
-        variable image_config_done_irq : std_logic;
+        --Each sensor's image has been configured since it was last started; set on the rise of its
+        --img_config_done, so its IRQ can be cleared while the image is still being taken
+        variable vnir_image_done_reg : std_logic;
+        variable vnir_image_done_irq : std_logic;
+        variable vnir_image_done_prev : std_logic;
+        variable swir_image_done_reg : std_logic;
+        variable swir_image_done_irq : std_logic;
+        variable swir_image_done_prev : std_logic;
 
         variable vnir_num_rows_reg : integer;
         variable swir_num_rows_reg : integer;
+
+        --Clock cycles on which the write master's buffer was full, its writes being held off by waitrequest
+        variable waitrequest_cycles : unsigned(31 downto 0);
+
+        --VNIR band (see sdram.vnir_index) whose perf counters are read through x3B and x3C, so the
+        --bands past the first three can be read too
+        variable perf_band : natural range 0 to vnir.N_WINDOWS-1;
+
+        --The avs interface has a readWaitTime of 1 (see controller_interface_hw.tcl), so each read
+        --holds avs_read for two clock cycles, and back-to-back reads keep it high. Set on the second
+        --cycle of a read
+        variable read_wait : std_logic;
     begin
         if reset_n = '0' then
             config_to_sdram <= (memory_base => sdram.UNDEFINED_ADDRESS, memory_bounds => sdram.UNDEFINED_ADDRESS);
+            compress        <= '0';
+            readback_base   <= sdram.UNDEFINED_ADDRESS;
+            readback_end    <= sdram.UNDEFINED_ADDRESS;
+            readback_start  <= '0';
+            readback_catalog_index <= 0;
+            readback_catalog_start <= '0';
+            readback_read   <= '0';
+            perf_clear      <= '0';
+            waitrequest_cycles := (others => '0');
+            perf_band       := 0;
+            read_wait       := '0';
             swir_num_rows   <= 0;
             vnir_num_rows   <= 0;
             config_done_reg := '0';
             config_done_irq := '0';
-            image_config_done_reg := '0';
-            image_config_done_irq := '0';
+            vnir_image_done_reg := '0';
+            vnir_image_done_irq := '0';
+            vnir_image_done_prev := '0';
+            swir_image_done_reg := '0';
+            swir_image_done_irq := '0';
+            swir_image_done_prev := '0';
             
             vnir_num_rows_reg := 0;
             swir_num_rows_reg := 0;
+            vnir_row_widths <= (others => vnir.ROW_WIDTH);
+            swir_row_pixels <= swir_row_width;
+            swir_coadd_rows <= 1;
             vnir_num_rows <= 0;
             swir_num_rows <= 0;
         elsif rising_edge(clock) then
 
             start_config <= '0';
+            readback_start <= '0';
+            readback_catalog_start <= '0';
+            readback_read <= '0';
+            perf_clear <= '0';
             vnir_num_rows <= 0;
             swir_num_rows <= 0;
 
@@ -138,15 +211,44 @@ begin
                 
                 when x"08" => start_config <= '1';
                               config_done_reg := '0';
+                --Start an image of both sensors (x09), or of just one (x34, x35), with the row counts
+                --written to x02 and x03 and each sensor's current row widths. A row count starts one image
+                --only, so a later start doesn't begin another image of a sensor whose count wasn't rewritten
                 when x"09" => swir_num_rows <= swir_num_rows_reg;
                               vnir_num_rows <= vnir_num_rows_reg;
-                              image_config_done_reg := '0';
+                              vnir_row_widths <= sdram.vnir_row_widths(vnir_image_row_widths);
+                              swir_row_pixels <= swir_image_row_pixels;
+                              swir_coadd_rows <= swir_image_coadd_rows;
+                              vnir_num_rows_reg := 0;
+                              swir_num_rows_reg := 0;
+                              vnir_image_done_reg := '0';
+                              swir_image_done_reg := '0';
+                when x"34" => vnir_num_rows <= vnir_num_rows_reg;
+                              vnir_row_widths <= sdram.vnir_row_widths(vnir_image_row_widths);
+                              vnir_num_rows_reg := 0;
+                              vnir_image_done_reg := '0';
+                when x"35" => swir_num_rows <= swir_num_rows_reg;
+                              swir_row_pixels <= swir_image_row_pixels;
+                              swir_coadd_rows <= swir_image_coadd_rows;
+                              swir_num_rows_reg := 0;
+                              swir_image_done_reg := '0';
+                when x"1E" => compress                      <= avs_writedata(0);
+                when x"21" => readback_base                 <= read_address(avs_writedata);
+                when x"22" => readback_end                  <= read_address(avs_writedata);
+                when x"23" => readback_start <= '1';
+                when x"24" => readback_catalog_index        <= read_integer(avs_writedata);
+                              readback_catalog_start <= '1';
+                when x"27" => perf_clear <= '1';
+                              waitrequest_cycles := (others => '0');
+                when x"3A" => perf_band                     := maximum(minimum(read_integer(avs_writedata), vnir.N_WINDOWS-1), 0);
                 when others =>
                 end case;
             elsif avs_read = '1' then
                 case avs_address is
                 when x"0A" => avs_readdata <= to_l32(config_done_reg); config_done_irq := '0';
-                when x"0B" => avs_readdata <= to_l32(image_config_done_reg); image_config_done_irq := '0';
+                when x"0B" => avs_readdata <= to_l32(vnir_image_done_reg or swir_image_done_reg);
+                              vnir_image_done_irq := '0';
+                              swir_image_done_irq := '0';
 
                 when x"0C" => avs_readdata <= to_l32(config_from_sdram.vnir.base);
                 when x"0D" => avs_readdata <= to_l32(config_from_sdram.vnir.bounds);
@@ -166,23 +268,65 @@ begin
                 when x"1B" => avs_readdata <= to_l32(config_from_sdram.swir_temp.fill_base);
                 when x"1C" => avs_readdata <= to_l32(sdram_busy);
                 when x"1D" => avs_readdata <= to_l32(sdram_error);
+                when x"1E" => avs_readdata <= to_l32(compress_overflow);
+                when x"1F" => avs_readdata <= to_l32(config_from_sdram.catalog_base);
+                when x"20" => avs_readdata <= to_l32(config_from_sdram.catalog_count);
+                when x"25" => avs_readdata <= readback_data; readback_read <= readback_valid and not read_wait;
+                when x"26" => avs_readdata <= (0 => readback_busy, 1 => readback_valid, others => '0');
+                when x"28" => avs_readdata <= to_l32(perf_counters.rows_received(sdram.ROW_RED));
+                when x"29" => avs_readdata <= to_l32(perf_counters.rows_received(sdram.ROW_BLUE));
+                when x"2A" => avs_readdata <= to_l32(perf_counters.rows_received(sdram.ROW_NIR));
+                when x"2B" => avs_readdata <= to_l32(perf_counters.rows_received(sdram.ROW_SWIR));
+                when x"2C" => avs_readdata <= to_l32(perf_counters.rows_dropped);
+                when x"2D" => avs_readdata <= to_l32(perf_counters.rows_high_water(sdram.ROW_RED));
+                when x"2E" => avs_readdata <= to_l32(perf_counters.rows_high_water(sdram.ROW_BLUE));
+                when x"2F" => avs_readdata <= to_l32(perf_counters.rows_high_water(sdram.ROW_NIR));
+                when x"30" => avs_readdata <= to_l32(perf_counters.rows_high_water(sdram.ROW_SWIR));
+                when x"31" => avs_readdata <= to_l32(perf_counters.write_cycles);
+                when x"32" => avs_readdata <= to_l32(perf_counters.wait_cycles);
+                when x"33" => avs_readdata <= to_l32(waitrequest_cycles);
+                --Each sensor's status: bit 0 its image has been configured, bit 1 its image didn't fit once compressed
+                when x"34" => avs_readdata <= (0 => vnir_image_done_reg, 1 => vnir_compress_overflow, others => '0');
+                              vnir_image_done_irq := '0';
+                when x"35" => avs_readdata <= (0 => swir_image_done_reg, 1 => swir_compress_overflow, others => '0');
+                              swir_image_done_irq := '0';
+                when x"36" => avs_readdata <= to_l32(config_from_sdram.scratch_base);
+                when x"3A" => avs_readdata <= to_l32(perf_band);
+                when x"3B" => avs_readdata <= to_l32(perf_counters.rows_received(sdram.vnir_type(perf_band)));
+                when x"3C" => avs_readdata <= to_l32(perf_counters.rows_high_water(sdram.vnir_type(perf_band)));
                 when others =>
                 end case;
             end if;
 
+            if avs_write = '0' and avs_read = '1' then
+                read_wait := not read_wait;
+            else
+                read_wait := '0';
+            end if;
+
             if config_done = '1' then
                 config_done_reg := '1';
                 config_done_irq := '1';
             end if;
 
-            if img_config_done = '1' then
-                image_config_done_reg := '1';
-                image_config_done_irq := '1';
+            if vnir_img_config_done = '1' and vnir_image_done_prev = '0' then
+                vnir_image_done_reg := '1';
+                vnir_image_done_irq := '1';
+            end if;
+            if swir_img_config_done = '1' and swir_image_done_prev = '0' then
+                swir_image_done_reg := '1';
+                swir_image_done_irq := '1';
+            end if;
+            vnir_image_done_prev := vnir_img_config_done;
+            swir_image_done_prev := swir_img_config_done;
+
+            if master_waitrequest = '1' then
+                waitrequest_cycles := waitrequest_cycles + 1;
             end if;
 
         end if;
 
-        avs_irq <= config_done_irq or image_config_done_irq;
+        avs_irq <= config_done_irq or vnir_image_done_irq or swir_image_done_irq;
     
     end process;
     
@@ -27,9 +27,12 @@ use work.vnir;
 use work.swir_types.all;
 use work.sdram;
 use work.fpga.timestamp_t;
-use work.avalonmm;
+use work.custom_master_pkg.all;
 
 entity sdram_subsystem_avalonmm is
+generic (
+    SCRATCH_ADDRESSES   : natural := 0
+);
 port (
     clock               : in std_logic;
     reset_n             : in std_logic;
@@ -41,13 +44,23 @@ port (
     avs_writedata       : in  std_logic_vector(31 downto 0);
     avs_irq             : out std_logic;
 
-    sdram_avalon_out    : out avalonmm.from_master_t;
-    sdram_avalon_in     : in avalonmm.to_master_t;
+    read_master_in      : in from_read_master_t;
+    read_master_out     : out to_read_master_t;
+    write_master_in     : in from_master_t;
+    write_master_out    : out to_master_t;
+
+    scratch_base        : out sdram.address_t;  -- start of the scratch space set aside for the VNIR subsystem
 
-    vnir_row_available  : in vnir.row_type_t;
-    vnir_row            : in vnir.row_t;
+    vnir_fragment_available : in vnir.row_type_t;
+    vnir_fragment       : in vnir.row_fragment_t;
+    vnir_fragment_first : in std_logic;
+    vnir_fragment_last  : in std_logic;
+    vnir_fragment_ready : out std_logic;
+    vnir_image_row_widths : in vnir.crop_widths_t := (others => vnir.ROW_WIDTH);  -- row widths of the VNIR subsystem's per-image configuration
     swir_pxl_available  : in std_logic;
-    swir_pixel          : in swir_pixel_t
+    swir_pixel          : in swir_pixel_t;
+    swir_image_row_pixels : in integer := swir_row_width;   -- row width of the SWIR subsystem's crop
+    swir_image_coadd_rows : in integer range 1 to swir_max_coadd_rows := 1  -- rows the SWIR subsystem co-adds into each one
 );
 end entity sdram_subsystem_avalonmm;
 
@@ -68,6 +81,26 @@ architecture rtl of sdram_subsystem_avalonmm is
 
         swir_num_rows       : out integer;
         vnir_num_rows       : out integer;
+        vnir_row_widths     : out sdram.vnir_row_widths_t;
+        vnir_image_row_widths : in vnir.crop_widths_t := (others => vnir.ROW_WIDTH);
+        swir_row_pixels     : out integer;
+        swir_image_row_pixels : in integer := swir_row_width;
+        swir_coadd_rows     : out integer range 1 to swir_max_coadd_rows;
+        swir_image_coadd_rows : in integer range 1 to swir_max_coadd_rows := 1;
+        compress            : out std_logic;
+        compress_overflow   : in  std_logic;
+        vnir_compress_overflow : in std_logic := '0';
+        swir_compress_overflow : in std_logic := '0';
+
+        readback_base       : out sdram.address_t;
+        readback_end        : out sdram.address_t;
+        readback_start      : out std_logic;
+        readback_catalog_index : out natural;
+        readback_catalog_start : out std_logic;
+        readback_data       : in  std_logic_vector(31 downto 0);
+        readback_valid      : in  std_logic;
+        readback_read       : out std_logic;
+        readback_busy       : in  std_logic;
 
         timestamp           : out timestamp_t;
         mpu_memory_change   : out sdram.address_block_t;
@@ -75,25 +108,59 @@ architecture rtl of sdram_subsystem_avalonmm is
         start_config        : out std_logic;
         config_from_sdram   : in  sdram.memory_state_t;
         config_done         : in  std_logic;
-        img_config_done     : in  std_logic;
+        vnir_img_config_done : in std_logic := '0';
+        swir_img_config_done : in std_logic := '0';
 
         sdram_busy          : in std_logic;
-        sdram_error         : in sdram.error_t
+        sdram_error         : in sdram.error_t;
+
+        perf_clear          : out std_logic;
+        perf_counters       : in  sdram.perf_counters_t;
+        master_waitrequest  : in  std_logic := '0'
     );
     end component sdram_controller;
 
     component sdram_subsystem is
+    generic (
+        SCRATCH_ADDRESSES   : natural := SCRATCH_ADDRESSES
+    );
     port (
         clock               : in std_logic;
         reset_n             : in std_logic;
 
-        vnir_row_available  : in vnir.row_type_t;
+        vnir_fragment_available : in vnir.row_type_t;
         vnir_num_rows       : in integer;
-        vnir_row            : in vnir.row_t;
+        vnir_row_widths     : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);
+        swir_row_pixels     : in integer := swir_row_width;
+        swir_coadd_rows     : in integer range 1 to swir_max_coadd_rows := 1;
+        vnir_fragment       : in vnir.row_fragment_t;
+        vnir_fragment_first : in std_logic;
+        vnir_fragment_last  : in std_logic;
+        vnir_fragment_ready : out std_logic;
         
         swir_pxl_available  : in std_logic;
         swir_num_rows       : in integer;
         swir_pixel          : in swir_pixel_t;
+
+        compress            : in std_logic;
+        compress_overflow   : out std_logic;
+        vnir_compress_overflow : out std_logic;
+        swir_compress_overflow : out std_logic;
+
+        readback_base       : in sdram.address_t;
+        readback_end        : in sdram.address_t;
+        readback_start      : in std_logic;
+        readback_catalog_index : in natural;
+        readback_catalog_start : in std_logic;
+        readback_data       : out std_logic_vector(31 downto 0);
+        readback_valid      : out std_logic;
+        readback_read       : in std_logic;
+        readback_busy       : out std_logic;
+        read_master_in      : in from_read_master_t;
+        read_master_out     : out to_read_master_t;
+
+        write_master_in     : in from_master_t;
+        write_master_out    : out to_master_t;
         
         timestamp           : in timestamp_t;
         mpu_memory_change   : in sdram.address_block_t;
@@ -102,26 +169,48 @@ architecture rtl of sdram_subsystem_avalonmm is
         config_out          : out sdram.memory_state_t;
         config_done         : out std_logic;
         img_config_done     : out std_logic;
+        vnir_img_config_done : out std_logic;
+        swir_img_config_done : out std_logic;
         
         sdram_busy          : out std_logic;
         sdram_error         : out sdram.error_t;
-        
-        sdram_avalon_out    : out avalonmm.from_master_t;
-        sdram_avalon_in     : in avalonmm.to_master_t
+
+        perf_clear          : in std_logic := '0';
+        perf_counters       : out sdram.perf_counters_t
     );
     end component sdram_subsystem;
 
     signal swir_num_rows        : integer;
     signal vnir_num_rows        : integer;
+    signal vnir_row_widths      : sdram.vnir_row_widths_t;
+    signal swir_row_pixels      : integer;
+    signal swir_coadd_rows      : integer range 1 to swir_max_coadd_rows;
+    signal compress             : std_logic;
+    signal compress_overflow    : std_logic;
+    signal vnir_compress_overflow : std_logic;
+    signal swir_compress_overflow : std_logic;
+    signal readback_base        : sdram.address_t;
+    signal readback_end         : sdram.address_t;
+    signal readback_start       : std_logic;
+    signal readback_catalog_index : natural;
+    signal readback_catalog_start : std_logic;
+    signal readback_data        : std_logic_vector(31 downto 0);
+    signal readback_valid       : std_logic;
+    signal readback_read        : std_logic;
+    signal readback_busy        : std_logic;
     signal timestamp            : timestamp_t;
     signal mpu_memory_change    : sdram.address_block_t;
     signal config_to_sdram      : sdram.config_to_sdram_t;
     signal start_config         : std_logic;
     signal config_from_sdram    : sdram.memory_state_t;
     signal config_done          : std_logic;
-    signal img_config_done      : std_logic;
+    signal vnir_img_config_done : std_logic;
+    signal swir_img_config_done : std_logic;
     signal sdram_busy           : std_logic;
     signal sdram_error          : sdram.error_t;
+    signal perf_clear           : std_logic;
+    signal perf_counters        : sdram.perf_counters_t;
+    signal master_waitrequest   : std_logic;
 
 begin
 
@@ -137,6 +226,26 @@ begin
 
         swir_num_rows => swir_num_rows,
         vnir_num_rows => vnir_num_rows,
+        vnir_row_widths => vnir_row_widths,
+        vnir_image_row_widths => vnir_image_row_widths,
+        swir_row_pixels => swir_row_pixels,
+        swir_image_row_pixels => swir_image_row_pixels,
+        swir_coadd_rows => swir_coadd_rows,
+        swir_image_coadd_rows => swir_image_coadd_rows,
+        compress => compress,
+        compress_overflow => compress_overflow,
+        vnir_compress_overflow => vnir_compress_overflow,
+        swir_compress_overflow => swir_compress_overflow,
+
+        readback_base => readback_base,
+        readback_end => readback_end,
+        readback_start => readback_start,
+        readback_catalog_index => readback_catalog_index,
+        readback_catalog_start => readback_catalog_start,
+        readback_data => readback_data,
+        readback_valid => readback_valid,
+        readback_read => readback_read,
+        readback_busy => readback_busy,
         
         timestamp => timestamp,
         mpu_memory_change => mpu_memory_change,
@@ -144,23 +253,54 @@ begin
         start_config => start_config,
         config_from_sdram => config_from_sdram,
         config_done => config_done,
-        img_config_done => img_config_done,
+        vnir_img_config_done => vnir_img_config_done,
+        swir_img_config_done => swir_img_config_done,
         
         sdram_busy => sdram_busy,
-        sdram_error => sdram_error
+        sdram_error => sdram_error,
+
+        perf_clear => perf_clear,
+        perf_counters => perf_counters,
+        master_waitrequest => master_waitrequest
     );
 
     sdram_subsystem_cmp : sdram_subsystem port map (
         clock => clock,
         reset_n => reset_n,
 
-        vnir_row_available => vnir_row_available,
+        vnir_fragment_available => vnir_fragment_available,
         vnir_num_rows => vnir_num_rows,
-        vnir_row => vnir_row,
+        vnir_row_widths => vnir_row_widths,
+        swir_row_pixels => swir_row_pixels,
+        swir_coadd_rows => swir_coadd_rows,
+        vnir_fragment => vnir_fragment,
+        vnir_fragment_first => vnir_fragment_first,
+        vnir_fragment_last => vnir_fragment_last,
+        vnir_fragment_ready => vnir_fragment_ready,
         
         swir_pxl_available => swir_pxl_available,
         swir_num_rows => swir_num_rows,
         swir_pixel => swir_pixel,
+
+        compress => compress,
+        compress_overflow => compress_overflow,
+        vnir_compress_overflow => vnir_compress_overflow,
+        swir_compress_overflow => swir_compress_overflow,
+
+        readback_base => readback_base,
+        readback_end => readback_end,
+        readback_start => readback_start,
+        readback_catalog_index => readback_catalog_index,
+        readback_catalog_start => readback_catalog_start,
+        readback_data => readback_data,
+        readback_valid => readback_valid,
+        readback_read => readback_read,
+        readback_busy => readback_busy,
+        read_master_in => read_master_in,
+        read_master_out => read_master_out,
+
+        write_master_in => write_master_in,
+        write_master_out => write_master_out,
         
         timestamp => timestamp,
         mpu_memory_change => mpu_memory_change,
@@ -168,13 +308,20 @@ begin
         start_config => start_config,
         config_out => config_from_sdram,
         config_done => config_done,
-        img_config_done => img_config_done,
+        img_config_done => open,
+        vnir_img_config_done => vnir_img_config_done,
+        swir_img_config_done => swir_img_config_done,
         
         sdram_busy => sdram_busy,
         sdram_error => sdram_error,
-        
-        sdram_avalon_out => sdram_avalon_out,
-        sdram_avalon_in => sdram_avalon_in
+
+        perf_clear => perf_clear,
+        perf_counters => perf_counters
     );
 
+    -- The write master's buffer only fills up while the bus holds its writes off with waitrequest
+    master_waitrequest <= write_master_in.user_buffer_full;
+
+    scratch_base <= config_from_sdram.scratch_base;
+
 end architecture rtl;
@@ -34,16 +34,30 @@ entity swir_controller is
         avs_irq             : out std_logic;
 
         config              : out swir_config_t;
+        control             : out swir_control_t;
         start_config        : out std_logic;
         config_done         : in  std_logic;
 
         do_imaging          : out std_logic;
-        imaging_done        : in  std_logic
+        imaging_done        : in  std_logic;
+
+        bad_pixel_column    : out integer range 0 to swir_row_width-1;
+        bad_pixel_bad       : out std_logic;
+        write_bad_pixel     : out std_logic;
+
+        crop_start          : out integer range 0 to swir_row_width-1;
+        crop_width          : out integer range 0 to swir_row_width;
+
+        pxl_available       : in  std_logic := '0';
+        samples_dropped     : in  unsigned(15 downto 0) := (others => '0')
     );
 end entity swir_controller;
 
 architecture rtl of swir_controller is
 
+    -- SWIR pixels per SDRAM word. Cropped rows are a whole number of words
+    constant CROP_STEP : integer := 8;
+
     pure function read_integer(bits : std_logic_vector) return integer is
     begin
         return to_integer(signed(bits));
@@ -56,6 +70,11 @@ architecture rtl of swir_controller is
         return re;
     end function to_l32;
 
+    pure function to_l32(u : unsigned) return std_logic_vector is
+    begin
+        return std_logic_vector(resize(u, 32));
+    end function to_l32;
+
 begin
 
     process (clock, reset_n)
@@ -63,18 +82,43 @@ begin
         variable config_done_irq    : std_logic;
         variable imaging_done_reg   : std_logic;
         variable imaging_done_irq   : std_logic;
+
+        -- Performance counters, cleared by writing to x07
+        variable pixels_received    : unsigned(31 downto 0);
+        variable rows_received      : unsigned(31 downto 0);
+        variable row_pixel          : integer range 0 to swir_row_width-1;
+
+        -- Crop as written, and clamped to whole words within the row
+        variable crop_start_reg     : integer range 0 to swir_row_width-1;
+        variable crop_width_reg     : integer range 0 to swir_row_width;
+        variable crop_start_v       : integer range 0 to swir_row_width-1;
+        variable crop_width_v       : integer range 0 to swir_row_width;
     begin
         if reset_n = '0' then
             start_config <= '0';
-            config <= (frame_clocks => 0, exposure_clocks => 0, length => 0);
+            write_bad_pixel <= '0';
+            bad_pixel_column <= 0;
+            bad_pixel_bad <= '0';
+            crop_start <= 0;
+            crop_width <= swir_row_width;
+            crop_start_reg   := 0;
+            crop_width_reg   := swir_row_width;
+            crop_start_v     := 0;
+            crop_width_v     := swir_row_width;
+            config <= (frame_clocks => 0, exposure_clocks => 0, length => 0, coadd_rows => 1, cds => '0');
+            control <= (volt_conv => '0');
             config_done_reg  := '0';
             config_done_irq  := '0';
             imaging_done_reg := '0';
             imaging_done_irq := '0';
+            pixels_received  := (others => '0');
+            rows_received    := (others => '0');
+            row_pixel        := 0;
         elsif rising_edge(clock) then
 
             start_config <= '0';
             do_imaging <= '0';
+            write_bad_pixel <= '0';
 
             if avs_write = '1' then
                 case avs_address is
@@ -83,16 +127,44 @@ begin
                     when x"02" => config.exposure_clocks <= read_integer(avs_writedata);
                     when x"03" => start_config           <= '1';
                     when x"04" => do_imaging             <= '1';
+                    when x"07" => pixels_received        := (others => '0');
+                                  rows_received          := (others => '0');
+                    -- Bad-pixel map: bits 15-0 are the column, bit 31 is set if it's bad
+                    when x"0A" => bad_pixel_column       <= to_integer(unsigned(avs_writedata(15 downto 0))) mod swir_row_width;
+                                  bad_pixel_bad          <= avs_writedata(31);
+                                  write_bad_pixel        <= '1';
+                    -- Cross-track crop (see `swir_row_cropper`), set before imaging. Read back as clamped
+                    when x"0B" => crop_start_reg         := to_integer(unsigned(avs_writedata(15 downto 0))) mod swir_row_width;
+                    when x"0C" => crop_width_reg         := minimum(to_integer(unsigned(avs_writedata(15 downto 0))), swir_row_width);
+                    -- Rows co-added into each output row (see `swir_row_coadder`), set before imaging
+                    when x"0D" => config.coadd_rows      <= maximum(minimum(to_integer(unsigned(avs_writedata(15 downto 0))), swir_max_coadd_rows), 1);
+                    -- Correlated double sampling on (bit 0 set) or off, set before imaging
+                    when x"0E" => config.cds             <= avs_writedata(0);
+                    -- Sensor voltage regulators on (bit 0 set) or off
+                    when x"10" => control.volt_conv      <= avs_writedata(0);
                     when others =>
                 end case;
             elsif avs_read = '1' then
                 case avs_address is
                     when x"05" => avs_readdata <= to_l32(config_done_reg);  config_done_irq  := '0';
                     when x"06" => avs_readdata <= to_l32(imaging_done_reg); imaging_done_irq := '0';
+                    when x"08" => avs_readdata <= to_l32(pixels_received);
+                    when x"09" => avs_readdata <= to_l32(rows_received);
+                    when x"0B" => avs_readdata <= to_l32(to_unsigned(crop_start_v, 16));
+                    when x"0C" => avs_readdata <= to_l32(to_unsigned(crop_width_v, 16));
+                    -- ADC samples dropped since reset (see `swir_subsystem`); nonzero means some rows are missing pixels
+                    when x"0F" => avs_readdata <= to_l32(samples_dropped);
                     when others =>
                 end case;
             end if;
 
+            -- The crop must be at least a word wide, a whole number of words, and within the row, or
+            -- swir_row_cropper would pass on rows of a different width than the SDRAM subsystem expects
+            crop_start_v := minimum(crop_start_reg, swir_row_width - CROP_STEP);
+            crop_width_v := minimum(maximum(crop_width_reg, CROP_STEP), swir_row_width - crop_start_v) / CROP_STEP * CROP_STEP;
+            crop_start <= crop_start_v;
+            crop_width <= crop_width_v;
+
             if config_done = '1' then
                 config_done_reg := '1';
                 config_done_irq := '1';
@@ -103,6 +175,16 @@ begin
                 imaging_done_irq := '1';
             end if;
 
+            if pxl_available = '1' then
+                pixels_received := pixels_received + 1;
+                if row_pixel = swir_row_width-1 then
+                    rows_received := rows_received + 1;
+                    row_pixel := 0;
+                else
+                    row_pixel := row_pixel + 1;
+                end if;
+            end if;
+
         end if;
 
         avs_irq <= config_done_irq or imaging_done_irq;
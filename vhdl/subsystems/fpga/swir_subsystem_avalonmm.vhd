@@ -40,11 +40,16 @@ port (
     
     pixel               : out swir_pixel_t;
     pxl_available       : out std_logic;
+    row_width           : out integer;      -- pixels per row of `pixel`, after cropping
+    coadd_rows          : out integer range 1 to swir_max_coadd_rows;  -- rows co-added into each row of `pixel`
     
-    sdi                 : out std_logic;
-    sdo                 : in std_logic;
+    sdi_even            : out std_logic;
+    sdo_even            : in std_logic;
+    cnv_even            : out std_logic;
+    sdi_odd             : out std_logic;
+    sdo_odd             : in std_logic;
+    cnv_odd             : out std_logic;
     sck                 : out std_logic;
-    cnv                 : out std_logic;
 
     sensor_clock_even   : out std_logic;
     sensor_clock_odd    : out std_logic;
@@ -75,11 +80,22 @@ architecture rtl of swir_subsystem_avalonmm is
         avs_irq             : out std_logic;
 
         config              : out swir_config_t;
+        control             : out swir_control_t;
         start_config        : out std_logic;
         config_done         : in  std_logic;
 
         do_imaging          : out std_logic;
-        imaging_done        : in  std_logic
+        imaging_done        : in  std_logic;
+
+        bad_pixel_column    : out integer range 0 to swir_row_width-1;
+        bad_pixel_bad       : out std_logic;
+        write_bad_pixel     : out std_logic;
+
+        crop_start          : out integer range 0 to swir_row_width-1;
+        crop_width          : out integer range 0 to swir_row_width;
+
+        pxl_available       : in  std_logic := '0';
+        samples_dropped     : in  unsigned(15 downto 0) := (others => '0')
     );
     end component swir_controller;
 
@@ -89,7 +105,7 @@ architecture rtl of swir_subsystem_avalonmm is
         reset_n             : in std_logic;
         
         config              : in swir_config_t;
-        control             : out swir_control_t;
+        control             : in swir_control_t;
         start_config        : in std_logic;
         config_done         : out std_logic;
         
@@ -97,12 +113,16 @@ architecture rtl of swir_subsystem_avalonmm is
         imaging_done        : out std_logic;
 
         pixel               : out swir_pixel_t;
-        pxl_available       : out std_logic;
+        pixel_available     : out std_logic;
+        samples_dropped     : out unsigned(15 downto 0);
 
-        sdi                 : out std_logic;
-        sdo                 : in std_logic;
+        sdi_even            : out std_logic;
+        sdo_even            : in std_logic;
+        cnv_even            : out std_logic;
+        sdi_odd             : out std_logic;
+        sdo_odd             : in std_logic;
+        cnv_odd             : out std_logic;
         sck                 : out std_logic;
-        cnv                 : out std_logic;
         
         sensor_clock_even   : out std_logic;
         sensor_clock_odd    : out std_logic;
@@ -117,14 +137,77 @@ architecture rtl of swir_subsystem_avalonmm is
     );
     end component swir_subsystem;
 
+    component swir_bad_pixel_replacer is
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        map_column          : in integer range 0 to swir_row_width-1;
+        map_bad             : in std_logic;
+        map_write           : in std_logic;
+
+        pixel_in            : in swir_pixel_t;
+        pixel_in_available  : in std_logic;
+        pixel_out           : out swir_pixel_t;
+        pixel_out_available : out std_logic
+    );
+    end component swir_bad_pixel_replacer;
+
+    component swir_row_coadder is
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        coadd_rows          : in integer range 1 to swir_max_coadd_rows;
+        start               : in std_logic;
+
+        pixel_in            : in swir_pixel_t;
+        pixel_in_available  : in std_logic;
+        pixel_out           : out swir_pixel_t;
+        pixel_out_available : out std_logic
+    );
+    end component swir_row_coadder;
+
+    component swir_row_cropper is
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        crop_start          : in integer range 0 to swir_row_width-1;
+        crop_width          : in integer range 0 to swir_row_width;
+
+        pixel_in            : in swir_pixel_t;
+        pixel_in_available  : in std_logic;
+        pixel_out           : out swir_pixel_t;
+        pixel_out_available : out std_logic
+    );
+    end component swir_row_cropper;
+
     signal config               : swir_config_t;
+    signal control_i            : swir_control_t;
     signal start_config         : std_logic;
     signal config_done          : std_logic;
     signal do_imaging           : std_logic;
     signal imaging_done         : std_logic;
+    signal pxl_available_i      : std_logic;
+    signal pixel_i              : swir_pixel_t;
+    signal samples_dropped      : unsigned(15 downto 0);
+    signal bad_pixel_column     : integer range 0 to swir_row_width-1;
+    signal bad_pixel_bad        : std_logic;
+    signal write_bad_pixel      : std_logic;
+    signal replaced_pixel       : swir_pixel_t;
+    signal replaced_available   : std_logic;
+    signal coadded_pixel        : swir_pixel_t;
+    signal coadded_available    : std_logic;
+    signal crop_start           : integer range 0 to swir_row_width-1;
+    signal crop_width           : integer range 0 to swir_row_width;
     
 begin
 
+    control <= control_i;
+    row_width <= crop_width;
+    coadd_rows <= config.coadd_rows;
+
     swir_controller_cmp : swir_controller port map (
         clock => clock,
         reset_n => reset_n,
@@ -136,11 +219,22 @@ begin
         avs_irq => avs_irq,
 
         config => config,
+        control => control_i,
         start_config => start_config,
         config_done => config_done,
 
         do_imaging => do_imaging,
-        imaging_done => imaging_done
+        imaging_done => imaging_done,
+
+        bad_pixel_column => bad_pixel_column,
+        bad_pixel_bad => bad_pixel_bad,
+        write_bad_pixel => write_bad_pixel,
+
+        crop_start => crop_start,
+        crop_width => crop_width,
+
+        pxl_available => pxl_available_i,
+        samples_dropped => samples_dropped
     );
 
     swir_subsystem_cmp : swir_subsystem port map (
@@ -148,20 +242,24 @@ begin
         reset_n => reset_n,
         
         config => config,
-        control => control,
+        control => control_i,
         start_config => start_config,
         config_done => config_done,
 
         do_imaging => do_imaging,
         imaging_done => imaging_done,
 
-        pixel => pixel,
-        pxl_available => pxl_available,
+        pixel => pixel_i,
+        pixel_available => pxl_available_i,
+        samples_dropped => samples_dropped,
         
-        sdi => sdi,
-        sdo => sdo,
+        sdi_even => sdi_even,
+        sdo_even => sdo_even,
+        cnv_even => cnv_even,
+        sdi_odd => sdi_odd,
+        sdo_odd => sdo_odd,
+        cnv_odd => cnv_odd,
         sck => sck,
-        cnv => cnv,
         
         sensor_clock_even => sensor_clock_even,
         sensor_clock_odd => sensor_clock_odd,
@@ -175,4 +273,44 @@ begin
         AD_trig_odd => AD_trig_odd
     );
 
+    swir_bad_pixel_replacer_cmp : swir_bad_pixel_replacer port map (
+        clock => clock,
+        reset_n => reset_n,
+
+        map_column => bad_pixel_column,
+        map_bad => bad_pixel_bad,
+        map_write => write_bad_pixel,
+
+        pixel_in => pixel_i,
+        pixel_in_available => pxl_available_i,
+        pixel_out => replaced_pixel,
+        pixel_out_available => replaced_available
+    );
+
+    swir_row_coadder_cmp : swir_row_coadder port map (
+        clock => clock,
+        reset_n => reset_n,
+
+        coadd_rows => config.coadd_rows,
+        start => do_imaging,
+
+        pixel_in => replaced_pixel,
+        pixel_in_available => replaced_available,
+        pixel_out => coadded_pixel,
+        pixel_out_available => coadded_available
+    );
+
+    swir_row_cropper_cmp : swir_row_cropper port map (
+        clock => clock,
+        reset_n => reset_n,
+
+        crop_start => crop_start,
+        crop_width => crop_width,
+
+        pixel_in => coadded_pixel,
+        pixel_in_available => coadded_available,
+        pixel_out => pixel,
+        pixel_out_available => pxl_available
+    );
+
 end architecture rtl;
@@ -44,6 +44,14 @@ entity vnir_controller is
         do_imaging          : out std_logic;
         imaging_done        : in  std_logic;
 
+        correction_enable   : out std_logic;
+        correction_entry    : out vnir.correction_entry_t;
+        write_correction    : out std_logic;
+
+        bad_pixel_enable    : out std_logic;
+        bad_pixel_entry     : out vnir.bad_pixel_entry_t;
+        write_bad_pixel     : out std_logic;
+
         status              : in  vnir.status_t
     );
 end entity vnir_controller;
@@ -75,6 +83,11 @@ architecture rtl of vnir_controller is
         return re;
     end function to_l32;
 
+    pure function to_l32(u : unsigned) return std_logic_vector is
+    begin
+        return std_logic_vector(resize(u, 32));
+    end function to_l32;
+
 begin
 
     process (clock, reset_n)
@@ -84,6 +97,24 @@ begin
         variable config_done_irq        : std_logic;
         variable image_config_done_irq  : std_logic;
         variable imaging_done_irq       : std_logic;
+
+        -- Performance counters, cleared by writing to x14. The pixel integrator's counts of
+        -- filtered fragments and dropped rows can't be cleared, so they're read relative to
+        -- their values when cleared
+        variable fragments_received     : unsigned(31 downto 0);
+        variable fragments_filtered_base : unsigned(31 downto 0);
+        variable rows_overflowed        : unsigned(31 downto 0);
+        variable integrator_dropped_base : unsigned(31 downto 0);
+
+        -- Column of the next correction table entry written through x1A
+        variable correction_column      : integer;
+
+        -- Extra window (3 to vnir.N_WINDOWS-1) configured through x25-x27
+        variable extra_window           : integer range 3 to vnir.MAX_WINDOWS-1;
+
+        -- Crop as written; image_config has it clamped (see vnir.crop_width)
+        variable crop_starts_reg        : vnir.crop_starts_t;
+        variable crop_widths_reg        : vnir.crop_widths_t;
     begin
         if reset_n = '0' then
             start_config        <= '0';
@@ -93,13 +124,17 @@ begin
                 window_red => (lo => 0, hi => 0),
                 window_nir => (lo => 0, hi => 0),
                 window_blue => (lo => 0, hi => 0),
+                extra_windows => (others => (lo => 0, hi => 0)),
                 flip => sensor_configurer_pkg.FLIP_NONE,
                 calibration => (v_ramp1 => 0, v_ramp2 => 0, offset => 0, adc_gain => 0)
             );
             image_config <= (
                 length => 0,
                 frame_clocks => 0,
-                exposure_clocks => 0
+                exposure_clocks => 0,
+                binning => 1,
+                crop_widths => (others => 0),
+                crop_starts => (others => 0)
             );
             config_done_reg         := '0';
             image_config_done_reg   := '0';
@@ -107,11 +142,27 @@ begin
             config_done_irq         := '0';
             image_config_done_irq   := '0';
             imaging_done_irq        := '0';
+            fragments_received      := (others => '0');
+            fragments_filtered_base := (others => '0');
+            rows_overflowed         := (others => '0');
+            integrator_dropped_base := (others => '0');
+            correction_enable       <= '0';
+            write_correction        <= '0';
+            correction_entry <= (window => 0, column => 0, dark => (others => '0'), gain => (others => '0'));
+            correction_column       := 0;
+            extra_window            := 3;
+            crop_starts_reg         := (others => 0);
+            crop_widths_reg         := (others => 0);
+            bad_pixel_enable        <= '0';
+            write_bad_pixel         <= '0';
+            bad_pixel_entry <= (window => 0, index => 0, mask => (others => '0'));
         elsif rising_edge(clock) then
             
             start_config        <= '0';
             start_image_config  <= '0';
             do_imaging          <= '0';
+            write_correction    <= '0';
+            write_bad_pixel     <= '0';
 
             if avs_write = '1' then
                 case avs_address is
@@ -130,10 +181,56 @@ begin
                 when x"0B" => image_config.length          <= read_integer(avs_writedata);
                 when x"0C" => image_config.frame_clocks    <= read_integer(avs_writedata);
                 when x"0D" => image_config.exposure_clocks <= read_integer(avs_writedata);
+                when x"1F" => image_config.binning         <= read_integer(avs_writedata);
+                when x"20" => crop_widths_reg              := (others => read_integer(avs_writedata));  -- all windows
+                when x"21" => crop_starts_reg(0)           := read_integer(avs_writedata);  -- red
+                when x"22" => crop_starts_reg(1)           := read_integer(avs_writedata);  -- NIR
+                when x"23" => crop_starts_reg(2)           := read_integer(avs_writedata);  -- blue
+                when x"28" => crop_widths_reg(0)           := read_integer(avs_writedata);  -- red
+                when x"29" => crop_widths_reg(1)           := read_integer(avs_writedata);  -- NIR
+                when x"2A" => crop_widths_reg(2)           := read_integer(avs_writedata);  -- blue
+
+                -- Extra windows, when vnir.N_WINDOWS > 3: select the window, then write
+                -- its bounds and crop start and width
+                when x"24" => if read_integer(avs_writedata) >= 3 and read_integer(avs_writedata) < vnir.N_WINDOWS then
+                                  extra_window := read_integer(avs_writedata);
+                              end if;
+                when x"25" => config.extra_windows(extra_window).lo <= read_integer(avs_writedata);
+                when x"26" => config.extra_windows(extra_window).hi <= read_integer(avs_writedata);
+                when x"27" => if extra_window < vnir.N_WINDOWS then
+                                  crop_starts_reg(extra_window) := read_integer(avs_writedata);
+                              end if;
+                when x"2B" => if extra_window < vnir.N_WINDOWS then
+                                  crop_widths_reg(extra_window) := read_integer(avs_writedata);
+                              end if;
                 
                 when x"0E" => start_config       <= '1'; config_done_reg       := '0';
                 when x"0F" => start_image_config <= '1'; image_config_done_reg := '0';
                 when x"10" => do_imaging         <= '1'; imaging_done_reg      := '0';
+
+                when x"14" => fragments_received      := (others => '0');
+                              fragments_filtered_base := status.pixel_integrator.fragments_filtered;
+                              rows_overflowed         := (others => '0');
+                              integrator_dropped_base := status.integrator_rows_dropped;
+
+                -- Correction tables: select the window and first column, then write
+                -- {dark, gain} to x1A for each column in turn
+                when x"18" => correction_entry.window      <= read_integer(avs_writedata);
+                when x"19" => correction_column            := read_integer(avs_writedata);
+                when x"1A" => correction_entry.column      <= correction_column;
+                              correction_entry.dark        <= unsigned(avs_writedata(vnir.ROW_PIXEL_BITS+15 downto 16));
+                              correction_entry.gain        <= unsigned(avs_writedata(vnir.GAIN_BITS-1 downto 0));
+                              write_correction             <= '1';
+                              correction_column            := correction_column + 1;
+                when x"1B" => correction_enable            <= avs_writedata(0);
+
+                -- Bad-pixel bitmaps: select the window, then write {fragment index, mask}
+                -- (bits 31-16 and 15-0) to x1D for each fragment
+                when x"1C" => bad_pixel_entry.window       <= read_integer(avs_writedata);
+                when x"1D" => bad_pixel_entry.index        <= to_integer(unsigned(avs_writedata(31 downto 16)));
+                              bad_pixel_entry.mask         <= avs_writedata(vnir.FRAGMENT_WIDTH-1 downto 0);
+                              write_bad_pixel              <= '1';
+                when x"1E" => bad_pixel_enable             <= avs_writedata(0);
                 
                 when others =>
                 end case;
@@ -142,10 +239,22 @@ begin
                     when x"11" => avs_readdata <= to_l32(config_done_reg);       config_done_irq        := '0';
                     when x"12" => avs_readdata <= to_l32(image_config_done_reg); image_config_done_irq  := '0';
                     when x"13" => avs_readdata <= to_l32(imaging_done_reg);      imaging_done_irq       := '0';
+                    when x"15" => avs_readdata <= to_l32(fragments_received);
+                    when x"16" => avs_readdata <= to_l32(status.pixel_integrator.fragments_filtered - fragments_filtered_base);
+                    when x"17" => avs_readdata <= to_l32(rows_overflowed);
+                    -- Rows dropped by pixel_integrator_spill (always 0 with the on-chip integrator)
+                    when x"2C" => avs_readdata <= to_l32(status.integrator_rows_dropped - integrator_dropped_base);
                     when others =>
                 end case;
             end if;
 
+            -- The crop must be whole fragments within the binned row, or row_cropper would pass on
+            -- rows of a different width than the SDRAM subsystem expects, or never end them
+            for w in 0 to vnir.N_WINDOWS-1 loop
+                image_config.crop_starts(w) <= vnir.crop_start(crop_starts_reg(w), crop_widths_reg(w), image_config.binning);
+                image_config.crop_widths(w) <= vnir.crop_width(crop_starts_reg(w), crop_widths_reg(w), image_config.binning);
+            end loop;
+
             if config_done = '1' then
                 config_done_reg := '1';
                 config_done_irq := '1';
@@ -161,6 +270,14 @@ begin
                 imaging_done_irq := '1';
             end if;
 
+            if status.pixel_integrator.fragment_available = '1' then
+                fragments_received := fragments_received + 1;
+            end if;
+
+            if status.row_overflow = '1' then
+                rows_overflowed := rows_overflowed + 1;
+            end if;
+
         end if;
 
         avs_irq <= config_done_irq or image_config_done_irq or imaging_done_irq;
@@ -25,6 +25,8 @@ use ieee.numeric_std.all;
 use work.spi_types.all;
 use work.vnir;
 use work.sensor_configurer_defaults;
+use work.sdram;
+use work.custom_master_pkg.all;
 
 entity vnir_subsystem_avalonmm is
 generic (
@@ -33,7 +35,10 @@ generic (
     POWER_ON_DELAY_us   : integer := sensor_configurer_defaults.POWER_ON_DELAY_us;
     CLOCK_ON_DELAY_us   : integer := sensor_configurer_defaults.CLOCK_ON_DELAY_us;
     RESET_OFF_DELAY_us  : integer := sensor_configurer_defaults.RESET_OFF_DELAY_us;
-    SPI_SETTLE_us       : integer := sensor_configurer_defaults.SPI_SETTLE_us
+    SPI_SETTLE_us       : integer := sensor_configurer_defaults.SPI_SETTLE_us;
+
+    PARALLEL_ROW        : boolean := true;
+    INTEGRATOR          : string := "SINGLE"
 );
 port (
     clock               : in std_logic;
@@ -53,13 +58,26 @@ port (
 
     row                 : out vnir.row_t;
     row_available       : out vnir.row_type_t;
+
+    row_fragment            : out vnir.row_fragment_t;
+    row_fragment_available  : out vnir.row_type_t;
+    row_fragment_first      : out std_logic;
+    row_fragment_last       : out std_logic;
+    row_fragment_ready      : in std_logic := '1';
+    row_widths              : out vnir.crop_widths_t;
     
     spi_out             : out spi_from_master_t;
     spi_in              : in spi_to_master_t;
     
     frame_request       : out std_logic;
     exposure_start      : out std_logic;
-    lvds                : in vnir.lvds_t
+    lvds                : in vnir.lvds_t;
+
+    scratch_base        : in sdram.address_t := (others => '0');
+    read_master_in      : in from_read_master_t := FROM_READ_MASTER_IDLE;
+    read_master_out     : out to_read_master_t;
+    write_master_in     : in from_master_t := FROM_MASTER_IDLE;
+    write_master_out    : out to_master_t
 );
 end entity vnir_subsystem_avalonmm;
 
@@ -89,6 +107,14 @@ architecture rtl of vnir_subsystem_avalonmm is
         do_imaging          : out std_logic;
         imaging_done        : in  std_logic;
 
+        correction_enable   : out std_logic;
+        correction_entry    : out vnir.correction_entry_t;
+        write_correction    : out std_logic;
+
+        bad_pixel_enable    : out std_logic;
+        bad_pixel_entry     : out vnir.bad_pixel_entry_t;
+        write_bad_pixel     : out std_logic;
+
         status              : in  vnir.status_t
     );
     end component vnir_controller;
@@ -100,7 +126,10 @@ architecture rtl of vnir_subsystem_avalonmm is
         POWER_ON_DELAY_us   : integer := POWER_ON_DELAY_us;
         CLOCK_ON_DELAY_us   : integer := CLOCK_ON_DELAY_us;
         RESET_OFF_DELAY_us  : integer := RESET_OFF_DELAY_us;
-        SPI_SETTLE_us       : integer := SPI_SETTLE_us
+        SPI_SETTLE_us       : integer := SPI_SETTLE_us;
+
+        PARALLEL_ROW        : boolean := PARALLEL_ROW;
+        INTEGRATOR          : string := INTEGRATOR
     );
     port (
         clock               : in std_logic;
@@ -124,6 +153,21 @@ architecture rtl of vnir_subsystem_avalonmm is
     
         row                 : out vnir.row_t;
         row_available       : out vnir.row_type_t;
+
+        correction_enable   : in std_logic;
+        correction_entry    : in vnir.correction_entry_t;
+        write_correction    : in std_logic;
+
+        bad_pixel_enable    : in std_logic;
+        bad_pixel_entry     : in vnir.bad_pixel_entry_t;
+        write_bad_pixel     : in std_logic;
+
+        row_fragment            : out vnir.row_fragment_t;
+        row_fragment_available  : out vnir.row_type_t;
+        row_fragment_first      : out std_logic;
+        row_fragment_last       : out std_logic;
+        row_fragment_ready      : in std_logic;
+        row_widths              : out vnir.crop_widths_t;
         
         spi_out             : out spi_from_master_t;
         spi_in              : in spi_to_master_t;
@@ -131,6 +175,12 @@ architecture rtl of vnir_subsystem_avalonmm is
         frame_request       : out std_logic;
         exposure_start      : out std_logic;
         lvds                : in vnir.lvds_t;
+
+        scratch_base        : in sdram.address_t;
+        read_master_in      : in from_read_master_t;
+        read_master_out     : out to_read_master_t;
+        write_master_in     : in from_master_t;
+        write_master_out    : out to_master_t;
     
         status              : out vnir.status_t
     );
@@ -144,6 +194,12 @@ architecture rtl of vnir_subsystem_avalonmm is
     signal image_config_done    : std_logic;
     signal do_imaging           : std_logic;
     signal imaging_done         : std_logic;
+    signal correction_enable    : std_logic;
+    signal correction_entry     : vnir.correction_entry_t;
+    signal write_correction     : std_logic;
+    signal bad_pixel_enable     : std_logic;
+    signal bad_pixel_entry      : vnir.bad_pixel_entry_t;
+    signal write_bad_pixel      : std_logic;
     signal status               : vnir.status_t;
 
 begin
@@ -169,6 +225,14 @@ begin
         do_imaging => do_imaging,
         imaging_done => imaging_done,
 
+        correction_enable => correction_enable,
+        correction_entry => correction_entry,
+        write_correction => write_correction,
+
+        bad_pixel_enable => bad_pixel_enable,
+        bad_pixel_entry => bad_pixel_entry,
+        write_bad_pixel => write_bad_pixel,
+
         status => status
     );
 
@@ -194,6 +258,21 @@ begin
 
         row => row,
         row_available => row_available,
+
+        correction_enable => correction_enable,
+        correction_entry => correction_entry,
+        write_correction => write_correction,
+
+        bad_pixel_enable => bad_pixel_enable,
+        bad_pixel_entry => bad_pixel_entry,
+        write_bad_pixel => write_bad_pixel,
+
+        row_fragment => row_fragment,
+        row_fragment_available => row_fragment_available,
+        row_fragment_first => row_fragment_first,
+        row_fragment_last => row_fragment_last,
+        row_fragment_ready => row_fragment_ready,
+        row_widths => row_widths,
         
         spi_out => spi_out,
         spi_in => spi_in,
@@ -202,6 +281,12 @@ begin
         exposure_start => exposure_start,
         lvds => lvds,
 
+        scratch_base => scratch_base,
+        read_master_in => read_master_in,
+        read_master_out => read_master_out,
+        write_master_in => write_master_in,
+        write_master_out => write_master_out,
+
         status => status
     );
 
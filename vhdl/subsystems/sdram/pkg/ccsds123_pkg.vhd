@@ -0,0 +1,82 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Parameters of the CCSDS-123.0-B-1 lossless compressor (see `ccsds123_compressor`), shared with
+-- the header creator so the header always describes what the compressor actually does.
+package ccsds123 is
+    --Largest dynamic range (D) of any sensor: 10 bits for VNIR, 16 for SWIR
+    constant MAX_DYNAMIC_RANGE          : integer := 16;
+
+    --Predictor parameters. Only P = 0 (no spectral bands used for prediction) in reduced mode is
+    --implemented, so the weight parameters below don't affect the output; they are still written to
+    --the header, so they have to be valid values
+    constant PREDICTION_BANDS           : integer := 0;     -- P
+    constant WEIGHT_RESOLUTION          : integer := 13;    -- Omega
+    constant REGISTER_SIZE              : integer := 32;    -- R
+    constant WEIGHT_INTERVAL_EXPONENT   : integer := 6;     -- log2(t_inc)
+    constant WEIGHT_EXPONENT_MIN        : integer := -1;    -- nu_min
+    constant WEIGHT_EXPONENT_MAX        : integer := 3;     -- nu_max
+
+    --Sample-adaptive entropy coder parameters
+    constant UNARY_LENGTH_LIMIT         : integer := 16;    -- U_max
+    constant RESCALING_COUNTER_SIZE     : integer := 6;     -- gamma*
+    constant INITIAL_COUNT_EXPONENT     : integer := 1;     -- gamma_0
+    constant ACCUMULATOR_INIT_CONSTANT  : integer := 4;     -- K
+
+    --Longest codeword the entropy coder can emit
+    constant MAX_CODEWORD_BITS          : integer := UNARY_LENGTH_LIMIT + MAX_DYNAMIC_RANGE;
+
+    constant PREDICTOR_METADATA_LENGTH  : integer := 40;
+    constant ENTROPY_METADATA_LENGTH    : integer := 16;
+
+    --Header fields (Predictor Metadata, and Entropy Coder Metadata for the sample-adaptive coder)
+    function predictor_metadata return std_logic_vector;
+    function entropy_metadata return std_logic_vector;
+end package ccsds123;
+
+package body ccsds123 is
+    function predictor_metadata return std_logic_vector is
+    begin
+        return "00" &                                                           --Reserved (2 bits)
+               std_logic_vector(to_unsigned(PREDICTION_BANDS, 4)) &             --Number of Prediction Bands (4 bits)
+               '1' &                                                            --Prediction Mode [reduced] (1 bit)
+               '0' &                                                            --Reserved (1 bit)
+               '0' &                                                            --Local Sum Type [neighbor-oriented] (1 bit)
+               '0' &                                                            --Reserved (1 bit)
+               std_logic_vector(to_unsigned(REGISTER_SIZE mod 64, 6)) &         --Register Size (6 bits)
+               std_logic_vector(to_unsigned(WEIGHT_RESOLUTION - 4, 4)) &        --Weight Component Resolution (4 bits)
+               std_logic_vector(to_unsigned(WEIGHT_INTERVAL_EXPONENT - 4, 4)) & --Weight Update Change Interval (4 bits)
+               std_logic_vector(to_unsigned(WEIGHT_EXPONENT_MIN + 6, 4)) &      --Weight Update Initial Parameter (4 bits)
+               std_logic_vector(to_unsigned(WEIGHT_EXPONENT_MAX + 6, 4)) &      --Weight Update Final Parameter (4 bits)
+               '0' &                                                            --Reserved (1 bit)
+               '0' &                                                            --Weight Initialization Method [default] (1 bit)
+               '0' &                                                            --Weight Initialization Table Flag (1 bit)
+               "00000";                                                         --Weight Initialization Resolution (5 bits)
+    end function predictor_metadata;
+
+    function entropy_metadata return std_logic_vector is
+    begin
+        return std_logic_vector(to_unsigned(UNARY_LENGTH_LIMIT mod 32, 5)) &    --Unary Length Limit (5 bits)
+               std_logic_vector(to_unsigned(RESCALING_COUNTER_SIZE - 4, 3)) &   --Rescaling Counter Size (3 bits)
+               std_logic_vector(to_unsigned(INITIAL_COUNT_EXPONENT mod 8, 3)) & --Initial Count Exponent (3 bits)
+               std_logic_vector(to_unsigned(ACCUMULATOR_INIT_CONSTANT, 4)) &    --Accumulator Initialization Constant (4 bits)
+               '0';                                                             --Accumulator Initialization Table Flag (1 bit)
+    end function entropy_metadata;
+end package body ccsds123;
@@ -37,5 +37,34 @@ package custom_master_pkg is
         user_buffer_full         : std_logic;
     end record from_master_t;
 
+    -- Read master (custom_master with MASTER_DIRECTION = 0 and BURST_CAPABLE = 1)
+    type to_read_master_t is record
+        control_fixed_location   : std_logic;
+        control_read_length      : std_logic_vector(sdram.ADDRESS_LENGTH-1 downto 0);
+        control_read_base        : std_logic_vector(sdram.ADDRESS_LENGTH-1 downto 0);
+        control_go               : std_logic;
+        user_read_buffer         : std_logic;
+    end record to_read_master_t;
+
+    type from_read_master_t is record
+        control_done             : std_logic;
+        user_buffer_data         : std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+        user_data_available      : std_logic;
+    end record from_read_master_t;
+
+    -- An idle master, for the ports of one that isn't connected
+    constant TO_MASTER_IDLE : to_master_t := (
+        control_fixed_location => '0', control_write_length => (others => '0'), control_write_base => (others => '0'),
+        control_go => '0', user_write_buffer => '0', user_buffer_data => (others => '0')
+    );
+    constant FROM_MASTER_IDLE : from_master_t := (control_done => '1', user_buffer_full => '0');
+    constant TO_READ_MASTER_IDLE : to_read_master_t := (
+        control_fixed_location => '0', control_read_length => (others => '0'), control_read_base => (others => '0'),
+        control_go => '0', user_read_buffer => '0'
+    );
+    constant FROM_READ_MASTER_IDLE : from_read_master_t := (
+        control_done => '1', user_buffer_data => (others => '0'), user_data_available => '0'
+    );
+
 end package custom_master_pkg;
 
@@ -19,24 +19,39 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.swir_types;
+use work.vnir;
 
 package img_buffer_pkg is
-    --Generating 1 buffer for each, allowing for storage of up to 1 row
-    --Do not change the number of fifos, as the logic to handle them is written for these numbers, ie. 1 fifo per row type
+    --Generating 1 buffer for each row type
+    --Do not change the number of SWIR fifos, as the logic to handle them is written for 1 fifo. There is
+    --one VNIR fifo per window (red, blue, NIR and any extra bands), indexed by sdram.vnir_index
     constant NUM_SWIR_ROW_FIFO : integer := 1;  
-    constant NUM_VNIR_ROW_FIFO : integer := 3;  -- needs 3 fifos for the 3 sensors (red, blue and NIR)
+    constant NUM_VNIR_ROW_FIFO : integer := vnir.N_WINDOWS;
 
     constant FIFO_WORD_LENGTH : integer := 128;  
     constant FIFO_WORD_BYTES : integer := FIFO_WORD_LENGTH/8;  -- for command creator
 
-    --Number of words in swir and vnir fifo
-    --Changing these requires changes to the VNIR and SWIR row fifo IPs. Specifically, change lpm_numwords
-    constant VNIR_FIFO_DEPTH : integer := 160;  
-    constant SWIR_FIFO_DEPTH : integer := 64;   
+    --Number of words in a full swir and vnir row (160 and 64 with 10 b/px for vnir and 16 b/px for swir).
+    --A vnir row's pixels are packed back to back, so ROW_PIXEL_BITS can be anything up to 16, with the last
+    --word of the row padded with zeros
+    constant VNIR_FIFO_DEPTH : integer := (vnir.ROW_WIDTH * vnir.ROW_PIXEL_BITS + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH;
+    constant SWIR_FIFO_DEPTH : integer := swir_types.swir_row_width * swir_types.swir_pixel_bits / FIFO_WORD_LENGTH;
 
-    --
-    constant VNIR_ROW_BYTES  : integer := FIFO_WORD_BYTES * VNIR_FIFO_DEPTH;
-    constant SWIR_ROW_BYTES  : integer := FIFO_WORD_BYTES * SWIR_FIFO_DEPTH;
+    --Words of the trailer following each row (see sdram.row_metadata_t), which are counted in the
+    --row's size in memory
+    constant ROW_TRAILER_WORDS : integer := 1;
+
+    --Default number of rows each VNIR fifo can hold. Rows past this are dropped (and counted)
+    --rather than overwriting the rows still waiting on the SDRAM
+    constant VNIR_BUFFER_ROWS : integer := 4;
+
+    --Default number of rows the SWIR fifo can hold. With two, a row can be sent while the next
+    --one is coming in, even if the pixels come in back-to-back
+    constant SWIR_BUFFER_ROWS : integer := 2;
+
+    --Bytes taken in memory by a full row, including its trailer
+    constant VNIR_ROW_BYTES  : integer := FIFO_WORD_BYTES * (VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS);
+    constant SWIR_ROW_BYTES  : integer := FIFO_WORD_BYTES * (SWIR_FIFO_DEPTH + ROW_TRAILER_WORDS);
 
     --vnir & swir row fragments are split into their respective FIFO word lengths
     subtype row_fragment_t is std_logic_vector (FIFO_WORD_LENGTH-1 downto 0);
@@ -45,15 +60,26 @@ package img_buffer_pkg is
     type vnir_link_a is array (0 to NUM_VNIR_ROW_FIFO-1) of row_fragment_t;
     type swir_link_a is array (0 to NUM_SWIR_ROW_FIFO-1) of row_fragment_t;
 
-    type vnir_row_fragment_a is array (0 to VNIR_FIFO_DEPTH-1) of row_fragment_t;
-    type swir_row_fragment_a is array (0 to SWIR_FIFO_DEPTH-1) of row_fragment_t;
+    --Fragments coming in from the VNIR subsystem are packed into fifo words by a gearbox that can hold a
+    --word and a fragment
+    constant VNIR_BEAT_BITS : integer := vnir.FRAGMENT_WIDTH * vnir.ROW_PIXEL_BITS;
+    constant GEARBOX_BITS : integer := FIFO_WORD_LENGTH + VNIR_BEAT_BITS;
 
-    type row_type_tracker_a is array (0 to NUM_VNIR_ROW_FIFO-1) of std_logic;
-    type row_buffer_a is array (0 to NUM_VNIR_ROW_FIFO-1) of vnir_row_fragment_a;
-    type frag_count_a is array (0 to NUM_VNIR_ROW_FIFO-1) of natural range 0 to VNIR_FIFO_DEPTH;
+    type row_count_a is array (0 to NUM_VNIR_ROW_FIFO-1) of natural;
 
     subtype swir_pixel_stdlogicvector_t is std_logic_vector(0 to swir_types.SWIR_PIXEL_BITS-1);
 
+    --Size of a VNIR row of row_width pixels (less than vnir.ROW_WIDTH when the row is binned or cropped),
+    --padded to a whole number of fifo words by the gearbox. The words are the row's data, the bytes
+    --its size in memory, including its trailer
+    function vnir_row_words(row_width : integer) return integer;
+    function vnir_row_bytes(row_width : integer) return integer;
+
+    --Size of a SWIR row of row_width pixels (less than swir_row_width when the row is cropped), which
+    --must be a whole number of fifo words. As for VNIR rows, the bytes include the trailer
+    function swir_row_words(row_width : integer) return integer;
+    function swir_row_bytes(row_width : integer) return integer;
+
     -- functions for converting from swir pixel to std_logic_vector and back
     function swir_pixel_to_stdlogicvector(px_in : swir_types.swir_pixel_t) return swir_pixel_stdlogicvector_t;
     function stdlogicvector_to_swir_pixel(stdlogicvect_in : swir_pixel_stdlogicvector_t) return swir_types.swir_pixel_t;
@@ -62,6 +88,26 @@ end package img_buffer_pkg;
 
 package body img_buffer_pkg is
 
+    function vnir_row_words(row_width : integer) return integer is
+    begin
+        return (row_width * vnir.ROW_PIXEL_BITS + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH;
+    end function;
+
+    function vnir_row_bytes(row_width : integer) return integer is
+    begin
+        return FIFO_WORD_BYTES * (vnir_row_words(row_width) + ROW_TRAILER_WORDS);
+    end function;
+
+    function swir_row_words(row_width : integer) return integer is
+    begin
+        return row_width * swir_types.SWIR_PIXEL_BITS / FIFO_WORD_LENGTH;
+    end function;
+
+    function swir_row_bytes(row_width : integer) return integer is
+    begin
+        return FIFO_WORD_BYTES * (swir_row_words(row_width) + ROW_TRAILER_WORDS);
+    end function;
+
     function swir_pixel_to_stdlogicvector(px_in : swir_types.swir_pixel_t) return swir_pixel_stdlogicvector_t is
         variable stdlogicvect_out : swir_pixel_stdlogicvector_t;
     begin
@@ -19,11 +19,15 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 use work.vnir;
+use work.fpga.capture_time_t;
 
 package sdram is
     --An SDRAM Address is a 29 bit signed, any negative addresses are invalid
     constant ADDRESS_LENGTH : integer := 32;
-    constant HEADER_LENGTH  : integer := 160;
+    constant HEADER_LENGTH  : integer := 224;
+    --The trailers are a 128 bit word of image status, then for VNIR each band's row width followed by
+    --the rows of the bands past the first three (16 bits each), padded to whole 128 bit words
+    constant TRAILER_LENGTH : integer := 128 + (32 * vnir.N_WINDOWS - 48 + 127) / 128 * 128;
 
     --Creating the address type, a signed that shows a invalid address if negative
     subtype address_t is signed (ADDRESS_LENGTH-1 downto 0);
@@ -32,12 +36,38 @@ package sdram is
     --A header type that stores the headers as a std_logic_vector
     subtype header_t is std_logic_vector (HEADER_LENGTH-1 downto 0);
 
+    --A trailer type, written after the last row of each image
+    subtype trailer_t is std_logic_vector (TRAILER_LENGTH-1 downto 0);
+
+    --Image catalog, kept at the top of the FPGA's memory. Each image adds a VNIR and a SWIR entry,
+    --wrapping around after CATALOG_ENTRIES entries
+    constant CATALOG_ENTRIES        : integer := 64;
+    constant CATALOG_ENTRY_LENGTH   : integer := 256;
+    subtype catalog_entry_t is std_logic_vector (CATALOG_ENTRY_LENGTH-1 downto 0);
+
     --Address block for the MPU to specify block of changed RAM
     type address_block_t is array (0 to 1) of address_t;
     
     --Enumerators for both the errors and row types
     type error_t is (no_error, full, mpu_check_failed);
-    type row_type_t is (ROW_NONE, ROW_BLUE, ROW_RED, ROW_NIR, ROW_SWIR);
+    --ROW_BAND3 to ROW_BAND7 are the extra VNIR windows 3 to 7, when vnir.N_WINDOWS > 3
+    type row_type_t is (ROW_NONE, ROW_BLUE, ROW_RED, ROW_NIR,
+                        ROW_BAND3, ROW_BAND4, ROW_BAND5, ROW_BAND6, ROW_BAND7, ROW_SWIR);
+
+    --Every row is followed in memory by a one-word trailer describing it, filled in by the imaging
+    --buffer as the row comes in. Gaps in a band's row_index show where rows were dropped, so the rest
+    --of the image can still be used. Packed by row_trailer as capture_time (bits 127-64), row_index
+    --(63-32), band (31-24, row_type_t'pos), dropped (23-8) and flags (7-0, bit 0 set for compressed)
+    constant ROW_TRAILER_LENGTH : integer := 128;
+    subtype row_trailer_t is std_logic_vector (ROW_TRAILER_LENGTH-1 downto 0);
+
+    type row_metadata_t is record
+        capture_time: capture_time_t;           --clock cycles since reset when the row's first pixel came in
+        row_index   : unsigned(31 downto 0);    --rows of the band that came in before this one since reset
+        band        : row_type_t;
+        dropped     : unsigned(15 downto 0);    --rows of any band dropped by the imaging buffer since reset
+        compressed  : std_logic;                --the row holds part of its band's compressed bitstream
+    end record row_metadata_t;
 
     type config_to_sdram_t is record
         memory_base     : address_t;
@@ -56,9 +86,38 @@ package sdram is
         swir        : partition_t;
         vnir_temp   : partition_t;
         swir_temp   : partition_t;
+        scratch_base  : address_t;  -- start of the VNIR subsystem's scratch space, up to catalog_base
+        catalog_base  : address_t;  -- address of catalog entry 0
+        catalog_count : natural;    -- entries written so far; entry n is at index n mod CATALOG_ENTRIES
     end record memory_state_t;
 
+    --Performance counters, read through the SDRAM controller to find where throughput is lost.
+    --They count from reset (or from the last clear) and wrap around
+    type row_counter_a is array (ROW_BLUE to ROW_SWIR) of unsigned(31 downto 0);
+    type row_high_water_a is array (ROW_BLUE to ROW_SWIR) of natural;
+
+    type perf_counters_t is record
+        rows_received   : row_counter_a;        -- rows coming into the imaging buffer, dropped or not
+        rows_dropped    : unsigned(31 downto 0);
+        rows_high_water : row_high_water_a;     -- most rows each imaging buffer fifo has held at once
+        write_cycles    : unsigned(31 downto 0); -- clock cycles the master spent writing a command
+        wait_cycles     : unsigned(31 downto 0); -- clock cycles command_creator spent waiting for a row
+    end record perf_counters_t;
+
     function sdram_type (row_type : in vnir.row_type_t) return row_type_t;
+
+    --Index of each VNIR band in the imaging buffer and compressor: 0 for red, 1 for blue, 2 for NIR
+    --and k for band k. vnir_index returns -1 for ROW_NONE and ROW_SWIR
+    function vnir_index (row_type : in row_type_t) return integer;
+    function vnir_type (index : in integer) return row_type_t;
+
+    --Pixels per row of each VNIR band, indexed by vnir_index, and the same from the row widths of
+    --the VNIR windows (see vnir.row_widths)
+    type vnir_row_widths_t is array (0 to vnir.N_WINDOWS-1) of natural;
+    function vnir_row_widths (window_widths : in vnir.crop_widths_t) return vnir_row_widths_t;
+
+    function row_trailer (metadata : in row_metadata_t) return row_trailer_t;
+    function row_metadata (trailer : in row_trailer_t) return row_metadata_t;
 end package sdram;
 
 package body sdram is
@@ -71,8 +130,77 @@ package body sdram is
                 return ROW_BLUE;
             when vnir.ROW_NIR =>
                 return ROW_NIR;
+            when vnir.ROW_BAND3 =>
+                return ROW_BAND3;
+            when vnir.ROW_BAND4 =>
+                return ROW_BAND4;
+            when vnir.ROW_BAND5 =>
+                return ROW_BAND5;
+            when vnir.ROW_BAND6 =>
+                return ROW_BAND6;
+            when vnir.ROW_BAND7 =>
+                return ROW_BAND7;
             when vnir.ROW_NONE =>
                 return ROW_NONE;
         end case;
     end function;
+
+    function vnir_index (row_type : in row_type_t) return integer is
+    begin
+        case row_type is
+            when ROW_RED    => return 0;
+            when ROW_BLUE   => return 1;
+            when ROW_NIR    => return 2;
+            when ROW_BAND3  => return 3;
+            when ROW_BAND4  => return 4;
+            when ROW_BAND5  => return 5;
+            when ROW_BAND6  => return 6;
+            when ROW_BAND7  => return 7;
+            when others     => return -1;
+        end case;
+    end function;
+
+    function vnir_type (index : in integer) return row_type_t is
+    begin
+        case index is
+            when 0      => return ROW_RED;
+            when 1      => return ROW_BLUE;
+            when 2      => return ROW_NIR;
+            when 3      => return ROW_BAND3;
+            when 4      => return ROW_BAND4;
+            when 5      => return ROW_BAND5;
+            when 6      => return ROW_BAND6;
+            when 7      => return ROW_BAND7;
+            when others => return ROW_NONE;
+        end case;
+    end function;
+
+    function vnir_row_widths (window_widths : in vnir.crop_widths_t) return vnir_row_widths_t is
+        variable widths : vnir_row_widths_t;
+    begin
+        for w in window_widths'range loop
+            widths(vnir_index(sdram_type(vnir.row_type(w)))) := window_widths(w);
+        end loop;
+        return widths;
+    end function;
+
+    function row_trailer (metadata : in row_metadata_t) return row_trailer_t is
+    begin
+        return std_logic_vector(metadata.capture_time) &
+               std_logic_vector(metadata.row_index) &
+               std_logic_vector(to_unsigned(row_type_t'pos(metadata.band), 8)) &
+               std_logic_vector(metadata.dropped) &
+               "0000000" & metadata.compressed;
+    end function;
+
+    function row_metadata (trailer : in row_trailer_t) return row_metadata_t is
+        variable metadata : row_metadata_t;
+    begin
+        metadata.capture_time := unsigned(trailer(127 downto 64));
+        metadata.row_index := unsigned(trailer(63 downto 32));
+        metadata.band := row_type_t'val(to_integer(unsigned(trailer(31 downto 24))));
+        metadata.dropped := unsigned(trailer(23 downto 8));
+        metadata.compressed := trailer(0);
+        return metadata;
+    end function;
 end package body;
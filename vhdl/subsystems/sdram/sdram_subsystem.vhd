@@ -20,26 +20,59 @@ use ieee.numeric_std.all;
 
 use work.sdram;
 use work.img_buffer_pkg.all;
+use work.custom_master_pkg.all;
 use work.vnir;
 use work.swir_types.all;
 use work.fpga.timestamp_t;
 
 
 entity sdram_subsystem is
+    generic (
+        SCRATCH_ADDRESSES   : natural := 0      -- scratch space for the VNIR subsystem (see `memory_map`)
+    );
     port (
         --Control signals
         clock               : in std_logic;
         reset_n             : in std_logic;
 
-        --VNIR row signals
-        vnir_row_available  : in vnir.row_type_t;
-        vnir_row            : in vnir.row_t;
+        --VNIR row signals, as a stream of fragments (there's no parallel-row input)
+        vnir_fragment_available : in vnir.row_type_t;
+        vnir_fragment       : in vnir.row_fragment_t;
+        vnir_fragment_first : in std_logic;
+        vnir_fragment_last  : in std_logic;
+        vnir_fragment_ready : out std_logic;
         vnir_num_rows       : in integer;
+        vnir_row_widths     : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);   -- pixels per row of each VNIR band, fewer when binned or cropped
         
         --SWIR row signals
         swir_pxl_available  : in std_logic;
         swir_pixel          : in swir_pixel_t;
         swir_num_rows       : in integer;
+        swir_row_pixels     : in integer := swir_row_width;   -- pixels per SWIR row, fewer when cropped
+        swir_coadd_rows     : in integer range 1 to swir_max_coadd_rows := 1;  -- SWIR rows co-added into each one
+
+        --Compression of the next image (see `ccsds123_compressor`)
+        compress            : in std_logic;
+        compress_overflow   : out std_logic;        -- vnir_compress_overflow or swir_compress_overflow
+        vnir_compress_overflow : out std_logic;     -- each sensor's current or last image didn't fit once compressed
+        swir_compress_overflow : out std_logic;
+
+        --Read-back of images (see `read_back_engine`)
+        readback_base       : in sdram.address_t;
+        readback_end        : in sdram.address_t;
+        readback_start      : in std_logic;
+        readback_catalog_index : in natural;
+        readback_catalog_start : in std_logic;
+        readback_data       : out std_logic_vector(31 downto 0);
+        readback_valid      : out std_logic;
+        readback_read       : in std_logic;
+        readback_busy       : out std_logic;
+        read_master_in      : in from_read_master_t;
+        read_master_out     : out to_read_master_t;
+
+        --Writes of rows, headers, trailers and catalog entries (see `command_creator`)
+        write_master_in     : in from_master_t;
+        write_master_out    : out to_master_t;
         
         timestamp           : in timestamp_t;
         mpu_memory_change   : in sdram.address_block_t;
@@ -48,10 +81,16 @@ entity sdram_subsystem is
 
         config_out          : out sdram.memory_state_t;
         config_done         : out std_logic;
-        img_config_done     : out std_logic;
+        img_config_done     : out std_logic;        -- vnir_img_config_done or swir_img_config_done
+        vnir_img_config_done : out std_logic;       -- each sensor's image is configured (see `memory_map`)
+        swir_img_config_done : out std_logic;
         
         sdram_busy          : out std_logic;
-        sdram_error         : out sdram.error_t
+        sdram_error         : out sdram.error_t;
+
+        --Performance counters (see `imaging_buffer` and `command_creator`)
+        perf_clear          : in std_logic := '0';
+        perf_counters       : out sdram.perf_counters_t
         );
 end entity sdram_subsystem;
 
@@ -60,33 +99,111 @@ architecture rtl of sdram_subsystem is
     --header_creator <==> command_creator
     signal vnir_header : sdram.header_t;
     signal swir_header : sdram.header_t;
+    signal vnir_trailer : sdram.trailer_t;
+    signal swir_trailer : sdram.trailer_t;
+    signal vnir_catalog_entry : sdram.catalog_entry_t;
+    signal swir_catalog_entry : sdram.catalog_entry_t;
 
-    --imaging_buffer <==> command_creator
+    --imaging_buffer, ccsds123_compressor ==> header_creator
+    signal rows_dropped         : unsigned(31 downto 0);
+    signal vnir_rows_written    : row_count_a;
+    signal swir_rows_written    : natural;
+    signal compressing          : std_logic;
+    signal vnir_overflow_i      : std_logic;
+    signal swir_overflow_i      : std_logic;
+
+    --imaging_buffer <==> ccsds123_compressor
+    signal buffer_frag          : row_fragment_t;
+    signal buffer_row_req       : std_logic;
+    signal buffer_transmitting  : std_logic;
+    signal buffer_row_type      : sdram.row_type_t;
+    signal buffer_vnir_dropped  : std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+    signal buffer_swir_dropped  : std_logic;
+
+    --ccsds123_compressor <==> command_creator
     signal row_frag     : row_fragment_t;
     signal next_row_req : std_logic;
     signal transmitting : std_logic;
 
-    --imaging_buffer <==> memory_map
+    --ccsds123_compressor <==> memory_map
     signal next_row_type : sdram.row_type_t;
+    signal vnir_row_dropped : std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+    signal swir_row_dropped : std_logic;
 
     --command_creator <==> memory_map
     signal address : sdram.address_t;
+    signal vnir_header_address  : sdram.address_t;
+    signal swir_header_address  : sdram.address_t;
+    signal vnir_trailer_address : sdram.address_t;
+    signal swir_trailer_address : sdram.address_t;
+    signal vnir_catalog_address : sdram.address_t;
+    signal swir_catalog_address : sdram.address_t;
+
+    --memory_map ==> header_creator
+    signal vnir_end_address     : sdram.address_t;
+    signal swir_end_address     : sdram.address_t;
 
     --header_creator <==> memory_map
     signal img_config_done_i : std_logic;
+    signal vnir_img_config_done_i : std_logic;
+    signal swir_img_config_done_i : std_logic;
+
+    --memory_map ==> read_back_engine
+    signal memory_state : sdram.memory_state_t;
 
 begin
     imaging_buffer_component : entity work.imaging_buffer port map(
         clock               => clock,                   -- external input
         reset_n             => reset_n,                 -- external input
-        vnir_row            => vnir_row,                -- external input
-        vnir_row_ready      => vnir_row_available,      -- external input
+        vnir_fragment       => vnir_fragment,           -- external input
+        vnir_fragment_available => vnir_fragment_available, -- external input
+        vnir_fragment_first => vnir_fragment_first,     -- external input
+        vnir_fragment_last  => vnir_fragment_last,      -- external input
+        vnir_fragment_ready => vnir_fragment_ready,     -- external output
+        vnir_row_widths     => vnir_row_widths,         -- external input
+        swir_row_pixels     => swir_row_pixels,         -- external input
         swir_pixel          => swir_pixel,              -- external input
         swir_pixel_ready    => swir_pxl_available,      -- external input
-        row_request         => next_row_req,            -- imaging_buffer <==  command_creator
-        fragment_out        => row_frag,                -- imaging_buffer  ==> command_creator
-        fragment_type       => next_row_type,           -- imaging_buffer  ==> command_creator
-        transmitting        => transmitting             -- imaging_buffer  ==> command_creator
+        row_request         => buffer_row_req,          -- imaging_buffer <==  ccsds123_compressor
+        fragment_out        => buffer_frag,             -- imaging_buffer  ==> ccsds123_compressor
+        fragment_type       => buffer_row_type,         -- imaging_buffer  ==> ccsds123_compressor
+        transmitting        => buffer_transmitting,     -- imaging_buffer  ==> ccsds123_compressor
+        overflow_count      => rows_dropped,            -- imaging_buffer  ==> perf_counters
+        vnir_row_dropped    => buffer_vnir_dropped,     -- imaging_buffer  ==> ccsds123_compressor, header_creator
+        swir_row_dropped    => buffer_swir_dropped,     -- imaging_buffer  ==> ccsds123_compressor, header_creator
+        perf_clear          => perf_clear,              -- external input
+        rows_received       => perf_counters.rows_received,   -- external output
+        rows_high_water     => perf_counters.rows_high_water  -- external output
+    );
+
+    compressor_component : entity work.ccsds123_compressor port map(
+        clock               => clock,                   -- external input
+        reset_n             => reset_n,                 -- external input
+        compress            => compress,                -- external input
+        vnir_img_config_done => vnir_img_config_done_i, -- memory_map      ==> ccsds123_compressor
+        swir_img_config_done => swir_img_config_done_i, -- memory_map      ==> ccsds123_compressor
+        vnir_num_rows       => vnir_num_rows,           -- external input
+        vnir_row_widths     => vnir_row_widths,         -- external input
+        swir_row_pixels     => swir_row_pixels,         -- external input
+        swir_num_rows       => swir_num_rows,           -- external input
+        swir_coadd_rows     => swir_coadd_rows,         -- external input
+        row_request         => buffer_row_req,          -- imaging_buffer <==  ccsds123_compressor
+        fragment_in         => buffer_frag,             -- imaging_buffer  ==> ccsds123_compressor
+        fragment_in_type    => buffer_row_type,         -- imaging_buffer  ==> ccsds123_compressor
+        transmitting_in     => buffer_transmitting,     -- imaging_buffer  ==> ccsds123_compressor
+        vnir_row_dropped_in => buffer_vnir_dropped,     -- imaging_buffer  ==> ccsds123_compressor
+        swir_row_dropped_in => buffer_swir_dropped,     -- imaging_buffer  ==> ccsds123_compressor
+        next_row_req        => next_row_req,            -- ccsds123_compressor <==  command_creator
+        fragment_out        => row_frag,                -- ccsds123_compressor  ==> command_creator
+        fragment_type       => next_row_type,           -- ccsds123_compressor  ==> command_creator
+        transmitting        => transmitting,            -- ccsds123_compressor  ==> command_creator
+        vnir_row_dropped    => vnir_row_dropped,        -- ccsds123_compressor  ==> memory_map
+        swir_row_dropped    => swir_row_dropped,        -- ccsds123_compressor  ==> memory_map
+        compressing         => compressing,             -- ccsds123_compressor  ==> header_creator
+        vnir_overflow       => vnir_overflow_i,         -- ccsds123_compressor  ==> header_creator
+        swir_overflow       => swir_overflow_i,         -- ccsds123_compressor  ==> header_creator
+        vnir_rows_written   => vnir_rows_written,       -- ccsds123_compressor  ==> header_creator
+        swir_rows_written   => swir_rows_written        -- ccsds123_compressor  ==> header_creator
     );
 
     command_creator_component : entity work.command_creator port map(
@@ -94,40 +211,120 @@ begin
         reset_n             => reset_n,                 -- external input
         vnir_img_header     => vnir_header,             -- header_creator  ==> command_creator
         swir_img_header     => swir_header,             -- header_creator  ==> command_creator
-        row_data            => row_frag,                -- imaging_buffer  ==> command_creator
-        row_type            => next_row_type,           -- imaging_buffer  ==> command_creator
-        buffer_transmitting => transmitting,            -- imaging_buffer  ==> command_creator
+        vnir_img_config_done => vnir_img_config_done_i, -- memory_map      ==> command_creator
+        swir_img_config_done => swir_img_config_done_i, -- memory_map      ==> command_creator
+        vnir_img_trailer    => vnir_trailer,            -- header_creator  ==> command_creator
+        swir_img_trailer    => swir_trailer,            -- header_creator  ==> command_creator
+        vnir_header_address => vnir_header_address,     -- memory_map      ==> command_creator
+        swir_header_address => swir_header_address,     -- memory_map      ==> command_creator
+        vnir_trailer_address => vnir_trailer_address,   -- memory_map      ==> command_creator
+        swir_trailer_address => swir_trailer_address,   -- memory_map      ==> command_creator
+        vnir_catalog_entry  => vnir_catalog_entry,      -- header_creator  ==> command_creator
+        swir_catalog_entry  => swir_catalog_entry,      -- header_creator  ==> command_creator
+        vnir_catalog_address => vnir_catalog_address,   -- memory_map      ==> command_creator
+        swir_catalog_address => swir_catalog_address,   -- memory_map      ==> command_creator
+        row_data            => row_frag,                -- ccsds123_compressor  ==> command_creator
+        row_type            => next_row_type,           -- ccsds123_compressor  ==> command_creator
+        buffer_transmitting => transmitting,            -- ccsds123_compressor  ==> command_creator
         address             => address,                 -- memory_map      ==> command_creator
-        next_row_req        => next_row_req,            -- imaging_buffer <==  command_creator
-        sdram_busy          => sdram_busy               -- external output   
+        vnir_row_widths     => vnir_row_widths,         -- external input
+        swir_row_pixels     => swir_row_pixels,         -- external input
+        next_row_req        => next_row_req,            -- ccsds123_compressor <==  command_creator
+        sdram_busy          => sdram_busy,              -- external output
+        master_cmd_in       => write_master_in,         -- external input
+        master_cmd_out      => write_master_out,        -- external output
+        perf_clear          => perf_clear,              -- external input
+        write_cycles        => perf_counters.write_cycles,    -- external output
+        wait_cycles         => perf_counters.wait_cycles      -- external output
     );
 
     header_creator_component : entity work.header_creator port map(
         clock           => clock,
         reset_n         => reset_n,
         timestamp       => timestamp,
-        swir_img_header => vnir_header,
-        vnir_img_header => swir_header,
+        swir_img_header => swir_header,
+        vnir_img_header => vnir_header,
+        swir_img_trailer => swir_trailer,
+        vnir_img_trailer => vnir_trailer,
+        swir_catalog_entry => swir_catalog_entry,
+        vnir_catalog_entry => vnir_catalog_entry,
         vnir_rows       => vnir_num_rows,
+        vnir_row_widths => vnir_row_widths,
+        swir_row_pixels => swir_row_pixels,
         swir_rows       => swir_num_rows,
-        img_config_done => img_config_done_i
+        swir_coadd_rows => swir_coadd_rows,
+        vnir_img_config_done => vnir_img_config_done_i,
+        swir_img_config_done => swir_img_config_done_i,
+        compress        => compress,
+        compressing     => compressing,
+        vnir_rows_written => vnir_rows_written,
+        swir_rows_written => swir_rows_written,
+        vnir_compress_overflow => vnir_overflow_i,
+        swir_compress_overflow => swir_overflow_i,
+        vnir_row_dropped => buffer_vnir_dropped,
+        swir_row_dropped => buffer_swir_dropped,
+        vnir_start_address => vnir_header_address,
+        vnir_end_address => vnir_end_address,
+        swir_start_address => swir_header_address,
+        swir_end_address => swir_end_address
     );
 
-    memory_map_component : entity work.memory_map port map(
+    memory_map_component : entity work.memory_map generic map(
+        SCRATCH_ADDRESSES   => SCRATCH_ADDRESSES
+    ) port map(
         clock               => clock,
         reset_n             => reset_n,
         config              => config_in,
-        memory_state        => config_out,
+        memory_state        => memory_state,
         start_config        => start_config,
         config_done         => config_done,
         img_config_done     => img_config_done_i,
+        vnir_img_config_done => vnir_img_config_done_i,
+        swir_img_config_done => swir_img_config_done_i,
         number_swir_rows    => swir_num_rows,
         number_vnir_rows    => vnir_num_rows,
+        vnir_row_widths     => vnir_row_widths,
+        swir_row_pixels     => swir_row_pixels,
+        swir_coadd_rows     => swir_coadd_rows,
         next_row_type       => next_row_type,
         next_row_req        => next_row_req,
         output_address      => address,
+        vnir_row_dropped    => vnir_row_dropped,
+        swir_row_dropped    => swir_row_dropped,
+        vnir_header_address => vnir_header_address,
+        swir_header_address => swir_header_address,
+        vnir_trailer_address => vnir_trailer_address,
+        swir_trailer_address => swir_trailer_address,
+        vnir_end_address    => vnir_end_address,
+        swir_end_address    => swir_end_address,
+        vnir_catalog_address => vnir_catalog_address,
+        swir_catalog_address => swir_catalog_address,
         sdram_error         => sdram_error
     );
 
+    read_back_component : entity work.read_back_engine port map(
+        clock               => clock,                   -- external input
+        reset_n             => reset_n,                 -- external input
+        read_start          => readback_start,          -- external input
+        read_base           => readback_base,           -- external input
+        read_end            => readback_end,            -- external input
+        catalog_start       => readback_catalog_start,  -- external input
+        catalog_index       => readback_catalog_index,  -- external input
+        catalog_base        => memory_state.catalog_base, -- memory_map ==> read_back_engine
+        data_out            => readback_data,           -- external output
+        data_valid          => readback_valid,          -- external output
+        data_read           => readback_read,           -- external input
+        busy                => readback_busy,           -- external output
+        master_cmd_in       => read_master_in,          -- external input
+        master_cmd_out      => read_master_out          -- external output
+    );
+
+    config_out <= memory_state;
     img_config_done <= img_config_done_i;
+    vnir_img_config_done <= vnir_img_config_done_i;
+    swir_img_config_done <= swir_img_config_done_i;
+    compress_overflow <= vnir_overflow_i or swir_overflow_i;
+    vnir_compress_overflow <= vnir_overflow_i;
+    swir_compress_overflow <= swir_overflow_i;
+    perf_counters.rows_dropped <= rows_dropped;
 end architecture;
\ No newline at end of file
@@ -0,0 +1,1024 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.img_buffer_pkg.all;
+use work.swir_types.all;
+use work.sdram;
+use work.sdram."=";
+use work.sdram."/=";
+use work.vnir;
+use work.ccsds123.all;
+
+-- Lossless CCSDS-123.0-B-1 compressor, sitting between the imaging buffer and the command creator.
+-- It looks like the command creator to the imaging buffer, and like the imaging buffer to the
+-- command creator.
+--
+-- Compression is turned on or off per imaging session: compress is sampled when an image is
+-- configured while neither sensor is imaging, and a VNIR or SWIR image configured while the other
+-- sensor's is still going on is compressed (or not) along with it. The state of each band is reset
+-- when its sensor's image is configured (on the rising edge of vnir_img_config_done or
+-- swir_img_config_done). While compression is off, rows go straight through.
+--
+-- While it's on, rows are requested from the imaging buffer whenever the input fifo has room for
+-- one, and their samples are run through the predictor and the entropy coder at one sample per
+-- clock cycle. Each band (red, blue, NIR, any extra VNIR bands and SWIR) is compressed as its own image in
+-- BSQ order, so the previous row of each band is kept in a RAM for the predictor. The predictor
+-- uses no spectral bands (P = 0) in reduced mode with neighbor-oriented local sums, so the
+-- prediction is the mean of the neighbouring samples and no weights are needed. The mapped
+-- residuals are coded with the sample-adaptive entropy coder; its parameters are in `ccsds123`.
+--
+-- The rows of VNIR band b are vnir_row_widths(b) samples wide (fewer than vnir.ROW_WIDTH when they
+-- are binned or cropped), and SWIR rows swir_row_pixels samples wide (fewer than swir_row_width when they are
+-- cropped). Both must only change between images.
+--
+-- The coded bitstream of each band is cut into rows of the band's usual row length, so the
+-- command creator and memory map are unchanged. The bitstream goes into memory MSB first, in byte
+-- order. At the end of a band's last row, its bitstream is padded with zeros to the end of a row,
+-- and the rest of the band's region is filled with rows of zeros, so the memory map still sees
+-- every row of the image. A band whose bitstream doesn't fit in its region (which only happens if
+-- the data doesn't compress at all) loses the rows that don't fit, and vnir_overflow or
+-- swir_overflow is set until that sensor's next image.
+--
+-- Each row comes in followed by its trailer (see sdram.row_metadata_t), which isn't compressed.
+-- While compressing, the trailer of each band's last row in is kept, and every row sent out is
+-- followed by a copy of it with the compressed flag set and row_index set to the row's index in the
+-- band's bitstream.
+--
+-- Rows dropped by the imaging buffer (vnir_row_dropped_in, indexed by sdram.vnir_index, and
+-- swir_row_dropped_in) count towards their band's rows while compressing, so the band's last row
+-- is still found and the band padded out when some of its rows never come in. The imaging buffer
+-- only drops a row while it holds another row of the band that hasn't been sent yet, so the drop
+-- is always seen before the band's last row is started. While compression is off, the drops are
+-- passed on to the memory map (vnir_row_dropped, swir_row_dropped); while it's on, the memory map
+-- sees every row of the image anyway.
+--
+-- vnir_rows_written and swir_rows_written count the rows of image data of each band sent out for
+-- the current image: the rows holding the bitstream while compressing, or every row otherwise.
+entity ccsds123_compressor is
+    port(
+        --Control Signals
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        --Compression is turned on or off for the session starting on the next rising edge of either img_config_done
+        compress            : in std_logic;
+        vnir_img_config_done : in std_logic;
+        swir_img_config_done : in std_logic;
+        vnir_num_rows       : in integer;
+        swir_num_rows       : in integer;
+        vnir_row_widths     : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);
+        swir_row_pixels     : in integer := swir_row_width;
+        swir_coadd_rows     : in integer range 1 to swir_max_coadd_rows := 1;  -- the SWIR band has swir_num_rows / swir_coadd_rows rows
+
+        --Rows from the imaging buffer
+        row_request         : out std_logic;
+        fragment_in         : in row_fragment_t;
+        fragment_in_type    : in sdram.row_type_t;
+        transmitting_in     : in std_logic;
+        vnir_row_dropped_in : in std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1) := (others => '0');
+        swir_row_dropped_in : in std_logic := '0';
+
+        --Rows to the command creator
+        next_row_req        : in std_logic;
+        fragment_out        : out row_fragment_t;
+        fragment_type       : out sdram.row_type_t;
+        transmitting        : out std_logic;
+        vnir_row_dropped    : out std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+        swir_row_dropped    : out std_logic;
+
+        --Status of the current image
+        compressing         : out std_logic;
+        vnir_overflow       : out std_logic;
+        swir_overflow       : out std_logic;
+        vnir_rows_written   : out row_count_a;
+        swir_rows_written   : out natural
+    );
+end entity ccsds123_compressor;
+
+architecture rtl of ccsds123_compressor is
+
+    --Bits needed to hold the numbers 0 to n-1
+    pure function index_bits(n : integer) return integer is
+        variable bits : integer := 1;
+    begin
+        while 2**bits < n loop
+            bits := bits + 1;
+        end loop;
+        return bits;
+    end function index_bits;
+
+    constant NUM_BANDS          : integer := NUM_VNIR_ROW_FIFO + NUM_SWIR_ROW_FIFO;
+    constant SWIR_BAND          : integer := NUM_VNIR_ROW_FIFO;
+    constant BAND_BITS          : integer := index_bits(NUM_BANDS);
+    constant MAX_ROW_SAMPLES    : integer := vnir.ROW_WIDTH;
+
+    --The input fifo can hold two VNIR rows, so a row can come in while the last one is compressed
+    constant IN_FIFO_WORDS      : integer := 2*VNIR_FIFO_DEPTH;
+
+    --The unpacker holds a word and a sample, the packer a word and a codeword
+    constant UNPACK_BITS        : integer := FIFO_WORD_LENGTH + MAX_DYNAMIC_RANGE;
+    constant PACK_BITS          : integer := FIFO_WORD_LENGTH + MAX_CODEWORD_BITS;
+
+    subtype band_t is integer range 0 to NUM_BANDS-1;
+    subtype sample_t is unsigned(MAX_DYNAMIC_RANGE-1 downto 0);
+    subtype accumulator_t is unsigned(MAX_DYNAMIC_RANGE+RESCALING_COUNTER_SIZE downto 0);
+    subtype counter_t is unsigned(RESCALING_COUNTER_SIZE downto 0);
+    subtype pack_t is std_logic_vector(PACK_BITS-1 downto 0);
+
+    type band_count_a is array (0 to NUM_BANDS-1) of natural;
+    type accumulator_a is array (0 to NUM_BANDS-1) of accumulator_t;
+    type counter_a is array (0 to NUM_BANDS-1) of counter_t;
+    type pack_a is array (0 to NUM_BANDS-1) of pack_t;
+    type pack_count_a is array (0 to NUM_BANDS-1) of integer range 0 to PACK_BITS;
+    type link_a is array (0 to NUM_BANDS-1) of row_fragment_t;
+    type sample_a is array (0 to NUM_BANDS*MAX_ROW_SAMPLES-1) of sample_t;
+    type metadata_a is array (0 to NUM_BANDS-1) of sdram.row_metadata_t;
+
+    constant INITIAL_COUNTER    : counter_t := to_unsigned(2**INITIAL_COUNT_EXPONENT, counter_t'length);
+    constant INITIAL_ACCUMULATOR : accumulator_t := to_unsigned(
+        ((3 * 2**(ACCUMULATOR_INIT_CONSTANT+6) - 49) * 2**INITIAL_COUNT_EXPONENT) / 2**7, accumulator_t'length
+    );
+
+    --Band of each row type, with the VNIR bands in the same order as the imaging buffer's fifos
+    pure function band_index(row_type : sdram.row_type_t) return integer is
+    begin
+        case row_type is
+            when sdram.ROW_SWIR => return SWIR_BAND;
+            when sdram.ROW_NONE => return 0;
+            when others         => return sdram.vnir_index(row_type);
+        end case;
+    end function band_index;
+
+    --Dynamic range (D), samples and fifo words in a row of each band
+    pure function dynamic_range(band : band_t) return integer is
+    begin
+        if band = SWIR_BAND then
+            return swir_pixel_bits;
+        else
+            return vnir.ROW_PIXEL_BITS;
+        end if;
+    end function dynamic_range;
+
+    impure function row_samples(band : band_t) return integer is
+    begin
+        if band = SWIR_BAND then
+            return swir_row_pixels;
+        else
+            return vnir_row_widths(band);
+        end if;
+    end function row_samples;
+
+    impure function row_words(band : band_t) return integer is
+    begin
+        if band = SWIR_BAND then
+            return swir_row_words(swir_row_pixels);
+        else
+            return vnir_row_words(vnir_row_widths(band));
+        end if;
+    end function row_words;
+
+    --Each band's output fifo holds two of its widest rows, so one can be sent while the next one is coded
+    pure function out_depth(band : band_t) return integer is
+    begin
+        if band = SWIR_BAND then
+            return 2*SWIR_FIFO_DEPTH;
+        else
+            return 2*VNIR_FIFO_DEPTH;
+        end if;
+    end function out_depth;
+
+    --The bitstream is built MSB first; its first byte goes to the lowest address in memory
+    pure function memory_order(word : row_fragment_t) return row_fragment_t is
+        variable re : row_fragment_t;
+    begin
+        for i in 0 to FIFO_WORD_BYTES-1 loop
+            re(8*i+7 downto 8*i) := word(FIFO_WORD_LENGTH-8*i-1 downto FIFO_WORD_LENGTH-8*i-8);
+        end loop;
+        return re;
+    end function memory_order;
+
+    --Image control
+    signal vnir_config_prev     : std_logic;
+    signal swir_config_prev     : std_logic;
+    signal vnir_start           : std_logic;
+    signal swir_start           : std_logic;
+    signal image_start          : std_logic;                            -- start of an imaging session
+    signal band_start           : std_logic_vector(0 to NUM_BANDS-1);   -- start of the band's image
+    signal compressing_i        : std_logic;
+    signal vnir_rows_next       : natural;      -- rows of the sensor's next image, given when it's configured
+    signal swir_rows_next       : natural;
+    signal vnir_rows_reg        : natural;      -- rows of the sensor's current image
+    signal swir_rows_reg        : natural;
+    signal band_rows            : band_count_a;
+
+    --The whole pipeline moves on a clock cycle only if advance = '1'
+    signal advance              : std_logic;
+
+    --Input fifo, holding the rows coming in from the imaging buffer along with their band
+    signal fifo_clear           : std_logic;
+    signal in_fifo_data         : std_logic_vector(BAND_BITS+FIFO_WORD_LENGTH-1 downto 0);
+    signal in_fifo_q            : std_logic_vector(BAND_BITS+FIFO_WORD_LENGTH-1 downto 0);
+    signal in_fifo_wrreq        : std_logic;
+    signal in_fifo_rdreq        : std_logic;
+    signal in_fifo_empty        : std_logic;
+    signal in_words             : integer range 0 to IN_FIFO_WORDS;
+    signal row_request_i        : std_logic;
+    signal row_pending          : std_logic;    -- a row has been requested and hasn't come in yet
+    signal transmitting_in_prev : std_logic;
+    signal band_words           : band_count_a;     -- words of row data in each band's rows
+    signal in_row_words         : natural range 0 to VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS;  -- words of the row coming in so far
+    signal in_trailer           : std_logic;    -- the word coming in is the row's trailer
+    signal band_metadata        : metadata_a;   -- trailer of each band's last row in
+
+    --First stage: unpacking samples from the input fifo
+    signal s0_active            : std_logic;    -- a row is being unpacked
+    signal s0_band              : band_t;
+    signal s0_x                 : integer range 0 to MAX_ROW_SAMPLES-1;
+    signal s0_words_left        : integer range 0 to VNIR_FIFO_DEPTH;
+    signal s0_last_image        : std_logic;    -- the row is the band's last in the image
+    signal unpack_buf           : std_logic_vector(UNPACK_BITS-1 downto 0);
+    signal unpack_count         : integer range 0 to UNPACK_BITS;
+    signal rows_in              : band_count_a;
+    signal rows_dropped_in      : band_count_a;     -- rows of each band dropped before they came in
+    signal row_dropped_in       : std_logic_vector(0 to NUM_BANDS-1);
+
+    --Each sample going down the pipeline. A setup item is sent ahead of each row to read the first
+    --sample of the band's previous row
+    signal p0_valid, p1_valid   : std_logic;
+    signal p0_setup, p1_setup   : std_logic;
+    signal p0_band, p1_band     : band_t;
+    signal p0_x, p1_x           : integer range 0 to MAX_ROW_SAMPLES-1;
+    signal p0_sample, p1_sample : sample_t;
+    signal p0_last, p1_last     : std_logic;    -- last sample of the row
+    signal p0_last_image        : std_logic;    -- last sample of the band's last row
+    signal p1_last_image        : std_logic;
+
+    --Previous row of each band. Sample x of the band's previous row is read (on ram_q) along with
+    --sample x-1 of the current row, and sample x of the current row is written one stage later
+    signal prev_rows            : sample_a;
+    signal ram_rdaddr           : integer range 0 to NUM_BANDS*MAX_ROW_SAMPLES-1;
+    signal ram_wraddr           : integer range 0 to NUM_BANDS*MAX_ROW_SAMPLES-1;
+    signal ram_wren             : std_logic;
+    signal ram_q                : sample_t;
+
+    --Second stage: predictor
+    signal band_started         : std_logic_vector(0 to NUM_BANDS-1);   -- the band's first row is done
+    signal win_n                : sample_t;     -- sample above the current one
+    signal win_nw               : sample_t;     -- sample above and to the left
+    signal win_w                : sample_t;     -- sample to the left
+
+    signal p2_valid             : std_logic;
+    signal p2_band              : band_t;
+    signal p2_first             : std_logic;    -- first sample of the band (t = 0)
+    signal p2_row_first         : std_logic;
+    signal p2_row_last          : std_logic;
+    signal p2_last_image        : std_logic;
+    signal p2_delta             : sample_t;     -- mapped prediction residual
+
+    --Third stage: entropy coder
+    signal accumulator          : accumulator_t;
+    signal counter              : counter_t;
+    signal accumulators         : accumulator_a;
+    signal counters             : counter_a;
+
+    signal p3_valid             : std_logic;
+    signal p3_band              : band_t;
+    signal p3_code              : sample_t;     -- codeword, with leading zeros up to p3_length
+    signal p3_length            : integer range 0 to MAX_CODEWORD_BITS;
+    signal p3_row_first         : std_logic;
+    signal p3_row_last          : std_logic;
+    signal p3_last_image        : std_logic;
+
+    --Fourth stage: packing codewords into words, and each band's output fifo
+    signal pack                 : pack_t;
+    signal pack_count           : integer range 0 to PACK_BITS;
+    signal packs                : pack_a;
+    signal pack_counts          : pack_count_a;
+    signal flush_active         : std_logic;
+    signal flush_band           : band_t;
+    signal flush_padding        : std_logic;    -- the bitstream is done, and the band is being filled with zero rows
+
+    signal out_data             : link_a;
+    signal out_q                : link_a;
+    signal out_wrreq            : std_logic_vector(0 to NUM_BANDS-1);
+    signal out_rdreq            : std_logic_vector(0 to NUM_BANDS-1);
+    signal words_held           : band_count_a;     -- words in each output fifo, including the row being filled
+    signal row_fill             : band_count_a;     -- words in the row being filled
+    signal rows_ready           : band_count_a;     -- complete rows that can be sent
+    signal rows_out             : band_count_a;     -- rows written for each band this image
+    signal data_rows            : band_count_a;     -- rows of image data written for each band this image
+    signal vnir_overflow_i      : std_logic;
+    signal swir_overflow_i      : std_logic;
+
+    --Final stage, sending rows to the command creator
+    signal next_row_req_prev    : std_logic;
+    signal row_requested        : std_logic;
+    signal read_words_left      : natural range 0 to VNIR_FIFO_DEPTH;
+    signal read_type            : sdram.row_type_t;
+    signal read_type_p1         : sdram.row_type_t;
+    signal read_trailer         : std_logic;    -- the word being sent this cycle is the row's trailer
+    signal read_trailer_p1      : std_logic;
+    signal rows_sent            : band_count_a; -- rows sent out for each band this image
+    signal fragment_out_i       : row_fragment_t;
+    signal fragment_type_i      : sdram.row_type_t;
+    signal transmitting_i       : std_logic;
+
+begin
+
+    assert vnir.ROW_PIXEL_BITS <= MAX_DYNAMIC_RANGE
+        report "ccsds123_compressor requires vnir.ROW_PIXEL_BITS <= MAX_DYNAMIC_RANGE" severity failure;
+
+    --The pipeline stalls while a band is being flushed, or if the last stage might not have room for a word
+    advance <= '0' when flush_active = '1' or
+                        (p3_valid = '1' and words_held(p3_band) >= out_depth(p3_band) - 1) else '1';
+
+    vnir_start <= vnir_img_config_done and not vnir_config_prev;
+    swir_start <= swir_img_config_done and not swir_config_prev;
+    image_start <= (vnir_start or swir_start) and not (vnir_config_prev or swir_config_prev);
+
+    control_process : process (clock, reset_n) is
+    begin
+        if (reset_n = '0') then
+            vnir_config_prev <= '0';
+            swir_config_prev <= '0';
+            compressing_i <= '0';
+            vnir_rows_next <= 0;
+            swir_rows_next <= 0;
+            vnir_rows_reg <= 0;
+            swir_rows_reg <= 0;
+            band_words <= (others => 0);
+        elsif rising_edge(clock) then
+            vnir_config_prev <= vnir_img_config_done;
+            swir_config_prev <= swir_img_config_done;
+            for b in 0 to NUM_BANDS-1 loop
+                band_words(b) <= row_words(b);
+            end loop;
+            if (image_start = '1') then
+                compressing_i <= compress;
+            end if;
+
+            --The number of rows is only valid on the clock cycle the image is configured, and is only
+            --taken on for the sensor's own image when it starts, so a row count given while the sensor
+            --is busy (which the memory map ignores) doesn't change the image in progress
+            if (vnir_num_rows > 0) then
+                vnir_rows_next <= vnir_num_rows;
+            end if;
+            if (swir_num_rows > 0) then
+                swir_rows_next <= to_integer(coadd_divide(to_unsigned(swir_num_rows, swir_coadd_sum_bits), swir_coadd_rows));
+            end if;
+            if (vnir_start = '1') then
+                vnir_rows_reg <= vnir_rows_next;
+            end if;
+            if (swir_start = '1') then
+                swir_rows_reg <= swir_rows_next;
+            end if;
+        end if;
+    end process control_process;
+
+    BAND_ROWS_GEN : for i in 0 to NUM_BANDS-1 generate
+        band_rows(i) <= swir_rows_reg when i = SWIR_BAND else vnir_rows_reg;
+        band_start(i) <= swir_start when i = SWIR_BAND else vnir_start;
+        SWIR_DROP_GEN : if i = SWIR_BAND generate
+            row_dropped_in(i) <= swir_row_dropped_in;
+        else generate
+            row_dropped_in(i) <= vnir_row_dropped_in(i);
+        end generate SWIR_DROP_GEN;
+    end generate BAND_ROWS_GEN;
+
+    IN_FIFO : entity work.row_fifo generic map (
+        WORD_SIZE => BAND_BITS+FIFO_WORD_LENGTH,
+        NUM_WORDS => IN_FIFO_WORDS,
+        SHOWAHEAD => "ON"
+    ) port map (
+        aclr    => fifo_clear,
+        clock   => clock,
+        data    => in_fifo_data,
+        rdreq   => in_fifo_rdreq,
+        wrreq   => in_fifo_wrreq,
+        empty   => in_fifo_empty,
+        full    => open,
+        q       => in_fifo_q
+    );
+
+    --Only one row is requested at a time, and only if there's room for a VNIR row in the input fifo
+    row_request_i <= '1' when compressing_i = '1' and row_pending = '0' and in_words <= IN_FIFO_WORDS - VNIR_FIFO_DEPTH else '0';
+    in_trailer <= '1' when transmitting_in = '1' and in_row_words = band_words(band_index(fragment_in_type)) else '0';
+    in_fifo_wrreq <= transmitting_in and compressing_i and not in_trailer;
+    in_fifo_data <= std_logic_vector(to_unsigned(band_index(fragment_in_type), BAND_BITS)) & fragment_in;
+
+    --A word is taken out of the input fifo whenever the unpacker would otherwise run out of bits for the next sample
+    in_fifo_rdreq <= '1' when advance = '1' and s0_active = '1' and s0_words_left > 0 and in_fifo_empty = '0'
+                              and unpack_count < 2*dynamic_range(s0_band) else '0';
+
+    input_process : process (clock, reset_n) is
+        variable in_words_v     : integer range 0 to IN_FIFO_WORDS;
+        variable band_v         : band_t;
+        variable buf_v          : std_logic_vector(UNPACK_BITS-1 downto 0);
+        variable count_v        : integer range 0 to UNPACK_BITS;
+        variable sample_v       : sample_t;
+        variable row_end_v      : boolean;
+    begin
+        if (reset_n = '0') then
+            transmitting_in_prev <= '0';
+            row_pending <= '0';
+            in_words <= 0;
+            s0_active <= '0';
+            s0_band <= 0;
+            s0_x <= 0;
+            s0_words_left <= 0;
+            s0_last_image <= '0';
+            unpack_buf <= (others => '0');
+            unpack_count <= 0;
+            rows_in <= (others => 0);
+            rows_dropped_in <= (others => 0);
+            in_row_words <= 0;
+            band_metadata <= (others => (capture_time => (others => '0'), row_index => (others => '0'),
+                                         band => sdram.ROW_NONE, dropped => (others => '0'), compressed => '0'));
+            ram_rdaddr <= 0;
+            p0_valid <= '0';
+            p0_setup <= '0';
+            p1_valid <= '0';
+            p1_setup <= '0';
+        elsif rising_edge(clock) then
+            transmitting_in_prev <= transmitting_in;
+            if (row_request_i = '1') then
+                row_pending <= '1';
+            elsif (transmitting_in = '0' and transmitting_in_prev = '1') then
+                row_pending <= '0';
+            end if;
+
+            in_words_v := in_words;
+            if (in_fifo_wrreq = '1') then
+                in_words_v := in_words_v + 1;
+            end if;
+            if (in_fifo_rdreq = '1') then
+                in_words_v := in_words_v - 1;
+            end if;
+            in_words <= in_words_v;
+
+            --Keeping the trailer of each band's last row in, for the trailers of the rows sent out
+            if (transmitting_in = '1') then
+                in_row_words <= in_row_words + 1;
+            else
+                in_row_words <= 0;
+            end if;
+            if (in_trailer = '1') then
+                band_metadata(band_index(fragment_in_type)) <= sdram.row_metadata(fragment_in);
+            end if;
+
+            for i in 0 to NUM_BANDS-1 loop
+                if (band_start(i) = '1') then
+                    rows_in(i) <= 0;
+                    rows_dropped_in(i) <= 0;
+                elsif (row_dropped_in(i) = '1') then
+                    rows_dropped_in(i) <= rows_dropped_in(i) + 1;
+                end if;
+            end loop;
+
+            if (advance = '1') then
+                p0_valid <= '0';
+                p0_setup <= '0';
+                p0_last <= '0';
+
+                if (s0_active = '0') then
+                    if (in_fifo_empty = '0') then
+                        --Start on the next row with its setup item
+                        band_v := to_integer(unsigned(in_fifo_q(in_fifo_q'high downto FIFO_WORD_LENGTH)));
+                        s0_active <= '1';
+                        s0_band <= band_v;
+                        s0_x <= 0;
+                        s0_words_left <= row_words(band_v);
+                        if (rows_in(band_v) + rows_dropped_in(band_v) = band_rows(band_v) - 1) then
+                            s0_last_image <= '1';
+                        else
+                            s0_last_image <= '0';
+                        end if;
+                        rows_in(band_v) <= rows_in(band_v) + 1;
+
+                        p0_valid <= '1';
+                        p0_setup <= '1';
+                        p0_band <= band_v;
+                        p0_x <= 0;
+                        ram_rdaddr <= band_v * MAX_ROW_SAMPLES;
+                    end if;
+                else
+                    --Samples are packed into words LSB first, and rows start on a word boundary: the padding
+                    --after a row's last sample is dropped with it, so it can't shift the next row's samples
+                    buf_v := unpack_buf;
+                    count_v := unpack_count;
+                    row_end_v := false;
+                    if (count_v >= dynamic_range(s0_band)) then
+                        sample_v := unsigned(buf_v(MAX_DYNAMIC_RANGE-1 downto 0));
+                        if (s0_band /= SWIR_BAND) then
+                            sample_v(MAX_DYNAMIC_RANGE-1 downto vnir.ROW_PIXEL_BITS) := (others => '0');
+                        end if;
+                        buf_v := std_logic_vector(shift_right(unsigned(buf_v), dynamic_range(s0_band)));
+                        count_v := count_v - dynamic_range(s0_band);
+
+                        p0_valid <= '1';
+                        p0_band <= s0_band;
+                        p0_x <= s0_x;
+                        p0_sample <= sample_v;
+                        p0_last_image <= s0_last_image;
+                        ram_rdaddr <= s0_band * MAX_ROW_SAMPLES + s0_x + 1;
+                        if (s0_x = row_samples(s0_band) - 1) then
+                            p0_last <= '1';
+                            s0_active <= '0';
+                            row_end_v := true;
+                        else
+                            s0_x <= s0_x + 1;
+                        end if;
+                    end if;
+
+                    if (in_fifo_rdreq = '1') then
+                        buf_v := buf_v or std_logic_vector(shift_left(resize(unsigned(in_fifo_q(FIFO_WORD_LENGTH-1 downto 0)), UNPACK_BITS), count_v));
+                        count_v := count_v + FIFO_WORD_LENGTH;
+                        s0_words_left <= s0_words_left - 1;
+                    end if;
+                    if (row_end_v) then
+                        buf_v := (others => '0');
+                        count_v := 0;
+                    end if;
+                    unpack_buf <= buf_v;
+                    unpack_count <= count_v;
+                end if;
+
+                --The previous row's sample is read from the RAM while the item moves to p1
+                p1_valid <= p0_valid;
+                p1_setup <= p0_setup;
+                p1_band <= p0_band;
+                p1_x <= p0_x;
+                p1_sample <= p0_sample;
+                p1_last <= p0_last;
+                p1_last_image <= p0_last_image;
+            end if;
+        end if;
+    end process input_process;
+
+    ram_wren <= p1_valid and not p1_setup;
+    ram_wraddr <= p1_band * MAX_ROW_SAMPLES + p1_x;
+
+    prev_row_ram : process (clock) is
+    begin
+        if rising_edge(clock) then
+            if (advance = '1') then
+                if (ram_wren = '1') then
+                    prev_rows(ram_wraddr) <= p1_sample;
+                end if;
+                ram_q <= prev_rows(ram_rdaddr);
+            end if;
+        end if;
+    end process prev_row_ram;
+
+    --Predictor (P = 0, reduced mode, neighbor-oriented local sums) and residual mapping
+    predictor_process : process (clock, reset_n) is
+        variable sigma_v        : unsigned(MAX_DYNAMIC_RANGE+2 downto 0);
+        variable predicted_v    : sample_t;     -- predicted sample value
+        variable odd_v          : std_logic;    -- the scaled predicted sample value is odd
+        variable max_v          : sample_t;
+        variable diff_v         : signed(MAX_DYNAMIC_RANGE+1 downto 0);
+        variable magnitude_v    : unsigned(MAX_DYNAMIC_RANGE downto 0);
+        variable theta_v        : unsigned(MAX_DYNAMIC_RANGE downto 0);
+        variable delta_v        : unsigned(MAX_DYNAMIC_RANGE downto 0);
+        variable first_v        : boolean;
+    begin
+        if (reset_n = '0') then
+            band_started <= (others => '0');
+            win_n <= (others => '0');
+            win_nw <= (others => '0');
+            win_w <= (others => '0');
+            p2_valid <= '0';
+        elsif rising_edge(clock) then
+            band_started <= band_started and not band_start;
+
+            if (advance = '1') then
+                p2_valid <= '0';
+                if (p1_valid = '1' and p1_setup = '1') then
+                    win_n <= ram_q;
+                elsif (p1_valid = '1') then
+                    --Local sum of the neighbouring samples (ram_q is the sample above and to the right)
+                    first_v := false;
+                    sigma_v := (others => '0');
+                    if (band_started(p1_band) = '0') then
+                        if (p1_x = 0) then
+                            first_v := true;
+                        else
+                            sigma_v := shift_left(resize(win_w, sigma_v'length), 2);
+                        end if;
+                    elsif (p1_x = 0) then
+                        sigma_v := shift_left(resize(win_n, sigma_v'length) + resize(ram_q, sigma_v'length), 1);
+                    elsif (p1_last = '1') then
+                        sigma_v := resize(win_w, sigma_v'length) + resize(win_nw, sigma_v'length) +
+                                   shift_left(resize(win_n, sigma_v'length), 1);
+                    else
+                        sigma_v := resize(win_w, sigma_v'length) + resize(win_nw, sigma_v'length) +
+                                   resize(win_n, sigma_v'length) + resize(ram_q, sigma_v'length);
+                    end if;
+
+                    --With no spectral prediction, the scaled predicted value is floor(sigma/2) + 1, and the
+                    --predicted value is half of that: the rounded mean of the four neighbours
+                    if (first_v) then
+                        predicted_v := shift_left(to_unsigned(1, MAX_DYNAMIC_RANGE), dynamic_range(p1_band) - 1);
+                        odd_v := '0';
+                    else
+                        predicted_v := resize(shift_right(sigma_v + 2, 2), MAX_DYNAMIC_RANGE);
+                        odd_v := not sigma_v(1);
+                    end if;
+
+                    --Mapping the residual
+                    if (p1_band = SWIR_BAND) then
+                        max_v := (others => '1');
+                    else
+                        max_v := to_unsigned(2**vnir.ROW_PIXEL_BITS - 1, MAX_DYNAMIC_RANGE);
+                    end if;
+                    diff_v := signed(resize(p1_sample, diff_v'length)) - signed(resize(predicted_v, diff_v'length));
+                    magnitude_v := resize(unsigned(abs(diff_v)), magnitude_v'length);
+                    if (predicted_v < max_v - predicted_v) then
+                        theta_v := resize(predicted_v, theta_v'length);
+                    else
+                        theta_v := resize(max_v - predicted_v, theta_v'length);
+                    end if;
+
+                    if (magnitude_v > theta_v) then
+                        delta_v := magnitude_v + theta_v;
+                    elsif ((odd_v = '0' and diff_v >= 0) or (odd_v = '1' and diff_v <= 0)) then
+                        delta_v := shift_left(magnitude_v, 1);
+                    else
+                        delta_v := shift_left(magnitude_v, 1) - 1;
+                    end if;
+
+                    p2_valid <= '1';
+                    p2_band <= p1_band;
+                    p2_first <= '1' when first_v else '0';
+                    p2_row_first <= '1' when p1_x = 0 else '0';
+                    p2_row_last <= p1_last;
+                    p2_last_image <= p1_last_image;
+                    p2_delta <= resize(delta_v, MAX_DYNAMIC_RANGE);
+
+                    win_nw <= win_n;
+                    win_n <= ram_q;
+                    win_w <= p1_sample;
+                    if (p1_last = '1') then
+                        band_started(p1_band) <= '1';
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process predictor_process;
+
+    --Sample-adaptive entropy coder, with each band's accumulator and counter saved between its rows
+    coder_process : process (clock, reset_n) is
+        variable accumulator_v  : accumulator_t;
+        variable counter_v      : counter_t;
+        variable threshold_v    : accumulator_t;
+        variable k_v            : integer range 0 to MAX_DYNAMIC_RANGE-2;
+        variable unary_v        : sample_t;
+    begin
+        if (reset_n = '0') then
+            accumulators <= (others => INITIAL_ACCUMULATOR);
+            counters <= (others => INITIAL_COUNTER);
+            accumulator <= INITIAL_ACCUMULATOR;
+            counter <= INITIAL_COUNTER;
+            p3_valid <= '0';
+        elsif rising_edge(clock) then
+            for i in 0 to NUM_BANDS-1 loop
+                if (band_start(i) = '1') then
+                    accumulators(i) <= INITIAL_ACCUMULATOR;
+                    counters(i) <= INITIAL_COUNTER;
+                end if;
+            end loop;
+
+            if (advance = '1') then
+                p3_valid <= p2_valid;
+                p3_band <= p2_band;
+                p3_row_first <= p2_row_first;
+                p3_row_last <= p2_row_last;
+                p3_last_image <= p2_last_image;
+
+                if (p2_valid = '1') then
+                    if (p2_row_first = '1') then
+                        accumulator_v := accumulators(p2_band);
+                        counter_v := counters(p2_band);
+                    else
+                        accumulator_v := accumulator;
+                        counter_v := counter;
+                    end if;
+
+                    if (p2_first = '1') then
+                        --The band's first sample is sent as is
+                        p3_code <= p2_delta;
+                        p3_length <= dynamic_range(p2_band);
+                    else
+                        --k is the largest value (up to D-2) for which counter * 2^k <= accumulator + floor(49*counter / 2^7)
+                        threshold_v := accumulator_v + resize(shift_right(counter_v * to_unsigned(49, 6), 7), accumulator_t'length);
+                        k_v := 0;
+                        for i in 1 to MAX_DYNAMIC_RANGE-2 loop
+                            if (i <= dynamic_range(p2_band) - 2 and
+                                shift_left(resize(counter_v, accumulator_t'length), i) <= threshold_v) then
+                                k_v := i;
+                            end if;
+                        end loop;
+
+                        unary_v := shift_right(p2_delta, k_v);
+                        if (unary_v < UNARY_LENGTH_LIMIT) then
+                            --unary_v zeros, a one, and the k LSBs of the residual
+                            p3_code <= shift_left(to_unsigned(1, MAX_DYNAMIC_RANGE), k_v) or
+                                       (p2_delta and (shift_left(to_unsigned(1, MAX_DYNAMIC_RANGE), k_v) - 1));
+                            p3_length <= to_integer(unary_v) + 1 + k_v;
+                        else
+                            --UNARY_LENGTH_LIMIT zeros, and the residual in D bits
+                            p3_code <= p2_delta;
+                            p3_length <= UNARY_LENGTH_LIMIT + dynamic_range(p2_band);
+                        end if;
+
+                        if (counter_v < 2**RESCALING_COUNTER_SIZE - 1) then
+                            accumulator_v := accumulator_v + p2_delta;
+                            counter_v := counter_v + 1;
+                        else
+                            accumulator_v := shift_right(accumulator_v + p2_delta + 1, 1);
+                            counter_v := shift_right(counter_v + 1, 1);
+                        end if;
+                    end if;
+
+                    accumulator <= accumulator_v;
+                    counter <= counter_v;
+                    if (p2_row_last = '1') then
+                        accumulators(p2_band) <= accumulator_v;
+                        counters(p2_band) <= counter_v;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process coder_process;
+
+    OUT_FIFO_GEN : for i in 0 to NUM_BANDS-1 generate
+        OUT_FIFO : entity work.row_fifo generic map (
+            WORD_SIZE => FIFO_WORD_LENGTH,
+            NUM_WORDS => out_depth(i)
+        ) port map (
+            aclr    => fifo_clear,
+            clock   => clock,
+            data    => out_data(i),
+            rdreq   => out_rdreq(i),
+            wrreq   => out_wrreq(i),
+            empty   => open,
+            full    => open,
+            q       => out_q(i)
+        );
+    end generate OUT_FIFO_GEN;
+
+    output_process : process (clock, reset_n) is
+        variable pack_v         : pack_t;
+        variable pack_count_v   : integer range 0 to PACK_BITS;
+        variable word_v         : row_fragment_t;
+        variable write_v        : boolean;
+        variable write_band_v   : band_t;
+        variable words_held_v   : band_count_a;
+        variable rows_ready_v   : band_count_a;
+        variable next_type      : sdram.row_type_t;
+        variable padding_v      : std_logic;
+        variable metadata_v     : sdram.row_metadata_t;
+    begin
+        if (reset_n = '0') then
+            pack <= (others => '0');
+            pack_count <= 0;
+            packs <= (others => (others => '0'));
+            pack_counts <= (others => 0);
+            flush_active <= '0';
+            flush_band <= 0;
+            flush_padding <= '0';
+            out_wrreq <= (others => '0');
+            out_rdreq <= (others => '0');
+            words_held <= (others => 0);
+            row_fill <= (others => 0);
+            rows_ready <= (others => 0);
+            rows_out <= (others => 0);
+            data_rows <= (others => 0);
+            vnir_overflow_i <= '0';
+            swir_overflow_i <= '0';
+            next_row_req_prev <= '0';
+            row_requested <= '0';
+            read_words_left <= 0;
+            read_type <= sdram.ROW_NONE;
+            read_type_p1 <= sdram.ROW_NONE;
+            read_trailer <= '0';
+            read_trailer_p1 <= '0';
+            rows_sent <= (others => 0);
+            transmitting_i <= '0';
+            fragment_type_i <= sdram.ROW_NONE;
+        elsif rising_edge(clock) then
+            words_held_v := words_held;
+            rows_ready_v := rows_ready;
+            write_v := false;
+            write_band_v := 0;
+            word_v := (others => '0');
+            padding_v := '0';
+
+            for i in 0 to NUM_BANDS-1 loop
+                if (band_start(i) = '1') then
+                    packs(i) <= (others => '0');
+                    pack_counts(i) <= 0;
+                    rows_out(i) <= 0;
+                    rows_sent(i) <= 0;
+                    data_rows(i) <= 0;
+                end if;
+            end loop;
+            if (vnir_start = '1') then
+                vnir_overflow_i <= '0';
+            end if;
+            if (swir_start = '1') then
+                swir_overflow_i <= '0';
+            end if;
+
+            --Rows going straight through are all image data
+            if (compressing_i = '0' and transmitting_in = '1' and transmitting_in_prev = '0') then
+                data_rows(band_index(fragment_in_type)) <= data_rows(band_index(fragment_in_type)) + 1;
+            end if;
+
+            --Appending the codeword to its band's bitstream, and sending out a word once there's one
+            if (advance = '1' and p3_valid = '1') then
+                if (p3_row_first = '1') then
+                    pack_v := packs(p3_band);
+                    pack_count_v := pack_counts(p3_band);
+                else
+                    pack_v := pack;
+                    pack_count_v := pack_count;
+                end if;
+
+                pack_v := pack_v or std_logic_vector(shift_left(resize(p3_code, PACK_BITS), PACK_BITS - pack_count_v - p3_length));
+                pack_count_v := pack_count_v + p3_length;
+                if (pack_count_v >= FIFO_WORD_LENGTH) then
+                    word_v := pack_v(PACK_BITS-1 downto PACK_BITS-FIFO_WORD_LENGTH);
+                    write_v := true;
+                    write_band_v := p3_band;
+                    pack_v := std_logic_vector(shift_left(unsigned(pack_v), FIFO_WORD_LENGTH));
+                    pack_count_v := pack_count_v - FIFO_WORD_LENGTH;
+                end if;
+
+                pack <= pack_v;
+                pack_count <= pack_count_v;
+                if (p3_row_last = '1') then
+                    packs(p3_band) <= pack_v;
+                    pack_counts(p3_band) <= pack_count_v;
+                end if;
+                if (p3_last_image = '1') then
+                    flush_active <= '1';
+                    flush_band <= p3_band;
+                    flush_padding <= '0';
+                end if;
+            elsif (flush_active = '1') then
+                --End of the band's image: send out what's left of the bitstream, pad it to the end of a row,
+                --and fill the rest of the band's region with zero rows
+                padding_v := flush_padding;
+                if (words_held(flush_band) < out_depth(flush_band)) then
+                    write_band_v := flush_band;
+                    if (pack_counts(flush_band) > 0) then
+                        word_v := packs(flush_band)(PACK_BITS-1 downto PACK_BITS-FIFO_WORD_LENGTH);
+                        write_v := true;
+                        packs(flush_band) <= (others => '0');
+                        pack_counts(flush_band) <= 0;
+                    elsif (row_fill(flush_band) /= 0) then
+                        write_v := true;
+                    elsif (rows_out(flush_band) < band_rows(flush_band)) then
+                        write_v := true;
+                        padding_v := '1';
+                    else
+                        flush_active <= '0';
+                    end if;
+                end if;
+                flush_padding <= padding_v;
+            end if;
+
+            out_wrreq <= (others => '0');
+            if (write_v) then
+                if (rows_out(write_band_v) < band_rows(write_band_v)) then
+                    out_data(write_band_v) <= memory_order(word_v);
+                    out_wrreq(write_band_v) <= '1';
+                    words_held_v(write_band_v) := words_held_v(write_band_v) + 1;
+                    if (row_fill(write_band_v) = row_words(write_band_v) - 1) then
+                        row_fill(write_band_v) <= 0;
+                        rows_ready_v(write_band_v) := rows_ready_v(write_band_v) + 1;
+                        rows_out(write_band_v) <= rows_out(write_band_v) + 1;
+                        if (padding_v = '0') then
+                            data_rows(write_band_v) <= data_rows(write_band_v) + 1;
+                        end if;
+                    else
+                        row_fill(write_band_v) <= row_fill(write_band_v) + 1;
+                    end if;
+                else
+                    --The band's region is full
+                    if (write_band_v = SWIR_BAND) then
+                        swir_overflow_i <= '1';
+                    else
+                        vnir_overflow_i <= '1';
+                    end if;
+                end if;
+            end if;
+
+            --The final stage, same as the imaging buffer's: reading a full row out of one of the fifos
+            --on the rising edge of next_row_req
+            next_row_req_prev <= next_row_req;
+            if (next_row_req = '1' and next_row_req_prev = '0' and compressing_i = '1') then
+                row_requested <= '1';
+            end if;
+
+            out_rdreq <= (others => '0');
+            read_type <= sdram.ROW_NONE;
+            read_trailer <= '0';
+
+            if (read_words_left > 0) then
+                read_type <= read_type;
+                read_words_left <= read_words_left - 1;
+                if (read_words_left > ROW_TRAILER_WORDS) then
+                    out_rdreq(band_index(read_type)) <= '1';
+                    if (read_words_left = ROW_TRAILER_WORDS + 1) then
+                        words_held_v(band_index(read_type)) := words_held_v(band_index(read_type)) - row_words(band_index(read_type));
+                    end if;
+                else
+                    --The row's trailer isn't in the fifo, it's made up in the next stage
+                    read_trailer <= '1';
+                end if;
+            elsif (row_requested = '1' or (next_row_req = '1' and next_row_req_prev = '0' and compressing_i = '1')) then
+                next_type := sdram.ROW_NONE;
+                if (rows_ready_v(SWIR_BAND) > 0) then
+                    next_type := sdram.ROW_SWIR;
+                else
+                    for i in NUM_VNIR_ROW_FIFO-1 downto 0 loop
+                        if (rows_ready_v(i) > 0) then
+                            next_type := sdram.vnir_type(i);
+                        end if;
+                    end loop;
+                end if;
+
+                if (next_type /= sdram.ROW_NONE) then
+                    out_rdreq(band_index(next_type)) <= '1';
+                    read_type <= next_type;
+                    read_words_left <= row_words(band_index(next_type)) + ROW_TRAILER_WORDS - 1;
+                    rows_ready_v(band_index(next_type)) := rows_ready_v(band_index(next_type)) - 1;
+                    row_requested <= '0';
+                end if;
+            end if;
+
+            --The fifos' outputs are valid the clock cycle after they are read
+            read_type_p1 <= read_type;
+            read_trailer_p1 <= read_trailer;
+            if (read_type_p1 /= sdram.ROW_NONE) then
+                if (read_trailer_p1 = '1') then
+                    metadata_v := band_metadata(band_index(read_type_p1));
+                    metadata_v.row_index := to_unsigned(rows_sent(band_index(read_type_p1)), 32);
+                    metadata_v.band := read_type_p1;
+                    metadata_v.compressed := '1';
+                    fragment_out_i <= sdram.row_trailer(metadata_v);
+                    rows_sent(band_index(read_type_p1)) <= rows_sent(band_index(read_type_p1)) + 1;
+                else
+                    fragment_out_i <= out_q(band_index(read_type_p1));
+                end if;
+                fragment_type_i <= read_type_p1;
+                transmitting_i <= '1';
+            else
+                fragment_out_i <= (others => 'X');
+                fragment_type_i <= sdram.ROW_NONE;
+                transmitting_i <= '0';
+            end if;
+
+            words_held <= words_held_v;
+            rows_ready <= rows_ready_v;
+        end if;
+    end process output_process;
+
+    fifo_clear <= '1' when reset_n = '0' else '0';
+
+    --Rows go straight through while compression is off
+    row_request <= row_request_i when compressing_i = '1' else next_row_req;
+    fragment_out <= fragment_out_i when compressing_i = '1' else fragment_in;
+    fragment_type <= fragment_type_i when compressing_i = '1' else fragment_in_type;
+    transmitting <= transmitting_i when compressing_i = '1' else transmitting_in;
+    vnir_row_dropped <= vnir_row_dropped_in when compressing_i = '0' else (others => '0');
+    swir_row_dropped <= swir_row_dropped_in and not compressing_i;
+
+    compressing <= compressing_i;
+    vnir_overflow <= vnir_overflow_i;
+    swir_overflow <= swir_overflow_i;
+    VNIR_ROWS_GEN : for i in 0 to NUM_VNIR_ROW_FIFO-1 generate
+        vnir_rows_written(i) <= data_rows(i);
+    end generate VNIR_ROWS_GEN;
+    swir_rows_written <= data_rows(SWIR_BAND);
+
+end architecture rtl;
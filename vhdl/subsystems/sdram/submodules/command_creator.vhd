@@ -14,11 +14,6 @@
 -- limitations under the License.
 ----------------------------------------------------------------
 
---TODO: 
--- 1) add state to write header data
--- 2) register address 
---       both of these are the same thing. need to know when fpga subsystem is first giving command and give write commands appropriately
-
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
@@ -31,8 +26,58 @@ use work.custom_master_pkg.all;
 use work.swir_types.all;
 use work.fpga.all;
 use work.sdram."=";
+use work.sdram."/=";
 
+-- Turns rows coming out of the imaging buffer into write commands for the custom master.
+--
+-- By default (PIPELINED = true), the next row is requested as soon as the current one has been
+-- handed to the master, rather than once the master has finished writing it. Each row's base
+-- address and length are queued in a command fifo of CMD_FIFO_DEPTH commands as the row comes in,
+-- and the next command is given to the master on the clock cycle after it finishes the current
+-- one. The row data goes straight into the master's own buffer, which it is allowed to fill ahead
+-- of control_go, so the Avalon write port can be kept busy across rows.
+--
+-- This relies on the following behaviour of burst_write_master (see
+-- project_files/ip/Master_Template/burst_write_master.v):
+--   - its buffer is a plain fifo, only read as words are written to the Avalon port, so words can
+--     be put into it before their command's control_go, and the words of several commands queued
+--     in it in order;
+--   - control_done is (length = 0), so it drops on the clock cycle after control_go;
+--   - user_buffer_full is the buffer's almost_full, set once it holds FIFODEPTH-2 words.
+-- Words are only passed on to the master while user_buffer_full is low, which leaves room for the
+-- word already on its way and the rest of a header. Since the imaging buffer can't be stalled in
+-- the middle of a row, the skid fifo can hold a whole row, and a row is only requested once the
+-- skid fifo is empty.
+--
+-- In pipelined mode, each image's header is also written ahead of its rows, at the header address
+-- latched when its sensor's img_config_done rises, and its trailer and catalog entry after its
+-- rows once that falls, at the trailer and catalog addresses latched then. The VNIR and SWIR
+-- images are followed separately, so either can start or end while the other's rows are coming
+-- in. Rows pass through a skid fifo so a header or trailer can be slotted in between two
+-- rows without holding up the imaging buffer.
+--
+-- With PIPELINED = false, the original state machine is used, which waits for control_done
+-- before requesting the next row. Unlike the original, it passes every word of the row to the
+-- master as it comes in, including the ones that come in before control_go (the original only did
+-- so from s3_writing on, which lost the row's first words), and it registers the row's address
+-- along with its type. It writes headers, trailers and catalog entries too, one at a time while
+-- no row is being written. Since a row that has been requested can come in at any time, row words
+-- reach the master through a delay line of MAX_META_WORDS words, so a header whose words were
+-- started while none was coming in is always in the master's buffer ahead of the row; the row's
+-- command is then issued once the header's is done.
+--
+-- In both modes, the rows of VNIR band b are written as vnir_row_widths(b) pixels (see
+-- `vnir_row_bytes`) and SWIR rows as swir_row_pixels pixels, which must only change between images,
+-- each followed by its trailer.
+--
+-- In both modes, write_cycles counts the clock cycles on which the master is busy writing a
+-- command, and wait_cycles the ones on which a row has been requested but none is coming in. Both
+-- are cleared by perf_clear.
 entity command_creator is
+    generic(
+        PIPELINED           : boolean := true;
+        CMD_FIFO_DEPTH      : integer := 4
+    );
     port(
         --Control Signals
         clock               : in std_logic;
@@ -42,11 +87,29 @@ entity command_creator is
         vnir_img_header     : in sdram.header_t;
         swir_img_header     : in sdram.header_t;
 
+        --Trailer data and where the headers and trailers go
+        vnir_img_config_done : in std_logic := '0';
+        swir_img_config_done : in std_logic := '0';
+        vnir_img_trailer    : in sdram.trailer_t := (others => '0');
+        swir_img_trailer    : in sdram.trailer_t := (others => '0');
+        vnir_header_address : in sdram.address_t := (others => '0');
+        swir_header_address : in sdram.address_t := (others => '0');
+        vnir_trailer_address : in sdram.address_t := (others => '0');
+        swir_trailer_address : in sdram.address_t := (others => '0');
+
+        --Catalog entries and where they go
+        vnir_catalog_entry  : in sdram.catalog_entry_t := (others => '0');
+        swir_catalog_entry  : in sdram.catalog_entry_t := (others => '0');
+        vnir_catalog_address : in sdram.address_t := (others => '0');
+        swir_catalog_address : in sdram.address_t := (others => '0');
+
         --Rows
         row_data            : in row_fragment_t;
         row_type            : in sdram.row_type_t;
         buffer_transmitting : in std_logic;
         address             : in sdram.address_t;
+        vnir_row_widths     : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);
+        swir_row_pixels     : in integer := swir_row_width;
         
         --Output Flag to Imaging Buffer
         next_row_req        : out std_logic;
@@ -56,7 +119,12 @@ entity command_creator is
 
         --Commands to custom master
         master_cmd_in       : in from_master_t;
-        master_cmd_out      : out to_master_t
+        master_cmd_out      : out to_master_t;
+
+        --Performance counters
+        perf_clear          : in std_logic := '0';
+        write_cycles        : out unsigned(31 downto 0);
+        wait_cycles         : out unsigned(31 downto 0)
     );
 end entity command_creator;
 
@@ -76,7 +144,110 @@ architecture rtl of command_creator is
     signal address_reg              : sdram.address_t;
     signal row_type_reg             : sdram.row_type_t;
 
-	type state_type is (s0_reset, s1_empty, s2_write_cmd, s3_writing);
+    -- pipelined mode: command fifo holding {base, length} of the rows handed to the master
+    constant CMD_WIDTH              : integer := 2*sdram.ADDRESS_LENGTH;
+    signal cmd_clear                : std_logic;
+    signal cmd_in                   : std_logic_vector(CMD_WIDTH-1 downto 0);
+    signal cmd_out                  : std_logic_vector(CMD_WIDTH-1 downto 0);
+    signal cmd_wrreq                : std_logic;
+    signal cmd_rdreq                : std_logic;
+    signal cmd_empty                : std_logic;
+    signal cmd_full                 : std_logic;
+    signal transmitting_prev        : std_logic;
+    signal control_go               : std_logic;
+    signal control_base             : std_logic_vector(sdram.ADDRESS_LENGTH-1 downto 0);
+    signal control_length           : std_logic_vector(sdram.ADDRESS_LENGTH-1 downto 0);
+    signal cmd_count                : integer range 0 to CMD_FIFO_DEPTH;   -- commands queued or about to be
+
+    -- pipelined mode: skid fifo holding {first word flag, command, data} of incoming row words
+    constant SKID_WIDTH             : integer := 1 + CMD_WIDTH + FIFO_WORD_LENGTH;
+    constant SKID_DEPTH             : integer := maximum(VNIR_FIFO_DEPTH, SWIR_FIFO_DEPTH) + ROW_TRAILER_WORDS;
+    signal skid_in                  : std_logic_vector(SKID_WIDTH-1 downto 0);
+    signal skid_out                 : std_logic_vector(SKID_WIDTH-1 downto 0);
+    signal skid_rdreq               : std_logic;
+    signal skid_empty               : std_logic;
+    signal skid_count               : integer range 0 to SKID_DEPTH;
+    signal skid_first               : std_logic;
+    signal between_rows             : std_logic;
+
+    -- headers, trailers and catalog entries, written in this order when more than one is pending
+    type meta_t is (META_VNIR_HEADER, META_SWIR_HEADER, META_VNIR_TRAILER, META_SWIR_TRAILER,
+                    META_VNIR_CATALOG, META_SWIR_CATALOG);
+    type meta_flags_t is array (meta_t) of std_logic;
+    type meta_addresses_t is array (meta_t) of sdram.address_t;
+    constant MAX_META_WORDS         : integer := maximum((sdram.HEADER_LENGTH + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH,
+                                                         maximum((sdram.TRAILER_LENGTH + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH,
+                                                                 sdram.CATALOG_ENTRY_LENGTH / FIFO_WORD_LENGTH));
+    type meta_word_a is array (0 to MAX_META_WORDS-1) of std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+    type meta_data_t is array (meta_t) of meta_word_a;
+    constant NO_META                : meta_flags_t := (others => '0');
+    signal meta_pending             : meta_flags_t;
+    signal meta_set                 : meta_flags_t;     -- items becoming pending this clock cycle
+    signal meta_addresses           : meta_addresses_t;
+    signal meta_next                : meta_t;
+    signal meta_start               : std_logic;
+    signal meta_active              : std_logic;    -- the header being written has words left
+    signal meta_item                : meta_t;
+    signal meta_sel                 : meta_t;
+    signal meta_index               : integer range 0 to MAX_META_WORDS-1;
+    signal meta_word_sel            : integer range 0 to MAX_META_WORDS-1;
+    signal meta_words_in            : meta_data_t;
+    signal meta_data                : std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+    signal vnir_config_prev         : std_logic;
+    signal swir_config_prev         : std_logic;
+
+    signal write_buffer             : std_logic;
+    signal buffer_data              : std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+
+    -- serial mode: row words on their way to the master, and a row that came in while a header,
+    -- trailer or catalog entry was being written
+    type row_delay_a is array (1 to MAX_META_WORDS) of std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+    signal row_delay                : row_delay_a;
+    signal row_delay_valid          : std_logic_vector(1 to MAX_META_WORDS);
+    signal row_start                : std_logic;
+    signal row_waiting              : std_logic;
+
+    -- Number of bytes written for a row of the given type
+    impure function row_bytes(row_type : sdram.row_type_t) return std_logic_vector is
+    begin
+        case row_type is
+            when sdram.ROW_SWIR =>
+                return std_logic_vector(to_unsigned(swir_row_bytes(swir_row_pixels), sdram.ADDRESS_LENGTH));
+            when sdram.ROW_NONE =>
+                return std_logic_vector(to_unsigned(0, sdram.ADDRESS_LENGTH));
+            when others =>
+                return std_logic_vector(to_unsigned(vnir_row_bytes(vnir_row_widths(sdram.vnir_index(row_type))), sdram.ADDRESS_LENGTH));
+        end case;
+    end function row_bytes;
+
+    -- Number of words written for a header, trailer or catalog entry. Headers are padded to a whole
+    -- number of words
+    pure function meta_words(item : meta_t) return integer is
+    begin
+        case item is
+            when META_VNIR_HEADER | META_SWIR_HEADER =>
+                return (sdram.HEADER_LENGTH + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH;
+            when META_VNIR_TRAILER | META_SWIR_TRAILER =>
+                return (sdram.TRAILER_LENGTH + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH;
+            when META_VNIR_CATALOG | META_SWIR_CATALOG =>
+                return sdram.CATALOG_ENTRY_LENGTH / FIFO_WORD_LENGTH;
+        end case;
+    end function meta_words;
+
+    -- Splits a header or trailer into words, most significant first, padding the last with zeros
+    pure function meta_split(meta : std_logic_vector) return meta_word_a is
+        constant PADDED_LENGTH : integer := MAX_META_WORDS * FIFO_WORD_LENGTH;
+        variable padded : std_logic_vector(PADDED_LENGTH-1 downto 0) := (others => '0');
+        variable words  : meta_word_a;
+    begin
+        padded(PADDED_LENGTH-1 downto PADDED_LENGTH-meta'length) := meta;
+        for i in 0 to MAX_META_WORDS-1 loop
+            words(i) := padded(PADDED_LENGTH-1-i*FIFO_WORD_LENGTH downto PADDED_LENGTH-(i+1)*FIFO_WORD_LENGTH);
+        end loop;
+        return words;
+    end function meta_split;
+
+	type state_type is (s0_reset, s1_empty, s2_write_cmd, s3_writing, s4_meta_data);
         signal state   : state_type;   -- Register to hold the current state
 
         -- Attribute "safe" implements a safe state machine. 
@@ -97,74 +268,350 @@ begin
     -- control_done                          <= master_cmd_in.control_done;
     -- user_buffer_full                      <= master_cmd_in.user_buffer_full;
 
-    -- state machine transfers
-    process (reset_n, clock) is
+    -- Headers are written at the start of the image, trailers and catalog entries once all its
+    -- rows are in. Each mode keeps its own meta_pending, setting the items in meta_set
+    meta_set <= (META_VNIR_HEADER  => vnir_img_config_done and not vnir_config_prev,
+                 META_SWIR_HEADER  => swir_img_config_done and not swir_config_prev,
+                 META_VNIR_TRAILER => vnir_config_prev and not vnir_img_config_done,
+                 META_SWIR_TRAILER => swir_config_prev and not swir_img_config_done,
+                 META_VNIR_CATALOG => vnir_config_prev and not vnir_img_config_done,
+                 META_SWIR_CATALOG => swir_config_prev and not swir_img_config_done);
+
+    meta_next <= META_VNIR_HEADER when meta_pending(META_VNIR_HEADER) = '1' else
+                 META_SWIR_HEADER when meta_pending(META_SWIR_HEADER) = '1' else
+                 META_VNIR_TRAILER when meta_pending(META_VNIR_TRAILER) = '1' else
+                 META_SWIR_TRAILER when meta_pending(META_SWIR_TRAILER) = '1' else
+                 META_VNIR_CATALOG when meta_pending(META_VNIR_CATALOG) = '1' else
+                 META_SWIR_CATALOG;
+
+    meta_words_in <= (META_VNIR_HEADER  => meta_split(vnir_img_header),
+                      META_SWIR_HEADER  => meta_split(swir_img_header),
+                      META_VNIR_TRAILER => meta_split(vnir_img_trailer),
+                      META_SWIR_TRAILER => meta_split(swir_img_trailer),
+                      META_VNIR_CATALOG => meta_split(vnir_catalog_entry),
+                      META_SWIR_CATALOG => meta_split(swir_catalog_entry));
+
+    -- Each item's address is latched along with it becoming pending
+    meta_latch : process (reset_n, clock) is
     begin
         if (reset_n = '0') then
-            row_type_reg <= sdram.ROW_NONE;
-            state <= s0_reset;
+            vnir_config_prev <= '0';
+            swir_config_prev <= '0';
+            meta_addresses <= (others => (others => '0'));
         elsif rising_edge(clock) then
-			case state is
-				when s0_reset =>
-					if reset_n = '1' then
-						state <= s1_empty;
-					else
-						state <= s0_reset;
-					end if;
-				when s1_empty =>  
-					if buffer_transmitting = '1' then
-                        row_type_reg <= row_type;    -- register the row type that's coming
-						state <= s2_write_cmd;       
-					else
-						state <= s1_empty;
-					end if;
-				when s2_write_cmd =>
-                    state <= s3_writing;
-                when s3_writing =>
-                    if master_cmd_in.control_done = '1' then 
-                        state <= s1_empty;
-                    else
-                        state <= s3_writing;
-                    end if;
-                when others =>
-                    state <= s0_reset;
-			end case;
+            vnir_config_prev <= vnir_img_config_done;
+            swir_config_prev <= swir_img_config_done;
+
+            if (meta_set(META_VNIR_HEADER) = '1') then
+                meta_addresses(META_VNIR_HEADER) <= vnir_header_address;
+            end if;
+            if (meta_set(META_VNIR_TRAILER) = '1') then
+                meta_addresses(META_VNIR_TRAILER) <= vnir_trailer_address;
+                meta_addresses(META_VNIR_CATALOG) <= vnir_catalog_address;
+            end if;
+            if (meta_set(META_SWIR_HEADER) = '1') then
+                meta_addresses(META_SWIR_HEADER) <= swir_header_address;
+            end if;
+            if (meta_set(META_SWIR_TRAILER) = '1') then
+                meta_addresses(META_SWIR_TRAILER) <= swir_trailer_address;
+                meta_addresses(META_SWIR_CATALOG) <= swir_catalog_address;
+            end if;
         end if;
-    end process;
+    end process meta_latch;
+
+    SERIAL_GEN : if not PIPELINED generate
+        row_start <= buffer_transmitting and not transmitting_prev;
+
+        -- state machine transfers
+        process (reset_n, clock) is
+        begin
+            if (reset_n = '0') then
+                row_type_reg <= sdram.ROW_NONE;
+                address_reg <= (others => '0');
+                transmitting_prev <= '0';
+                row_waiting <= '0';
+                row_delay <= (others => (others => '0'));
+                row_delay_valid <= (others => '0');
+                meta_pending <= NO_META;
+                meta_active <= '0';
+                meta_item <= META_VNIR_HEADER;
+                meta_index <= 0;
+                state <= s0_reset;
+            elsif rising_edge(clock) then
+                transmitting_prev <= buffer_transmitting;
+                meta_pending <= meta_pending or meta_set;
+
+                -- Row words go to the master MAX_META_WORDS clock cycles after they come in
+                row_delay(1) <= row_data;
+                row_delay_valid(1) <= buffer_transmitting;
+                for i in 2 to MAX_META_WORDS loop
+                    row_delay(i) <= row_delay(i-1);
+                    row_delay_valid(i) <= row_delay_valid(i-1);
+                end loop;
+
+                if (row_start = '1') then
+                    row_type_reg <= row_type;    -- register the row type that's coming
+                    address_reg <= address;      -- and where it goes
+                    row_waiting <= '1';
+                end if;
+
+				case state is
+					when s0_reset =>
+						if reset_n = '1' then
+							state <= s1_empty;
+						else
+							state <= s0_reset;
+						end if;
+					when s1_empty =>  
+						if row_waiting = '1' or row_start = '1' then
+                            row_waiting <= '0';
+                            meta_active <= '0';
+							state <= s2_write_cmd;       
+                        elsif meta_pending /= NO_META and buffer_transmitting = '0' and
+                              row_delay_valid = (row_delay_valid'range => '0') then
+                            -- No row words can reach the master before this item's
+                            meta_pending(meta_next) <= '0';
+                            meta_active <= '1';
+                            meta_item <= meta_next;
+                            meta_index <= 0;
+                            state <= s4_meta_data;
+						else
+							state <= s1_empty;
+						end if;
+                    when s4_meta_data =>
+                        if (meta_index = meta_words(meta_item)-1) then
+                            state <= s2_write_cmd;
+                        else
+                            meta_index <= meta_index + 1;
+                        end if;
+					when s2_write_cmd =>
+                        state <= s3_writing;
+                    when s3_writing =>
+                        if master_cmd_in.control_done = '1' then 
+                            meta_active <= '0';
+                            state <= s1_empty;
+                        else
+                            state <= s3_writing;
+                        end if;
+                    when others =>
+                        state <= s0_reset;
+				end case;
+            end if;
+        end process;
     
-    -- output signals 
-    next_row_req            <= '1' when state = s1_empty else '0';
-    sdram_busy              <= '1' when ((state = s2_write_cmd) or (state = s3_writing)) else '0';
+        -- output signals. A row is only requested while none is waiting, so at most one is in the
+        -- master's buffer
+        next_row_req            <= '1' when state = s1_empty and row_waiting = '0' else '0';
+        sdram_busy              <= '1' when ((state = s2_write_cmd) or (state = s3_writing) or (state = s4_meta_data)
+                                             or row_waiting = '1' or meta_pending /= NO_META) else '0';
         
-    -- command to write master
-    master_cmd_out.control_fixed_location  <= '0';
-    master_cmd_out.control_go              <= '1' when state = s2_write_cmd else '0';
+        -- command to write master
+        master_cmd_out.control_fixed_location  <= '0';
+        master_cmd_out.control_go              <= '1' when state = s2_write_cmd else '0';
     
-    -- data to write master
-    master_cmd_out.user_write_buffer       <= '1' when state = s3_writing else '0';
-    master_cmd_out.user_buffer_data        <= row_data when state = s3_writing else (others => '0');
-
-    -- setting address and write length for write master 
-    process (state) is
-    begin 
-        if (state = s2_write_cmd) then
-            -- base address
-            master_cmd_out.control_write_base      <= std_logic_vector(address_reg); 
-
-            -- write length
-            if row_type_reg = sdram.ROW_SWIR then 
-                master_cmd_out.control_write_length    <= std_logic_vector(to_unsigned(SWIR_ROW_BYTES, sdram.ADDRESS_LENGTH));
-            elsif (row_type_reg = sdram.ROW_RED or row_type_reg = sdram.ROW_BLUE or row_type_reg = sdram.ROW_NIR) then 
-                master_cmd_out.control_write_length    <= std_logic_vector(to_unsigned(VNIR_ROW_BYTES, sdram.ADDRESS_LENGTH));
+        -- data to write master. The row starts coming in while in s1_empty, and the master
+        -- takes data into its buffer before control_go, so every transmitted word is passed on
+        -- (through the delay line). Header, trailer and catalog words go in during s4_meta_data
+        master_cmd_out.user_write_buffer       <= '1' when state = s4_meta_data else row_delay_valid(MAX_META_WORDS);
+        master_cmd_out.user_buffer_data        <= meta_words_in(meta_item)(meta_index) when state = s4_meta_data else
+                                                  row_delay(MAX_META_WORDS) when row_delay_valid(MAX_META_WORDS) = '1' else
+                                                  (others => '0');
+
+        -- setting address and write length for write master 
+        process (state, meta_active, meta_item, meta_addresses, address_reg, row_type_reg, vnir_row_widths, swir_row_pixels) is
+        begin 
+            if (state = s2_write_cmd and meta_active = '1') then
+                master_cmd_out.control_write_base      <= std_logic_vector(meta_addresses(meta_item));
+                master_cmd_out.control_write_length    <= std_logic_vector(to_unsigned(meta_words(meta_item) * FIFO_WORD_BYTES, sdram.ADDRESS_LENGTH));
+            elsif (state = s2_write_cmd) then
+                -- base address
+                master_cmd_out.control_write_base      <= std_logic_vector(address_reg); 
+
+                -- write length
+                if row_type_reg = sdram.ROW_SWIR then 
+                    master_cmd_out.control_write_length    <= std_logic_vector(to_unsigned(swir_row_bytes(swir_row_pixels), sdram.ADDRESS_LENGTH));
+                elsif (row_type_reg /= sdram.ROW_NONE) then 
+                    master_cmd_out.control_write_length    <= std_logic_vector(to_unsigned(vnir_row_bytes(vnir_row_widths(sdram.vnir_index(row_type_reg))), sdram.ADDRESS_LENGTH));
+                else 
+                    master_cmd_out.control_write_length    <= (others => '0');
+                end if;
             else 
+                master_cmd_out.control_write_base      <= (others => '0');
                 master_cmd_out.control_write_length    <= (others => '0');
             end if;
-        else 
-            master_cmd_out.control_write_base      <= (others => '0');
-            master_cmd_out.control_write_length    <= (others => '0');
+        end process;
+    end generate SERIAL_GEN;
+
+    PIPELINED_GEN : if PIPELINED generate
+
+        CMD_FIFO : entity work.row_fifo generic map (
+            WORD_SIZE => CMD_WIDTH,
+            NUM_WORDS => CMD_FIFO_DEPTH,
+            SHOWAHEAD => "ON"
+        ) port map (
+            aclr    => cmd_clear,
+            clock   => clock,
+            data    => cmd_in,
+            rdreq   => cmd_rdreq,
+            wrreq   => cmd_wrreq,
+            empty   => cmd_empty,
+            full    => cmd_full,
+            q       => cmd_out
+        );
+
+        SKID_FIFO : entity work.row_fifo generic map (
+            WORD_SIZE => SKID_WIDTH,
+            NUM_WORDS => SKID_DEPTH,
+            SHOWAHEAD => "ON"
+        ) port map (
+            aclr    => cmd_clear,
+            clock   => clock,
+            data    => skid_in,
+            rdreq   => skid_rdreq,
+            wrreq   => buffer_transmitting,
+            empty   => skid_empty,
+            full    => open,
+            q       => skid_out
+        );
+
+        cmd_clear <= '1' when reset_n = '0' else '0';
+
+        -- Each row word goes into the skid fifo, tagged with the row's command on its first word
+        skid_in <= (buffer_transmitting and not transmitting_prev) &
+                   std_logic_vector(address) & row_bytes(row_type) & row_data;
+        skid_first <= skid_out(SKID_WIDTH-1);
+
+        -- A header or trailer can only go in before a row's first word, or when no row is coming in
+        between_rows <= '1' when (skid_count = 0 and buffer_transmitting = '0') or
+                                 (skid_empty = '0' and skid_first = '1') else '0';
+
+        meta_start <= '1' when meta_active = '0' and meta_pending /= NO_META and between_rows = '1' and
+                               cmd_count < CMD_FIFO_DEPTH-1 and master_cmd_in.user_buffer_full = '0' else '0';
+
+        skid_rdreq <= '1' when meta_active = '0' and meta_start = '0' and skid_empty = '0'
+                               and master_cmd_in.user_buffer_full = '0' else '0';
+
+        meta_sel <= meta_next when meta_start = '1' else meta_item;
+        meta_word_sel <= 0 when meta_start = '1' else meta_index;
+        meta_data <= meta_words_in(meta_sel)(meta_word_sel);
+
+        -- The next command can go out once the master is done with the current one. control_done
+        -- only drops the clock cycle after control_go, so a command is never issued two cycles in a row
+        cmd_rdreq <= '1' when cmd_empty = '0' and master_cmd_in.control_done = '1' and control_go = '0' else '0';
+
+        process (reset_n, clock) is
+            variable cmd_count_v : integer range 0 to CMD_FIFO_DEPTH;
+        begin
+            if (reset_n = '0') then
+                transmitting_prev <= '0';
+                cmd_wrreq <= '0';
+                cmd_in <= (others => '0');
+                cmd_count <= 0;
+                skid_count <= 0;
+                meta_pending <= NO_META;
+                meta_active <= '0';
+                meta_item <= META_VNIR_HEADER;
+                meta_index <= 0;
+                write_buffer <= '0';
+                buffer_data <= (others => '0');
+                control_go <= '0';
+                control_base <= (others => '0');
+                control_length <= (others => '0');
+            elsif rising_edge(clock) then
+                transmitting_prev <= buffer_transmitting;
+                meta_pending <= meta_pending or meta_set;
+
+                if (buffer_transmitting = '1' and skid_rdreq = '0') then
+                    skid_count <= skid_count + 1;
+                elsif (buffer_transmitting = '0' and skid_rdreq = '1') then
+                    skid_count <= skid_count - 1;
+                end if;
+
+                -- One word goes to the master per clock cycle: the rest of a header, the start of a
+                -- header or trailer along with its command, or a row word (along with its command
+                -- if it's the row's first)
+                cmd_count_v := cmd_count;
+                cmd_wrreq <= '0';
+                write_buffer <= '0';
+                if (meta_active = '1') then
+                    write_buffer <= '1';
+                    buffer_data <= meta_data;
+                    if (meta_index = meta_words(meta_item)-1) then
+                        meta_active <= '0';
+                        meta_index <= 0;
+                    else
+                        meta_index <= meta_index + 1;
+                    end if;
+                elsif (meta_start = '1') then
+                    meta_pending(meta_next) <= '0';
+                    cmd_in <= std_logic_vector(meta_addresses(meta_next)) &
+                              std_logic_vector(to_unsigned(meta_words(meta_next) * FIFO_WORD_BYTES, sdram.ADDRESS_LENGTH));
+                    cmd_wrreq <= '1';
+                    cmd_count_v := cmd_count_v + 1;
+                    write_buffer <= '1';
+                    buffer_data <= meta_data;
+                    meta_item <= meta_next;
+                    if (meta_words(meta_next) > 1) then
+                        meta_active <= '1';
+                        meta_index <= 1;
+                    end if;
+                elsif (skid_rdreq = '1') then
+                    if (skid_first = '1') then
+                        cmd_in <= skid_out(SKID_WIDTH-2 downto FIFO_WORD_LENGTH);
+                        cmd_wrreq <= '1';
+                        cmd_count_v := cmd_count_v + 1;
+                    end if;
+                    write_buffer <= '1';
+                    buffer_data <= skid_out(FIFO_WORD_LENGTH-1 downto 0);
+                end if;
+
+                control_go <= cmd_rdreq;
+                if (cmd_rdreq = '1') then
+                    control_base <= cmd_out(CMD_WIDTH-1 downto sdram.ADDRESS_LENGTH);
+                    control_length <= cmd_out(sdram.ADDRESS_LENGTH-1 downto 0);
+                    cmd_count_v := cmd_count_v - 1;
+                end if;
+                cmd_count <= cmd_count_v;
+            end if;
+        end process;
+
+        -- Only one row can be on its way from the imaging buffer at a time, so a row is requested
+        -- whenever there's room for its command, one header or trailer's, and its data in the
+        -- skid fifo
+        next_row_req <= '1' when buffer_transmitting = '0' and cmd_wrreq = '0' and cmd_count < CMD_FIFO_DEPTH-1
+                                 and skid_count = 0 else '0';
+        sdram_busy <= '1' when cmd_empty = '0' or cmd_wrreq = '1' or control_go = '1'
+                               or master_cmd_in.control_done = '0' or skid_count /= 0 or write_buffer = '1'
+                               or meta_active = '1' or meta_pending /= NO_META else '0';
+
+        master_cmd_out.control_fixed_location  <= '0';
+        master_cmd_out.control_go              <= control_go;
+        master_cmd_out.control_write_base      <= control_base when control_go = '1' else (others => '0');
+        master_cmd_out.control_write_length    <= control_length when control_go = '1' else (others => '0');
+
+        master_cmd_out.user_write_buffer       <= write_buffer;
+        master_cmd_out.user_buffer_data        <= buffer_data when write_buffer = '1' else (others => '0');
+
+    end generate PIPELINED_GEN;
+
+    perf_counters : process (reset_n, clock) is
+    begin
+        if (reset_n = '0') then
+            write_cycles <= (others => '0');
+            wait_cycles <= (others => '0');
+        elsif rising_edge(clock) then
+            if (perf_clear = '1') then
+                write_cycles <= (others => '0');
+                wait_cycles <= (others => '0');
+            else
+                if (master_cmd_in.control_done = '0') then
+                    write_cycles <= write_cycles + 1;
+                end if;
+                if (next_row_req = '1' and buffer_transmitting = '0') then
+                    wait_cycles <= wait_cycles + 1;
+                end if;
+            end if;
         end if;
-    end process;
-    
-    address_reg <= address; -- TODO: FIX
+    end process perf_counters;
 
 end architecture;
\ No newline at end of file
@@ -23,6 +23,8 @@ use work.vnir;
 use work.swir_types.all;
 use work.sdram;
 use work.fpga.all;
+use work.ccsds123;
+use work.img_buffer_pkg.all;
 
 entity header_creator is 
     port (
@@ -37,29 +39,174 @@ entity header_creator is
         vnir_rows       : in integer;
         swir_rows       : in integer;
 
-        --Flag indicating the imager is working
-        img_config_done : in std_logic;
+        -- SWIR rows co-added into each row written (see `swir_row_coadder`), so the image has
+        -- swir_rows / swir_coadd_rows rows
+        swir_coadd_rows : in integer range 1 to swir_max_coadd_rows := 1;
+
+        -- Pixels per row, fewer than vnir.ROW_WIDTH and swir_row_width when the rows are binned or cropped
+        vnir_row_widths : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);
+        swir_row_pixels : in integer := swir_row_width;
+
+        --Flags indicating each imager is working, set from when its image is configured until it's done
+        vnir_img_config_done : in std_logic;
+        swir_img_config_done : in std_logic;
+
+        --Whether images are compressed: the compression setting for the next imaging session, and
+        --the compressor's setting for the current one (see `ccsds123_compressor`)
+        compress        : in std_logic;
+        compressing     : in std_logic;
+
+        --Image status, for the trailers
+        vnir_rows_written : in row_count_a;         -- rows actually written, per VNIR band
+        swir_rows_written : in natural;
+        vnir_compress_overflow : in std_logic;
+        swir_compress_overflow : in std_logic;
+        vnir_row_dropped : in std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);  -- pulsed by the imaging buffer for each row
+        swir_row_dropped : in std_logic;                                    -- it drops (VNIR indexed by sdram.vnir_index)
+
+        --Where the images are, for the catalog entries
+        vnir_start_address : in sdram.address_t;
+        vnir_end_address : in sdram.address_t;
+        swir_start_address : in sdram.address_t;
+        swir_end_address : in sdram.address_t;
 
         --Headers
         swir_img_header : out sdram.header_t;
-        vnir_img_header : out sdram.header_t
+        vnir_img_header : out sdram.header_t;
+
+        --Trailers, valid once the sensor's img_config_done falls at the end of its image
+        swir_img_trailer : out sdram.trailer_t;
+        vnir_img_trailer : out sdram.trailer_t;
+
+        --Catalog entries, valid along with the trailers
+        swir_catalog_entry : out sdram.catalog_entry_t;
+        vnir_catalog_entry : out sdram.catalog_entry_t
     );
 end entity header_creator;
 
 architecture rtl of header_creator is
+    --Trailer status word of an image
+    pure function status_word(dropped : unsigned(15 downto 0); overflow : std_logic; compressed : std_logic)
+                              return std_logic_vector is
+    begin
+        return std_logic_vector(dropped) &                              --Rows dropped by the imaging buffer (16 bits)
+               "00000000000000" &                                       --Reserved (14 bits)
+               overflow &                                               --Compressed rows didn't fit (1 bit)
+               compressed;                                              --Compressed (1 bit)
+    end function status_word;
+
+    --Rows dropped during an image so far, saturated to 16 bits, plus the rows dropped on a clock cycle
+    pure function add_dropped(dropped : unsigned(15 downto 0); rows : std_logic_vector) return unsigned is
+        variable sum : unsigned(15 downto 0) := dropped;
+    begin
+        for i in rows'range loop
+            if rows(i) = '1' and sum /= 2**16-1 then
+                sum := sum + 1;
+            end if;
+        end loop;
+        return sum;
+    end function add_dropped;
+
+    --VNIR trailer past its first word: each band's row width, then the rows written of the bands past
+    --the first three, both in sdram.vnir_index order
+    pure function band_words(widths : sdram.vnir_row_widths_t; rows : row_count_a) return std_logic_vector is
+        variable words  : std_logic_vector (sdram.TRAILER_LENGTH-129 downto 0) := (others => '0');
+        variable top    : integer := words'high;
+    begin
+        for b in 0 to NUM_VNIR_ROW_FIFO-1 loop
+            words(top downto top-15) := std_logic_vector(to_unsigned(widths(b), 16));
+            top := top - 16;
+        end loop;
+        for b in 3 to NUM_VNIR_ROW_FIFO-1 loop
+            words(top downto top-15) := std_logic_vector(to_unsigned(rows(b), 16));
+            top := top - 16;
+        end loop;
+        return words;
+    end function band_words;
+
+    --Pixels in the widest VNIR band's rows
+    pure function widest(widths : sdram.vnir_row_widths_t) return natural is
+        variable width : natural := 0;
+    begin
+        for b in widths'range loop
+            width := maximum(width, widths(b));
+        end loop;
+        return width;
+    end function widest;
+
     --Counter variable for the user defined bits indicating image number
     signal counter                  : unsigned (7 downto 0) := "00000000";
-    signal prev_img_config_done     : std_logic;
+    signal vnir_config_prev         : std_logic;
+    signal swir_config_prev         : std_logic;
+    signal vnir_rise                : std_logic;
+    signal swir_rise                : std_logic;
 
     --Buffer headers
     signal swir_buff_header : sdram.header_t;
     signal vnir_buff_header : sdram.header_t;
+
+    --Whether an image configured on this clock cycle is compressed: the compressor only takes on
+    --compress when an image starts while neither sensor is imaging
+    signal compressed_now   : std_logic;
+
+    --Compression parameters, all zero if the image isn't compressed
+    signal compression_metadata : std_logic_vector(ccsds123.PREDICTOR_METADATA_LENGTH+ccsds123.ENTROPY_METADATA_LENGTH+7 downto 0);
+
+    --Buffer trailers
+    signal swir_buff_trailer : sdram.trailer_t;
+    signal vnir_buff_trailer : sdram.trailer_t;
+
+    --Values latched at the start of each sensor's image for its trailers
+    signal vnir_compressed  : std_logic;
+    signal vnir_counter     : unsigned (7 downto 0);
+    signal vnir_timestamp   : timestamp_t;
+    signal vnir_widths_reg  : sdram.vnir_row_widths_t;
+    signal swir_compressed  : std_logic;
+    signal swir_counter     : unsigned (7 downto 0);
+    signal swir_timestamp   : timestamp_t;
+    signal vnir_start       : sdram.address_t;
+    signal vnir_end         : sdram.address_t;
+    signal swir_start       : sdram.address_t;
+    signal swir_end         : sdram.address_t;
+
+    --Buffer catalog entries
+    signal swir_buff_entry  : sdram.catalog_entry_t;
+    signal vnir_buff_entry  : sdram.catalog_entry_t;
+
+    --Rows dropped during each sensor's current image
+    signal vnir_dropped     : unsigned (15 downto 0);
+    signal swir_dropped     : unsigned (15 downto 0);
+
+    --Trailer status words
+    signal vnir_status      : std_logic_vector (31 downto 0);
+    signal swir_status      : std_logic_vector (31 downto 0);
+
+    --Row counts of each sensor's next image, which are only given for a clock cycle when it's
+    --configured, and of its current image, taken on when it starts. A row count given while the
+    --sensor is busy is ignored by the memory map, so it mustn't change the image in progress
+    signal vnir_rows_next   : integer;
+    signal swir_rows_next   : integer;
+    signal swir_coadd_next  : integer range 1 to swir_max_coadd_rows;
+    signal vnir_rows_reg    : integer;
+    signal swir_coadd_reg   : integer range 1 to swir_max_coadd_rows;
+
+    --SWIR rows in the next and current images, once co-added
+    signal swir_rows_out_next : unsigned (15 downto 0);
+    signal swir_rows_out    : unsigned (15 downto 0);
 begin
+    vnir_rise <= vnir_img_config_done and not vnir_config_prev;
+    swir_rise <= swir_img_config_done and not swir_config_prev;
+
+    swir_rows_out_next <= resize(coadd_divide(to_unsigned(swir_rows_next, swir_coadd_sum_bits), swir_coadd_next), 16);
+
+    compressed_now <= compress when vnir_config_prev = '0' and swir_config_prev = '0' else compressing;
+
+
     --Values for the headers
     swir_buff_header <= std_logic_vector(timestamp) &                    --Timestamp (32 bits)
                         std_logic_vector(counter) &                      --User Defined [img number defined by counter] (8 bits)
-                        "0000001000000000" &                             --X Size [512 px/row for swir] (16 bits)
-                        std_logic_vector(to_unsigned(swir_rows, 16)) &   --Y Size (16 bits)
+                        std_logic_vector(to_unsigned(swir_row_pixels, 16)) & --X Size [px/row for swir after cropping] (16 bits)
+                        std_logic_vector(swir_rows_out_next) &           --Y Size [rows once co-added] (16 bits)
                         "0000000000000001" &                             --Z Size [1 for swir] (16 bits)
                         '0' &                                            --Sample Type (1 bit)
                         "11" &                                           --Reserved (2 bits)
@@ -68,42 +215,166 @@ begin
                         "0000000000000000" &                             --Interleave Depth (16 bits)
                         "00" &                                           --Reserved
                         "001" &                                          --Output word length (3 bits)
-                        '0' &                                            --Entropy Encoding
-                        "0000000000";                                    --Reserved (10 bits)
+                        compressed_now &                                 --Entropy Encoding [set when the image is compressed]
+                        "0000000000" &                                   --Reserved (10 bits)
+                        compression_metadata;                            --Compression parameters (64 bits)
     
     
     vnir_buff_header <= std_logic_vector(timestamp) &                    --Timestamp (32 bits)
                         std_logic_vector(counter) &                      --User Defined [img number defined by counter] (8 bits)
-                        "0000100000000000" &                             --X Size [2048 px/row for vnir] (16 bits)
-                        std_logic_vector(to_unsigned(vnir_rows, 16)) &   --Y Size (16 bits)
-                        "0000000000000011" &                             --Z Size [3 for vnir] (16 bits)
+                        std_logic_vector(to_unsigned(widest(vnir_row_widths), 16)) & --X Size [px/row of the widest vnir band, each band's is in the trailer] (16 bits)
+                        std_logic_vector(to_unsigned(vnir_rows_next, 16)) & --Y Size (16 bits)
+                        std_logic_vector(to_unsigned(NUM_VNIR_ROW_FIFO, 16)) & --Z Size [one per vnir band] (16 bits)
                         '0' &                                            --Sample Type (1 bit)
                         "11" &                                           --Reserved (2 bits)
-                        "1010" &                                         --Dynamic Range [10 bit/px for vnir] (4 bits)
+                        std_logic_vector(to_unsigned(vnir.ROW_PIXEL_BITS mod 16, 4)) & --Dynamic Range [ROW_PIXEL_BITS bit/px for vnir, 0 for 16] (4 bits)
                         '1' &                                            --BSQ format (1 bit)
                         "0000000000000000" &                             --Interleave Depth (16 bits)
                         "00" &                                           --Reserved
                         "001" &                                          --Output word length (3 bits)
-                        '0' &                                            --Entropy Encoding
-                        "0000000000";                                    --Reserved (10 bits)
+                        compressed_now &                                 --Entropy Encoding [set when the image is compressed]
+                        "0000000000" &                                   --Reserved (10 bits)
+                        compression_metadata;                            --Compression parameters (64 bits)
     
+    compression_metadata <= ccsds123.predictor_metadata &                --Predictor Metadata (40 bits)
+                            ccsds123.entropy_metadata &                  --Entropy Coder Metadata (16 bits)
+                            "0000000" & '1'                              --Reserved (7 bits), compressed (1 bit)
+                            when compressed_now = '1' else (others => '0');
+
+    vnir_status <= status_word(vnir_dropped, vnir_compress_overflow, vnir_compressed);
+    swir_status <= status_word(swir_dropped, swir_compress_overflow, swir_compressed);
+
+    swir_buff_trailer <= std_logic_vector(to_unsigned(swir_rows_written, 16)) &                         --SWIR rows (16 bits)
+                         std_logic_vector(to_unsigned(swir_coadd_reg, 16)) &                            --Rows co-added into each row (16 bits)
+                         x"0000" &                                                                      --Reserved (16 bits)
+                         x"0000" &                                                                      --Reserved (16 bits)
+                         swir_status &                                                                  --Status (32 bits)
+                         std_logic_vector(swir_counter) &                                               --Image number (8 bits)
+                         x"000000" &                                                                    --Reserved (24 bits)
+                         (sdram.TRAILER_LENGTH-129 downto 0 => '0');                                    --Reserved (VNIR band words)
+
+    vnir_buff_trailer <= std_logic_vector(to_unsigned(vnir_rows_written(1), 16)) &                       --Blue rows (16 bits)
+                         std_logic_vector(to_unsigned(vnir_rows_written(0), 16)) &                       --Red rows (16 bits)
+                         std_logic_vector(to_unsigned(vnir_rows_written(2), 16)) &                       --NIR rows (16 bits)
+                         x"0000" &                                                                      --Reserved (16 bits)
+                         vnir_status &                                                                  --Status (32 bits)
+                         std_logic_vector(vnir_counter) &                                               --Image number (8 bits)
+                         x"000000" &                                                                    --Reserved (24 bits)
+                         band_words(vnir_widths_reg, vnir_rows_written);                                --Band row widths and extra band rows
+
+    swir_buff_entry <= std_logic_vector(swir_timestamp) &                                               --Timestamp (64 bits)
+                       std_logic_vector(swir_counter) &                                                 --Image number (8 bits)
+                       x"01" &                                                                          --Partition [1 for swir] (8 bits)
+                       std_logic_vector(swir_rows_out) &                                                --Rows (16 bits)
+                       std_logic_vector(swir_start) &                                                   --Start address (32 bits)
+                       std_logic_vector(swir_end) &                                                     --End address (32 bits)
+                       swir_status &                                                                    --Status (32 bits)
+                       x"0000000000000000";                                                             --Reserved (64 bits)
+
+    vnir_buff_entry <= std_logic_vector(vnir_timestamp) &                                               --Timestamp (64 bits)
+                       std_logic_vector(vnir_counter) &                                                 --Image number (8 bits)
+                       x"00" &                                                                          --Partition [0 for vnir] (8 bits)
+                       std_logic_vector(to_unsigned(vnir_rows_reg, 16)) &                               --Rows (16 bits)
+                       std_logic_vector(vnir_start) &                                                   --Start address (32 bits)
+                       std_logic_vector(vnir_end) &                                                     --End address (32 bits)
+                       vnir_status &                                                                    --Status (32 bits)
+                       x"0000000000000000";                                                             --Reserved (64 bits)
+
     counter_process : process (clock) is
     begin
         if (reset_n = '0') then
             swir_img_header <= std_logic_vector(to_unsigned(0, sdram.HEADER_LENGTH));
             vnir_img_header <= std_logic_vector(to_unsigned(0, sdram.HEADER_LENGTH));
+            swir_img_trailer <= (others => '0');
+            vnir_img_trailer <= (others => '0');
+            swir_catalog_entry <= (others => '0');
+            vnir_catalog_entry <= (others => '0');
+
+            vnir_compressed <= '0';
+            vnir_counter <= to_unsigned(0, 8);
+            vnir_timestamp <= to_unsigned(0, timestamp_t'length);
+            vnir_widths_reg <= (others => vnir.ROW_WIDTH);
+            swir_compressed <= '0';
+            swir_counter <= to_unsigned(0, 8);
+            swir_timestamp <= to_unsigned(0, timestamp_t'length);
+            vnir_dropped <= (others => '0');
+            swir_dropped <= (others => '0');
+            vnir_start <= sdram.UNDEFINED_ADDRESS;
+            vnir_end <= sdram.UNDEFINED_ADDRESS;
+            swir_start <= sdram.UNDEFINED_ADDRESS;
+            swir_end <= sdram.UNDEFINED_ADDRESS;
 
             counter <= to_unsigned(0, 8);
-            prev_img_config_done <= '0';
+            vnir_config_prev <= '0';
+            swir_config_prev <= '0';
+            vnir_rows_next <= 0;
+            swir_rows_next <= 0;
+            swir_coadd_next <= 1;
+            vnir_rows_reg <= 0;
+            swir_coadd_reg <= 1;
+            swir_rows_out <= (others => '0');
         elsif rising_edge(clock) then
-            if (prev_img_config_done /= img_config_done and prev_img_config_done = '0') then
-                swir_img_header <= swir_buff_header;
+            if (vnir_rows > 0) then
+                vnir_rows_next <= vnir_rows;
+            end if;
+            if (swir_rows > 0) then
+                swir_rows_next <= swir_rows;
+                swir_coadd_next <= swir_coadd_rows;
+            end if;
+
+            --Rows dropped during each image, from when it's configured
+            if (vnir_rise = '1') then
+                vnir_dropped <= (others => '0');
+            elsif (vnir_img_config_done = '1') then
+                vnir_dropped <= add_dropped(vnir_dropped, vnir_row_dropped);
+            end if;
+            if (swir_rise = '1') then
+                swir_dropped <= (others => '0');
+            elsif (swir_img_config_done = '1') then
+                swir_dropped <= add_dropped(swir_dropped, (0 => swir_row_dropped));
+            end if;
+
+            --Each sensor's image is numbered when it's configured; images configured together share a number
+            if (vnir_rise = '1') then
                 vnir_img_header <= vnir_buff_header;
 
+                vnir_rows_reg <= vnir_rows_next;
+                vnir_widths_reg <= vnir_row_widths;
+                vnir_compressed <= compressed_now;
+                vnir_counter <= counter;
+                vnir_timestamp <= timestamp;
+                vnir_start <= vnir_start_address;
+                vnir_end <= vnir_end_address;
+            end if;
+
+            if (swir_rise = '1') then
+                swir_img_header <= swir_buff_header;
+
+                swir_rows_out <= swir_rows_out_next;
+                swir_coadd_reg <= swir_coadd_next;
+                swir_compressed <= compressed_now;
+                swir_counter <= counter;
+                swir_timestamp <= timestamp;
+                swir_start <= swir_start_address;
+                swir_end <= swir_end_address;
+            end if;
+
+            if (vnir_rise = '1' or swir_rise = '1') then
                 counter <= counter + 1;
             end if;
 
-            prev_img_config_done <= img_config_done;
+            if (vnir_config_prev = '1' and vnir_img_config_done = '0') then
+                vnir_img_trailer <= vnir_buff_trailer;
+                vnir_catalog_entry <= vnir_buff_entry;
+            end if;
+
+            if (swir_config_prev = '1' and swir_img_config_done = '0') then
+                swir_img_trailer <= swir_buff_trailer;
+                swir_catalog_entry <= swir_buff_entry;
+            end if;
+
+            vnir_config_prev <= vnir_img_config_done;
+            swir_config_prev <= swir_img_config_done;
         end if;
     end process;
 end architecture;
\ No newline at end of file
@@ -22,27 +22,73 @@ library work;
 use work.img_buffer_pkg.all;
 use work.swir_types.all;
 use work.sdram;
+use work.sdram."=";
+use work.sdram."/=";
 use work.fpga.all;
 
 use work.vnir;
 use work.vnir."/=";
 
--- possible bug: what happens if you get row_request at the same clock cycle as when you finish transmitting?
--- bug found: if you keep getting swir pixels every clock cycle, the first stage of swir breaks. 
---            it needs one clock cycle to write the 128 bit word to fifo
+-- VNIR rows come in as a stream of fragments of consecutive pixels (see `row_collator`), which are
+-- packed into fifo words as they come in, rather than waiting for the whole row. The stream is an
+-- Avalon-ST sink with a readyLatency of 0: a fragment is taken in on each clock cycle on which
+-- vnir_fragment_available /= ROW_NONE and vnir_fragment_ready = '1'. vnir_fragment_ready only depends
+-- on registers, so it can't form a combinational loop with the source's valid.
+--
+-- Each VNIR fifo holds up to VNIR_ROWS rows of its band, so that rows can keep coming in from the
+-- VNIR subsystem while the command creator is waiting on a slow SDRAM burst. If a band's fifo is
+-- already holding VNIR_ROWS rows when a new row of that band comes in, the new row is dropped and
+-- overflow_count is incremented. The rows of VNIR band b are vnir_row_widths(b) pixels wide (fewer
+-- than vnir.ROW_WIDTH when the VNIR subsystem bins or crops them), which must only change between
+-- images.
+--
+-- SWIR pixels can come in every clock cycle. The word being filled and the word being written to
+-- the SWIR fifo are held in separate registers, so a full word is handed off to the fifo on the
+-- same clock cycle that its last pixel comes in. The SWIR fifo holds up to SWIR_ROWS rows; a row
+-- that starts while it's full is dropped and counted in overflow_count, like a VNIR row. SWIR rows
+-- are swir_row_pixels pixels wide (fewer than swir_row_width when they are cropped), which must be a
+-- whole number of fifo words and only change between images.
+--
+-- Each row stored is followed in its fifo by a trailer word (see sdram.row_metadata_t), holding
+-- the capture time and row_index (per band, counting dropped rows) taken when its first fragment or
+-- pixel came in, and overflow_count at that time. The capture time is a free-running count of clock
+-- cycles since reset, so rows can be timed against each other (and against the image timestamp
+-- by the MCU, which knows when it started the image). The trailer is written on the clock cycle after the
+-- row's last word, which is always free since the next row's first word takes longer to fill, and
+-- the row is ready to be sent once it's in. The trailer is sent as the row's last word.
+--
+-- A row is sent out on the rising edge of row_request (or as soon as one is stored, if none was
+-- stored when the request came in). transmitting is held high for exactly the clock cycles that
+-- fragment_out holds a valid word of the row.
+--
+-- vnir_row_dropped (indexed by sdram.vnir_index) and swir_row_dropped pulse for a clock cycle when
+-- a row is dropped, so the memory map can count it towards its image like the rows it stores.
+--
+-- For performance monitoring, rows_received counts the rows of each type coming in (whether they
+-- are dropped or not), and rows_high_water holds the most rows each fifo has held at once. Both
+-- are cleared by perf_clear.
 
 entity imaging_buffer is
+    generic(
+        VNIR_ROWS           : integer := VNIR_BUFFER_ROWS;
+        SWIR_ROWS           : integer := SWIR_BUFFER_ROWS
+    );
     port(
         --Control Signals
         clock               : in std_logic;
         reset_n             : in std_logic;
 
         --Image data inputs and flags
-        vnir_row            : in vnir.row_t;
-        vnir_row_ready      : in vnir.row_type_t;
+        vnir_fragment           : in vnir.row_fragment_t;
+        vnir_fragment_available : in vnir.row_type_t;
+        vnir_fragment_first     : in std_logic;
+        vnir_fragment_last      : in std_logic;
+        vnir_fragment_ready     : out std_logic;
+        vnir_row_widths         : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);
 
         swir_pixel          : in swir_pixel_t;
         swir_pixel_ready    : in std_logic;
+        swir_row_pixels     : in integer := swir_row_width;
 
         --Input from Command Creator
         row_request         : in std_logic;
@@ -50,7 +96,20 @@ entity imaging_buffer is
         --Outputs
         fragment_out        : out row_fragment_t;
         fragment_type       : out sdram.row_type_t;
-        transmitting        : out std_logic
+        transmitting        : out std_logic;
+
+        --Buffer occupancy
+        vnir_rows_stored    : out row_count_a;
+        vnir_buffer_empty   : out std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+        vnir_buffer_full    : out std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+        overflow_count      : out unsigned(31 downto 0);
+        vnir_row_dropped    : out std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+        swir_row_dropped    : out std_logic;
+
+        --Performance counters
+        perf_clear          : in std_logic := '0';
+        rows_received       : out sdram.row_counter_a;
+        rows_high_water     : out sdram.row_high_water_a
     );
 end entity imaging_buffer;
 
@@ -59,32 +118,47 @@ architecture rtl of imaging_buffer is
     signal fifo_clear           : std_logic;
     
     --signals for the first stage of the vnir pipeline
-    signal vnir_row_ready_i      : vnir.row_type_t;
-    signal new_row_in            : std_logic;
-    signal vnir_row_fragments    : vnir_row_fragment_a;
-
-    signal row_buffer           : row_buffer_a;
-    signal fifo_write           : row_type_tracker_a;
-    signal row_type_stored      : row_type_tracker_a;
+    signal vnir_beat_accept     : std_logic;
 
     --Signals for the first stage of the swir pipeline
-    signal swir_bit_counter     : integer;
+    signal swir_bit_counter     : integer range 0 to FIFO_WORD_LENGTH-SWIR_PIXEL_BITS;
+    signal swir_word_counter    : integer range 0 to SWIR_FIFO_DEPTH-1;
     signal swir_fragment        : row_fragment_t;
+    signal swir_drop            : std_logic;    -- the current swir row didn't fit in the fifo
+    signal swir_metadata        : sdram.row_metadata_t;
+    signal swir_trailer_pending : std_logic;    -- the current swir row's words are in, its trailer isn't
 
     --signals for the second stage of the vnir pipeline    
-    signal vnir_frag_counter    : frag_count_a;
-    signal vnir_store_counter   : natural range 0 to NUM_VNIR_ROW_FIFO;
-    signal num_store_vnir_rows  : natural range 0 to NUM_VNIR_ROW_FIFO;
-
-    --Signal for the second stage of the swir pipeline
-    signal swir_fragment_ready  : std_logic;
-    signal swir_fifo_stored     : std_logic;
+    signal gearbox              : std_logic_vector(GEARBOX_BITS-1 downto 0);
+    signal gearbox_count        : integer range 0 to GEARBOX_BITS;     -- number of bits held in the gearbox
+    signal gearbox_band         : integer range 0 to NUM_VNIR_ROW_FIFO-1;
+    signal gearbox_flush        : std_logic;    -- the end of the current row has been taken in
+    signal gearbox_drop         : std_logic;    -- the current row didn't fit in its fifo
+    signal gearbox_metadata     : sdram.row_metadata_t;
+    signal vnir_trailer_pending : std_logic;    -- the current row's words are in, its trailer isn't
+
+    --Rows held by each vnir fifo, including the one being written (rows_held), and rows
+    --that have been completely written and can be transmitted (rows_ready)
+    signal rows_held            : row_count_a;
+    signal rows_ready           : row_count_a;
+    signal overflow_count_i     : unsigned(31 downto 0);
+
+    --Rows of each type that have come in since reset, and clock cycles since reset, for the trailers
+    signal row_index            : sdram.row_counter_a;
+    signal capture_time         : capture_time_t;
+
+    --Rows held by the swir fifo (including the one being written), and rows ready to be sent
+    signal swir_rows_held       : natural range 0 to SWIR_ROWS;
+    signal swir_rows_ready      : natural range 0 to SWIR_ROWS;
+
+    --Performance counters
+    signal rows_received_i      : sdram.row_counter_a;
+    signal rows_high_water_i    : sdram.row_high_water_a;
 
     --Signals for the third stage of the swir pipeline
     signal swir_link_rdreq      : std_logic_vector(0 to NUM_SWIR_ROW_FIFO-1);
     signal swir_link_wrreq      : std_logic_vector(0 to NUM_SWIR_ROW_FIFO-1);
     signal swir_fifo_empty      : std_logic_vector(0 to NUM_SWIR_ROW_FIFO-1);
-    signal swir_fifo_full       : std_logic_vector(0 to NUM_SWIR_ROW_FIFO-1);
     signal swir_link_in         : swir_link_a;
     signal swir_link_out        : swir_link_a;
 
@@ -95,299 +169,377 @@ architecture rtl of imaging_buffer is
     signal vnir_link_in         : vnir_link_a;
     signal vnir_link_out        : vnir_link_a;
 
-    signal transmitting_i       : std_logic;
-    signal swir_out_counter     : natural range 0 to SWIR_FIFO_DEPTH+1;
-    signal vnir_out_counter     : natural range 0 to VNIR_FIFO_DEPTH+1;
+    --Signals for the final stage
+    signal row_request_prev     : std_logic;
+    signal row_requested        : std_logic;
+    signal read_words_left      : natural range 0 to VNIR_FIFO_DEPTH;
+    signal read_type            : sdram.row_type_t;   -- row type of the word being read this cycle
+    signal read_type_p1         : sdram.row_type_t;   -- row type of the word on the fifo outputs
 
 begin
+
+    --The first stage of the vnir pipeline: a fragment can be taken into the gearbox if, after this clock
+    --cycle's word is sent out, there's still room for it. Until then, the VNIR subsystem holds on to it.
+    --As the gearbox holds a word and a fragment, this doesn't depend on the pixel size.
+    vnir_fragment_ready <= '1' when gearbox_flush = '0' and gearbox_count <= 2*FIFO_WORD_LENGTH else '0';
+    vnir_beat_accept <= '1' when gearbox_flush = '0' and gearbox_count <= 2*FIFO_WORD_LENGTH
+                            and vnir_fragment_available /= vnir.ROW_NONE else '0';
     
     VNIR_FIFO_GEN : for i in 0 to NUM_VNIR_ROW_FIFO-1 generate
-        VNIR_FIFO : entity work.VNIR_ROW_FIFO port map (
+        VNIR_FIFO : entity work.row_fifo generic map (
+            WORD_SIZE => FIFO_WORD_LENGTH,
+            NUM_WORDS => (VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS) * VNIR_ROWS
+        ) port map (
             aclr    => fifo_clear,
             clock   => clock,
             data    => vnir_link_in(i),
             rdreq   => vnir_link_rdreq(i),
             wrreq   => vnir_link_wrreq(i),
             empty   => vnir_fifo_empty(i),
+            full    => open,
             q       => vnir_link_out(i)
         );
     end generate VNIR_FIFO_GEN;
 
     SWIR_FIFO_GEN : for i in 0 to NUM_SWIR_ROW_FIFO-1 generate
-        SWIR_FIFO : entity work.SWIR_ROW_FIFO port map (
+        SWIR_FIFO : entity work.row_fifo generic map (
+            WORD_SIZE => FIFO_WORD_LENGTH,
+            NUM_WORDS => (SWIR_FIFO_DEPTH + ROW_TRAILER_WORDS) * SWIR_ROWS
+        ) port map (
             aclr    => fifo_clear,
             clock   => clock,
             data    => swir_link_in(i),
             rdreq   => swir_link_rdreq(i),
             wrreq   => swir_link_wrreq(i),
             empty   => swir_fifo_empty(i),
-            full    => swir_fifo_full(i),
+            full    => open,
             q       => swir_link_out(i)
         );
     end generate SWIR_FIFO_GEN;
 
     pipeline : process (reset_n, clock) is
-        
+        variable rows_held_v        : row_count_a;
+        variable rows_ready_v       : row_count_a;
+        variable swir_rows_held_v   : natural range 0 to SWIR_ROWS;
+        variable swir_rows_ready_v  : natural range 0 to SWIR_ROWS;
+        variable overflow_count_v   : unsigned(31 downto 0);
+        variable swir_fragment_v    : row_fragment_t;
+        variable swir_drop_v        : std_logic;
+        variable gearbox_v          : std_logic_vector(GEARBOX_BITS-1 downto 0);
+        variable gearbox_count_v    : integer range 0 to GEARBOX_BITS;
+        variable band_v             : integer range 0 to NUM_VNIR_ROW_FIFO-1;
+        variable next_type          : sdram.row_type_t;
+        variable row_type_v         : sdram.row_type_t;
     begin
         if (reset_n = '0') then
             
             -- SWIR
             swir_bit_counter <= 0;
+            swir_word_counter <= 0;
             swir_fragment <= (others => '0');
+            swir_drop <= '0';
+            swir_trailer_pending <= '0';
 
-            swir_fragment_ready <= '0';
-            swir_fifo_stored <= '0';
+            swir_rows_held <= 0;
+            swir_rows_ready <= 0;
 
             swir_link_wrreq <= (others => '0');
             swir_link_rdreq <= (others => '0');
             swir_link_in <= (others => (others => '0'));
             
             -- VNIR 
-            -- First stage resets
-            vnir_row_ready_i <= vnir.ROW_NONE;
-            new_row_in       <= '0';
-            row_type_stored  <= (others => '0');
-            row_buffer       <= (others => (others => (others => '0')));
-
             --Second stage resets
-            fifo_write <= (others => '0');
-            vnir_frag_counter <= (others => 0);
-            vnir_store_counter <= 0;
+            gearbox <= (others => '0');
+            gearbox_count <= 0;
+            gearbox_band <= 0;
+            gearbox_flush <= '0';
+            gearbox_drop <= '0';
+            vnir_trailer_pending <= '0';
+            rows_held <= (others => 0);
+            rows_ready <= (others => 0);
+            overflow_count_i <= (others => '0');
+            vnir_row_dropped <= (others => '0');
+            swir_row_dropped <= '0';
+            row_index <= (others => (others => '0'));
+            capture_time <= (others => '0');
 
             --FIFO resets
             vnir_link_in <= (others => (others => '0'));
             vnir_link_rdreq <= (others => '0');
             vnir_link_wrreq <= (others => '0');
-            
-            transmitting_i <= '0';
+
+            --Final stage resets
+            row_request_prev <= '0';
+            row_requested <= '0';
+            read_words_left <= 0;
+            read_type <= sdram.ROW_NONE;
+            read_type_p1 <= sdram.ROW_NONE;
 
             -- Outputs 
             transmitting <= '0';
-            swir_out_counter <= 0;
-            vnir_out_counter <= 0;
-        
             fragment_out <= (others => '0');
             fragment_type <= sdram.ROW_NONE;
         
         elsif rising_edge(clock) then
 
-            --The first stage of the vnir pipeline, converting a VNIR row to FIFO compatible words
-            if (vnir_row_ready /= vnir.ROW_NONE) then    -- we have new row from VNIR subsystem
+            rows_held_v := rows_held;
+            rows_ready_v := rows_ready;
+            swir_rows_held_v := swir_rows_held;
+            swir_rows_ready_v := swir_rows_ready;
+            overflow_count_v := overflow_count_i;
+            capture_time <= capture_time + 1;
+            vnir_row_dropped <= (others => '0');
+            swir_row_dropped <= '0';
+
+            --The second stage of the vnir pipeline, a gearbox packing the fragments' pixels into fifo words.
+            --A word is sent to the fifo whenever the gearbox holds enough bits for one (or at the end of a row,
+            --whatever is left, padded with zeros), and a fragment is taken in whenever there is room for it
+            --(see vnir_fragment_ready)
+            vnir_link_wrreq <= (others => '0');
+            if (vnir_trailer_pending = '1') then
+                --The gearbox was emptied by the row's last word, so it has nothing to send this clock cycle
+                vnir_link_in(gearbox_band) <= sdram.row_trailer(gearbox_metadata);
+                vnir_link_wrreq(gearbox_band) <= '1';
+                vnir_trailer_pending <= '0';
+                rows_ready_v(gearbox_band) := rows_ready_v(gearbox_band) + 1;
+            end if;
 
-                new_row_in <= '1'; -- flag for next stage
-                vnir_row_ready_i <= vnir_row_ready; -- register for storing row type
+            gearbox_v := gearbox;
+            gearbox_count_v := gearbox_count;
+            if (gearbox_count >= FIFO_WORD_LENGTH or (gearbox_flush = '1' and gearbox_count > 0)) then
+                if (gearbox_drop = '0') then
+                    vnir_link_in(gearbox_band) <= gearbox(FIFO_WORD_LENGTH-1 downto 0);
+                    vnir_link_wrreq(gearbox_band) <= '1';
+                end if;
+                gearbox_v := std_logic_vector(shift_right(unsigned(gearbox), FIFO_WORD_LENGTH));
 
-                -- 64 VNIR pixels (10 bits/pixel) can be put into 5 consecutive fifo words of 128 bits each.
-                -- Since 128 is not a multiple of 10, some pixels need to be split up. 
-                -- Every 5 words (128 bits/word * 5 words = 640 bits) we get to a multiple of 10, so we can put
-                -- 64 complete pixels every 5 words.
+                if (gearbox_count > FIFO_WORD_LENGTH) then
+                    gearbox_count_v := gearbox_count - FIFO_WORD_LENGTH;
+                else
+                    gearbox_count_v := 0;
+                    if (gearbox_flush = '1') then
+                        --Last word of the row, its trailer follows
+                        gearbox_flush <= '0';
+                        if (gearbox_drop = '0') then
+                            vnir_trailer_pending <= '1';
+                        end if;
+                    end if;
+                end if;
+            end if;
 
-                -- There are 32 of these 5-word groups in total (64 pixels/group * 32 groups = 2048 pixels total)            
-                for five_word_group in 0 to 31 loop
-                    
-                    -- first word
-                    for i in 0 to 11 loop    -- put 12 full pixels in the first fifo word
-                        vnir_row_fragments(5*five_word_group)((10*(i+1))-1 downto 10*i) <= std_logic_vector(vnir_row(64*five_word_group+i));
-                    end loop;
-                    for i in 120 to 127 loop -- final 8 bits of the word are the first 8 bits of the next (13th) pixel to make up the 128 bits
-                        vnir_row_fragments(5*five_word_group)(i) <= vnir_row(64*five_word_group+12)(i-120);
-                    end loop;
-                    
-                    -- second word
-                    for i in 0 to 1 loop     -- the next word contains the last 2 pixels from the 13th pixel
-                        vnir_row_fragments(5*five_word_group+1)(i) <= vnir_row(64*five_word_group+12)(8+i);  
-                    end loop;
-                    for i in 0 to 11 loop    -- 14th to 25th pixels
-                        vnir_row_fragments(5*five_word_group+1)(((10*(i+1))+1) downto 10*i+2) <= std_logic_vector(vnir_row(64*five_word_group+13+i));
-                    end loop;
-                    for i in 122 to 127 loop -- first 6 bits of the 26th pixel
-                        vnir_row_fragments(5*five_word_group+1)(i) <= vnir_row(64*five_word_group+25)(i-122);
-                    end loop;
-                
-                    --third word 
-                    for i in 0 to 3 loop     -- last 4 bits of the 26th pixel
-                        vnir_row_fragments(5*five_word_group+2)(i) <= vnir_row(64*five_word_group+25)(6+i);  
-                    end loop;
-                    for i in 0 to 11 loop    -- 27th to 38th pixels
-                        vnir_row_fragments(5*five_word_group+2)(((10*(i+1))+3) downto 10*i+4) <= std_logic_vector(vnir_row(64*five_word_group+26+i));
-                    end loop;
-                    for i in 124 to 127 loop -- 4 bits of the 39th pixel
-                        vnir_row_fragments(5*five_word_group+2)(i) <= vnir_row(64*five_word_group+38)(i-124);
-                    end loop;
-                
-                    -- fourth word
-                    for i in 0 to 5 loop     -- rest of the 39th pixel
-                        vnir_row_fragments(5*five_word_group+3)(i) <= vnir_row(64*five_word_group+38)(4+i);  
-                    end loop;
-                    for i in 0 to 11 loop    -- 40th to 51st pixels 
-                        vnir_row_fragments(5*five_word_group+3)(((10*(i+1))+5) downto 10*i+6) <= std_logic_vector(vnir_row(64*five_word_group+39+i));
-                    end loop;
-                    for i in 126 to 127 loop -- 52nd pixel
-                        vnir_row_fragments(5*five_word_group+3)(i) <= vnir_row(64*five_word_group+51)(i-126);
-                    end loop;
+            if (vnir_beat_accept = '1') then
+                --Checking if there's room for the row when its first fragment comes in. Otherwise the row is dropped.
+                if (vnir_fragment_first = '1') then
+                    row_type_v := sdram.sdram_type(vnir_fragment_available);
+                    band_v := sdram.vnir_index(row_type_v);
+                    gearbox_band <= band_v;
+                    gearbox_metadata <= (capture_time => capture_time,
+                                         row_index => row_index(row_type_v),
+                                         band => row_type_v,
+                                         dropped => overflow_count_v(15 downto 0),
+                                         compressed => '0');
+                    row_index(row_type_v) <= row_index(row_type_v) + 1;
+                    if (rows_held_v(band_v) < VNIR_ROWS) then
+                        gearbox_drop <= '0';
+                        rows_held_v(band_v) := rows_held_v(band_v) + 1;
+                    else
+                        gearbox_drop <= '1';
+                        vnir_row_dropped(band_v) <= '1';
+                        overflow_count_v := overflow_count_v + 1;
+                    end if;
+                end if;
 
-                    --fifth word
-                    for i in 0 to 7 loop     -- 52nd pixel
-                        vnir_row_fragments(5*five_word_group+4)(i) <= vnir_row(64*five_word_group+51)(2+i);
-                    end loop;
-                    for i in 0 to 11 loop    -- 53rd to 64th pixels
-                        vnir_row_fragments(5*five_word_group+4)((10*(i+1))+7 downto 10*i+8) <= std_logic_vector(vnir_row(64*five_word_group+52+i));
-                    end loop;   
-                end loop;     
-            else 
-                vnir_row_fragments <= (others => (others => 'X'));
-                new_row_in <= '0';
-                vnir_row_ready_i <= vnir.ROW_NONE;
+                for i in 0 to vnir.FRAGMENT_WIDTH-1 loop
+                    gearbox_v(gearbox_count_v + vnir.ROW_PIXEL_BITS*(i+1) - 1 downto gearbox_count_v + vnir.ROW_PIXEL_BITS*i) := std_logic_vector(vnir_fragment(i));
+                end loop;
+                gearbox_count_v := gearbox_count_v + VNIR_BEAT_BITS;
+
+                if (vnir_fragment_last = '1') then
+                    gearbox_flush <= '1';
+                end if;
             end if;
+            gearbox <= gearbox_v;
+            gearbox_count <= gearbox_count_v;
 
-            -- VNIR stage 1.5: putting the fifo row fragments into the appropriate signal 
-            if (new_row_in = '1') then
-                case vnir_row_ready_i is 
-                    when vnir.ROW_RED   => 
-                        row_buffer(0) <= vnir_row_fragments;   -- store fragments in temp registers
-                        fifo_write(0) <= '1';                   -- start reading into fifo
-                    when vnir.ROW_BLUE  => 
-                        row_buffer(1) <= vnir_row_fragments;
-                        fifo_write(1) <= '1';
-                    when vnir.ROW_NIR   => 
-                        row_buffer(2) <= vnir_row_fragments;
-                        fifo_write(2) <= '1';
-                    when others => 
-                        report "Invalid new row input to imaging buffer" severity failure;
-                end case;
+            --The first stage of the swir pipeline, accumulating pixels to fill a word
+            swir_link_wrreq <= (others => '0');
+            if (swir_trailer_pending = '1') then
+                --The next row's first word takes more than a clock cycle to fill, so the fifo is free
+                swir_link_in(0) <= sdram.row_trailer(swir_metadata);
+                swir_link_wrreq(0) <= '1';
+                swir_trailer_pending <= '0';
+                swir_rows_ready_v := swir_rows_ready_v + 1;
             end if;
 
-            -- Second stage of the VNIR pipeline, storing data into the fifo chain
-            for i in 0 to NUM_VNIR_ROW_FIFO-1 loop  -- three second stages in parallel; one for each row fifo
-                if (fifo_write(i) = '1') then
-                    vnir_link_in(i) <= row_buffer(i)(vnir_frag_counter(i));
-                    vnir_link_wrreq(i) <= '1';
-                    vnir_frag_counter(i) <= vnir_frag_counter(i) + 1;
-        
-                    --If it's the last word getting stored, adding the type to the type buffer
-                    if (vnir_frag_counter(i) = VNIR_FIFO_DEPTH-1) then
-                        fifo_write(i) <= '0';       -- finished writing to fifo 
-                        row_type_stored(i) <= '1';  -- stored, can be transmitted now
+            if (swir_pixel_ready = '1') then 
+                --Checking if there's room for the row when its first pixel comes in
+                swir_drop_v := swir_drop;
+                if (swir_bit_counter = 0 and swir_word_counter = 0) then
+                    swir_metadata <= (capture_time => capture_time,
+                                      row_index => row_index(sdram.ROW_SWIR),
+                                      band => sdram.ROW_SWIR,
+                                      dropped => overflow_count_v(15 downto 0),
+                                      compressed => '0');
+                    row_index(sdram.ROW_SWIR) <= row_index(sdram.ROW_SWIR) + 1;
+                    if (swir_rows_held_v < SWIR_ROWS) then
+                        swir_drop_v := '0';
+                        swir_rows_held_v := swir_rows_held_v + 1;
+                    else
+                        swir_drop_v := '1';
+                        swir_row_dropped <= '1';
+                        overflow_count_v := overflow_count_v + 1;
+                    end if;
+                end if;
+                swir_drop <= swir_drop_v;
+
+                swir_fragment_v := swir_fragment;
+                swir_fragment_v(swir_bit_counter + SWIR_PIXEL_BITS - 1 downto swir_bit_counter) := swir_pixel_to_stdlogicvector(swir_pixel);
+                swir_fragment <= swir_fragment_v;
+
+                --The second stage of the swir pipeline: once the word is full it's put into the fifo chain
+                --straight away, so the fragment register is free for the next pixel on the next clock cycle
+                if (swir_bit_counter = FIFO_WORD_LENGTH - SWIR_PIXEL_BITS) then
+                    swir_link_in(0) <= swir_fragment_v;
+                    swir_link_wrreq(0) <= not swir_drop_v;
+                    swir_bit_counter <= 0;
+
+                    if (swir_word_counter = swir_row_words(swir_row_pixels)-1) then
+                        swir_word_counter <= 0;
+                        if (swir_drop_v = '0') then
+                            swir_trailer_pending <= '1';
+                        end if;
+                    else
+                        swir_word_counter <= swir_word_counter + 1;
                     end if;
                 else
-                    vnir_frag_counter(i) <= 0;      -- finished writing to fifo
-                    vnir_link_in(i) <= (others => '0');
-                    vnir_link_wrreq(i) <= '0'; 
+                    swir_bit_counter <= swir_bit_counter + SWIR_PIXEL_BITS;
                 end if;
-            end loop;
-
-            --The first stage of the swir_pipeline, accumulating pixels to fill a word
-            if (swir_pixel_ready = '1') then 
-                swir_fragment(swir_bit_counter + SWIR_PIXEL_BITS - 1 downto swir_bit_counter) <= swir_pixel_to_stdlogicvector(swir_pixel);
-                swir_bit_counter <= swir_bit_counter + SWIR_PIXEL_BITS;
-            end if;
-        
-            --The second stage of the swir pipeline, putting the fragment into the fifo chain
-            if (swir_bit_counter = FIFO_WORD_LENGTH) then 
-                swir_link_wrreq(0) <= '1';
-                swir_link_in(0) <= swir_fragment;
-                swir_bit_counter <= 0;
-            else
-                swir_link_wrreq <= (others => '0');
-                swir_link_in <= (others => (others => '0'));
-            end if;
-        
-            --Checking to see if a fifo is full and enabling the flag to send swir fifo 
-            if (swir_fifo_full(0) = '1') then
-                swir_fifo_stored <= '1';
             end if;
             
-            --The final stage
-            if (row_request = '1') then
-                transmitting_i <= '1';
+            --The final stage, reading a full row out of one of the fifos
+            --A new request is registered on the rising edge of row_request, and held until a row is sent
+            row_request_prev <= row_request;
+            if (row_request = '1' and row_request_prev = '0') then
+                row_requested <= '1';
             end if;
-            
-            if (transmitting_i = '1') then
-                if (swir_fifo_stored /= '0') then
-                    if swir_fifo_empty(0) = '0' then  -- while the swir fifo is not empty
-                        swir_link_rdreq(0) <= '1';    -- read it
-                        fragment_out <= swir_link_out(0);   
-                        fragment_type <= sdram.ROW_SWIR;
-                        transmitting <= '1';
-                        swir_out_counter <= swir_out_counter + 1;
-                    elsif swir_out_counter = SWIR_FIFO_DEPTH+1 then -- if last fragment in fifo
-                        fragment_out <= swir_link_out(0);
-                        swir_out_counter <= 0;
-                    else 
-                        swir_link_rdreq(0) <= '0';
-                        swir_fifo_stored <= '0';
-                        fragment_out <= (others => 'X');
-                        fragment_type <= sdram.ROW_NONE;
-                        transmitting <= '0';
-                        transmitting_i <= '0';
-                    end if;
-                elsif (row_type_stored(0) = '1') then
-                    if vnir_fifo_empty(0) = '0' then  -- while the red fifo is not empty
-                        vnir_link_rdreq(0) <= '1';    -- read it 
-                        fragment_out <= vnir_link_out(0); 
-                        fragment_type <= sdram.ROW_RED;
-                        transmitting <= '1';
-                        vnir_out_counter <= vnir_out_counter + 1;
-                    elsif vnir_out_counter = VNIR_FIFO_DEPTH+1 then -- if last fragment in fifo
-                        fragment_out <= vnir_link_out(0);
-                        vnir_out_counter <= 0;
-                    else 
-                        row_type_stored(0) <= '0';
-                        vnir_link_rdreq(0) <= '0';
-                        fragment_out <= (others => 'X');
-                        fragment_type <= sdram.ROW_NONE;
-                        transmitting <= '0';
-                        transmitting_i <= '0';
-                    end if;
-                elsif (row_type_stored(1) = '1') then
-                    if vnir_fifo_empty(1) = '0' then
-                        vnir_link_rdreq(1) <= '1';
-                        fragment_out <= vnir_link_out(1);
-                        fragment_type <= sdram.ROW_BLUE;
-                        transmitting <= '1';
-                        vnir_out_counter <= vnir_out_counter + 1;
-                    elsif vnir_out_counter = VNIR_FIFO_DEPTH+1 then -- if last fragment in fifo
-                        fragment_out <= vnir_link_out(1);
-                        vnir_out_counter <= 0;
-                    else 
-                        row_type_stored(1) <= '0';
-                        vnir_link_rdreq(1) <= '0';
-                        fragment_out <= (others => 'X');
-                        fragment_type <= sdram.ROW_NONE;
-                        transmitting <= '0';
-                        transmitting_i <= '0';
-                    end if;
-                elsif (row_type_stored(2) = '1') then
-                    if vnir_fifo_empty(2) = '0' then
-                        vnir_link_rdreq(2) <= '1';
-                        fragment_out <= vnir_link_out(2);
-                        fragment_type <= sdram.ROW_NIR;
-                        transmitting <= '1';
-                        vnir_out_counter <= vnir_out_counter + 1;
-                    elsif vnir_out_counter = VNIR_FIFO_DEPTH+1 then -- if last fragment in fifo
-                        fragment_out <= vnir_link_out(2);
-                        vnir_out_counter <= 0;
-                    else 
-                        row_type_stored(2) <= '0';
-                        vnir_link_rdreq(2) <= '0';
-                        fragment_out <= (others => 'X');
-                        fragment_type <= sdram.ROW_NONE;
-                        transmitting <= '0';
-                        transmitting_i <= '0';
+
+            vnir_link_rdreq <= (others => '0');
+            swir_link_rdreq <= (others => '0');
+            read_type <= sdram.ROW_NONE;
+
+            if (read_words_left > 0) then
+                --Keep reading the row that's being sent
+                if (read_type = sdram.ROW_SWIR) then
+                    swir_link_rdreq(0) <= '1';
+                else
+                    vnir_link_rdreq(sdram.vnir_index(read_type)) <= '1';
+                end if;
+                read_type <= read_type;
+                read_words_left <= read_words_left - 1;
+
+                if (read_words_left = 1) then
+                    --Last word of the row, free its space in the fifo
+                    if (read_type = sdram.ROW_SWIR) then
+                        swir_rows_held_v := swir_rows_held_v - 1;
+                    else
+                        rows_held_v(sdram.vnir_index(read_type)) := rows_held_v(sdram.vnir_index(read_type)) - 1;
                     end if;
-                else 
-                    fragment_out <= (others => 'X');
-                    fragment_type <= sdram.ROW_NONE;
-                    transmitting <= '0';
                 end if;
+            elsif (row_requested = '1' or (row_request = '1' and row_request_prev = '0')) then
+                --Start sending the next stored row, with SWIR first, then the VNIR bands in fifo order
+                next_type := sdram.ROW_NONE;
+                if (swir_rows_ready_v > 0) then
+                    next_type := sdram.ROW_SWIR;
+                else
+                    for i in NUM_VNIR_ROW_FIFO-1 downto 0 loop
+                        if (rows_ready_v(i) > 0) then
+                            next_type := sdram.vnir_type(i);
+                        end if;
+                    end loop;
+                end if;
+
+                if (next_type = sdram.ROW_SWIR) then
+                    swir_link_rdreq(0) <= '1';
+                    read_type <= sdram.ROW_SWIR;
+                    read_words_left <= swir_row_words(swir_row_pixels) + ROW_TRAILER_WORDS - 1;
+                    swir_rows_ready_v := swir_rows_ready_v - 1;
+                    row_requested <= '0';
+                elsif (next_type /= sdram.ROW_NONE) then
+                    vnir_link_rdreq(sdram.vnir_index(next_type)) <= '1';
+                    read_type <= next_type;
+                    read_words_left <= vnir_row_words(vnir_row_widths(sdram.vnir_index(next_type))) + ROW_TRAILER_WORDS - 1;
+                    rows_ready_v(sdram.vnir_index(next_type)) := rows_ready_v(sdram.vnir_index(next_type)) - 1;
+                    row_requested <= '0';
+                end if;
+            end if;
+
+            --The fifos' outputs are valid the clock cycle after they are read
+            read_type_p1 <= read_type;
+            if (read_type_p1 = sdram.ROW_SWIR) then
+                fragment_out <= swir_link_out(0);
+                fragment_type <= sdram.ROW_SWIR;
+                transmitting <= '1';
+            elsif (read_type_p1 /= sdram.ROW_NONE) then
+                fragment_out <= vnir_link_out(sdram.vnir_index(read_type_p1));
+                fragment_type <= read_type_p1;
+                transmitting <= '1';
             else
                 fragment_out <= (others => 'X');
                 fragment_type <= sdram.ROW_NONE;
                 transmitting <= '0';
             end if;
+
+            rows_held <= rows_held_v;
+            rows_ready <= rows_ready_v;
+            swir_rows_held <= swir_rows_held_v;
+            swir_rows_ready <= swir_rows_ready_v;
+            overflow_count_i <= overflow_count_v;
         end if;
     end process pipeline;
 
     fifo_clear <= '1' when reset_n = '0' else '0';
 
-end architecture;
\ No newline at end of file
+    --Counting rows as their first fragment (or pixel) comes in, and the most rows held by each fifo
+    perf_counters : process (reset_n, clock) is
+        variable row_type_v : sdram.row_type_t;
+    begin
+        if (reset_n = '0') then
+            rows_received_i <= (others => (others => '0'));
+            rows_high_water_i <= (others => 0);
+        elsif rising_edge(clock) then
+            if (perf_clear = '1') then
+                rows_received_i <= (others => (others => '0'));
+                rows_high_water_i <= (others => 0);
+            else
+                if (vnir_beat_accept = '1' and vnir_fragment_first = '1') then
+                    row_type_v := sdram.sdram_type(vnir_fragment_available);
+                    rows_received_i(row_type_v) <= rows_received_i(row_type_v) + 1;
+                end if;
+                if (swir_pixel_ready = '1' and swir_bit_counter = 0 and swir_word_counter = 0) then
+                    rows_received_i(sdram.ROW_SWIR) <= rows_received_i(sdram.ROW_SWIR) + 1;
+                end if;
+
+                for i in 0 to NUM_VNIR_ROW_FIFO-1 loop
+                    if (rows_held(i) > rows_high_water_i(sdram.vnir_type(i))) then
+                        rows_high_water_i(sdram.vnir_type(i)) <= rows_held(i);
+                    end if;
+                end loop;
+                if (swir_rows_held > rows_high_water_i(sdram.ROW_SWIR)) then
+                    rows_high_water_i(sdram.ROW_SWIR) <= swir_rows_held;
+                end if;
+            end if;
+        end if;
+    end process perf_counters;
+
+    rows_received <= rows_received_i;
+    rows_high_water <= rows_high_water_i;
+
+    --Buffer occupancy outputs
+    vnir_rows_stored <= rows_held;
+    overflow_count <= overflow_count_i;
+    OCCUPANCY_GEN : for i in 0 to NUM_VNIR_ROW_FIFO-1 generate
+        vnir_buffer_empty(i) <= '1' when rows_held(i) = 0 else '0';
+        vnir_buffer_full(i)  <= '1' when rows_held(i) = VNIR_ROWS else '0';
+    end generate OCCUPANCY_GEN;
+
+end architecture;
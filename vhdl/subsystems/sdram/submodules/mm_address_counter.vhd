@@ -5,12 +5,12 @@ use ieee.numeric_std.all;
 use work.sdram;
 
 entity address_counter is 
-    generic(increment_size : integer);
     port(
         clk             : in std_logic;
 
         start_address   : in sdram.address_t;
         inc_flag        : in std_logic;
+        increment_size  : in integer;
 
         output_address  : out sdram.address_t
     );
@@ -18,21 +18,21 @@ end entity address_counter;
 
 architecture rtl of address_counter is
     signal prev_start : sdram.address_t;
-    signal count : natural;
+    signal address : sdram.address_t;
 begin
     count_process : process (clk) is
     begin
         if rising_edge(clk) then
+            --Accumulating the increments rather than multiplying them, as the increment isn't a constant
             if (prev_start /= start_address) then
-                --Needs to be set to one to make the next loop work
-                count <= 1;
-                output_address <= start_address;
+                address <= start_address;
             elsif (inc_flag = '1') then
-                count <= count + 1;
-                output_address <= start_address + (increment_size * count);
+                address <= address + increment_size;
             end if;
 
             prev_start <= start_address;
         end if;
     end process;
+
+    output_address <= address;
 end architecture; 
\ No newline at end of file
@@ -23,8 +23,28 @@ use work.vnir;
 use work.swir_types.all;
 use work.sdram.all;
 use work.fpga.all;
-
+use work.img_buffer_pkg.vnir_row_bytes;
+use work.img_buffer_pkg.swir_row_bytes;
+
+--Allocates the images in the VNIR and SWIR partitions, and assigns each row its address.
+--
+--Once the partitions have been set up (start_config), the VNIR and SWIR images each have their
+--own state machine: an image is allocated as soon as its number of rows is given while its
+--sensor is idle, and its sensor is done with it once all its rows have been assigned or dropped
+--by the imaging buffer, whatever the other sensor is doing. Each band's rows are assigned
+--consecutive addresses, so the rows a band is short by are left at the end of its region. A SWIR
+--image has number_swir_rows / swir_coadd_rows rows, as that is what swir_row_coadder writes of it, so
+--one shorter than swir_coadd_rows isn't allocated at all. vnir_img_config_done and swir_img_config_done are high from
+--just after an image is allocated until its last row has been assigned, and img_config_done while
+--either is. Each image's catalog entry goes in the next free slot when it's done, so the entries
+--are in the order the images end.
+--
+--With SCRATCH_ADDRESSES > 0, that many addresses just below the catalog are taken from the SWIR temp
+--partition and set aside as scratch space for the VNIR subsystem (see `pixel_integrator_spill`).
 entity memory_map is
+    generic (
+        SCRATCH_ADDRESSES   : natural := 0
+    );
     port (
         --Control signals
         clock               : in std_logic;
@@ -36,27 +56,53 @@ entity memory_map is
 
         start_config        : in std_logic;         
         config_done         : out std_logic;
-        img_config_done     : out std_logic;
+        img_config_done     : out std_logic;        -- vnir_img_config_done or swir_img_config_done
+        vnir_img_config_done : out std_logic;
+        swir_img_config_done : out std_logic;
 
         --Image Config signals
         number_swir_rows    : in integer;           
         number_vnir_rows    : in integer;
+        vnir_row_widths     : in sdram.vnir_row_widths_t := (others => vnir.ROW_WIDTH);     -- pixels per row of each VNIR band, fewer when binned or cropped
+        swir_row_pixels     : in integer := swir_row_width;     -- pixels per SWIR row, fewer when cropped
+        swir_coadd_rows     : in integer range 1 to swir_max_coadd_rows := 1;  -- SWIR rows co-added into each row written
 
         --Output image row address config
         next_row_type       : in row_type_t;
         next_row_req        : in std_logic;
         output_address      : out address_t;
 
+        --Rows dropped before they got here (VNIR indexed by vnir_index), counting towards their image
+        vnir_row_dropped    : in std_logic_vector(0 to vnir.N_WINDOWS-1) := (others => '0');
+        swir_row_dropped    : in std_logic := '0';
+
+        --Addresses of the current image's headers and trailers
+        vnir_header_address : out address_t;
+        swir_header_address : out address_t;
+        vnir_trailer_address : out address_t;
+        swir_trailer_address : out address_t;
+        vnir_end_address    : out address_t;    -- first address past the image
+        swir_end_address    : out address_t;
+
+        --Addresses of the catalog entries of the images that were done last
+        vnir_catalog_address : out address_t;
+        swir_catalog_address : out address_t;
+
         --Read data to be read from sdram due to mpu interaction
         sdram_error         : out error_t
     );
 end entity memory_map;
 
 architecture rtl of memory_map is
-    --FSM signals
-    type state_t is (init, idle, img_config_vnir, img_config_swir, imaging);
+    --FSM signals: the partitions are set up once, then each sensor's images go through their own
+    --state machine
+    type state_t is (init, configured);
     signal state, next_state : state_t;
 
+    type image_state_t is (idle, img_alloc, img_config, imaging);
+    signal vnir_state, vnir_next_state : image_state_t;
+    signal swir_state, swir_next_state : image_state_t;
+
     signal buffer_address : address_t;
 
     --Creating buffer partitions for the partitions
@@ -73,30 +119,34 @@ architecture rtl of memory_map is
     signal vnir_temp_sub_length : address_t;
     signal swir_temp_sub_length : address_t;
 
+    --The VNIR bands are stored one after the other: blue, red, NIR, then any extra bands (see band_slot)
+    constant NUM_VNIR_BANDS : integer := vnir.N_WINDOWS;
+    type band_address_a is array (0 to NUM_VNIR_BANDS-1) of address_t;
+
     --Start addresses for each band for the image
-    signal start_blue_address : address_t;
-    signal start_red_address  : address_t;
-    signal start_nir_address  : address_t;
+    signal start_band_address : band_address_a;
     signal start_swir_address : address_t;
 
     signal start_swir_header_address : address_t;
     signal start_vnir_header_address : address_t;
 
     --Next addresses out of the memory state
-    signal next_blue_address : address_t;
-    signal next_red_address  : address_t;
-    signal next_nir_address  : address_t;
+    signal next_band_address : band_address_a;
     signal next_swir_address : address_t;
 
     --Output signal coming from enumerator
-    signal inc_blue_address : std_logic;
-    signal inc_red_address  : std_logic;
-    signal inc_nir_address  : std_logic;
+    signal inc_band_address : std_logic_vector(0 to NUM_VNIR_BANDS-1);
     signal inc_swir_address : std_logic;
 
+    --Rows of each band and of the SWIR image still to be assigned or dropped, and each band's done flag
+    type band_rows_a is array (0 to NUM_VNIR_BANDS-1) of natural;
+    signal band_rows_left : band_rows_a;
+    signal swir_rows_left : natural;
+    signal swir_image_rows : natural;   -- rows written of a SWIR image of number_swir_rows rows
+    signal band_done : std_logic_vector(0 to NUM_VNIR_BANDS-1);
+
     --Various output signals to be Mux'd
     signal row_assign_address : address_t;
-    signal img_config_address : address_t;
 
     --Img write addresses
     signal vnir_img_start : address_t;
@@ -123,15 +173,18 @@ architecture rtl of memory_map is
     signal swir_temp_bad_mpu_check : std_logic;
 
     --State controlling variables
-    signal write_addresses  : std_logic;
+    signal write_vnir_addresses : std_logic;
+    signal write_swir_addresses : std_logic;
     signal write_temp_addresses : std_logic;
     signal delete_addresses : std_logic;
-    signal no_new_rows      : std_logic;
+    signal vnir_rows_done   : std_logic;
+    signal swir_rows_done   : std_logic;
 
     signal curr_row_type, prev_row_type : row_type_t;
     signal set_part_bounds : std_logic;
 
-    signal vnir_band_length : address_t;
+    --Offset of each VNIR band from the end of the image's header
+    signal vnir_band_offset : band_address_a;
     signal swir_band_length : address_t;
 
     --All these are bounds for the partitions
@@ -140,13 +193,59 @@ architecture rtl of memory_map is
     signal swir_base, swir_bounds : address_t;
     signal vnir_temp_base, vnir_temp_bounds : address_t;
     signal swir_temp_base, swir_temp_bounds : address_t;
+    signal scratch_base : address_t;
+    signal catalog_base : address_t;
+
+    --Catalog entries written, counting each image's once it's done
+    signal catalog_count : natural;
+
+    --Registered img_config_done of each sensor, which can't be read from the outputs
+    signal vnir_img_config_done_i : std_logic;
+    signal swir_img_config_done_i : std_logic;
 
     --A signal that detects when the addresses should be incremented
     signal inc_flag : std_logic;
 
-    constant VNIR_ROW_LENGTH : integer := 1280; --2048 px/row * 10 b/px / 16 b/address = 1280 address/row
-    constant SWIR_ROW_LENGTH : integer := 512;  -- 512 px/row * 16 b/px / 16 b/address = 512 address/row
-    constant HEADER_LENGTH   : integer := 16;   -- 160 b/header         / 16 b/address = 16 address/header
+    --Addresses per row of each VNIR band: 1288 for 2048 px/row * 10 b/px / 16 b/address plus an 8 address
+    --row trailer, fewer when the rows are binned or cropped
+    type band_length_a is array (0 to NUM_VNIR_BANDS-1) of integer;
+    signal vnir_row_length : band_length_a;
+    --Addresses per SWIR row: 520 for 512 px/row * 16 b/px / 16 b/address plus the row trailer, fewer when
+    --the rows are cropped
+    signal swir_row_length : integer;
+
+    constant HEADER_LENGTH   : integer := 16;   -- 224 b/header, padded to two 128 b words / 16 b/address = 16 address/header
+    constant TRAILER_LENGTH  : integer := (sdram.TRAILER_LENGTH + 127) / 128 * 8;  -- whole 128 b words / 16 b/address
+    constant CATALOG_ENTRY_ADDRESSES : integer := CATALOG_ENTRY_LENGTH / 16;
+    constant CATALOG_LENGTH  : integer := CATALOG_ENTRIES * CATALOG_ENTRY_ADDRESSES;
+
+    --Catalog slot of the n-th entry, the catalog wrapping around once it's full
+    impure function catalog_slot(n : natural) return address_t is
+    begin
+        return catalog_base + (n mod CATALOG_ENTRIES) * CATALOG_ENTRY_ADDRESSES;
+    end function catalog_slot;
+
+    --Position of each VNIR band in the image
+    pure function band_slot(row_type : row_type_t) return integer is
+    begin
+        case row_type is
+            when ROW_BLUE => return 0;
+            when ROW_RED  => return 1;
+            when ROW_NIR  => return 2;
+            when others   => return vnir_index(row_type);
+        end case;
+    end function band_slot;
+
+    --VNIR band in each position of the image, the inverse of band_slot
+    pure function slot_band(slot : integer) return row_type_t is
+    begin
+        case slot is
+            when 0      => return ROW_BLUE;
+            when 1      => return ROW_RED;
+            when 2      => return ROW_NIR;
+            when others => return vnir_type(slot);
+        end case;
+    end function slot_band;
 
     component edge_detector is
         generic(fall_edge : boolean := false);
@@ -160,11 +259,11 @@ architecture rtl of memory_map is
     end component edge_detector;
 
     component address_counter is
-        generic(increment_size : integer);
         port(
             clk             : in std_logic;
             start_address   : in address_t;
             inc_flag        : in std_logic;
+            increment_size  : in integer;
             
             output_address  : out address_t
         );
@@ -181,86 +280,121 @@ architecture rtl of memory_map is
     end component partition_register;
 
 begin
+    swir_row_length <= swir_row_bytes(swir_row_pixels) / 2;
+    swir_image_rows <= to_integer(coadd_divide(to_unsigned(number_swir_rows, swir_coadd_sum_bits), swir_coadd_rows))
+                       when number_swir_rows > 0 else 0;
+
     --Process responsible assigning the next state at the rising edge
     op_sig_assign : process(clock) is
     begin
         if (reset_n = '0') then
             state <= init;
+            vnir_state <= idle;
+            swir_state <= idle;
             output_address <= UNDEFINED_ADDRESS;
 
             config_done <= '0';
-            img_config_done <= '0';
+            vnir_img_config_done_i <= '0';
+            swir_img_config_done_i <= '0';
             
         elsif rising_edge(clock) then
             state <= next_state;
+            vnir_state <= vnir_next_state;
+            swir_state <= swir_next_state;
             output_address <= buffer_address;
 
-            case state IS
+            case state is
                 when init =>
                     config_done <= '0';
-                    img_config_done <= '0';
-
-                when idle =>
-                    config_done <= '1';
-                    img_config_done <= '0';
-                
-                when img_config_vnir =>
-                    config_done <= '1';
-                    img_config_done <= '1';
-                
-                when img_config_swir =>
-                    config_done <= '1';
-                    img_config_done <= '1';
 
-                when imaging =>
+                when configured =>
                     config_done <= '1';
-                    img_config_done <= '1';
             end case;
+
+            if (vnir_state = idle) then
+                vnir_img_config_done_i <= '0';
+            else
+                vnir_img_config_done_i <= '1';
+            end if;
+
+            if (swir_state = idle) then
+                swir_img_config_done_i <= '0';
+            else
+                swir_img_config_done_i <= '1';
+            end if;
         end if;
     end process;
 
     --Process responsible for assigning the appropriate state
-    state_machine : process(start_config, inc_flag, write_addresses, no_new_rows) is
+    state_machine : process(state, start_config) is
     begin
         case state is
             when init =>
                 if (start_config = '1') then
-                    next_state <= idle;
+                    next_state <= configured;
                 else
                     next_state <= init;
                 end if;
+            when configured =>
+                next_state <= configured;
+        end case;
+    end process;
+
+    --The image is in the partition register's img_start and img_end in img_alloc, and in the row
+    --counters in img_config. The headers are written by the command creator from
+    --vnir/swir_header_address, so these states don't wait on it
+    vnir_state_machine : process(vnir_state, write_vnir_addresses, vnir_rows_done) is
+    begin
+        case vnir_state is
             when idle =>
-                if (write_addresses = '1') then
-                    next_state <= img_config_vnir;
+                if (write_vnir_addresses = '1') then
+                    vnir_next_state <= img_alloc;
                 else
-                    next_state <= idle;
+                    vnir_next_state <= idle;
                 end if;
-            when img_config_vnir =>
-                if (inc_flag = '1') then
-                    next_state <= img_config_swir;
+            when img_alloc =>
+                vnir_next_state <= img_config;
+            when img_config =>
+                vnir_next_state <= imaging;
+            when imaging =>
+                if (vnir_rows_done = '1') then
+                    vnir_next_state <= idle;
                 else
-                    next_state <= img_config_vnir;
+                    vnir_next_state <= imaging;
                 end if;
-            when img_config_swir =>
-                if (inc_flag = '1') then
-                    next_state <= imaging;
+        end case;
+    end process;
+
+    swir_state_machine : process(swir_state, write_swir_addresses, swir_rows_done) is
+    begin
+        case swir_state is
+            when idle =>
+                if (write_swir_addresses = '1') then
+                    swir_next_state <= img_alloc;
                 else
-                    next_state <= img_config_swir;
+                    swir_next_state <= idle;
                 end if;
+            when img_alloc =>
+                swir_next_state <= img_config;
+            when img_config =>
+                swir_next_state <= imaging;
             when imaging =>
-                if (no_new_rows = '1') then
-                    next_state <= idle;
+                if (swir_rows_done = '1') then
+                    swir_next_state <= idle;
                 else
-                    next_state <= imaging;
+                    swir_next_state <= imaging;
                 end if;
         end case;
     end process;
 
     internal_sync_registers : process (clock, reset_n) is
+        variable band_offset : integer;
+        variable band_rows_left_v : band_rows_a;
+        variable swir_rows_left_v : natural;
     begin
         if (reset_n = '0') then
             --Reseting everything
-            vnir_band_length <= UNDEFINED_ADDRESS;
+            vnir_band_offset <= (others => UNDEFINED_ADDRESS);
             swir_band_length <= UNDEFINED_ADDRESS;
 
             vnir_add_length <= UNDEFINED_ADDRESS;
@@ -268,16 +402,24 @@ begin
             vnir_temp_add_length <= UNDEFINED_ADDRESS;
             swir_temp_add_length <= UNDEFINED_ADDRESS;
 
+            write_vnir_addresses <= '0';
+            write_swir_addresses <= '0';
             set_part_bounds <= '0';
+            catalog_count <= 0;
+            band_rows_left <= (others => 0);
+            swir_rows_left <= 0;
+            vnir_catalog_address <= UNDEFINED_ADDRESS;
+            swir_catalog_address <= UNDEFINED_ADDRESS;
 
         elsif rising_edge(clock) then
-            write_addresses <= '0';
+            write_vnir_addresses <= '0';
+            write_swir_addresses <= '0';
             set_part_bounds <= '0';
 
-            inc_nir_address <= '0';
-            inc_red_address <= '0';
-            inc_blue_address <= '0';
+            inc_band_address <= (others => '0');
             inc_swir_address <= '0';
+            band_rows_left_v := band_rows_left;
+            swir_rows_left_v := swir_rows_left;
 
             case state is
                 --Init stores the full vhdl partition bounds
@@ -288,35 +430,74 @@ begin
                         vhdl_bounds <= config.memory_bounds;
                     end if;
 
-                when idle =>
-                    --Setting the image boundaries
-                    if (number_vnir_rows > 0 and number_swir_rows > 0 and vnir_band_length = UNDEFINED_ADDRESS) then
-                        vnir_band_length <= to_signed(number_vnir_rows * VNIR_ROW_LENGTH, ADDRESS_LENGTH);
-                        swir_band_length <= to_signed(number_swir_rows * SWIR_ROW_LENGTH, ADDRESS_LENGTH);
-        
-                        vnir_add_length <= to_signed(number_vnir_rows * VNIR_ROW_LENGTH * 3 + 16, ADDRESS_LENGTH);
-                        swir_add_length <= to_signed(number_swir_rows * SWIR_ROW_LENGTH + 16, ADDRESS_LENGTH);
-        
-                        write_addresses <= '1';
+                when configured =>
+                    --Setting the image boundaries of each sensor that's given rows while it's idle. The
+                    --last image's trailer address is kept until the fall of its img_config_done is seen
+                    if (number_vnir_rows > 0 and vnir_state = idle and vnir_img_config_done_i = '0' and write_vnir_addresses = '0') then
+                        band_offset := 0;
+                        for i in 0 to NUM_VNIR_BANDS-1 loop
+                            vnir_band_offset(i) <= to_signed(band_offset, ADDRESS_LENGTH);
+                            band_offset := band_offset + number_vnir_rows * vnir_row_length(i);
+                        end loop;
+                        vnir_add_length <= to_signed(band_offset + HEADER_LENGTH + TRAILER_LENGTH, ADDRESS_LENGTH);
+                        band_rows_left_v := (others => number_vnir_rows);
+                        write_vnir_addresses <= '1';
                     end if;
-                
-                --Img_config_vnir sets the band length
-                when img_config_vnir => null;
-
-                when img_config_swir => null;
-                
-                when imaging =>
-                    if (inc_flag = '1') then
-                        case prev_row_type is
-                            when ROW_NIR => inc_nir_address <= '1';
-                            when ROW_RED => inc_red_address <= '1';
-                            when ROW_BLUE => inc_blue_address <= '1';
-                            when ROW_SWIR => inc_swir_address <= '1';
-                            when ROW_NONE => null;
-                        end case;
+
+                    if (swir_image_rows > 0 and swir_state = idle and swir_img_config_done_i = '0' and write_swir_addresses = '0') then
+                        swir_band_length <= to_signed(swir_image_rows * swir_row_length, ADDRESS_LENGTH);
+                        swir_add_length <= to_signed(swir_image_rows * swir_row_length + HEADER_LENGTH + TRAILER_LENGTH, ADDRESS_LENGTH);
+                        swir_rows_left_v := swir_image_rows;
+                        write_swir_addresses <= '1';
                     end if;
             end case;
 
+            --Each image's catalog entry takes the next free slot once it's done, VNIR first if both
+            --are done at once
+            if (vnir_state = imaging and vnir_rows_done = '1' and swir_state = imaging and swir_rows_done = '1') then
+                vnir_catalog_address <= catalog_slot(catalog_count);
+                swir_catalog_address <= catalog_slot(catalog_count + 1);
+                catalog_count <= catalog_count + 2;
+            elsif (vnir_state = imaging and vnir_rows_done = '1') then
+                vnir_catalog_address <= catalog_slot(catalog_count);
+                catalog_count <= catalog_count + 1;
+            elsif (swir_state = imaging and swir_rows_done = '1') then
+                swir_catalog_address <= catalog_slot(catalog_count);
+                catalog_count <= catalog_count + 1;
+            end if;
+
+            --Rows only move their sensor's counters on while its image is being taken. Each row
+            --assigned or dropped is one less row for its image to wait for
+            if (inc_flag = '1') then
+                case prev_row_type is
+                    when ROW_SWIR =>
+                        if (swir_state = imaging and swir_rows_left_v > 0) then
+                            inc_swir_address <= '1';
+                            swir_rows_left_v := swir_rows_left_v - 1;
+                        end if;
+                    when ROW_NONE => null;
+                    when others =>
+                        if (vnir_state = imaging and band_rows_left_v(band_slot(prev_row_type)) > 0) then
+                            inc_band_address(band_slot(prev_row_type)) <= '1';
+                            band_rows_left_v(band_slot(prev_row_type)) := band_rows_left_v(band_slot(prev_row_type)) - 1;
+                        end if;
+                end case;
+            end if;
+
+            if (vnir_state /= idle) then
+                for k in 0 to NUM_VNIR_BANDS-1 loop
+                    if (vnir_row_dropped(k) = '1' and band_rows_left_v(band_slot(vnir_type(k))) > 0) then
+                        band_rows_left_v(band_slot(vnir_type(k))) := band_rows_left_v(band_slot(vnir_type(k))) - 1;
+                    end if;
+                end loop;
+            end if;
+            if (swir_state /= idle and swir_row_dropped = '1' and swir_rows_left_v > 0) then
+                swir_rows_left_v := swir_rows_left_v - 1;
+            end if;
+
+            band_rows_left <= band_rows_left_v;
+            swir_rows_left <= swir_rows_left_v;
+
             if (next_row_type /= ROW_NONE and next_row_req = '1') then
                 prev_row_type <= curr_row_type;
                 curr_row_type <= next_row_type;
@@ -326,40 +507,29 @@ begin
 
     next_row_edge : edge_detector generic map (false) port map (clock, reset_n, next_row_req, inc_flag);
 
-    --Address counters for each band
-    blue_row_counter : address_counter
-        generic map(increment_size => VNIR_ROW_LENGTH)
-        port map(
-            clk => clock,
-            start_address => start_blue_address,
-            inc_flag => inc_blue_address,
-            output_address => next_blue_address
-        );
+    --Address counters for each band, each band starting right after the one before it
+    BAND_COUNTER_GEN : for i in 0 to NUM_VNIR_BANDS-1 generate
+        vnir_row_length(i) <= vnir_row_bytes(vnir_row_widths(vnir_index(slot_band(i)))) / 2;
 
-    red_row_counter : address_counter
-        generic map(increment_size => VNIR_ROW_LENGTH)
-        port map(
-            clk => clock,
-            start_address => start_red_address,
-            inc_flag => inc_red_address,
-            output_address => next_red_address
-        );
+        band_row_counter : address_counter
+            port map(
+                clk => clock,
+                start_address => start_band_address(i),
+                inc_flag => inc_band_address(i),
+                increment_size => vnir_row_length(i),
+                output_address => next_band_address(i)
+            );
 
-    nir_row_counter : address_counter
-        generic map(increment_size => VNIR_ROW_LENGTH)
-        port map(
-            clk => clock,
-            start_address => start_nir_address,
-            inc_flag => inc_nir_address,
-            output_address => next_nir_address
-        );
+        start_band_address(i) <= vnir_img_start + HEADER_LENGTH + vnir_band_offset(i);
+        band_done(i) <= '1' when band_rows_left(i) = 0 else '0';
+    end generate BAND_COUNTER_GEN;
 
     swir_row_counter : address_counter
-        generic map(increment_size => SWIR_ROW_LENGTH)
         port map(
             clk => clock,
             start_address => start_swir_address,
             inc_flag => inc_swir_address,
+            increment_size => swir_row_length,
             output_address => next_swir_address
         );
 
@@ -370,7 +540,7 @@ begin
             reset_n => reset_n,
 
             bounds_write => set_part_bounds,
-            filled_add => write_addresses,
+            filled_add => write_vnir_addresses,
             filled_subtract => delete_addresses,
 
             base => vnir_base,
@@ -393,7 +563,7 @@ begin
             reset_n => reset_n,
 
             bounds_write => set_part_bounds,
-            filled_add => write_addresses,
+            filled_add => write_swir_addresses,
             filled_subtract => delete_addresses,
 
             base => swir_base,
@@ -465,9 +635,14 @@ begin
     vnir_temp_base   <= resize(vhdl_size * 14 / 16 + 1 + vhdl_base, ADDRESS_LENGTH);
     vnir_temp_bounds <= resize(vhdl_size * 15 / 16 + vhdl_base, ADDRESS_LENGTH);
     swir_temp_base   <= resize(vhdl_size * 15 / 16 + 1 + vhdl_base, ADDRESS_LENGTH);
-    swir_temp_bounds <= vhdl_size + vhdl_base;
+    swir_temp_bounds <= scratch_base - 1;
+    scratch_base     <= catalog_base - SCRATCH_ADDRESSES;
+    catalog_base     <= vhdl_size + vhdl_base - CATALOG_LENGTH + 1;   --The catalog takes the top of the memory
 
     --Mapping the memory state to match the buffer parts out of the partition components
+    memory_state_i.scratch_base <= scratch_base;
+    memory_state_i.catalog_base <= catalog_base;
+    memory_state_i.catalog_count <= catalog_count;
     memory_state <= memory_state_i;
 
     sdram_error <= full             when (vnir_full = '1' or swir_full = '1' or vnir_temp_full = '1' or swir_temp_full = '1') else
@@ -478,30 +653,31 @@ begin
     start_swir_header_address <= swir_img_start;
     start_vnir_header_address <= vnir_img_start;
 
-    start_blue_address <= vnir_img_start + HEADER_LENGTH;
-    start_red_address  <= vnir_img_start + HEADER_LENGTH + vnir_band_length; --Adding room for the blue band
-    start_nir_address  <= resize(vnir_img_start + HEADER_LENGTH + vnir_band_length * 2, ADDRESS_LENGTH); --Room for both blue and red
     start_swir_address <= swir_img_start + HEADER_LENGTH;
-    
-    no_new_rows <= '1' when (next_blue_address = start_red_address and 
-                              next_red_address = start_nir_address and 
-                              next_nir_address = vnir_img_end and 
-                              next_swir_address = swir_img_end) 
-                       else '0';
-
-    with curr_row_type select row_assign_address <=
-        next_swir_address when ROW_SWIR,
-        next_nir_address  when  ROW_NIR,
-        next_red_address  when  ROW_RED,
-        next_blue_address when ROW_BLUE,
-        UNDEFINED_ADDRESS when ROW_NONE;
-
-    img_config_address <= vnir_img_start when state = img_config_vnir else
-                          swir_img_start when state = img_config_swir else
-                          UNDEFINED_ADDRESS;  
-    
-    buffer_address <= row_assign_address when state = imaging else
-                      img_config_address when state = img_config_vnir or state = img_config_swir else
+
+    --Each image is its header, its rows, and then its trailer
+    vnir_header_address <= start_vnir_header_address;
+    swir_header_address <= start_swir_header_address;
+    vnir_trailer_address <= vnir_img_end - TRAILER_LENGTH;
+    swir_trailer_address <= swir_img_end - TRAILER_LENGTH;
+    vnir_end_address <= vnir_img_end;
+    swir_end_address <= swir_img_end;
+
+    vnir_img_config_done <= vnir_img_config_done_i;
+    swir_img_config_done <= swir_img_config_done_i;
+    img_config_done <= vnir_img_config_done_i or swir_img_config_done_i;
+
+    vnir_rows_done <= '1' when band_done = (band_done'range => '1') else '0';
+    swir_rows_done <= '1' when swir_rows_left = 0 else '0';
+
+    row_assign_address <= next_swir_address when curr_row_type = ROW_SWIR else
+                          UNDEFINED_ADDRESS when curr_row_type = ROW_NONE else
+                          next_band_address(band_slot(curr_row_type));
+
+    --Rows only ever get row addresses, and only while their sensor is imaging; the header addresses
+    --have their own outputs
+    buffer_address <= row_assign_address when (curr_row_type = ROW_SWIR and swir_state = imaging) or
+                                              (curr_row_type /= ROW_SWIR and vnir_state = imaging) else
                       UNDEFINED_ADDRESS;    
     
 end architecture;
\ No newline at end of file
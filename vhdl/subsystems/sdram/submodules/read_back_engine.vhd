@@ -0,0 +1,191 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.sdram;
+use work.img_buffer_pkg.all;
+use work.custom_master_pkg.all;
+
+-- Streams a block of SDRAM out through the read master, for the MCU to drain 32 bits at a time.
+--
+-- A read is started either from an address range (read_start, with read_base and read_end) or from
+-- a catalog entry (catalog_start, with catalog_index); in the latter case, the entry is read first
+-- and the image's start and end addresses are taken from it. Addresses are given the same way as
+-- to the command creator, in the memory map's 16-bit units.
+--
+-- The read master fetches ahead into its own fifo, bursting as long as there's room in it, so the
+-- SDRAM is read while data is being drained. data_out holds the next 32 bits, least significant
+-- lane of each 128-bit word first, while data_valid is high; data_read moves on to the next ones.
+entity read_back_engine is
+    port (
+        --Control signals
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        --Address range to read
+        read_start          : in std_logic;
+        read_base           : in sdram.address_t;
+        read_end            : in sdram.address_t;   -- first address past the range
+
+        --Catalog entry to read the image of
+        catalog_start       : in std_logic;
+        catalog_index       : in natural;
+        catalog_base        : in sdram.address_t;
+
+        --Data out to the MCU interface
+        data_out            : out std_logic_vector(31 downto 0);
+        data_valid          : out std_logic;
+        data_read           : in std_logic;
+        busy                : out std_logic;
+
+        --Commands to custom read master
+        master_cmd_in       : in from_read_master_t;
+        master_cmd_out      : out to_read_master_t
+    );
+end entity read_back_engine;
+
+architecture rtl of read_back_engine is
+    type state_t is (s_idle, s_catalog_go, s_catalog_read, s_image_go, s_streaming);
+    signal state : state_t;
+
+    constant ADDRESS_BYTES      : integer := 2;     -- 16 b/address
+    constant LANES              : integer := FIFO_WORD_LENGTH / 32;
+    constant CATALOG_ENTRY_ADDRESSES : integer := sdram.CATALOG_ENTRY_LENGTH / (8 * ADDRESS_BYTES);
+    constant CATALOG_ENTRY_WORDS : integer := sdram.CATALOG_ENTRY_LENGTH / FIFO_WORD_LENGTH;
+
+    signal range_base           : sdram.address_t;
+    signal range_end            : sdram.address_t;
+    signal control_base         : sdram.address_t;
+    signal control_length       : unsigned(sdram.ADDRESS_LENGTH-1 downto 0);
+    signal control_go           : std_logic;
+    signal words_left           : unsigned(sdram.ADDRESS_LENGTH-1 downto 0);
+
+    signal word                 : std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+    signal lanes_left           : integer range 0 to LANES;
+    signal take_word            : std_logic;
+begin
+
+    -- A word is taken from the master while streaming once the last lane of the current one is read,
+    -- and right away while reading a catalog entry
+    take_word <= '1' when master_cmd_in.user_data_available = '1' and words_left /= 0 and
+                          ((state = s_streaming and (lanes_left = 0 or (lanes_left = 1 and data_read = '1'))) or
+                           state = s_catalog_read) else '0';
+
+    process (clock, reset_n) is
+        variable start_v : sdram.address_t;
+        variable end_v   : sdram.address_t;
+    begin
+        if (reset_n = '0') then
+            state <= s_idle;
+            range_base <= sdram.UNDEFINED_ADDRESS;
+            range_end <= sdram.UNDEFINED_ADDRESS;
+            control_base <= (others => '0');
+            control_length <= (others => '0');
+            control_go <= '0';
+            words_left <= (others => '0');
+            word <= (others => '0');
+            lanes_left <= 0;
+        elsif rising_edge(clock) then
+            control_go <= '0';
+
+            if (take_word = '1') then
+                words_left <= words_left - 1;
+            end if;
+
+            case state is
+                when s_idle =>
+                    if (catalog_start = '1') then
+                        control_base <= catalog_base + (catalog_index mod sdram.CATALOG_ENTRIES) * CATALOG_ENTRY_ADDRESSES;
+                        control_length <= to_unsigned(sdram.CATALOG_ENTRY_LENGTH / 8, sdram.ADDRESS_LENGTH);
+                        state <= s_catalog_go;
+                    elsif (read_start = '1') then
+                        range_base <= read_base;
+                        range_end <= read_end;
+                        state <= s_image_go;
+                    end if;
+
+                when s_catalog_go =>
+                    if (master_cmd_in.control_done = '1') then
+                        control_go <= '1';
+                        words_left <= to_unsigned(CATALOG_ENTRY_WORDS, sdram.ADDRESS_LENGTH);
+                        state <= s_catalog_read;
+                    end if;
+
+                --The entry's start address is in bits 159 downto 128, and its end address in bits
+                --127 downto 96 (see `header_creator`). The entry is written most significant word
+                --first, so these are the bottom of its first word and the top of its second
+                when s_catalog_read =>
+                    if (take_word = '1') then
+                        if (words_left = CATALOG_ENTRY_WORDS) then
+                            range_base <= signed(master_cmd_in.user_buffer_data(sdram.ADDRESS_LENGTH-1 downto 0));
+                        else
+                            range_end <= signed(master_cmd_in.user_buffer_data(FIFO_WORD_LENGTH-1 downto FIFO_WORD_LENGTH-sdram.ADDRESS_LENGTH));
+                        end if;
+                        if (words_left = 1) then
+                            state <= s_image_go;
+                        end if;
+                    end if;
+
+                when s_image_go =>
+                    if (master_cmd_in.control_done = '1' and control_go = '0') then
+                        start_v := range_base;
+                        end_v := range_end;
+                        if (start_v < 0 or end_v <= start_v) then
+                            --Nothing to read (e.g. an empty catalog slot)
+                            state <= s_idle;
+                        else
+                            control_base <= start_v;
+                            control_length <= resize(unsigned(end_v - start_v) * ADDRESS_BYTES, sdram.ADDRESS_LENGTH);
+                            words_left <= resize(unsigned(end_v - start_v) * ADDRESS_BYTES / FIFO_WORD_BYTES, sdram.ADDRESS_LENGTH);
+                            control_go <= '1';
+                            state <= s_streaming;
+                        end if;
+                    end if;
+
+                when s_streaming =>
+                    if (words_left = 0 and lanes_left = 0) then
+                        state <= s_idle;
+                    end if;
+            end case;
+
+            --Moving through the lanes of the current word
+            if (state = s_streaming) then
+                if (take_word = '1') then
+                    word <= master_cmd_in.user_buffer_data;
+                    lanes_left <= LANES;
+                elsif (lanes_left > 0 and data_read = '1') then
+                    word <= std_logic_vector(shift_right(unsigned(word), 32));
+                    lanes_left <= lanes_left - 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    data_out <= word(31 downto 0);
+    data_valid <= '1' when lanes_left > 0 else '0';
+    busy <= '0' when state = s_idle else '1';
+
+    master_cmd_out.control_fixed_location <= '0';
+    master_cmd_out.control_go <= control_go;
+    master_cmd_out.control_read_base <= std_logic_vector(control_base);
+    master_cmd_out.control_read_length <= std_logic_vector(control_length);
+    master_cmd_out.user_read_buffer <= take_word;
+
+end architecture rtl;
@@ -0,0 +1,74 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.math_real.all;
+
+library altera_mf;
+use altera_mf.altera_mf_components.all;
+
+-- Single-clock FIFO with a configurable width and depth.
+--
+-- Unlike the VNIR_ROW_FIFO and SWIR_ROW_FIFO IPs, the depth of this
+-- FIFO is set through a generic, so the number of rows the imaging
+-- buffer can hold doesn't require regenerating an IP.
+entity row_fifo is
+generic (
+    WORD_SIZE       : integer;
+    NUM_WORDS       : integer;
+    SHOWAHEAD       : string := "OFF"
+);
+port (
+    aclr            : in std_logic;
+    clock           : in std_logic;
+    data            : in std_logic_vector(WORD_SIZE-1 downto 0);
+    rdreq           : in std_logic;
+    wrreq           : in std_logic;
+    empty           : out std_logic;
+    full            : out std_logic;
+    q               : out std_logic_vector(WORD_SIZE-1 downto 0)
+);
+end entity row_fifo;
+
+
+architecture rtl of row_fifo is
+    constant ADDRESS_SIZE : integer := integer(ceil(log2(real(NUM_WORDS))));
+begin
+
+    fifo : scfifo generic map (
+        add_ram_output_register => "OFF",
+        intended_device_family => "Cyclone V",
+        lpm_numwords => NUM_WORDS,
+        lpm_showahead => SHOWAHEAD,
+        lpm_type => "scfifo",
+        lpm_width => WORD_SIZE,
+        lpm_widthu => ADDRESS_SIZE,
+        overflow_checking => "ON",
+        underflow_checking => "ON",
+        use_eab => "ON"
+    ) port map (
+        aclr => aclr,
+        clock => clock,
+        data => data,
+        rdreq => rdreq,
+        wrreq => wrreq,
+        empty => empty,
+        full => full,
+        q => q
+    );
+
+end architecture rtl;
@@ -0,0 +1,385 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir;
+use work.sdram;
+use work.sdram."=";
+use work.img_buffer_pkg.all;
+use work.ccsds123;
+
+-- Compresses a VNIR image of N_FRAMES frames and decodes it again.
+--
+-- Each band is a diagonal ramp (wrapping around every so often, so some residuals need the
+-- escape code) with some pseudo-random noise, and a few samples at 0 and full scale. The rows
+-- sent out are collected, and each band's bitstream is decoded by a sequential model of the
+-- CCSDS-123.0-B-1 decoder written from the standard (with the predictor and coder parameters in
+-- `ccsds123`). Every decoded sample has to match the one sent in, each row's trailer has to have
+-- the compressed flag set and the row's index in the band, and vnir_rows_written has to count the
+-- rows holding each band's bitstream. The blue rows are cropped to an odd number of fragments, so
+-- they end part way through their last word, and the padding after them mustn't shift the samples
+-- of the rows after them.
+entity ccsds123_compressor_tb is
+    generic (
+        N_FRAMES    : integer := 8
+    );
+end entity;
+
+architecture sim of ccsds123_compressor_tb is
+
+    constant clock_period       : time := 20 ns;
+    constant row_words          : integer := vnir_row_words(vnir.ROW_WIDTH);     -- of the widest rows
+
+    --Samples per row of each band, in the compressor's band order
+    constant ROW_SAMPLES        : sdram.vnir_row_widths_t := (1 => 27*vnir.FRAGMENT_WIDTH, others => vnir.ROW_WIDTH);
+    constant timeout_clocks     : integer := (N_FRAMES + 4) * 3 * (vnir.ROW_WIDTH + 200);
+
+    --Sample x of row y of each band (in the compressor's band order), x counting the fragment lanes in order
+    pure function pixel(band : integer; y : integer; x : integer) return integer is
+    begin
+        if ((x + 5*y + 3*band) mod 97 = 0) then
+            return 0;
+        elsif ((x + 7*y + band) mod 89 = 0) then
+            return 2**vnir.ROW_PIXEL_BITS - 1;
+        else
+            return 200 + 100*band + (3*x + 7*y) mod 512 + (x*1103 + y*4013 + band*7919) mod 17 - 8;
+        end if;
+    end function pixel;
+
+    signal clock                : std_logic := '1';
+    signal reset_n              : std_logic := '0';
+
+    signal vnir_fragment        : vnir.row_fragment_t := (others => (others => '0'));
+    signal vnir_fragment_avail  : vnir.row_type_t := vnir.ROW_NONE;
+    signal vnir_fragment_first  : std_logic := '0';
+    signal vnir_fragment_last   : std_logic := '0';
+    signal vnir_fragment_ready  : std_logic;
+    signal overflow_count       : unsigned(31 downto 0);
+
+    signal buffer_row_req       : std_logic;
+    signal buffer_data          : row_fragment_t;
+    signal buffer_type          : sdram.row_type_t;
+    signal buffer_transmitting  : std_logic;
+
+    signal img_config_done      : std_logic := '0';
+    signal vnir_num_rows        : integer := 0;
+
+    signal next_row_req         : std_logic;
+    signal row_data             : row_fragment_t;
+    signal row_type             : sdram.row_type_t;
+    signal transmitting         : std_logic;
+    signal compressing          : std_logic;
+    signal vnir_overflow        : std_logic;
+    signal swir_overflow        : std_logic;
+    signal vnir_rows_written    : row_count_a;
+
+begin
+
+    clock <= not clock after clock_period / 2;
+    reset_n <= '1' after clock_period * 4;
+
+    imaging_buffer : entity work.imaging_buffer port map (
+        clock               => clock,
+        reset_n             => reset_n,
+        vnir_fragment       => vnir_fragment,
+        vnir_fragment_available => vnir_fragment_avail,
+        vnir_fragment_first => vnir_fragment_first,
+        vnir_fragment_last  => vnir_fragment_last,
+        vnir_fragment_ready => vnir_fragment_ready,
+        vnir_row_widths     => ROW_SAMPLES,
+        swir_pixel          => (others => '0'),
+        swir_pixel_ready    => '0',
+        row_request         => buffer_row_req,
+        fragment_out        => buffer_data,
+        fragment_type       => buffer_type,
+        transmitting        => buffer_transmitting,
+        overflow_count      => overflow_count
+    );
+
+    compressor : entity work.ccsds123_compressor port map (
+        clock               => clock,
+        reset_n             => reset_n,
+        compress            => '1',
+        vnir_img_config_done => img_config_done,
+        swir_img_config_done => '0',
+        vnir_num_rows       => vnir_num_rows,
+        swir_num_rows       => 0,
+        vnir_row_widths     => ROW_SAMPLES,
+        row_request         => buffer_row_req,
+        fragment_in         => buffer_data,
+        fragment_in_type    => buffer_type,
+        transmitting_in     => buffer_transmitting,
+        next_row_req        => next_row_req,
+        fragment_out        => row_data,
+        fragment_type       => row_type,
+        transmitting        => transmitting,
+        compressing         => compressing,
+        vnir_overflow       => vnir_overflow,
+        swir_overflow       => swir_overflow,
+        vnir_rows_written   => vnir_rows_written,
+        swir_rows_written   => open
+    );
+
+    vnir_process : process
+        type row_type_a is array (0 to 2) of vnir.row_type_t;
+        constant types : row_type_a := (vnir.ROW_RED, vnir.ROW_BLUE, vnir.ROW_NIR);
+        variable band_v : integer;
+        variable row_clocks : integer;
+    begin
+        wait until reset_n = '1';
+        wait until rising_edge(clock);
+
+        --Configuring the image
+        vnir_num_rows <= N_FRAMES;
+        wait until rising_edge(clock);
+        vnir_num_rows <= 0;
+        wait until rising_edge(clock);
+        img_config_done <= '1';
+        wait until rising_edge(clock);
+
+        for frame in 0 to N_FRAMES-1 loop
+            for band in 0 to 2 loop
+                band_v := sdram.vnir_index(sdram.sdram_type(types(band)));
+                row_clocks := ROW_SAMPLES(band_v) / vnir.FRAGMENT_WIDTH;
+                for i in 0 to row_clocks-1 loop
+                    vnir_fragment_avail <= types(band);
+                    vnir_fragment_first <= '1' when i = 0 else '0';
+                    vnir_fragment_last <= '1' when i = row_clocks-1 else '0';
+                    for lane in 0 to vnir.FRAGMENT_WIDTH-1 loop
+                        vnir_fragment(lane) <= to_unsigned(pixel(band_v, frame, i*vnir.FRAGMENT_WIDTH + lane), vnir.ROW_PIXEL_BITS);
+                    end loop;
+                    loop
+                        wait until rising_edge(clock);
+                        exit when vnir_fragment_ready = '1';
+                    end loop;
+                end loop;
+            end loop;
+            vnir_fragment_avail <= vnir.ROW_NONE;
+            vnir_fragment_first <= '0';
+            vnir_fragment_last <= '0';
+
+            --The compressor takes a clock cycle per sample
+            wait for clock_period * 3 * (vnir.ROW_WIDTH + 100);
+        end loop;
+        wait;
+    end process vnir_process;
+
+    --Command creator model: a row is requested whenever none is coming in
+    next_row_req <= not transmitting;
+
+    --Collecting every row sent out, then decoding each band
+    check_process : process
+        type words_a is array (0 to N_FRAMES*row_words-1) of row_fragment_t;
+        type band_words_a is array (0 to NUM_VNIR_ROW_FIFO-1) of words_a;
+        type band_count_a is array (0 to NUM_VNIR_ROW_FIFO-1) of natural;
+        type samples_a is array (0 to vnir.ROW_WIDTH-1) of integer;
+
+        constant D          : integer := vnir.ROW_PIXEL_BITS;
+        constant MAX_SAMPLE : integer := 2**D - 1;
+
+        variable words      : band_words_a;
+        variable rows_seen  : band_count_a := (others => 0);
+        variable rows_total : natural := 0;
+        variable word_i     : natural := 0;
+        variable band       : integer := 0;
+        variable clocks     : natural := 0;
+        variable metadata   : sdram.row_metadata_t;
+        variable band_row_words : integer;
+        variable width      : integer;
+
+        variable bit_pos    : natural;
+        variable prev_row   : samples_a;
+        variable cur_row    : samples_a;
+        variable counter    : natural;
+        variable accumulator : natural;
+        variable sigma      : natural;
+        variable predicted  : integer;
+        variable odd        : boolean;
+        variable theta      : integer;
+        variable k          : natural;
+        variable unary      : natural;
+        variable delta      : natural;
+        variable lsbs       : natural;
+        variable sample     : integer;
+        variable mismatches : natural;
+        variable data_rows  : natural;
+
+        --Reads the next n bits of band's bitstream, MSB first, from memory byte order
+        procedure read_bits(n : in natural; value : out natural) is
+            variable word_v : natural;
+            variable bit_v  : natural;
+            variable re     : natural := 0;
+        begin
+            for i in 1 to n loop
+                word_v := bit_pos / FIFO_WORD_LENGTH;
+                bit_v := bit_pos mod FIFO_WORD_LENGTH;
+                re := 2*re;
+                if (word_v < words(band)'length and words(band)(word_v)(8*(bit_v/8) + 7 - bit_v mod 8) = '1') then
+                    re := re + 1;
+                end if;
+                bit_pos := bit_pos + 1;
+            end loop;
+            value := re;
+        end procedure read_bits;
+    begin
+        wait until reset_n = '1';
+
+        --Each row is its band's row words of bitstream followed by its trailer
+        loop
+            wait until rising_edge(clock);
+            clocks := clocks + 1;
+            if (transmitting = '1') then
+                band := sdram.vnir_index(row_type);
+                band_row_words := vnir_row_words(ROW_SAMPLES(band));
+                if (word_i < band_row_words) then
+                    if (rows_seen(band) < N_FRAMES) then
+                        words(band)(rows_seen(band)*band_row_words + word_i) := row_data;
+                    end if;
+                else
+                    metadata := sdram.row_metadata(row_data);
+                    assert metadata.compressed = '1' report "Row trailer isn't flagged as compressed" severity error;
+                    assert metadata.band = row_type report "Row trailer has the wrong band" severity error;
+                    assert metadata.row_index = rows_seen(band)
+                        report "Row trailer has row_index " & integer'image(to_integer(metadata.row_index)) &
+                               ", expected " & integer'image(rows_seen(band)) severity error;
+                end if;
+                word_i := word_i + 1;
+            elsif (word_i /= 0) then
+                assert word_i = band_row_words + ROW_TRAILER_WORDS
+                    report "Row of " & integer'image(word_i) & " words" severity error;
+                rows_seen(band) := rows_seen(band) + 1;
+                rows_total := rows_total + 1;
+                word_i := 0;
+            end if;
+            exit when rows_total = 3*N_FRAMES or clocks = timeout_clocks;
+        end loop;
+        wait for clock_period * 10;
+
+        assert compressing = '1' report "Compression wasn't turned on" severity error;
+        assert vnir_overflow = '0' and swir_overflow = '0' report "Compressed rows didn't fit" severity error;
+        assert overflow_count = 0 report "Imaging buffer dropped rows" severity error;
+        assert rows_total = 3*N_FRAMES
+            report "Expected every row of the image, got " & integer'image(rows_total) severity error;
+
+        --Decoding each band: the predictor and the coder's statistics are rebuilt from the decoded samples
+        for b in 0 to NUM_VNIR_ROW_FIFO-1 loop
+            band := b;
+            width := ROW_SAMPLES(b);
+            band_row_words := vnir_row_words(width);
+            bit_pos := 0;
+            mismatches := 0;
+            counter := 2**ccsds123.INITIAL_COUNT_EXPONENT;
+            accumulator := ((3 * 2**(ccsds123.ACCUMULATOR_INIT_CONSTANT+6) - 49) * counter) / 2**7;
+
+            for y in 0 to N_FRAMES-1 loop
+                for x in 0 to width-1 loop
+                    --Predicted value (s^) from the local sum, and the parity of the scaled predicted value (s~)
+                    if (y = 0 and x = 0) then
+                        predicted := 2**(D-1);
+                        odd := false;
+                    else
+                        if (y = 0) then
+                            sigma := 4*cur_row(x-1);
+                        elsif (x = 0) then
+                            sigma := 2*(prev_row(x) + prev_row(x+1));
+                        elsif (x = width-1) then
+                            sigma := cur_row(x-1) + prev_row(x-1) + 2*prev_row(x);
+                        else
+                            sigma := cur_row(x-1) + prev_row(x-1) + prev_row(x) + prev_row(x+1);
+                        end if;
+                        predicted := (sigma/2 + 1) / 2;
+                        odd := (sigma/2 + 1) mod 2 = 1;
+                    end if;
+
+                    --Mapped residual (delta)
+                    if (y = 0 and x = 0) then
+                        read_bits(D, delta);
+                    else
+                        k := 0;
+                        for i in 1 to D-2 loop
+                            if (counter * 2**i <= accumulator + (49*counter) / 2**7) then
+                                k := i;
+                            end if;
+                        end loop;
+
+                        unary := 0;
+                        loop
+                            exit when unary = ccsds123.UNARY_LENGTH_LIMIT;
+                            read_bits(1, lsbs);
+                            exit when lsbs = 1;
+                            unary := unary + 1;
+                        end loop;
+                        if (unary < ccsds123.UNARY_LENGTH_LIMIT) then
+                            read_bits(k, lsbs);
+                            delta := unary * 2**k + lsbs;
+                        else
+                            read_bits(D, delta);
+                        end if;
+
+                        if (counter < 2**ccsds123.RESCALING_COUNTER_SIZE - 1) then
+                            accumulator := accumulator + delta;
+                            counter := counter + 1;
+                        else
+                            accumulator := (accumulator + delta + 1) / 2;
+                            counter := (counter + 1) / 2;
+                        end if;
+                    end if;
+
+                    --Unmapping
+                    theta := minimum(predicted, MAX_SAMPLE - predicted);
+                    if (delta > 2*theta) then
+                        if (predicted < MAX_SAMPLE - predicted) then
+                            sample := predicted + delta - theta;
+                        else
+                            sample := predicted - (delta - theta);
+                        end if;
+                    elsif ((delta mod 2 = 0) = not odd) then
+                        sample := predicted + (delta + 1) / 2;
+                    else
+                        sample := predicted - (delta + 1) / 2;
+                    end if;
+                    cur_row(x) := sample;
+
+                    if (sample /= pixel(b, y, x)) then
+                        assert mismatches > 0
+                            report "Band " & integer'image(b) & " row " & integer'image(y) & " sample " & integer'image(x) &
+                                   " decoded as " & integer'image(sample) & ", expected " & integer'image(pixel(b, y, x))
+                            severity error;
+                        mismatches := mismatches + 1;
+                    end if;
+                end loop;
+                prev_row := cur_row;
+            end loop;
+
+            assert mismatches = 0
+                report "Band " & integer'image(b) & " has " & integer'image(mismatches) & " wrongly decoded samples"
+                severity error;
+
+            data_rows := (bit_pos + band_row_words*FIFO_WORD_LENGTH - 1) / (band_row_words*FIFO_WORD_LENGTH);
+            assert vnir_rows_written(b) = data_rows
+                report "Band " & integer'image(b) & ": expected " & integer'image(data_rows) &
+                       " compressed rows, got " & integer'image(vnir_rows_written(b)) severity error;
+        end loop;
+        stop;
+    end process check_process;
+
+end architecture;
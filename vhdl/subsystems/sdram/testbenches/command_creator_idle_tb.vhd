@@ -0,0 +1,208 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir;
+use work.sdram;
+use work.img_buffer_pkg.all;
+use work.custom_master_pkg.all;
+use work.fpga.all;
+
+-- Measures how long the Avalon write port sits idle between rows, with command_creator in its
+-- original (serial) mode and in its pipelined mode.
+--
+-- Both modes get their own imaging buffer, filled with the same 3*N_FRAMES VNIR rows up front, and
+-- their own model of the custom master. The model writes one word every MASTER_CLOCKS_PER_WORD
+-- clock cycles (standing in for SDRAM bursts and waitrequest) while it has a command and data. Like
+-- burst_write_master, it takes words into its buffer ahead of their command, and raises
+-- user_buffer_full once the buffer holds MASTER_FIFO_DEPTH-2 words; a word written while the buffer
+-- is full fails the test. The default depth is the one the custom master is built with in
+-- rw_test_sdram.qsys; the serial mode ignores user_buffer_full, so it needs room for a whole row,
+-- while the pipelined one has to wait for the master to drain. The number of clock cycles between
+-- the first and last word written on which the port had nothing to write is reported for each
+-- mode.
+entity command_creator_idle_tb is
+    generic (
+        N_FRAMES                : integer := 4;
+        MASTER_CLOCKS_PER_WORD  : integer := 2;
+        MASTER_FIFO_DEPTH       : integer := 256
+    );
+end entity;
+
+architecture sim of command_creator_idle_tb is
+
+    constant clock_period       : time := 20 ns;
+    constant vnir_row_clocks    : integer := vnir.ROW_WIDTH / vnir.FRAGMENT_WIDTH;
+    constant N_ROWS             : integer := 3*N_FRAMES;
+
+    signal clock                : std_logic := '1';
+    signal reset_n              : std_logic := '0';
+
+    type integer_a is array (0 to 1) of integer;
+    signal idle_cycles          : integer_a := (others => 0);
+    signal done                 : std_logic_vector(0 to 1) := "00";
+
+begin
+
+    clock <= not clock after clock_period / 2;
+    reset_n <= '1' after clock_period * 4;
+
+    -- Mode 0 is the serial command creator, mode 1 the pipelined one
+    MODE_GEN : for mode in 0 to 1 generate
+        signal vnir_fragment        : vnir.row_fragment_t := (others => (others => '0'));
+        signal vnir_fragment_avail  : vnir.row_type_t := vnir.ROW_NONE;
+        signal vnir_fragment_first  : std_logic := '0';
+        signal vnir_fragment_last   : std_logic := '0';
+        signal vnir_fragment_ready  : std_logic;
+
+        signal row_req              : std_logic;
+        signal transmitting_o       : std_logic;
+        signal row_data             : row_fragment_t;
+        signal row_type             : sdram.row_type_t;
+        signal sdram_busy           : std_logic;
+
+        signal master_cmd_in        : from_master_t;
+        signal master_cmd_out       : to_master_t;
+        signal words_left           : integer := 0;     -- words left in the master's current command
+        signal fifo_count           : integer := 0;     -- words in the master's buffer
+    begin
+
+        imaging_buffer : entity work.imaging_buffer generic map (
+            VNIR_ROWS           => N_FRAMES
+        ) port map (
+            clock               => clock,
+            reset_n             => reset_n,
+            vnir_fragment       => vnir_fragment,
+            vnir_fragment_available => vnir_fragment_avail,
+            vnir_fragment_first => vnir_fragment_first,
+            vnir_fragment_last  => vnir_fragment_last,
+            vnir_fragment_ready => vnir_fragment_ready,
+            swir_pixel          => (others => '0'),
+            swir_pixel_ready    => '0',
+            row_request         => row_req,
+            fragment_out        => row_data,
+            fragment_type       => row_type,
+            transmitting        => transmitting_o
+        );
+
+        command_creator : entity work.command_creator generic map (
+            PIPELINED           => mode = 1
+        ) port map (
+            clock               => clock,
+            reset_n             => reset_n,
+            vnir_img_header     => (others => '0'),
+            swir_img_header     => (others => '0'),
+            row_data            => row_data,
+            row_type            => row_type,
+            buffer_transmitting => transmitting_o,
+            address             => (others => '0'),
+            next_row_req        => row_req,
+            sdram_busy          => sdram_busy,
+            master_cmd_in       => master_cmd_in,
+            master_cmd_out      => master_cmd_out
+        );
+
+        vnir_process : process
+            type row_type_a is array (0 to 2) of vnir.row_type_t;
+            constant types : row_type_a := (vnir.ROW_RED, vnir.ROW_BLUE, vnir.ROW_NIR);
+        begin
+            wait until reset_n = '1';
+            wait until rising_edge(clock);
+            for row in 0 to N_ROWS-1 loop
+                for i in 0 to vnir_row_clocks-1 loop
+                    vnir_fragment <= (others => to_unsigned(row, vnir.ROW_PIXEL_BITS));
+                    vnir_fragment_avail <= types(row mod 3);
+                    vnir_fragment_first <= '1' when i = 0 else '0';
+                    vnir_fragment_last <= '1' when i = vnir_row_clocks-1 else '0';
+                    loop
+                        wait until rising_edge(clock);
+                        exit when vnir_fragment_ready = '1';
+                    end loop;
+                end loop;
+            end loop;
+            vnir_fragment_avail <= vnir.ROW_NONE;
+            vnir_fragment_first <= '0';
+            vnir_fragment_last <= '0';
+            wait;
+        end process vnir_process;
+
+        -- Custom master model
+        master_process : process
+            variable busy_clocks    : integer := 0;     -- clock cycles left on the word being written
+            variable words_written  : integer := 0;
+            variable idle           : integer := 0;
+            variable idle_run       : integer := 0;     -- idle clock cycles since the last word written
+            variable fifo_count_v   : integer;
+        begin
+            wait until rising_edge(clock);
+
+            fifo_count_v := fifo_count;
+            if master_cmd_out.user_write_buffer = '1' then
+                assert fifo_count < MASTER_FIFO_DEPTH report "Master buffer overflowed" severity failure;
+                fifo_count_v := fifo_count_v + 1;
+            end if;
+
+            if busy_clocks > 0 then
+                busy_clocks := busy_clocks - 1;
+            elsif words_left > 0 and fifo_count > 0 then
+                -- Start writing a word
+                busy_clocks := MASTER_CLOCKS_PER_WORD - 1;
+                words_left <= words_left - 1;
+                fifo_count_v := fifo_count_v - 1;
+                if words_written > 0 then
+                    idle := idle + idle_run;
+                end if;
+                idle_run := 0;
+                words_written := words_written + 1;
+                if words_written = N_ROWS * (VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS) then
+                    idle_cycles(mode) <= idle;
+                    done(mode) <= '1';
+                end if;
+            else
+                idle_run := idle_run + 1;
+            end if;
+            fifo_count <= fifo_count_v;
+
+            if master_cmd_out.control_go = '1' then
+                assert words_left = 0 report "control_go while the master is busy" severity failure;
+                words_left <= to_integer(unsigned(master_cmd_out.control_write_length)) / FIFO_WORD_BYTES;
+            end if;
+        end process master_process;
+
+        master_cmd_in.control_done <= '1' when words_left = 0 else '0';
+        master_cmd_in.user_buffer_full <= '1' when fifo_count >= MASTER_FIFO_DEPTH - 2 else '0';
+
+    end generate MODE_GEN;
+
+    report_process : process
+    begin
+        wait until done = "11" for clock_period * N_ROWS * (VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS) * MASTER_CLOCKS_PER_WORD * 4;
+        assert done = "11" report "Not every row was written" severity failure;
+
+        report "Idle write port clock cycles over " & integer'image(N_ROWS) & " rows: " &
+               "serial " & integer'image(idle_cycles(0)) & ", pipelined " & integer'image(idle_cycles(1));
+        assert idle_cycles(1) < idle_cycles(0)
+            report "Pipelined command creator didn't reduce idle cycles" severity error;
+        stop;
+    end process report_process;
+
+end architecture;
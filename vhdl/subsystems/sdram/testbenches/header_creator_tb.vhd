@@ -18,12 +18,20 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+library std;
+use std.env.stop;
+
 use work.spi_types.all;
 use work.vnir;
 use work.swir_types.all;
 use work.sdram.all;
 use work.fpga.all;
+use work.img_buffer_pkg.all;
 
+-- Takes two images through the header creator, and checks the fields of their trailers (the rows
+-- written and the row width of each band, each sensor's rows dropped and overflow during each image,
+-- the compressed flag and the image number) and catalog entries. A row count given while an image is
+-- in progress mustn't change it. The catalog slots the entries go in are checked by memory_map_tb.
 entity header_creator_tb is
 end entity;
 
@@ -31,6 +39,12 @@ architecture sim of header_creator_tb is
     --Clock frequency is 20 MHz
     constant clock_frequency    : integer := 20000000;
     constant clock_period       : time := 1000 ms / clock_frequency;
+
+    --Where the images are, for the catalog entries
+    constant VNIR_START         : integer := 16#200#;
+    constant VNIR_END           : integer := 16#EA18#;
+    constant SWIR_START         : integer := 16#1000200#;
+    constant SWIR_END           : integer := 16#1001A18#;
     
     --Control inputs
     signal clock                : std_logic := '1';
@@ -41,10 +55,36 @@ architecture sim of header_creator_tb is
     signal vnir_rows            : integer := 0;
     signal swir_rows            : integer := 0;
     signal sending_img          : std_logic := '0';
+    signal compress             : std_logic := '1';
+    signal compressing          : std_logic := '0';
+    signal vnir_rows_written    : row_count_a := (others => 0);
+    signal swir_rows_written    : natural := 0;
+    signal swir_compress_overflow : std_logic := '0';
+    signal vnir_row_dropped     : std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1) := (others => '0');
+    signal swir_row_dropped     : std_logic := '0';
 
     --Outputs
-    signal swir_img_header      : std_logic_vector(159 downto 0);
-    signal vnir_img_header      : std_logic_vector(159 downto 0);
+    signal swir_img_header      : header_t;
+    signal vnir_img_header      : header_t;
+    signal swir_img_trailer     : trailer_t;
+    signal vnir_img_trailer     : trailer_t;
+    signal swir_catalog_entry   : catalog_entry_t;
+    signal vnir_catalog_entry   : catalog_entry_t;
+
+    --First word of each trailer, the rest of the VNIR trailer being the band words
+    alias vnir_trailer_word     : std_logic_vector (127 downto 0) is vnir_img_trailer(TRAILER_LENGTH-1 downto TRAILER_LENGTH-128);
+    alias swir_trailer_word     : std_logic_vector (127 downto 0) is swir_img_trailer(TRAILER_LENGTH-1 downto TRAILER_LENGTH-128);
+
+    --A different row width for each band
+    pure function band_widths return vnir_row_widths_t is
+        variable widths : vnir_row_widths_t;
+    begin
+        for b in widths'range loop
+            widths(b) := vnir.ROW_WIDTH / (b + 1);
+        end loop;
+        return widths;
+    end function band_widths;
+    constant VNIR_ROW_WIDTHS    : vnir_row_widths_t := band_widths;
 begin
     i_header_creator : entity work.header_creator(rtl)
     port map(
@@ -53,14 +93,99 @@ begin
         timestamp       => timestamp,
         vnir_rows       => vnir_rows,
         swir_rows       => swir_rows,
-        img_config_done => sending_img,
+        vnir_row_widths => VNIR_ROW_WIDTHS,
+        vnir_img_config_done => sending_img,
+        swir_img_config_done => sending_img,
+        compress        => compress,
+        compressing     => compressing,
+        vnir_rows_written => vnir_rows_written,
+        swir_rows_written => swir_rows_written,
+        vnir_compress_overflow => '0',
+        swir_compress_overflow => swir_compress_overflow,
+        vnir_row_dropped => vnir_row_dropped,
+        swir_row_dropped => swir_row_dropped,
+        vnir_start_address => to_signed(VNIR_START, ADDRESS_LENGTH),
+        vnir_end_address => to_signed(VNIR_END, ADDRESS_LENGTH),
+        swir_start_address => to_signed(SWIR_START, ADDRESS_LENGTH),
+        swir_end_address => to_signed(SWIR_END, ADDRESS_LENGTH),
         swir_img_header => swir_img_header,
-        vnir_img_header => vnir_img_header);
+        vnir_img_header => vnir_img_header,
+        swir_img_trailer => swir_img_trailer,
+        vnir_img_trailer => vnir_img_trailer,
+        swir_catalog_entry => swir_catalog_entry,
+        vnir_catalog_entry => vnir_catalog_entry);
     
     clock <= not clock after clock_period / 2;
 
     --Testing stuff
     testing_process : process is
+        --Checks both trailers and catalog entries once the images are done
+        procedure check_trailers(vnir_rows_expected : row_count_a; swir_rows_expected : natural;
+                                 vnir_dropped : natural; swir_dropped : natural; swir_overflow : std_logic;
+                                 number : natural) is
+        begin
+            assert unsigned(vnir_trailer_word(127 downto 112)) = vnir_rows_expected(1) report "Wrong blue rows in the VNIR trailer" severity error;
+            assert unsigned(vnir_trailer_word(111 downto 96)) = vnir_rows_expected(0) report "Wrong red rows in the VNIR trailer" severity error;
+            assert unsigned(vnir_trailer_word(95 downto 80)) = vnir_rows_expected(2) report "Wrong NIR rows in the VNIR trailer" severity error;
+            assert unsigned(swir_trailer_word(127 downto 112)) = swir_rows_expected report "Wrong rows in the SWIR trailer" severity error;
+            assert unsigned(swir_trailer_word(111 downto 96)) = 1 report "Wrong co-added rows in the SWIR trailer" severity error;
+
+            --Status: rows dropped during the image, overflow and compressed
+            assert unsigned(vnir_trailer_word(63 downto 48)) = vnir_dropped report "Wrong dropped rows in the VNIR trailer" severity error;
+            assert unsigned(swir_trailer_word(63 downto 48)) = swir_dropped report "Wrong dropped rows in the SWIR trailer" severity error;
+            assert vnir_trailer_word(33) = '0' and vnir_trailer_word(32) = compress report "Wrong VNIR trailer flags" severity error;
+            assert swir_trailer_word(33) = swir_overflow and swir_trailer_word(32) = compress report "Wrong SWIR trailer flags" severity error;
+
+            --Image number, shared by images configured together
+            assert unsigned(vnir_trailer_word(31 downto 24)) = number report "Wrong image number in the VNIR trailer" severity error;
+            assert unsigned(swir_trailer_word(31 downto 24)) = number report "Wrong image number in the SWIR trailer" severity error;
+
+            --Reserved fields
+            assert vnir_trailer_word(79 downto 64) = x"0000" and vnir_trailer_word(47 downto 34) = "00000000000000" and
+                   vnir_trailer_word(23 downto 0) = x"000000" report "Reserved VNIR trailer bits set" severity error;
+            assert swir_trailer_word(95 downto 64) = x"00000000" and swir_trailer_word(47 downto 34) = "00000000000000" and
+                   swir_trailer_word(23 downto 0) = x"000000" report "Reserved SWIR trailer bits set" severity error;
+            assert swir_img_trailer(TRAILER_LENGTH-129 downto 0) = (TRAILER_LENGTH-129 downto 0 => '0')
+                report "SWIR trailer band words set" severity error;
+
+            --Each band's row width follows the first word of the VNIR trailer, then the rows of the
+            --bands past the first three
+            for b in 0 to NUM_VNIR_ROW_FIFO-1 loop
+                assert unsigned(vnir_img_trailer(TRAILER_LENGTH-129-16*b downto TRAILER_LENGTH-144-16*b)) = VNIR_ROW_WIDTHS(b)
+                    report "Wrong row width of band " & integer'image(b) & " in the VNIR trailer" severity error;
+            end loop;
+            for b in 3 to NUM_VNIR_ROW_FIFO-1 loop
+                assert unsigned(vnir_img_trailer(TRAILER_LENGTH-129-16*(NUM_VNIR_ROW_FIFO+b-3) downto TRAILER_LENGTH-144-16*(NUM_VNIR_ROW_FIFO+b-3))) = vnir_rows_expected(b)
+                    report "Wrong rows of band " & integer'image(b) & " in the VNIR trailer" severity error;
+            end loop;
+        end procedure check_trailers;
+
+        procedure check_catalog(vnir_rows_expected : natural; swir_rows_expected : natural; number : natural) is
+        begin
+            --Timestamp and image number, latched when the image was configured
+            assert unsigned(vnir_catalog_entry(255 downto 192)) = timestamp report "Wrong VNIR catalog timestamp" severity error;
+            assert unsigned(swir_catalog_entry(255 downto 192)) = timestamp report "Wrong SWIR catalog timestamp" severity error;
+            assert unsigned(vnir_catalog_entry(191 downto 184)) = number report "Wrong VNIR catalog image number" severity error;
+            assert unsigned(swir_catalog_entry(191 downto 184)) = number report "Wrong SWIR catalog image number" severity error;
+
+            --Partition and rows
+            assert vnir_catalog_entry(183 downto 176) = x"00" report "Wrong VNIR catalog partition" severity error;
+            assert swir_catalog_entry(183 downto 176) = x"01" report "Wrong SWIR catalog partition" severity error;
+            assert unsigned(vnir_catalog_entry(175 downto 160)) = vnir_rows_expected report "Wrong VNIR catalog rows" severity error;
+            assert unsigned(swir_catalog_entry(175 downto 160)) = swir_rows_expected report "Wrong SWIR catalog rows" severity error;
+
+            --Where the images are
+            assert signed(vnir_catalog_entry(159 downto 128)) = VNIR_START report "Wrong VNIR catalog start address" severity error;
+            assert signed(vnir_catalog_entry(127 downto 96)) = VNIR_END report "Wrong VNIR catalog end address" severity error;
+            assert signed(swir_catalog_entry(159 downto 128)) = SWIR_START report "Wrong SWIR catalog start address" severity error;
+            assert signed(swir_catalog_entry(127 downto 96)) = SWIR_END report "Wrong SWIR catalog end address" severity error;
+
+            --The status is the trailer's
+            assert vnir_catalog_entry(95 downto 64) = vnir_trailer_word(63 downto 32) report "Wrong VNIR catalog status" severity error;
+            assert swir_catalog_entry(95 downto 64) = swir_trailer_word(63 downto 32) report "Wrong SWIR catalog status" severity error;
+            assert vnir_catalog_entry(63 downto 0) = x"0000000000000000" and swir_catalog_entry(63 downto 0) = x"0000000000000000"
+                report "Reserved catalog bits set" severity error;
+        end procedure check_catalog;
     begin
         --Waiting two clock cycles before taking it out of reset
         wait until rising_edge(clock);
@@ -70,31 +195,66 @@ begin
         
         wait until rising_edge(clock);
 
+        --First image, compressed, with a VNIR row dropped while it's being taken, and row counts given
+        --while it's in progress, which the memory map would ignore
         timestamp <= to_unsigned(1594402392, 64);
         vnir_rows <= 23;
         swir_rows <= 12;
-
-        wait until (swir_img_header(102) /= '0');
+        wait until rising_edge(clock);
 
         sending_img <= '1';
 
         wait until rising_edge(clock);
+        vnir_rows <= 0;
         swir_rows <= 0;
         wait until rising_edge(clock);
+        vnir_rows <= 99;
+        swir_rows <= 99;
         wait until rising_edge(clock);
+        vnir_rows <= 0;
+        swir_rows <= 0;
+        vnir_row_dropped(2) <= '1';
         wait until rising_edge(clock);
+        vnir_row_dropped(2) <= '0';
+        vnir_rows_written <= (23, 23, 22);
+        swir_rows_written <= 12;
         wait until rising_edge(clock);
         sending_img <= '0';
         wait until rising_edge(clock);
         wait until rising_edge(clock);
+
+        check_trailers((23, 23, 22), 12, 1, 0, '0', 0);
+        check_catalog(23, 12, 0);
+
+        --Second image, uncompressed, with two SWIR rows dropped and its compressed rows not fitting. A
+        --row dropped between the images isn't counted
+        compress <= '0';
+        swir_row_dropped <= '1';
+        vnir_rows <= 10;
+        swir_rows <= 5;
+        wait until rising_edge(clock);
+        swir_row_dropped <= '0';
+        sending_img <= '1';
         wait until rising_edge(clock);
+        vnir_rows <= 0;
+        swir_rows <= 0;
+        swir_row_dropped <= '1';
         wait until rising_edge(clock);
         wait until rising_edge(clock);
+        swir_row_dropped <= '0';
+        vnir_rows_written <= (10, 10, 10);
+        swir_rows_written <= 5;
+        swir_compress_overflow <= '1';
         wait until rising_edge(clock);
+        sending_img <= '0';
         wait until rising_edge(clock);
         wait until rising_edge(clock);
-        
-        wait;
+
+        check_trailers((10, 10, 10), 5, 0, 2, '1', 1);
+        check_catalog(10, 5, 1);
+
+        report "Header creator test done";
+        stop;
 
     end process testing_process;
-end architecture;
\ No newline at end of file
+end architecture;
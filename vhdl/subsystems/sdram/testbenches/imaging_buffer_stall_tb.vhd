@@ -0,0 +1,197 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir;
+use work.swir_types.all;
+use work.sdram;
+use work.sdram."=";
+use work.img_buffer_pkg.all;
+use work.fpga.all;
+
+-- Checks that the imaging buffer doesn't lose or corrupt VNIR rows when the SDRAM stalls.
+--
+-- The command creator is emulated by requesting a row, collecting it, and then waiting
+-- STALL_CLOCKS clock cycles (standing in for a slow SDRAM burst) before requesting the next
+-- one. Every pixel of a row is set to the row's sequence number, so each received row can be
+-- checked word by word and matched up with the row that was sent. Rows are sent at full speed
+-- (3 back-to-back rows per frame, one fragment per clock cycle); any row that doesn't fit in the buffer should
+-- be counted by overflow_count rather than overwriting a stored row.
+entity imaging_buffer_stall_tb is
+    generic (
+        STALL_CLOCKS    : integer := 600;
+        VNIR_ROWS       : integer := VNIR_BUFFER_ROWS;
+        N_FRAMES        : integer := 20
+    );
+end entity;
+
+architecture sim of imaging_buffer_stall_tb is
+
+    constant clock_period       : time := 20 ns;
+    constant vnir_row_clocks    : integer := vnir.ROW_WIDTH / vnir.FRAGMENT_WIDTH;  -- clock cycles taken by each VNIR row
+    constant vnir_frame_clocks  : integer := 1000;  -- clock cycles between bursts
+
+    signal clock                : std_logic := '1';
+    signal reset_n              : std_logic := '0';
+
+    signal vnir_fragment        : vnir.row_fragment_t := (others => (others => '0'));
+    signal vnir_fragment_avail  : vnir.row_type_t := vnir.ROW_NONE;
+    signal vnir_fragment_first  : std_logic := '0';
+    signal vnir_fragment_last   : std_logic := '0';
+    signal vnir_fragment_ready  : std_logic;
+
+    signal row_req              : std_logic := '0';
+    signal transmitting_o       : std_logic;
+    signal fragment_out         : row_fragment_t;
+    signal row_type             : sdram.row_type_t;
+
+    signal rows_stored          : row_count_a;
+    signal buffer_empty         : std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+    signal buffer_full          : std_logic_vector(0 to NUM_VNIR_ROW_FIFO-1);
+    signal overflow_count       : unsigned(31 downto 0);
+
+    signal rows_sent            : integer := 0;
+    signal rows_received        : integer := 0;
+    signal sending_done         : boolean := false;
+
+    -- Word `word` of a packed row whose pixels all have value `pixel`
+    function packed_word(pixel : integer; word : integer) return row_fragment_t is
+        variable pixel_v : unsigned(vnir.ROW_PIXEL_BITS-1 downto 0) := to_unsigned(pixel, vnir.ROW_PIXEL_BITS);
+        variable word_v : row_fragment_t;
+    begin
+        for i in word_v'range loop
+            word_v(i) := pixel_v((word * FIFO_WORD_LENGTH + i) mod vnir.ROW_PIXEL_BITS);
+        end loop;
+        return word_v;
+    end function packed_word;
+
+begin
+
+    imaging_buffer : entity work.imaging_buffer generic map (
+        VNIR_ROWS           => VNIR_ROWS
+    ) port map (
+        clock               => clock,
+        reset_n             => reset_n,
+        vnir_fragment       => vnir_fragment,
+        vnir_fragment_available => vnir_fragment_avail,
+        vnir_fragment_first => vnir_fragment_first,
+        vnir_fragment_last  => vnir_fragment_last,
+        vnir_fragment_ready => vnir_fragment_ready,
+        swir_pixel          => (others => '0'),
+        swir_pixel_ready    => '0',
+        row_request         => row_req,
+        fragment_out        => fragment_out,
+        fragment_type       => row_type,
+        transmitting        => transmitting_o,
+        vnir_rows_stored    => rows_stored,
+        vnir_buffer_empty   => buffer_empty,
+        vnir_buffer_full    => buffer_full,
+        overflow_count      => overflow_count
+    );
+
+    clock <= not clock after clock_period / 2;
+
+    vnir_process: process
+        type row_type_a is array (0 to 2) of vnir.row_type_t;
+        constant types : row_type_a := (vnir.ROW_RED, vnir.ROW_BLUE, vnir.ROW_NIR);
+        variable row_number : integer := 0;
+    begin
+        wait for clock_period * 4;
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        for frame in 0 to N_FRAMES-1 loop
+            for band in 0 to 2 loop
+                for i in 0 to vnir_row_clocks-1 loop
+                    vnir_fragment <= (others => to_unsigned(row_number, vnir.ROW_PIXEL_BITS));
+                    vnir_fragment_avail <= types(band);
+                    vnir_fragment_first <= '1' when i = 0 else '0';
+                    vnir_fragment_last <= '1' when i = vnir_row_clocks-1 else '0';
+                    loop
+                        wait until rising_edge(clock);
+                        exit when vnir_fragment_ready = '1';
+                    end loop;
+                end loop;
+                vnir_fragment_avail <= vnir.ROW_NONE;
+                vnir_fragment_first <= '0';
+                vnir_fragment_last <= '0';
+                row_number := row_number + 1;
+                rows_sent <= row_number;
+            end loop;
+            wait for clock_period * (vnir_frame_clocks - 3*vnir_row_clocks);
+        end loop;
+        sending_done <= true;
+        wait;
+    end process vnir_process;
+
+    -- Emulates the command creator, with a stall after each row
+    transmit_process: process
+        variable row_number : integer;
+        variable last_row   : integer_vector(0 to NUM_VNIR_ROW_FIFO-1) := (others => -1);
+        variable band       : integer;
+    begin
+        wait until reset_n = '1';
+
+        loop
+            wait until rising_edge(clock);
+            row_req <= '1';
+            wait until rising_edge(clock);
+            row_req <= '0';
+
+            wait until rising_edge(clock) and (transmitting_o = '1' or (sending_done and buffer_empty = "111"));
+            exit when transmitting_o = '0';
+
+            row_number := to_integer(unsigned(fragment_out(vnir.ROW_PIXEL_BITS-1 downto 0)));
+            case row_type is
+                when sdram.ROW_RED  => band := 0;
+                when sdram.ROW_BLUE => band := 1;
+                when sdram.ROW_NIR  => band := 2;
+                when others         => report "Invalid row type" severity failure;
+            end case;
+            assert row_number mod 3 = band report "Row " & integer'image(row_number) & " has the wrong type" severity error;
+            assert row_number > last_row(band) report "Row " & integer'image(row_number) & " is out of order" severity error;
+            last_row(band) := row_number;
+
+            for word in 0 to VNIR_FIFO_DEPTH-1 loop
+                assert transmitting_o = '1' report "Row ended after " & integer'image(word) & " words" severity error;
+                assert fragment_out = packed_word(row_number, word)
+                    report "Mismatched word " & integer'image(word) & " of row " & integer'image(row_number) severity error;
+                wait until rising_edge(clock);
+            end loop;
+            assert transmitting_o = '1' report "Row " & integer'image(row_number) & " has no trailer" severity error;
+            assert sdram.row_metadata(fragment_out).band = row_type
+                report "Mismatched trailer of row " & integer'image(row_number) severity error;
+            wait until rising_edge(clock);
+            assert transmitting_o = '0' report "Row is longer than " & integer'image(VNIR_FIFO_DEPTH) & " words" severity error;
+            rows_received <= rows_received + 1;
+
+            wait for clock_period * STALL_CLOCKS;
+        end loop;
+
+        report "Sent " & integer'image(rows_sent) & " rows, received " & integer'image(rows_received) &
+               ", dropped " & integer'image(to_integer(overflow_count));
+        assert rows_received + to_integer(overflow_count) = rows_sent
+            report "Rows were lost without being counted" severity error;
+        stop;
+    end process transmit_process;
+
+end architecture;
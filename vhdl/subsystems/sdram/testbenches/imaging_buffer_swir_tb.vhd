@@ -0,0 +1,139 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir;
+use work.swir_types.all;
+use work.sdram;
+use work.sdram."=";
+use work.img_buffer_pkg.all;
+use work.fpga.all;
+
+-- Streams N_ROWS full SWIR rows into the imaging buffer with a new pixel on every clock cycle
+-- and no gap between rows, and checks every bit of every word read back out. Pixel i of row r
+-- has the value r*512 + i, so a dropped, repeated or shifted pixel shows up as a mismatch.
+entity imaging_buffer_swir_tb is
+    generic (
+        N_ROWS          : integer := 8;
+        STALL_CLOCKS    : integer := 100    -- clock cycles the emulated command creator waits between rows
+    );
+end entity;
+
+architecture sim of imaging_buffer_swir_tb is
+
+    constant clock_period       : time := 20 ns;
+    constant WORD_PIXELS        : integer := FIFO_WORD_LENGTH / swir_pixel_bits;
+
+    signal clock                : std_logic := '1';
+    signal reset_n              : std_logic := '0';
+
+    signal swir_pixel           : swir_pixel_t := (others => '0');
+    signal swir_pxl_rdy         : std_logic := '0';
+
+    signal row_req              : std_logic := '0';
+    signal transmitting_o       : std_logic;
+    signal fragment_out         : row_fragment_t;
+    signal row_type             : sdram.row_type_t;
+    signal overflow_count       : unsigned(31 downto 0);
+
+    function pixel_value(row : integer; pixel : integer) return unsigned is
+    begin
+        return to_unsigned((row * swir_row_width + pixel) mod 2**swir_pixel_bits, swir_pixel_bits);
+    end function pixel_value;
+
+begin
+
+    imaging_buffer : entity work.imaging_buffer port map (
+        clock               => clock,
+        reset_n             => reset_n,
+        vnir_fragment       => (others => (others => '0')),
+        vnir_fragment_available => vnir.ROW_NONE,
+        vnir_fragment_first => '0',
+        vnir_fragment_last  => '0',
+        vnir_fragment_ready => open,
+        swir_pixel          => swir_pixel,
+        swir_pixel_ready    => swir_pxl_rdy,
+        row_request         => row_req,
+        fragment_out        => fragment_out,
+        fragment_type       => row_type,
+        transmitting        => transmitting_o,
+        overflow_count      => overflow_count
+    );
+
+    clock <= not clock after clock_period / 2;
+
+    swir_process: process
+    begin
+        wait for clock_period * 4;
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        swir_pxl_rdy <= '1';
+        for row in 0 to N_ROWS-1 loop
+            for i in 0 to swir_row_width-1 loop
+                swir_pixel <= stdlogicvector_to_swir_pixel(std_logic_vector(pixel_value(row, i)));
+                wait until rising_edge(clock);
+            end loop;
+        end loop;
+        swir_pxl_rdy <= '0';
+        wait;
+    end process swir_process;
+
+    -- Emulates the command creator
+    transmit_process: process
+        variable expected : row_fragment_t;
+    begin
+        wait until reset_n = '1';
+
+        for row in 0 to N_ROWS-1 loop
+            wait until rising_edge(clock);
+            row_req <= '1';
+            wait until rising_edge(clock);
+            row_req <= '0';
+
+            wait until rising_edge(clock) and transmitting_o = '1';
+            assert row_type = sdram.ROW_SWIR report "Invalid row type" severity error;
+
+            for word in 0 to SWIR_FIFO_DEPTH-1 loop
+                for i in 0 to WORD_PIXELS-1 loop
+                    expected(swir_pixel_bits*(i+1)-1 downto swir_pixel_bits*i) := std_logic_vector(pixel_value(row, word*WORD_PIXELS + i));
+                end loop;
+                assert transmitting_o = '1' report "Row " & integer'image(row) & " ended after " & integer'image(word) & " words" severity error;
+                assert fragment_out = expected
+                    report "Mismatched word " & integer'image(word) & " of row " & integer'image(row) severity error;
+                wait until rising_edge(clock);
+            end loop;
+            assert transmitting_o = '1' report "Row " & integer'image(row) & " has no trailer" severity error;
+            assert sdram.row_metadata(fragment_out).row_index = row
+                report "Mismatched trailer of row " & integer'image(row) severity error;
+            wait until rising_edge(clock);
+            assert transmitting_o = '0' report "Row is longer than " & integer'image(SWIR_FIFO_DEPTH) & " words" severity error;
+
+            wait for clock_period * STALL_CLOCKS;
+        end loop;
+
+        assert overflow_count = 0 report "Rows were dropped" severity error;
+        report "Received " & integer'image(N_ROWS) & " rows";
+        stop;
+    end process transmit_process;
+
+end architecture;
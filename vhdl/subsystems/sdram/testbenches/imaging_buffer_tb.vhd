@@ -22,6 +22,7 @@ use work.spi_types.all;
 use work.vnir;
 use work.swir_types.all;
 use work.sdram;
+use work.sdram."=";
 use work.img_buffer_pkg.all;
 use work.fpga.all;
 
@@ -46,8 +47,12 @@ architecture sim of imaging_buffer_tb is
     signal reset_n              : std_logic := '0';
 
     -- Data inputs
-    signal vnir_row             : vnir.row_t := (others => "1111111111");
-    signal vnir_row_rdy         : vnir.row_type_t := vnir.ROW_NONE;
+    signal vnir_row             : vnir.row_t := (others => (others => '1'));
+    signal vnir_fragment        : vnir.row_fragment_t;
+    signal vnir_fragment_avail  : vnir.row_type_t := vnir.ROW_NONE;
+    signal vnir_fragment_first  : std_logic := '0';
+    signal vnir_fragment_last   : std_logic := '0';
+    signal vnir_fragment_ready  : std_logic;
     signal swir_pixel           : swir_pixel_t := "1010101010101010";
     signal swir_pxl_rdy         : std_logic := '0';
 
@@ -63,8 +68,11 @@ begin
     imaging_buffer : entity work.imaging_buffer port map (
         clock               => clock,
         reset_n             => reset_n,
-        vnir_row            => vnir_row,
-        vnir_row_ready      => vnir_row_rdy,
+        vnir_fragment       => vnir_fragment,
+        vnir_fragment_available => vnir_fragment_avail,
+        vnir_fragment_first => vnir_fragment_first,
+        vnir_fragment_last  => vnir_fragment_last,
+        vnir_fragment_ready => vnir_fragment_ready,
         swir_pixel          => swir_pixel,
         swir_pixel_ready    => swir_pxl_rdy,
         row_request         => row_req,
@@ -94,26 +102,46 @@ begin
     -- the burst will consist of only 1 or 2 rows. They should still be separated by 128 clock cycles.
 
     vnir_process: process
+        -- Sends vnir_row as a stream of fragments of consecutive pixels, like the VNIR subsystem does
+        procedure send_row(row_type : vnir.row_type_t) is
+        begin
+            for g in 0 to vnir.ROW_WIDTH/vnir.FRAGMENT_WIDTH-1 loop
+                for k in 0 to vnir.FRAGMENT_WIDTH-1 loop
+                    vnir_fragment(k) <= vnir_row(vnir.FRAGMENT_WIDTH*g + k);
+                end loop;
+                vnir_fragment_avail <= row_type;
+                if g = 0 then
+                    vnir_fragment_first <= '1';
+                else
+                    vnir_fragment_first <= '0';
+                end if;
+                if g = vnir.ROW_WIDTH/vnir.FRAGMENT_WIDTH-1 then
+                    vnir_fragment_last <= '1';
+                else
+                    vnir_fragment_last <= '0';
+                end if;
+                -- Hold the fragment until the imaging buffer takes it
+                loop
+                    wait until rising_edge(clock);
+                    exit when vnir_fragment_ready = '1';
+                end loop;
+            end loop;
+            vnir_fragment_avail <= vnir.ROW_NONE;
+            vnir_fragment_first <= '0';
+            vnir_fragment_last <= '0';
+        end procedure send_row;
     begin
         for i in 0 to 2047 loop
-            vnir_row(i) <= to_unsigned(i, 10);
+            vnir_row(i) <= to_unsigned(i mod 2**vnir.ROW_PIXEL_BITS, vnir.ROW_PIXEL_BITS);
         end loop;
         wait for reset_period; 
 
         for i in 1 to 100 loop
-            vnir_row_rdy <= vnir.ROW_RED;
-            wait until rising_edge(clock);
-            vnir_row_rdy <= vnir.ROW_NONE;
-            wait for vnir_row_clocks;
+            send_row(vnir.ROW_RED);
 
-            vnir_row_rdy <= vnir.ROW_BLUE;
-            wait until rising_edge(clock);
-            vnir_row_rdy <= vnir.ROW_NONE;
-            wait for vnir_row_clocks;
+            send_row(vnir.ROW_BLUE);
 
-            vnir_row_rdy <= vnir.ROW_NIR;
-            wait until rising_edge(clock);
-            vnir_row_rdy <= vnir.ROW_NONE;
+            send_row(vnir.ROW_NIR);
             wait for (vnir_frame_clocks-3*vnir_row_clocks);
         end loop;
         wait;
@@ -155,4 +183,47 @@ begin
         wait;
     end process transmit_process; 
 
+    -- Every row sent out ends with its trailer: it has to name the row's band, count the band's rows in
+    -- row_index, show that nothing was dropped, and have a capture time later than the band's last row's
+    check_process: process is
+        type capture_time_a is array (sdram.ROW_BLUE to sdram.ROW_SWIR) of capture_time_t;
+        variable words          : natural := 0;
+        variable row_words      : natural;
+        variable rows_seen      : sdram.row_counter_a := (others => (others => '0'));
+        variable last_capture   : capture_time_a := (others => (others => '0'));
+        variable metadata       : sdram.row_metadata_t;
+    begin
+        wait until rising_edge(clock);
+        if (transmitting_o = '1') then
+            if (row_type = sdram.ROW_SWIR) then
+                row_words := SWIR_FIFO_DEPTH + ROW_TRAILER_WORDS;
+            else
+                row_words := VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS;
+            end if;
+            words := words + 1;
+
+            if (words = row_words) then
+                metadata := sdram.row_metadata(fragment_out);
+                assert metadata.band = row_type
+                    report "Trailer of a " & sdram.row_type_t'image(row_type) & " row names " & sdram.row_type_t'image(metadata.band)
+                    severity error;
+                assert metadata.row_index = rows_seen(row_type)
+                    report "Row " & integer'image(to_integer(rows_seen(row_type))) & " of " & sdram.row_type_t'image(row_type)
+                           & " has row_index " & integer'image(to_integer(metadata.row_index))
+                    severity error;
+                assert metadata.dropped = 0 and metadata.compressed = '0'
+                    report "Unexpected dropped count or compressed flag in a trailer" severity error;
+                assert rows_seen(row_type) = 0 or metadata.capture_time > last_capture(row_type)
+                    report "Capture time of a " & sdram.row_type_t'image(row_type) & " row didn't go up" severity error;
+
+                rows_seen(row_type) := rows_seen(row_type) + 1;
+                last_capture(row_type) := metadata.capture_time;
+                words := 0;
+            end if;
+        else
+            assert words = 0 report "Row cut short after " & integer'image(words) & " words" severity error;
+            words := 0;
+        end if;
+    end process check_process;
+
 end architecture;
@@ -9,6 +9,16 @@ use work.swir_types.all;
 use work.sdram.all;
 use work.fpga.all;
 
+library std;
+use std.env.stop;
+
+-- Takes an image through the memory map, with its rows requested the way the command creator
+-- does, then resets it and takes CATALOG_ENTRIES+2 single-row SWIR images through it, checking that
+-- each one's catalog entry goes in the next slot and that the catalog wraps around once it's full.
+-- Then a SWIR image and a VNIR image each have a row dropped, and have to finish anyway.
+-- Last, each sensor takes an image from start to end while the other is in the middle of one, with
+-- the catalog entries in the order the images end, and a VNIR image is given its rows while the one
+-- before it is finishing, whose trailer address has to be kept until its img_config_done falls.
 entity memory_map_tb is
 end entity;
 
@@ -29,6 +39,8 @@ architecture sim of memory_map_tb is
     signal start_config        : std_logic := '0';
     signal config_done         : std_logic;
     signal img_config_done     : std_logic;
+    signal vnir_img_config_done : std_logic;
+    signal swir_img_config_done : std_logic;
 
     --Image Config signals
     signal number_swir_rows    : natural := 0;
@@ -37,7 +49,16 @@ architecture sim of memory_map_tb is
     --Output image row address config
     signal next_row_type       : row_type_t := ROW_NONE;
     signal next_row_req        : std_logic := '0';
+    signal vnir_row_dropped    : std_logic_vector(0 to vnir.N_WINDOWS-1) := (others => '0');
+    signal swir_row_dropped    : std_logic := '0';
     signal output_address      : address_t;
+    signal vnir_header_address : address_t;
+    signal swir_header_address : address_t;
+    signal vnir_trailer_address : address_t;
+    signal swir_trailer_address : address_t;
+    signal vnir_end_address    : address_t;
+    signal vnir_catalog_address : address_t;
+    signal swir_catalog_address : address_t;
 
     --Read data to be read from sdram due to mpu interaction
     signal sdram_error         : error_t := no_error;
@@ -51,17 +72,48 @@ begin
         start_config => start_config,
         config_done => config_done,
         img_config_done => img_config_done,
+        vnir_img_config_done => vnir_img_config_done,
+        swir_img_config_done => swir_img_config_done,
         number_vnir_rows => number_vnir_rows,
         number_swir_rows => number_swir_rows,
         next_row_type => next_row_type,
         next_row_req => next_row_req,
         output_address => output_address,
+        vnir_row_dropped => vnir_row_dropped,
+        swir_row_dropped => swir_row_dropped,
+        vnir_header_address => vnir_header_address,
+        swir_header_address => swir_header_address,
+        vnir_trailer_address => vnir_trailer_address,
+        swir_trailer_address => swir_trailer_address,
+        vnir_end_address => vnir_end_address,
+        vnir_catalog_address => vnir_catalog_address,
+        swir_catalog_address => swir_catalog_address,
         sdram_error => sdram_error
     );
 
     clk <= not(clk) after clk_period / 2;
 
     process is
+        constant CATALOG_ENTRY_ADDRESSES : integer := CATALOG_ENTRY_LENGTH / 16;
+
+        --Requests a row of the given type; each request moves the counter of the row before it on
+        procedure request_row(row_type : row_type_t) is
+        begin
+            next_row_type <= row_type;
+            next_row_req <= '1';
+            wait for clk_period * 3;
+            next_row_req <= '0';
+            wait for clk_period * 5;
+        end procedure request_row;
+
+        --Catalog slot of the n-th entry
+        impure function catalog_slot(n : natural) return address_t is
+        begin
+            return memory_state.catalog_base + (n mod CATALOG_ENTRIES) * CATALOG_ENTRY_ADDRESSES;
+        end function catalog_slot;
+
+        variable catalog_count : natural;
+        variable header, trailer, image_end : address_t;
     begin
         wait for 2 * clk_period;
 
@@ -82,23 +134,19 @@ begin
         wait until rising_edge(clk);
         next_row_req <= '1';
 
-        --Setting the number of rows for the incoming image
+        --Setting the number of rows for the incoming image, which are only given for a clock cycle
         number_vnir_rows <= 3;
         number_swir_rows <= 2;
+        wait until rising_edge(clk);
+        number_vnir_rows <= 0;
+        number_swir_rows <= 0;
         wait until (img_config_done = '1');
         next_row_req <= '0';
 
-        --Additionally, next row type waiting is red, then waiting 10 clks for next_row_req as it transmits vnir header
+        --The header addresses are on vnir_header_address and swir_header_address, so the first
+        --row can be requested straight away. Next row type waiting is red
         next_row_type <= ROW_RED;
         wait for clk_period * 10;
-        next_row_req <= '1';
-
-        --Waiting for address to change
-        wait for clk_period * 4;
-
-        --Output is now swir header
-        next_row_req <= '0';
-        wait for clk_period * 10;
 
         --Output is now red row, blue row next
         next_row_req <= '1';
@@ -173,6 +221,204 @@ begin
         next_row_req <= '1';
         wait for clk_period * 3;
         next_row_req <= '0';
+        wait for clk_period * 10;
+
+        --Starting over for the catalog
+        reset_n <= '0';
+        next_row_type <= ROW_NONE;
+        start_config <= '0';
+        wait for clk_period * 2;
+        reset_n <= '1';
+        wait until rising_edge(clk);
+        start_config <= '1';
+        wait until (config_done = '1');
+        wait until rising_edge(clk);
+
+        --Single-row SWIR images: the row's request is followed by one that moves its counter on
+        for n in 0 to CATALOG_ENTRIES+1 loop
+            number_swir_rows <= 1;
+            wait until rising_edge(clk);
+            number_swir_rows <= 0;
+            wait until (swir_img_config_done = '1');
+            wait for clk_period * 5;
+
+            request_row(ROW_SWIR);
+            request_row(ROW_NONE);
+            wait until (swir_img_config_done = '0') for clk_period * 100;
+            assert swir_img_config_done = '0' report "SWIR image " & integer'image(n) & " never finished" severity failure;
+            wait until rising_edge(clk);
+
+            assert swir_catalog_address = memory_state.catalog_base + (n mod CATALOG_ENTRIES) * CATALOG_ENTRY_ADDRESSES
+                report "SWIR image " & integer'image(n) & " isn't in catalog slot " & integer'image(n mod CATALOG_ENTRIES)
+                severity error;
+            assert memory_state.catalog_count = n + 1
+                report "Catalog count isn't " & integer'image(n + 1) severity error;
+        end loop;
+
+        --The first two slots have been written again
+        assert swir_catalog_address = memory_state.catalog_base + CATALOG_ENTRY_ADDRESSES
+            report "Catalog didn't wrap around" severity error;
+        assert vnir_catalog_address = UNDEFINED_ADDRESS
+            report "A VNIR catalog entry was written without a VNIR image" severity error;
+
+        --A 3-row SWIR image with its middle row dropped. The last request left a SWIR row as the one
+        --before the next request, so a VNIR row is requested first to keep it from counting
+        request_row(ROW_RED);
+        number_swir_rows <= 3;
+        wait until rising_edge(clk);
+        number_swir_rows <= 0;
+        wait until (swir_img_config_done = '1');
+        wait for clk_period * 5;
+
+        request_row(ROW_SWIR);
+        swir_row_dropped <= '1';
+        wait until rising_edge(clk);
+        swir_row_dropped <= '0';
+        request_row(ROW_SWIR);
+        assert swir_img_config_done = '1' report "SWIR image finished before its last row" severity error;
+        request_row(ROW_NONE);
+        wait until (swir_img_config_done = '0') for clk_period * 100;
+        assert swir_img_config_done = '0' report "SWIR image with a dropped row never finished" severity error;
+        wait until rising_edge(clk);
+
+        --A 1-row VNIR image with its NIR row dropped
+        number_vnir_rows <= 1;
+        wait until rising_edge(clk);
+        number_vnir_rows <= 0;
+        wait until (img_config_done = '1');
+        wait for clk_period * 5;
+
+        request_row(ROW_RED);
+        request_row(ROW_BLUE);
+        request_row(ROW_NONE);
+        assert img_config_done = '1' report "VNIR image finished without its NIR row" severity error;
+        vnir_row_dropped(vnir_index(ROW_NIR)) <= '1';
+        wait until rising_edge(clk);
+        vnir_row_dropped <= (others => '0');
+        wait until (img_config_done = '0') for clk_period * 100;
+        assert img_config_done = '0' report "VNIR image with a dropped row never finished" severity error;
+        wait until rising_edge(clk);
+
+        --A 2-row SWIR image from start to end while a 2-row VNIR image is being taken. A SWIR row is
+        --requested first, with both sensors idle, so the blue row before it isn't counted
+        request_row(ROW_SWIR);
+        catalog_count := memory_state.catalog_count;
+        number_vnir_rows <= 2;
+        wait until rising_edge(clk);
+        number_vnir_rows <= 0;
+        wait until (vnir_img_config_done = '1');
+        wait for clk_period * 5;
+        request_row(ROW_RED);
+
+        number_swir_rows <= 2;
+        wait until rising_edge(clk);
+        number_swir_rows <= 0;
+        wait until (swir_img_config_done = '1') for clk_period * 100;
+        assert swir_img_config_done = '1' report "SWIR image wasn't allocated while VNIR was imaging" severity failure;
+        wait for clk_period * 5;
+
+        request_row(ROW_SWIR);
+        request_row(ROW_SWIR);
+        request_row(ROW_BLUE);
+        wait until (swir_img_config_done = '0') for clk_period * 100;
+        assert swir_img_config_done = '0' report "SWIR image didn't finish while VNIR was imaging" severity failure;
+        assert vnir_img_config_done = '1' report "VNIR image finished with the SWIR image" severity error;
+        wait until rising_edge(clk);
+        assert swir_catalog_address = catalog_slot(catalog_count) and memory_state.catalog_count = catalog_count + 1
+            report "SWIR image that ended first didn't take the next catalog slot" severity error;
+
+        request_row(ROW_BLUE);
+        request_row(ROW_RED);
+        request_row(ROW_NIR);
+        request_row(ROW_NIR);
+        assert vnir_img_config_done = '1' report "VNIR image finished before its last row" severity error;
+        request_row(ROW_SWIR);
+        wait until (vnir_img_config_done = '0') for clk_period * 100;
+        assert vnir_img_config_done = '0' report "VNIR image never finished after the SWIR image" severity failure;
+        wait until rising_edge(clk);
+        assert vnir_catalog_address = catalog_slot(catalog_count + 1) and memory_state.catalog_count = catalog_count + 2
+            report "VNIR image that ended second didn't take the slot after the SWIR image's" severity error;
+
+        --The reverse: a 1-row VNIR image from start to end while a 2-row SWIR image is being taken. A red
+        --row is requested first, with both sensors idle, so the SWIR row before it isn't counted
+        request_row(ROW_RED);
+        catalog_count := memory_state.catalog_count;
+        number_swir_rows <= 2;
+        wait until rising_edge(clk);
+        number_swir_rows <= 0;
+        wait until (swir_img_config_done = '1');
+        wait for clk_period * 5;
+        request_row(ROW_SWIR);
+
+        number_vnir_rows <= 1;
+        wait until rising_edge(clk);
+        number_vnir_rows <= 0;
+        wait until (vnir_img_config_done = '1') for clk_period * 100;
+        assert vnir_img_config_done = '1' report "VNIR image wasn't allocated while SWIR was imaging" severity failure;
+        wait for clk_period * 5;
+
+        request_row(ROW_RED);
+        request_row(ROW_BLUE);
+        request_row(ROW_NIR);
+        request_row(ROW_SWIR);
+        wait until (vnir_img_config_done = '0') for clk_period * 100;
+        assert vnir_img_config_done = '0' report "VNIR image didn't finish while SWIR was imaging" severity failure;
+        assert swir_img_config_done = '1' report "SWIR image finished with the VNIR image" severity error;
+        wait until rising_edge(clk);
+        assert vnir_catalog_address = catalog_slot(catalog_count) and memory_state.catalog_count = catalog_count + 1
+            report "VNIR image that ended first didn't take the next catalog slot" severity error;
+
+        request_row(ROW_SWIR);
+        wait until (swir_img_config_done = '0') for clk_period * 100;
+        assert swir_img_config_done = '0' report "SWIR image never finished after the VNIR image" severity failure;
+        wait until rising_edge(clk);
+        assert swir_catalog_address = catalog_slot(catalog_count + 1) and memory_state.catalog_count = catalog_count + 2
+            report "SWIR image that ended second didn't take the slot after the VNIR image's" severity error;
+
+        --Back-to-back 1-row VNIR images, the second one's rows given from before the first one's last
+        --row is assigned. The first one's trailer address has to stay put until its img_config_done has
+        --fallen, and the second one has to go right after it
+        number_vnir_rows <= 1;
+        wait until rising_edge(clk);
+        number_vnir_rows <= 0;
+        wait until (vnir_img_config_done = '1');
+        wait for clk_period * 5;
+        header := vnir_header_address;
+        trailer := vnir_trailer_address;
+        image_end := vnir_end_address;
+
+        request_row(ROW_RED);
+        request_row(ROW_BLUE);
+        request_row(ROW_NIR);
+        number_vnir_rows <= 1;
+        next_row_type <= ROW_SWIR;
+        next_row_req <= '1';
+        for i in 1 to 100 loop
+            wait until rising_edge(clk);
+            assert vnir_trailer_address = trailer
+                report "First image's trailer address changed before its img_config_done fell" severity error;
+            exit when vnir_img_config_done = '0';
+        end loop;
+        assert vnir_img_config_done = '0' report "First of the back-to-back images never finished" severity failure;
+        next_row_req <= '0';
+
+        wait until (vnir_img_config_done = '1') for clk_period * 100;
+        assert vnir_img_config_done = '1' report "Second of the back-to-back images wasn't allocated" severity failure;
+        number_vnir_rows <= 0;
+        wait for clk_period * 5;
+        assert vnir_header_address = image_end + 1
+            report "Second image doesn't start right after the first one" severity error;
+        assert vnir_trailer_address - vnir_header_address = trailer - header
+            report "Second image's trailer isn't where the first one's was in it" severity error;
+
+        request_row(ROW_RED);
+        request_row(ROW_BLUE);
+        request_row(ROW_NIR);
+        request_row(ROW_SWIR);
+        wait until (vnir_img_config_done = '0') for clk_period * 100;
+        assert vnir_img_config_done = '0' report "Second of the back-to-back images never finished" severity error;
 
+        report "Memory map test done";
+        stop;
     end process;
 end architecture;
\ No newline at end of file
@@ -0,0 +1,255 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.sdram;
+use work.img_buffer_pkg.all;
+use work.custom_master_pkg.all;
+
+-- Reads an image back through its catalog entry, from a model of the custom read master backed by
+-- a small memory, and checks every 32 bits streamed out.
+--
+-- Word w of the image holds w in each of its 32-bit lanes. The master model hands out one word
+-- every MASTER_CLOCKS_PER_WORD clock cycles once a command is given. The engine is driven through
+-- sdram_controller's registers the way the MCU does it, with reads taking two clock cycles
+-- (readWaitTime 1): the read is started by writing the catalog index to x24, and x26 is polled
+-- until data is valid. The rest of the 32-bit word is then read from x25 with back-to-back reads,
+-- so each read has to move the data on exactly once.
+entity read_back_engine_tb is
+    generic (
+        IMAGE_WORDS             : integer := 40;
+        MASTER_CLOCKS_PER_WORD  : integer := 3
+    );
+end entity;
+
+architecture sim of read_back_engine_tb is
+
+    constant clock_period       : time := 20 ns;
+
+    constant CATALOG_BASE       : integer := 16#400#;
+    constant CATALOG_INDEX      : integer := 3;
+    constant IMAGE_START        : integer := 16#80#;
+    constant IMAGE_END          : integer := IMAGE_START + IMAGE_WORDS * FIFO_WORD_BYTES / 2;
+
+    signal clock                : std_logic := '1';
+    signal reset_n              : std_logic := '0';
+
+    signal avs_address          : std_logic_vector(7 downto 0) := (others => '0');
+    signal avs_read             : std_logic := '0';
+    signal avs_readdata         : std_logic_vector(31 downto 0);
+    signal avs_write            : std_logic := '0';
+    signal avs_writedata        : std_logic_vector(31 downto 0) := (others => '0');
+
+    signal catalog_start        : std_logic;
+    signal catalog_index        : natural;
+    signal data_out             : std_logic_vector(31 downto 0);
+    signal data_valid           : std_logic;
+    signal data_read            : std_logic;
+    signal busy                 : std_logic;
+
+    signal memory_state         : sdram.memory_state_t;
+    signal perf_counters        : sdram.perf_counters_t;
+
+    signal master_cmd_in        : from_read_master_t;
+    signal master_cmd_out       : to_read_master_t;
+    signal read_address         : integer := 0;     -- word address in the master's memory, in 16-bit units
+    signal words_left           : integer := 0;     -- words left to fetch in the master's current command
+    signal fifo_words           : integer := 0;     -- words fetched and not yet taken
+
+    -- Contents of the master's memory at the given address
+    function memory_word(address : integer) return std_logic_vector is
+        variable entry : sdram.catalog_entry_t := (others => '0');
+    begin
+        if (address >= IMAGE_START and address < IMAGE_END) then
+            return std_logic_vector(to_unsigned((address - IMAGE_START) * 2 / FIFO_WORD_BYTES, 32)) &
+                   std_logic_vector(to_unsigned((address - IMAGE_START) * 2 / FIFO_WORD_BYTES, 32)) &
+                   std_logic_vector(to_unsigned((address - IMAGE_START) * 2 / FIFO_WORD_BYTES, 32)) &
+                   std_logic_vector(to_unsigned((address - IMAGE_START) * 2 / FIFO_WORD_BYTES, 32));
+        end if;
+        entry(159 downto 128) := std_logic_vector(to_signed(IMAGE_START, 32));
+        entry(127 downto 96) := std_logic_vector(to_signed(IMAGE_END, 32));
+        if (address = CATALOG_BASE + CATALOG_INDEX * 16) then
+            return entry(255 downto 128);
+        elsif (address = CATALOG_BASE + CATALOG_INDEX * 16 + 8) then
+            return entry(127 downto 0);
+        end if;
+        return (others => 'U');
+    end function memory_word;
+
+begin
+
+    clock <= not clock after clock_period / 2;
+    reset_n <= '1' after clock_period * 4;
+
+    controller : entity work.sdram_controller port map (
+        clock               => clock,
+        reset_n             => reset_n,
+        avs_address         => avs_address,
+        avs_read            => avs_read,
+        avs_readdata        => avs_readdata,
+        avs_write           => avs_write,
+        avs_writedata       => avs_writedata,
+        avs_irq             => open,
+        swir_num_rows       => open,
+        vnir_num_rows       => open,
+        vnir_row_widths     => open,
+        swir_row_pixels     => open,
+        swir_coadd_rows     => open,
+        compress            => open,
+        compress_overflow   => '0',
+        readback_base       => open,
+        readback_end        => open,
+        readback_start      => open,
+        readback_catalog_index => catalog_index,
+        readback_catalog_start => catalog_start,
+        readback_data       => data_out,
+        readback_valid      => data_valid,
+        readback_read       => data_read,
+        readback_busy       => busy,
+        timestamp           => open,
+        mpu_memory_change   => open,
+        config_to_sdram     => open,
+        start_config        => open,
+        config_from_sdram   => memory_state,
+        config_done         => '0',
+        sdram_busy          => '0',
+        sdram_error         => sdram.no_error,
+        perf_clear          => open,
+        perf_counters       => perf_counters
+    );
+
+    read_back : entity work.read_back_engine port map (
+        clock               => clock,
+        reset_n             => reset_n,
+        read_start          => '0',
+        read_base           => sdram.UNDEFINED_ADDRESS,
+        read_end            => sdram.UNDEFINED_ADDRESS,
+        catalog_start       => catalog_start,
+        catalog_index       => catalog_index,
+        catalog_base        => to_signed(CATALOG_BASE, sdram.ADDRESS_LENGTH),
+        data_out            => data_out,
+        data_valid          => data_valid,
+        data_read           => data_read,
+        busy                => busy,
+        master_cmd_in       => master_cmd_in,
+        master_cmd_out      => master_cmd_out
+    );
+
+    -- Custom read master model, with its fifo's first word shown ahead
+    master_process : process
+        variable busy_clocks    : integer := 0;
+        variable fifo           : integer := 0;
+        variable next_address   : integer := 0;     -- address of the next word to fetch
+        variable head_address   : integer := 0;     -- address of the first word in the fifo
+    begin
+        wait until rising_edge(clock);
+
+        fifo := fifo_words;
+        if (master_cmd_out.user_read_buffer = '1') then
+            assert fifo > 0 report "Read from an empty master fifo" severity failure;
+            fifo := fifo - 1;
+            head_address := head_address + FIFO_WORD_BYTES / 2;
+        end if;
+
+        if (master_cmd_out.control_go = '1') then
+            assert words_left = 0 and fifo = 0 report "control_go while the master is busy" severity failure;
+            next_address := to_integer(signed(master_cmd_out.control_read_base));
+            head_address := next_address;
+            words_left <= to_integer(unsigned(master_cmd_out.control_read_length)) / FIFO_WORD_BYTES;
+            busy_clocks := MASTER_CLOCKS_PER_WORD;
+        elsif (words_left > 0) then
+            busy_clocks := busy_clocks - 1;
+            if (busy_clocks = 0) then
+                fifo := fifo + 1;
+                next_address := next_address + FIFO_WORD_BYTES / 2;
+                words_left <= words_left - 1;
+                busy_clocks := MASTER_CLOCKS_PER_WORD;
+            end if;
+        end if;
+
+        fifo_words <= fifo;
+        read_address <= head_address;
+    end process master_process;
+
+    master_cmd_in.control_done <= '1' when words_left = 0 and master_cmd_out.control_go = '0' else '0';
+    master_cmd_in.user_data_available <= '1' when fifo_words > 0 else '0';
+    master_cmd_in.user_buffer_data <= memory_word(read_address);
+
+    -- MCU model
+    mcu_process : process
+        constant TIMEOUT    : time := clock_period * (IMAGE_WORDS + 4) * (MASTER_CLOCKS_PER_WORD + 4) * 4 + clock_period * 100;
+        variable status     : std_logic_vector(31 downto 0);
+        variable data       : std_logic_vector(31 downto 0);
+        variable lanes      : integer := 0;
+
+        procedure write_reg(address : std_logic_vector(7 downto 0); value : integer) is
+        begin
+            avs_address <= address;
+            avs_writedata <= std_logic_vector(to_signed(value, 32));
+            avs_write <= '1';
+            wait until rising_edge(clock);
+            avs_write <= '0';
+        end procedure write_reg;
+
+        -- A read takes two clock cycles, and avs_read is left high so the next one follows straight on
+        procedure read_reg(address : std_logic_vector(7 downto 0); value : out std_logic_vector(31 downto 0)) is
+        begin
+            avs_address <= address;
+            avs_read <= '1';
+            wait until rising_edge(clock);
+            wait until rising_edge(clock);
+            value := avs_readdata;
+        end procedure read_reg;
+    begin
+        wait until reset_n = '1';
+        wait until rising_edge(clock);
+        write_reg(x"24", CATALOG_INDEX);
+
+        while lanes < IMAGE_WORDS * 4 and now < TIMEOUT loop
+            read_reg(x"26", status);
+            if (status(1) = '1') then
+                -- Every word starts with 4 lanes valid
+                for i in lanes mod 4 to 3 loop
+                    read_reg(x"25", data);
+                    assert to_integer(unsigned(data)) = lanes / 4
+                        report "Unexpected data " & integer'image(to_integer(unsigned(data))) &
+                               " in lane " & integer'image(lanes) severity error;
+                    lanes := lanes + 1;
+                end loop;
+            end if;
+            avs_read <= '0';
+            wait until rising_edge(clock);
+        end loop;
+
+        assert lanes = IMAGE_WORDS * 4
+            report "Expected " & integer'image(IMAGE_WORDS * 4) & " lanes, got " & integer'image(lanes)
+            severity error;
+        wait for clock_period * 4;
+        read_reg(x"26", status);
+        avs_read <= '0';
+        assert status(0) = '0' report "Read-back engine still busy" severity error;
+        assert status(1) = '0' report "Read-back engine has data left" severity error;
+        stop;
+    end process mcu_process;
+
+end architecture;
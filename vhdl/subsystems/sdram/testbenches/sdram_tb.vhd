@@ -4,6 +4,8 @@ use ieee.numeric_std.all;
 
 use work.vnir;
 use work.sdram;
+use work.sdram."=";
+use work.sdram."/=";
 
 use work.img_buffer_pkg.all;
 use work.custom_master_pkg.all;
@@ -48,8 +50,12 @@ architecture sim of sdram_tb is
    signal reset_n              : std_logic := '0';
 
    -- Data inputs
-   signal vnir_row             : vnir.row_t := (others => "1111111111");
-   signal vnir_row_rdy         : vnir.row_type_t := vnir.ROW_NONE;
+   signal vnir_row             : vnir.row_t := (others => (others => '1'));
+   signal vnir_fragment        : vnir.row_fragment_t;
+   signal vnir_fragment_avail  : vnir.row_type_t := vnir.ROW_NONE;
+   signal vnir_fragment_first  : std_logic := '0';
+   signal vnir_fragment_last   : std_logic := '0';
+   signal vnir_fragment_ready  : std_logic;
    signal swir_pixel           : swir_pixel_t := "1010101010101010";
    signal swir_pxl_rdy         : std_logic := '0';
 
@@ -67,14 +73,21 @@ architecture sim of sdram_tb is
    signal master_cmd_in        : from_master_t;
    signal master_cmd_out       : to_master_t;
 
+   -- Types of the rows sent by the imaging buffer, in the order they are sent
+   type row_types_a is array (0 to 1023) of sdram.row_type_t;
+   signal rows_sent            : row_types_a;
+
 
 begin
     
     imaging_buffer_component : entity work.imaging_buffer port map(
         clock               => clock,                   -- external input
         reset_n             => reset_n,                 -- external input
-        vnir_row            => vnir_row,                -- external input
-        vnir_row_ready      => vnir_row_rdy,            -- external input
+        vnir_fragment       => vnir_fragment,                -- external input
+        vnir_fragment_available => vnir_fragment_avail,     -- external input
+        vnir_fragment_first => vnir_fragment_first,     -- external input
+        vnir_fragment_last  => vnir_fragment_last,      -- external input
+        vnir_fragment_ready => vnir_fragment_ready,     -- external output
         swir_pixel          => swir_pixel,              -- external input
         swir_pixel_ready    => swir_pxl_rdy,            -- external input
         row_request         => row_req,                 -- imaging_buffer <==  command_creator
@@ -133,26 +146,46 @@ begin
     -- the burst will consist of only 1 or 2 rows. They should still be separated by 128 clock cycles.
 
     vnir_process: process
+        -- Sends vnir_row as a stream of fragments of consecutive pixels, like the VNIR subsystem does
+        procedure send_row(row_type : vnir.row_type_t) is
+        begin
+            for g in 0 to vnir.ROW_WIDTH/vnir.FRAGMENT_WIDTH-1 loop
+                for k in 0 to vnir.FRAGMENT_WIDTH-1 loop
+                    vnir_fragment(k) <= vnir_row(vnir.FRAGMENT_WIDTH*g + k);
+                end loop;
+                vnir_fragment_avail <= row_type;
+                if g = 0 then
+                    vnir_fragment_first <= '1';
+                else
+                    vnir_fragment_first <= '0';
+                end if;
+                if g = vnir.ROW_WIDTH/vnir.FRAGMENT_WIDTH-1 then
+                    vnir_fragment_last <= '1';
+                else
+                    vnir_fragment_last <= '0';
+                end if;
+                -- Hold the fragment until the imaging buffer takes it
+                loop
+                    wait until rising_edge(clock);
+                    exit when vnir_fragment_ready = '1';
+                end loop;
+            end loop;
+            vnir_fragment_avail <= vnir.ROW_NONE;
+            vnir_fragment_first <= '0';
+            vnir_fragment_last <= '0';
+        end procedure send_row;
     begin
         for i in 0 to 2047 loop
-            vnir_row(i) <= to_unsigned(i, 10);
+            vnir_row(i) <= to_unsigned(i mod 2**vnir.ROW_PIXEL_BITS, vnir.ROW_PIXEL_BITS);
         end loop;
         wait for reset_period; 
 
         for i in 1 to 100 loop
-            vnir_row_rdy <= vnir.ROW_RED;
-            wait until rising_edge(clock);
-            vnir_row_rdy <= vnir.ROW_NONE;
-            wait for vnir_row_clocks;
-
-            vnir_row_rdy <= vnir.ROW_BLUE;
-            wait until rising_edge(clock);
-            vnir_row_rdy <= vnir.ROW_NONE;
-            wait for vnir_row_clocks;
-
-            vnir_row_rdy <= vnir.ROW_NIR;
-            wait until rising_edge(clock);
-            vnir_row_rdy <= vnir.ROW_NONE;
+            send_row(vnir.ROW_RED);
+
+            send_row(vnir.ROW_BLUE);
+
+            send_row(vnir.ROW_NIR);
             wait for (vnir_frame_clocks-3*vnir_row_clocks);
         end loop;
         wait;
@@ -185,4 +218,56 @@ begin
 
     address <= (others => '0');
 
+    -- Numbering the rows as they come out of the imaging buffer
+    rows_sent_process: process is
+        variable words          : natural := 0;
+        variable rows           : natural := 0;
+    begin
+        wait until rising_edge(clock);
+        if (transmitting_o = '1') then
+            if (words = 0) then
+                rows_sent(rows) <= row_type;
+            end if;
+            words := words + 1;
+            if (row_type = sdram.ROW_SWIR and words = SWIR_FIFO_DEPTH + ROW_TRAILER_WORDS) or
+               (row_type /= sdram.ROW_SWIR and words = VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS) then
+                words := 0;
+                rows := rows + 1;
+            end if;
+        end if;
+    end process rows_sent_process;
+
+    -- Each row goes to the master with its trailer as its last word, naming the row's band and
+    -- counting the band's rows in row_index
+    trailer_check_process: process is
+        variable words          : natural := 0;
+        variable rows           : natural := 0;
+        variable row_words      : natural;
+        variable rows_seen      : sdram.row_counter_a := (others => (others => '0'));
+        variable metadata       : sdram.row_metadata_t;
+    begin
+        wait until rising_edge(clock);
+        if (master_cmd_out.user_write_buffer = '1') then
+            if (rows_sent(rows) = sdram.ROW_SWIR) then
+                row_words := SWIR_FIFO_DEPTH + ROW_TRAILER_WORDS;
+            else
+                row_words := VNIR_FIFO_DEPTH + ROW_TRAILER_WORDS;
+            end if;
+            words := words + 1;
+
+            if (words = row_words) then
+                metadata := sdram.row_metadata(master_cmd_out.user_buffer_data);
+                assert metadata.band = rows_sent(rows)
+                    report "Row " & integer'image(rows) & " was written with the trailer of a " & sdram.row_type_t'image(metadata.band)
+                    severity error;
+                assert metadata.row_index = rows_seen(rows_sent(rows))
+                    report "Row " & integer'image(rows) & " was written with row_index " & integer'image(to_integer(metadata.row_index))
+                    severity error;
+                rows_seen(rows_sent(rows)) := rows_seen(rows_sent(rows)) + 1;
+                words := 0;
+                rows := rows + 1;
+            end if;
+        end if;
+    end process trailer_check_process;
+
 end architecture sim;
\ No newline at end of file
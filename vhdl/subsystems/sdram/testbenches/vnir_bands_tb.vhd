@@ -0,0 +1,263 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.spi_types.all;
+use work.vnir;
+use work.swir_types.all;
+use work.sdram.all;
+use work.fpga.all;
+use work.img_buffer_pkg.all;
+
+-- Takes a VNIR image with a different row width for each band through the memory map and the
+-- header creator, checking that each band's rows go right after the band before it's, that the
+-- image is done once every band's rows have been assigned, and that the trailer has the rows and
+-- the row width of every band. Written for any vnir.N_WINDOWS, but meant to be run with
+-- vnir.N_WINDOWS = vnir.MAX_WINDOWS, which sim_sdram_vnir_bands.tcl compiles it with.
+entity vnir_bands_tb is
+end entity;
+
+architecture sim of vnir_bands_tb is
+    constant clk_freq : integer := 20000000;
+    constant clk_period : time := 1000 ms / clk_freq;
+
+    constant ROWS : integer := 3;
+
+    --Addresses of the image's header and trailer, 16 b/address
+    constant HEADER_ADDRESSES : integer := 16;
+    constant TRAILER_ADDRESSES : integer := TRAILER_LENGTH / 16;
+
+    --A different row width for each band
+    pure function band_widths return vnir_row_widths_t is
+        variable widths : vnir_row_widths_t;
+    begin
+        for b in widths'range loop
+            widths(b) := vnir.ROW_WIDTH / (b + 1);
+        end loop;
+        return widths;
+    end function band_widths;
+    constant VNIR_ROW_WIDTHS : vnir_row_widths_t := band_widths;
+
+    --The bands in the order they're stored in: blue, red, NIR, then the extra bands
+    type band_order_a is array (0 to vnir.N_WINDOWS-1) of row_type_t;
+    pure function stored_order return band_order_a is
+        variable order : band_order_a;
+    begin
+        order(0 to 2) := (ROW_BLUE, ROW_RED, ROW_NIR);
+        for i in 3 to vnir.N_WINDOWS-1 loop
+            order(i) := vnir_type(i);
+        end loop;
+        return order;
+    end function stored_order;
+    constant BAND_ORDER : band_order_a := stored_order;
+
+    --Addresses per row of a band
+    pure function row_addresses(row_type : row_type_t) return integer is
+    begin
+        return vnir_row_bytes(VNIR_ROW_WIDTHS(vnir_index(row_type))) / 2;
+    end function row_addresses;
+
+    signal clk : std_logic := '0';
+    signal reset_n : std_logic := '0';
+
+    --SDRAM config signals to and from the FPGA
+    signal config              : config_to_sdram_t := (
+        memory_base => to_signed(16#200#, ADDRESS_LENGTH),
+        memory_bounds => to_signed(16#2000000#, ADDRESS_LENGTH)
+    );
+    signal memory_state        : memory_state_t;
+    signal start_config        : std_logic := '0';
+    signal config_done         : std_logic;
+    signal img_config_done     : std_logic;
+    signal vnir_img_config_done : std_logic;
+    signal swir_img_config_done : std_logic;
+
+    --Image config signals
+    signal number_vnir_rows    : natural := 0;
+
+    --Output image row address config
+    signal next_row_type       : row_type_t := ROW_NONE;
+    signal next_row_req        : std_logic := '0';
+    signal output_address      : address_t;
+    signal vnir_header_address : address_t;
+    signal swir_header_address : address_t;
+    signal vnir_trailer_address : address_t;
+    signal swir_trailer_address : address_t;
+    signal vnir_end_address    : address_t;
+    signal swir_end_address    : address_t;
+    signal vnir_catalog_address : address_t;
+    signal swir_catalog_address : address_t;
+    signal sdram_error         : error_t;
+
+    --Header creator signals
+    signal timestamp           : timestamp_t := to_unsigned(0, timestamp_t'length);
+    signal vnir_rows_written   : row_count_a := (others => 0);
+    signal swir_img_header     : header_t;
+    signal vnir_img_header     : header_t;
+    signal swir_img_trailer    : trailer_t;
+    signal vnir_img_trailer    : trailer_t;
+    signal swir_catalog_entry  : catalog_entry_t;
+    signal vnir_catalog_entry  : catalog_entry_t;
+begin
+    memory_map_comp : entity work.memory_map port map (
+        clock => clk,
+        reset_n => reset_n,
+        config => config,
+        memory_state => memory_state,
+        start_config => start_config,
+        config_done => config_done,
+        img_config_done => img_config_done,
+        vnir_img_config_done => vnir_img_config_done,
+        swir_img_config_done => swir_img_config_done,
+        number_vnir_rows => number_vnir_rows,
+        number_swir_rows => 0,
+        vnir_row_widths => VNIR_ROW_WIDTHS,
+        next_row_type => next_row_type,
+        next_row_req => next_row_req,
+        output_address => output_address,
+        vnir_header_address => vnir_header_address,
+        swir_header_address => swir_header_address,
+        vnir_trailer_address => vnir_trailer_address,
+        swir_trailer_address => swir_trailer_address,
+        vnir_end_address => vnir_end_address,
+        swir_end_address => swir_end_address,
+        vnir_catalog_address => vnir_catalog_address,
+        swir_catalog_address => swir_catalog_address,
+        sdram_error => sdram_error
+    );
+
+    header_creator_comp : entity work.header_creator(rtl) port map (
+        clock => clk,
+        reset_n => reset_n,
+        timestamp => timestamp,
+        vnir_rows => number_vnir_rows,
+        swir_rows => 0,
+        vnir_row_widths => VNIR_ROW_WIDTHS,
+        vnir_img_config_done => vnir_img_config_done,
+        swir_img_config_done => '0',
+        compress => '0',
+        compressing => '0',
+        vnir_rows_written => vnir_rows_written,
+        swir_rows_written => 0,
+        vnir_compress_overflow => '0',
+        swir_compress_overflow => '0',
+        vnir_row_dropped => (others => '0'),
+        swir_row_dropped => '0',
+        vnir_start_address => vnir_header_address,
+        vnir_end_address => vnir_end_address,
+        swir_start_address => UNDEFINED_ADDRESS,
+        swir_end_address => UNDEFINED_ADDRESS,
+        swir_img_header => swir_img_header,
+        vnir_img_header => vnir_img_header,
+        swir_img_trailer => swir_img_trailer,
+        vnir_img_trailer => vnir_img_trailer,
+        swir_catalog_entry => swir_catalog_entry,
+        vnir_catalog_entry => vnir_catalog_entry
+    );
+
+    clk <= not(clk) after clk_period / 2;
+
+    process is
+        variable band_start : integer;
+        variable image_addresses : integer;
+        variable field : integer;
+
+        --Requests a row of the given type; each request moves the counter of the row before it on
+        procedure request_row(row_type : row_type_t) is
+        begin
+            next_row_type <= row_type;
+            next_row_req <= '1';
+            wait for clk_period * 3;
+            next_row_req <= '0';
+            wait for clk_period * 5;
+        end procedure request_row;
+    begin
+        assert vnir.N_WINDOWS = vnir.MAX_WINDOWS
+            report "Only " & integer'image(vnir.N_WINDOWS) & " VNIR bands, run through sim_sdram_vnir_bands.tcl for all of them"
+            severity warning;
+
+        wait for 2 * clk_period;
+        reset_n <= '1';
+        wait until rising_edge(clk);
+        start_config <= '1';
+        wait until (config_done = '1');
+        wait until rising_edge(clk);
+
+        --The row count is only given for a clock cycle
+        number_vnir_rows <= ROWS;
+        wait until rising_edge(clk);
+        number_vnir_rows <= 0;
+        wait until (vnir_img_config_done = '1');
+        wait for clk_period * 5;
+
+        --A row of each band in turn, each band's rows starting right after the band before it's
+        for row in 0 to ROWS-1 loop
+            band_start := to_integer(vnir_header_address) + HEADER_ADDRESSES;
+            for i in 0 to vnir.N_WINDOWS-1 loop
+                request_row(BAND_ORDER(i));
+                assert output_address = band_start + row * row_addresses(BAND_ORDER(i))
+                    report "Row " & integer'image(row) & " of band " & integer'image(vnir_index(BAND_ORDER(i))) &
+                           " is at the wrong address" severity error;
+                vnir_rows_written(vnir_index(BAND_ORDER(i))) <= row + 1;
+                band_start := band_start + ROWS * row_addresses(BAND_ORDER(i));
+            end loop;
+        end loop;
+
+        --The image is its header, every band's rows and its trailer
+        image_addresses := HEADER_ADDRESSES + TRAILER_ADDRESSES;
+        for i in 0 to vnir.N_WINDOWS-1 loop
+            image_addresses := image_addresses + ROWS * row_addresses(BAND_ORDER(i));
+        end loop;
+        assert vnir_end_address - vnir_header_address = image_addresses
+            report "The image isn't " & integer'image(image_addresses) & " addresses long" severity error;
+        assert vnir_trailer_address = vnir_end_address - TRAILER_ADDRESSES
+            report "Wrong trailer address" severity error;
+
+        --Moving the last row's counter on finishes the image
+        request_row(ROW_NONE);
+        wait until (vnir_img_config_done = '0') for clk_period * 100;
+        assert vnir_img_config_done = '0' report "The image never finished" severity failure;
+        wait until rising_edge(clk);
+        wait until rising_edge(clk);
+
+        --First trailer word: blue, red and NIR rows
+        assert unsigned(vnir_img_trailer(TRAILER_LENGTH-1 downto TRAILER_LENGTH-16)) = ROWS report "Wrong blue rows in the trailer" severity error;
+        assert unsigned(vnir_img_trailer(TRAILER_LENGTH-17 downto TRAILER_LENGTH-32)) = ROWS report "Wrong red rows in the trailer" severity error;
+        assert unsigned(vnir_img_trailer(TRAILER_LENGTH-33 downto TRAILER_LENGTH-48)) = ROWS report "Wrong NIR rows in the trailer" severity error;
+
+        --Then every band's row width, then the rows of the bands past the first three
+        for b in 0 to vnir.N_WINDOWS-1 loop
+            field := TRAILER_LENGTH-129-16*b;
+            assert unsigned(vnir_img_trailer(field downto field-15)) = VNIR_ROW_WIDTHS(b)
+                report "Wrong row width of band " & integer'image(b) & " in the trailer" severity error;
+        end loop;
+        for b in 3 to vnir.N_WINDOWS-1 loop
+            field := TRAILER_LENGTH-129-16*(vnir.N_WINDOWS+b-3);
+            assert unsigned(vnir_img_trailer(field downto field-15)) = ROWS
+                report "Wrong rows of band " & integer'image(b) & " in the trailer" severity error;
+        end loop;
+
+        report "VNIR bands test done";
+        stop;
+    end process;
+end architecture;
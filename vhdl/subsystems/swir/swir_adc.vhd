@@ -14,26 +14,32 @@
 -- limitations under the License.
 ----------------------------------------------------------------
 
+
 -- Circuit to control ADAQ7980 ADC, in 4-wire CS mode with busy indicator, with VIO above 1.7V
 -- ADC begins conversion after adc_start pulse
--- When conversion has finished, output_done is pulsed
--- As data is being outputted, it is written to FIFO buffer
+-- As data is being outputted, it is shifted into a 16 bit sample in the ADC clock domain, and each
+--	complete sample is written to a FIFO buffer along with a sequence tag, so only whole samples
+--	cross into the main clock domain
 
 -- Signals:
 --		clock_adc: 		43.75 MHz ADC clock
 --		clock_main:		Main 50 MHz clock, needed to feed into FIFO IP
 --		reset_n: 		input reset from SWIR subsystem top-level, stretched to accomadate slower SWIR and ADC clocks
---		
---		output_done: 	Pulse indicating that one pixel has been received and top level should read it out of FIFO
 --
 --		adc_trigger:	Signal sent from SWIR code to mirror AD_trig of SWIR sensor; unused
 --		adc_start: 		Pulse sent from SWIR code to tell it to begin capturing analog data
+--							If it comes in while a sample is still being read out, the next conversion
+--							starts as soon as the readout is done
 --
 --		sdi, cnv, sdo:	Signals sent to and from ADC (refer to ADC datasheet)
 --
 --		fifo_rdreq:		FIFO read request (Refer to FIFO Intel FPGA IP User Guide for Quartus 17.0 for timing information)
 --		fifo_rdempty:	FIFO read empty
---		FIFO_data_read:	FIFO read data
+--		fifo_data_read:	FIFO read data, one sample per word (MSB first from the ADC, so bit 15 is the MSB)
+--		fifo_sequence:	Sequence tag of fifo_data_read; counts samples modulo 16, including any
+--							dropped because the FIFO was full, so a gap shows where samples were lost
+--		fifo_clear:		Empties the FIFO, for when the samples in it are no longer wanted. Those samples show up
+--							as a gap in the sequence tags like dropped ones
 
 library ieee;
 use ieee.std_logic_1164.all;
@@ -45,8 +51,6 @@ entity swir_adc is
 		clock_main			: in std_logic;
         reset_n         	: in std_logic;
 		
-        output_done		   	: out std_logic;
-		
 		-- Signals from sensor circuit
 		adc_trigger			: in std_logic;
 		adc_start			: in std_logic;
@@ -59,60 +63,63 @@ entity swir_adc is
 		-- FIFO signals for higher level file to read from
 		fifo_rdreq			: in std_logic;
 		fifo_rdempty		: out std_logic;
-		fifo_data_read		: out std_logic_vector(15 downto 0)
+		fifo_data_read		: out std_logic_vector(15 downto 0);
+		fifo_sequence		: out unsigned(3 downto 0);
+		fifo_clear			: in std_logic := '0'
     );
 end entity swir_adc;
 
 architecture main of swir_adc is
 
-	--component dcfifo_mixed_widths
-	component fifo
-	--generic (
-	--	intended_device_family		: string;
-	--	lpm_numwords				: natural;
-	--	lpm_showahead				: string;
-	--	lpm_type					: string;
-	--	lpm_width					: natural;
-	--	lpm_widthu					: natural;
-	--	lpm_widthu_r				: natural;
-	--	lpm_width_r					: natural;
-	--	overflow_checking			: string;
-	--	rdsync_delaypipe			: natural;
-	--	underflow_checking			: string;
-	--	use_eab						: string;
-	--	wrsync_delaypipe			: natural
-	--);
+	component lvds_decoder_fifo is
+	generic (
+		BREADTH						: integer;
+		DEPTH						: integer := 8;
+		SHOW_AHEAD					: boolean := false
+	);
 	port (
-		data						: in std_logic_vector (0 downto 0);
+		aclr						: in std_logic;
+		data						: in std_logic_vector(BREADTH-1 downto 0);
 		rdclk						: in std_logic;
 		rdreq						: in std_logic;
 		wrclk						: in std_logic;
 		wrreq						: in std_logic;
-		q							: out std_logic_vector (15 downto 0);
+		q							: out std_logic_vector(BREADTH-1 downto 0);
 		rdempty						: out std_logic;
 		wrfull						: out std_logic 
 	);
-	end component;
+	end component lvds_decoder_fifo;
+
+	constant sample_bits			: integer := fifo_data_read'length;
+	constant sequence_bits			: integer := fifo_sequence'length;
 
 	-- State Machine signals
 	type adc_control_state is (idle, conversion, acquisition);
 	signal state_reg, state_next:	adc_control_state;
 	
 	-- FIFO Signals
-	signal fifo_data_write	: std_logic_vector(0 downto 0);
+	signal fifo_data_write	: std_logic_vector(sequence_bits+sample_bits-1 downto 0);
+	signal fifo_data_out	: std_logic_vector(sequence_bits+sample_bits-1 downto 0);
 	signal fifo_wrreq		: std_logic;
 	signal fifo_wrfull		: std_logic;
+	signal fifo_aclr		: std_logic;
+	
+	-- Deserializer signals
+	signal sdo_sampled				: std_logic;  -- sdo, registered on falling edge of sck
+	signal sample					: std_logic_vector(sample_bits-1 downto 0);
+	signal bit_counter				: integer range 0 to sample_bits-1;
+	signal sample_done				: std_logic;
+	signal sequence					: unsigned(sequence_bits-1 downto 0);
 	
-	signal one_clock_cycle_passed	: std_logic;
-	signal one_pixel_cycle_passed	: std_logic;
+	signal last_bit					: std_logic;
 	signal readout					: std_logic;
 	signal readout_shifted			: std_logic;
 	signal readout_no_interrupt		: std_logic;
-	signal timer					: natural;
 	
 	signal reset_n_local			: std_logic;
 	signal reset_n_metastable		: std_logic;
 	signal adc_start_local			: std_logic;
+	signal adc_start_pending		: std_logic;
 	signal adc_start1				: std_logic;
 	signal adc_start2				: std_logic;
 	signal adc_start3				: std_logic;
@@ -120,37 +127,22 @@ architecture main of swir_adc is
 begin
 
 	-- FIFO Information: 
-	-- 		1 bit wide input, 16 bit wide output
-	-- 		128 words deep
+	-- 		20 bit wide (16 bit sample and 4 bit sequence tag)
+	-- 		16 words deep; samples are read out as soon as they come in, so it never holds more than a few
 	-- 		Dual Clock
-	--		2 clock sync stages, good metastability protection, medium size, good fmax
-	--		empty (for read) and full (for write) signals
-	--		Normal synchronous FIFO mode
-	--		Automatic memory block type
-	--		Resource Usage: 4 LUT's, 1 M10K memory block, 46 reg's
-	adc_data_buffer : fifo
-	--generic map (
-	--	intended_device_family 		=> "cyclone v",
-	--	lpm_numwords 				=> 128,
-	--	lpm_showahead 				=> "off",
-	--	lpm_type 					=> "dcfifo_mixed_widths",
-	--	lpm_width 					=> 1,
-	--	lpm_widthu 					=> 7,
-	--	lpm_widthu_r 				=> 3,
-	--	lpm_width_r 				=> 16,
-	--	overflow_checking 			=> "on",
-	--	rdsync_delaypipe 			=> 4,
-	--	underflow_checking 			=> "on",
-	--	use_eab 					=> "on",
-	--	wrsync_delaypipe 			=> 4
-	--)
+	adc_data_buffer : lvds_decoder_fifo
+	generic map (
+		BREADTH 					=> sequence_bits + sample_bits,
+		DEPTH 						=> 16
+	)
 	port map (
+		aclr 						=> fifo_aclr,
 		data 						=> fifo_data_write,
 		rdclk 						=> clock_main,
 		rdreq 						=> fifo_rdreq,
 		wrclk 						=> clock_adc,
 		wrreq 						=> fifo_wrreq,
-		q 							=> fifo_data_read,
+		q 							=> fifo_data_out,
 		rdempty 					=> fifo_rdempty,
 		wrfull						=> fifo_wrfull
 	);
@@ -188,8 +180,23 @@ begin
 		end if;
 	end process; 
 	
+	-- Remember an adc_start pulse which comes in before the previous sample is read out,
+	--  so that it starts the next conversion instead of being missed
+	process(clock_adc, reset_n_local)
+	begin
+		if reset_n_local = '0' then
+			adc_start_pending <= '0';
+		elsif rising_edge(clock_adc) then
+			if state_reg = idle then
+				adc_start_pending <= '0';
+			elsif adc_start_local = '1' then
+				adc_start_pending <= '1';
+			end if;
+		end if;
+	end process;
+	
 	-- State machine next state logic
-	process(state_reg, sdo, adc_start_local, one_pixel_cycle_passed) 
+	process(state_reg, sdo, adc_start_local, adc_start_pending, last_bit) 
 	begin 
 		state_next <= state_reg; -- default state_next
 		-- default outputs
@@ -201,7 +208,7 @@ begin
 			when idle =>  -- Default state
 				sdi <= '1';
 				readout <= '0';
-				if adc_start_local = '1' then -- Trigger to indicate beginning of data transmission
+				if adc_start_local = '1' or adc_start_pending = '1' then -- Trigger to indicate beginning of data transmission
 					cnv <= '1';  -- Start a conversion with rising edge on cnv while sdi is high
 					state_next <= conversion; 
 					
@@ -223,10 +230,10 @@ begin
 					
 				end if;
 				
-			when acquisition =>  -- Main acquisition state for data being outputted; Held for 17 clock cycles (one pixel length + inital interrupt cycle)
+			when acquisition =>  -- Main acquisition state for data being outputted; Held until the last bit of the sample is shifted in (one pixel length + inital interrupt cycle)
 				sdi <= '0';
 				readout <= '1';
-				if one_pixel_cycle_passed = '1' then
+				if last_bit = '1' then
 					cnv <= '0';
 					state_next <= idle;
 					
@@ -238,30 +245,16 @@ begin
 		end case;
 	end process;
 	
-	-- Timer process; counts number of clock cycles each state is held in
-	process(clock_adc, reset_n_local)
-	begin
-		if reset_n_local = '0' then
-            timer <= 0;
-        elsif rising_edge(clock_adc) then
-            if state_reg /= state_next then  -- state is changing
-                timer <= 0;
-            else
-                timer <= timer + 1; 
-            end if; 
-        end if; 
-	end process;
-	
-	-- Process to write data from ADC to buffer; Data is read on falling edge of sck
+	-- Data is read on falling edge of sck
 	process(clock_adc, reset_n_local)
 	begin
 		if reset_n_local = '0' then
-            fifo_data_write <= (others => '0');
+            sdo_sampled <= '0';
         elsif falling_edge(clock_adc) then
             if readout = '1' then
-                fifo_data_write <= (others => sdo);
+                sdo_sampled <= sdo;
             else
-                fifo_data_write <= (others => '0'); 
+                sdo_sampled <= '0'; 
             end if; 
         end if; 
 	end process;
@@ -282,14 +275,51 @@ begin
 	
 	readout_no_interrupt <= '1' when readout_shifted = '1' and readout = '1' else '0';
 	
-	-- To control how long certain states are held for
-	one_pixel_cycle_passed <= '1' when timer = 16 else '0';
+	-- Shift the sample in, MSB first, and flag it as done once all of its bits are in
+	process(clock_adc, reset_n_local)
+	begin
+		if reset_n_local = '0' then
+			sample <= (others => '0');
+			bit_counter <= 0;
+			sample_done <= '0';
+		elsif rising_edge(clock_adc) then
+			sample_done <= '0';
+			if readout_no_interrupt = '1' then
+				sample <= sample(sample_bits-2 downto 0) & sdo_sampled;
+				if last_bit = '1' then
+					bit_counter <= 0;
+					sample_done <= '1';
+				else
+					bit_counter <= bit_counter + 1;
+				end if;
+			elsif readout = '0' then
+				bit_counter <= 0;
+			end if;
+		end if;
+	end process;
+	
+	-- Tag each sample as it's written to the FIFO. The tag advances even if the FIFO is full and the
+	--  sample is dropped, so that the reader can tell
+	process(clock_adc, reset_n_local)
+	begin
+		if reset_n_local = '0' then
+			sequence <= (others => '0');
+		elsif rising_edge(clock_adc) then
+			if sample_done = '1' then
+				sequence <= sequence + 1;
+			end if;
+		end if;
+	end process;
 	
-	-- Indicate that ADC has outputted all data
-	output_done <= '1' when one_pixel_cycle_passed = '1' and readout = '1' else '0';
+	-- Indicate that the last bit of the sample is being shifted in
+	last_bit <= '1' when readout_no_interrupt = '1' and bit_counter = sample_bits-1 else '0';
 	
 	-- FIFO write request signal; Ensure that FIFO is not full first
-	fifo_wrreq <= '1' when readout_no_interrupt = '1' and fifo_wrfull = '0' else '0';  
+	fifo_wrreq <= '1' when sample_done = '1' and fifo_wrfull = '0' else '0';
+	fifo_data_write <= std_logic_vector(sequence) & sample;
+	fifo_aclr <= not reset_n or fifo_clear;
 	
+	fifo_data_read <= fifo_data_out(sample_bits-1 downto 0);
+	fifo_sequence <= unsigned(fifo_data_out(sequence_bits+sample_bits-1 downto sample_bits));
 
-end architecture main;
\ No newline at end of file
+end architecture main;
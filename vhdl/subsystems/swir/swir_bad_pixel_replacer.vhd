@@ -0,0 +1,158 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+-- Replaces the pixels of defective SWIR columns with the mean of their neighbours, on their way from the
+-- SWIR subsystem to the SDRAM subsystem
+-- Pixels are assumed to come in in column order, swir_row_width to a row, starting with column 0 after reset
+-- Each pixel is held until the next one comes in, so its right neighbour is known. The last pixel of a row is
+-- sent out straight away. A bad pixel is replaced with the mean of whichever of its neighbours exist and aren't
+-- bad themselves, or left as is if neither is
+
+-- Signals:
+--		clock: 				50 MHz FPGA clock
+--		reset_n: 			input asynchronous reset. Clears the bitmap (no bad columns)
+--
+--		map_column:			Column to mark as good or bad
+--		map_bad:			'1' if map_column is bad
+--		map_write:			[Pulse] Writes map_bad to the bitmap
+--
+--		pixel_in:			Pixel from the SWIR subsystem
+--		pixel_in_available:	[Pulse] Indicates pixel_in is valid
+--		pixel_out:			Pixel to the SDRAM subsystem
+--		pixel_out_available:[Pulse] Indicates pixel_out is valid
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.swir_types.all;
+
+
+entity swir_bad_pixel_replacer is
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        map_column          : in integer range 0 to swir_row_width-1;
+        map_bad             : in std_logic;
+        map_write           : in std_logic;
+
+        pixel_in            : in swir_pixel_t;
+        pixel_in_available  : in std_logic;
+        pixel_out           : out swir_pixel_t;
+        pixel_out_available : out std_logic
+    );
+end entity swir_bad_pixel_replacer;
+
+
+architecture rtl of swir_bad_pixel_replacer is
+
+    subtype value_t is unsigned(swir_pixel_bits-1 downto 0);
+
+    pure function to_value(pixel : swir_pixel_t) return value_t is
+        variable value : value_t;
+    begin
+        for i in pixel'range loop
+            value(i) := pixel(i);
+        end loop;
+        return value;
+    end function to_value;
+
+    pure function to_pixel(value : value_t) return swir_pixel_t is
+        variable pixel : swir_pixel_t;
+    begin
+        for i in pixel'range loop
+            pixel(i) := value(i);
+        end loop;
+        return pixel;
+    end function to_pixel;
+
+    signal bad_columns      : std_logic_vector(0 to swir_row_width-1);
+
+    -- Column of the next pixel to come in
+    signal column           : integer range 0 to swir_row_width-1;
+
+    -- Pixel waiting on its right neighbour (cur), and the one before it (prev)
+    signal cur_pixel        : value_t;
+    signal cur_column       : integer range 0 to swir_row_width-1;
+    signal cur_valid        : std_logic;
+    signal prev_pixel       : value_t;
+
+begin
+
+    map_process : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            bad_columns <= (others => '0');
+        elsif rising_edge(clock) then
+            if map_write = '1' then
+                bad_columns(map_column) <= map_bad;
+            end if;
+        end if;
+    end process map_process;
+
+    process (clock, reset_n)
+        variable left_good  : boolean;
+        variable right_good : boolean;
+        variable sum        : unsigned(swir_pixel_bits downto 0);
+        variable value      : value_t;
+    begin
+        if reset_n = '0' then
+            column <= 0;
+            cur_valid <= '0';
+            pixel_out_available <= '0';
+        elsif rising_edge(clock) then
+            pixel_out_available <= '0';
+
+            if cur_valid = '1' and (pixel_in_available = '1' or cur_column = swir_row_width-1) then
+                -- The next pixel of the row has come in (unless this is the last one), send this one out
+                left_good := cur_column > 0 and bad_columns(cur_column - 1) = '0';
+                right_good := cur_column < swir_row_width-1 and bad_columns(cur_column + 1) = '0';
+
+                value := cur_pixel;
+                if bad_columns(cur_column) = '1' then
+                    if left_good and right_good then
+                        sum := resize(prev_pixel, swir_pixel_bits+1) + to_value(pixel_in) + 1;
+                        value := sum(swir_pixel_bits downto 1);
+                    elsif left_good then
+                        value := prev_pixel;
+                    elsif right_good then
+                        value := to_value(pixel_in);
+                    end if;
+                end if;
+
+                pixel_out <= to_pixel(value);
+                pixel_out_available <= '1';
+                prev_pixel <= cur_pixel;
+                cur_valid <= '0';
+            end if;
+
+            if pixel_in_available = '1' then
+                cur_pixel <= to_value(pixel_in);
+                cur_column <= column;
+                cur_valid <= '1';
+                if column = swir_row_width-1 then
+                    column <= 0;
+                else
+                    column <= column + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
@@ -0,0 +1,242 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+-- Co-adds groups of coadd_rows consecutive SWIR rows into one, on their way from the SWIR subsystem to
+-- the SDRAM subsystem, to raise SNR and cut the number of rows stored by a factor of coadd_rows
+-- Pixels are assumed to come in in column order, swir_row_width to a row, starting with column 0 after reset
+-- Each column's running sum is kept in an on-chip RAM, swir_coadd_sum_bits wide. When the last row of a group
+-- comes in, the sums are divided by coadd_rows (rounding down, see `coadd_divide`) and sent out as a row of
+-- swir_pixel_bits pixels. Rows left over at the end of an image, fewer than coadd_rows, are discarded
+-- coadd_rows must only change between images. When it is 1, rows are passed through unchanged
+
+-- Signals:
+--		clock: 				50 MHz FPGA clock
+--		reset_n: 			input asynchronous reset
+--
+--		coadd_rows:			Rows co-added into each output row, from 1 to swir_max_coadd_rows
+--		start:				[Pulse] Indicates an image is starting, so the next row starts a new group
+--
+--		pixel_in:			Pixel from the SWIR subsystem
+--		pixel_in_available:	[Pulse] Indicates pixel_in is valid
+--		pixel_out:			Pixel to the SDRAM subsystem
+--		pixel_out_available:[Pulse] Indicates pixel_out is valid
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+use work.swir_types.all;
+
+
+entity swir_row_coadder is
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        coadd_rows          : in integer range 1 to swir_max_coadd_rows;
+        start               : in std_logic;
+
+        pixel_in            : in swir_pixel_t;
+        pixel_in_available  : in std_logic;
+        pixel_out           : out swir_pixel_t;
+        pixel_out_available : out std_logic
+    );
+end entity swir_row_coadder;
+
+
+architecture rtl of swir_row_coadder is
+
+    component pixel_integrator_fifo is
+    generic (
+        WORD_SIZE       : integer;
+        ADDRESS_SIZE    : integer
+    );
+    port (
+        clock           : in std_logic;
+        read_data       : out std_logic_vector;
+        read_address    : in std_logic_vector;
+        read_enable     : in std_logic;
+        write_data      : in std_logic_vector;
+        write_address   : in std_logic_vector;
+        write_enable    : in std_logic
+    );
+    end component pixel_integrator_fifo;
+
+    constant ADDRESS_BITS : integer := integer(ceil(log2(real(swir_row_width))));
+
+    subtype value_t is unsigned(swir_pixel_bits-1 downto 0);
+    subtype sum_t is unsigned(swir_coadd_sum_bits-1 downto 0);
+
+    pure function to_value(pixel : swir_pixel_t) return value_t is
+        variable value : value_t;
+    begin
+        for i in pixel'range loop
+            value(i) := pixel(i);
+        end loop;
+        return value;
+    end function to_value;
+
+    pure function to_pixel(value : value_t) return swir_pixel_t is
+        variable pixel : swir_pixel_t;
+    begin
+        for i in pixel'range loop
+            pixel(i) := value(i);
+        end loop;
+        return pixel;
+    end function to_pixel;
+
+    -- RAM signals
+    signal read_data        : std_logic_vector(swir_coadd_sum_bits-1 downto 0);
+    signal read_address     : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal read_enable      : std_logic;
+    signal write_data       : std_logic_vector(swir_coadd_sum_bits-1 downto 0);
+    signal write_address    : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal write_enable     : std_logic;
+
+    -- Column of the next pixel to come in, and its row within the group
+    signal column           : integer range 0 to swir_row_width-1;
+    signal group_row        : integer range 0 to swir_max_coadd_rows-1;
+
+    -- Pipeline stage 0 output
+    signal pixel_c0         : value_t;
+    signal column_c0        : integer range 0 to swir_row_width-1;
+    signal first_c0         : std_logic;    -- first row of its group
+    signal last_c0          : std_logic;    -- last row of its group
+    signal valid_c0         : std_logic;
+    -- Pipeline stage 1 output
+    signal pixel_c1         : value_t;
+    signal column_c1        : integer range 0 to swir_row_width-1;
+    signal first_c1         : std_logic;
+    signal last_c1          : std_logic;
+    signal valid_c1         : std_logic;
+    -- Pipeline stage 2 output
+    signal sum_c2           : sum_t;
+    signal valid_c2         : std_logic;
+
+begin
+
+    -- Pipeline stage 0: request the column's sum so far
+    c0 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            column <= 0;
+            group_row <= 0;
+            valid_c0 <= '0';
+            read_enable <= '0';
+            read_address <= (others => '0');
+        elsif rising_edge(clock) then
+            valid_c0 <= '0';
+            read_enable <= '0';
+
+            if pixel_in_available = '1' then
+                read_address <= std_logic_vector(to_unsigned(column, ADDRESS_BITS));
+                read_enable <= '1';
+                pixel_c0 <= to_value(pixel_in);
+                column_c0 <= column;
+                first_c0 <= '1' when group_row = 0 else '0';
+                last_c0 <= '1' when group_row >= coadd_rows-1 else '0';
+                valid_c0 <= '1';
+
+                if column = swir_row_width-1 then
+                    column <= 0;
+                    if group_row >= coadd_rows-1 then
+                        group_row <= 0;
+                    else
+                        group_row <= group_row + 1;
+                    end if;
+                else
+                    column <= column + 1;
+                end if;
+            end if;
+
+            if start = '1' then
+                group_row <= 0;
+            end if;
+        end if;
+    end process c0;
+
+    -- Pipeline stage 1: delay until the sum is ready
+    c1 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            valid_c1 <= '0';
+        elsif rising_edge(clock) then
+            valid_c1 <= valid_c0;
+            pixel_c1 <= pixel_c0;
+            column_c1 <= column_c0;
+            first_c1 <= first_c0;
+            last_c1 <= last_c0;
+        end if;
+    end process c1;
+
+    -- Pipeline stage 2: add the pixel to the sum, and write it back unless the group is done
+    c2 : process (clock, reset_n)
+        variable sum : sum_t;
+    begin
+        if reset_n = '0' then
+            valid_c2 <= '0';
+            write_enable <= '0';
+        elsif rising_edge(clock) then
+            valid_c2 <= '0';
+            write_enable <= '0';
+
+            if valid_c1 = '1' then
+                if first_c1 = '1' then
+                    sum := resize(pixel_c1, swir_coadd_sum_bits);
+                else
+                    sum := unsigned(read_data) + pixel_c1;
+                end if;
+
+                if last_c1 = '1' then
+                    sum_c2 <= sum;
+                    valid_c2 <= '1';
+                else
+                    write_data <= std_logic_vector(sum);
+                    write_address <= std_logic_vector(to_unsigned(column_c1, ADDRESS_BITS));
+                    write_enable <= '1';
+                end if;
+            end if;
+        end if;
+    end process c2;
+
+    -- Pipeline stage 3: average the group's sum
+    c3 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            pixel_out_available <= '0';
+        elsif rising_edge(clock) then
+            pixel_out_available <= valid_c2;
+            pixel_out <= to_pixel(resize(coadd_divide(sum_c2, coadd_rows), swir_pixel_bits));
+        end if;
+    end process c3;
+
+    ram : pixel_integrator_fifo generic map (
+        WORD_SIZE => swir_coadd_sum_bits,
+        ADDRESS_SIZE => ADDRESS_BITS
+    ) port map (
+        clock => clock,
+        read_data => read_data,
+        read_address => read_address,
+        read_enable => read_enable,
+        write_data => write_data,
+        write_address => write_address,
+        write_enable => write_enable
+    );
+
+end architecture rtl;
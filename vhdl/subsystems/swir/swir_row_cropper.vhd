@@ -0,0 +1,91 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+-- Crops SWIR rows across-track, on their way from the SWIR subsystem to the SDRAM subsystem
+-- Pixels are assumed to come in in column order, swir_row_width to a row, starting with column 0 after reset
+-- Only the crop_width pixels starting at column crop_start are passed on. crop_width must be a multiple of 8
+-- (a whole number of SDRAM words), and crop_start + crop_width can't be more than swir_row_width, or fewer
+-- pixels than the SDRAM subsystem expects are passed on; swir_controller clamps the crop to keep to this.
+-- Both must only change between images
+
+-- Signals:
+--		clock: 				50 MHz FPGA clock
+--		reset_n: 			input asynchronous reset
+--
+--		crop_start:			First column passed on
+--		crop_width:			Number of columns passed on
+--
+--		pixel_in:			Pixel from the SWIR subsystem
+--		pixel_in_available:	[Pulse] Indicates pixel_in is valid
+--		pixel_out:			Pixel to the SDRAM subsystem
+--		pixel_out_available:[Pulse] Indicates pixel_out is valid
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.swir_types.all;
+
+
+entity swir_row_cropper is
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+
+        crop_start          : in integer range 0 to swir_row_width-1;
+        crop_width          : in integer range 0 to swir_row_width;
+
+        pixel_in            : in swir_pixel_t;
+        pixel_in_available  : in std_logic;
+        pixel_out           : out swir_pixel_t;
+        pixel_out_available : out std_logic
+    );
+end entity swir_row_cropper;
+
+
+architecture rtl of swir_row_cropper is
+
+    -- Column of the next pixel to come in
+    signal column           : integer range 0 to swir_row_width-1;
+
+begin
+
+    process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            column <= 0;
+            pixel_out_available <= '0';
+        elsif rising_edge(clock) then
+            pixel_out_available <= '0';
+
+            if pixel_in_available = '1' then
+                if column >= crop_start and column < crop_start + crop_width then
+                    pixel_out <= pixel_in;
+                    pixel_out_available <= '1';
+                end if;
+
+                if column = swir_row_width-1 then
+                    column <= 0;
+                else
+                    column <= column + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+end architecture rtl;
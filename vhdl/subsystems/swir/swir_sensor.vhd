@@ -16,8 +16,11 @@
 
 -- swir_sensor.vhd controls signals sent to the SWIR sensor
 -- When prompted by sensor_begin, will trigger imaging of one row, and will pulse sensor_done when row is finished
--- While analog data is outputed by sensor, adc_start will be sent to ADC control circuit to make it beging conversion
+-- While analog data is outputed by sensor, adc_start_odd and adc_start_even will be sent to the ADC control circuits of
+--	the odd and even pixels, in turn, to make them begin conversion
 --	based on the fact that analog data is valid on the falling edge of the SWIR sensor clock
+-- In correlated double sampling (CDS) mode, each ADC also converts in the SWIR clock cycle after each of its pixels,
+--	while the other output is being sampled, to capture that pixel's reset level
 
 -- Signals:
 --		clock_swir: 	0.78125 MHz SWIR clock
@@ -26,8 +29,12 @@
 --		integration_time: number of clock clock cycles to hold sensor_reset_even for, in SWIR sensor clock cycles (actual integration time + 5)
 --		
 --		ce:				Conversion efficiency - 0 (low) or 1 (high)
+--		cds:			Correlated double sampling - 1 to sample each pixel's reset level after its signal level
 --		adc_trigger:	Signal sent to ADC code to mirror AD_trig of SWIR sensor; unused
---		adc_start: 		Pulse sent to ADC code to tell it to begin capturing analog data
+--		adc_start_odd:	Pulse sent to odd pixel ADC code to tell it to begin capturing analog data
+--		adc_start_even:	Pulse sent to even pixel ADC code to tell it to begin capturing analog data
+--							The first pixel outputted is odd, so the two alternate starting with adc_start_odd
+--							In CDS mode, both are sent on every SWIR clock cycle of the readout (twice per pixel)
 --		sensor_begin:	Pulse from SWIR top level, indicating that imaging of 1 row should begin
 --		sensor_done: 	Pulse sent to SWIR top level, indicating that imaging of 1 row is done
 --							Will trigger one half cycle (of swir clk) after sensor is done outputting 512 pixels
@@ -47,8 +54,10 @@ entity swir_sensor is
         integration_time    : in unsigned(9 downto 0);
 		
 		ce					: in std_logic;
+		cds					: in std_logic;
 		adc_trigger			: out std_logic;
-		adc_start			: out std_logic;
+		adc_start_odd		: out std_logic;
+		adc_start_even		: out std_logic;
 		sensor_begin      	: in std_logic;
 		sensor_done			: out std_logic; 
 		
@@ -69,6 +78,9 @@ architecture main of swir_sensor is
 	signal integration_time1					: unsigned(9 downto 0);
 	signal integration_time_local				: unsigned(9 downto 0);
 	
+	signal cds1									: std_logic;
+	signal cds_local							: std_logic;
+	
 	signal reset_counter						: unsigned(9 downto 0);
 	signal reset_n_local						: std_logic;
 	signal reset_n_metastable					: std_logic;
@@ -119,6 +131,10 @@ begin
 			integration_time1(9)	  <= integration_time(9);
 			integration_time_local(9) <= integration_time1(9);
 			
+			-- Only changed between images, like integration_time
+			cds1				<= cds;
+			cds_local			<= cds1;
+			
 			-- Register rising edge of sensor_begin signal
 			if (sensor_begin3 = '0' and sensor_begin2 = '1') then
 				sensor_begin_local <= '1';
@@ -203,6 +219,10 @@ begin
 	sensor_done			<=	'1' when counter = 1 else '0';
 	
 	-- Indicates ADC to do a conversion when the sensor indicates it has begun outputting, and every SWIR sensor clock cycle after that until all pixels outputted
-	adc_start			<=	clock_swir when (counter > 1 or first_pixel_outputted = '1') else '0';
+	-- counter is even on even pixels (512 on the second pixel, down to 2 on the last one), and odd on the others
+	-- In CDS mode, each ADC converts again on the next clock cycle, so the odd pixel ADC converts on every cycle of the readout,
+	--	and the even pixel ADC on every cycle from the second pixel up to the one after the last (counter = 1)
+	adc_start_odd		<=	clock_swir when ((counter > 1 and (counter(0) = '1' or cds_local = '1')) or first_pixel_outputted = '1') else '0';
+	adc_start_even		<=	clock_swir when ((counter > 1 and counter(0) = '0') or (counter = 1 and cds_local = '1')) else '0';
 
 end architecture main;
\ No newline at end of file
@@ -18,7 +18,14 @@
 -- When triggered by the top-level "FPGA subsystem", this circuit (the "SWIR subsystem") will image n rows of SWIR data given 
 --		certain configuration specifications, and send the data to the "SDRAM subsystem" to be written to SDRAM
 -- The SWIR sensor is the 1x512 pixel G11508 Hamamatsu sensor
--- Data from the SWIR sensor is sent to an ADAQ7980 ADC, in 4-wire CS mode with busy indicator, with VIO over 1.7 V
+-- Data from the SWIR sensor is sent to two ADAQ7980 ADCs, one for the even pixel output and one for the odd pixel output,
+--		in 4-wire CS mode with busy indicator, with VIO over 1.7 V
+--		Each ADC only has to convert on every other SWIR clock cycle, but the PLL clocks (0.78125 MHz SWIR clock,
+--		0.390625 MHz sensor clocks) are kept as they were with a single ADC, so a row still takes 512 SWIR clock cycles
+--		to read out. They can't be raised for both modes: with CDS on (see below) each ADC already converts every
+--		1.28 us against its 1.2 us minimum, and the PLL is fixed, so the SWIR clock is the same with CDS on or off.
+--		The exposure and frame timing (config.exposure_clocks / 64, min_one_frame_len) also assume 64 FPGA clock
+--		cycles per SWIR clock cycle
 -- Voltage to the SWIR sensor is controlled by two voltage regulators: TPS73601DCQR (1V2) and TPS62821DLCR (4V0)
 
 -- swir_subsystem.vhd is the top level code of SWIR subsystem, and does the following:
@@ -26,10 +33,12 @@
 --		Reads configuration signals from FPGA subsystem, and passes on integration time to SWIR sensor control circuit
 --		Triggers SWIR sensor control circuit to image rows
 --		Instantiates PLL IP to create SWIR, ADC, and SWIR switch clocks
---		Reads data out of FIFO buffer to SDRAM subsystem
+--		Reads data out of the FIFO buffers of the two ADCs in turn to SDRAM subsystem, restoring pixel order, and
+--			puts the reads back in phase at the start of each row
+--		In correlated double sampling mode, subtracts each pixel's reset level from its signal level before passing it on
 --		Control enable signals to voltage regulators
 --		Instantiates swir_sensor.vhd, which controls signals directly to SWIR sensor, and may image 1 row if triggered
---		Instantiates swir_adc.vhd, which controls signals to ADC and writes data from ADC to FIFO buffer
+--		Instantiates swir_adc.vhd twice, once per ADC, which controls signals to ADC and writes each sample from ADC to FIFO buffer
 
 -- Signals:
 --		clock: 			50 MHz FPGA clock
@@ -42,17 +51,24 @@
 --			config.frame_clocks: 	Integer, sets number of 50 MHz clock cycles per frame (one frame indicates length between subsequent sensor integrations)
 --			config.exposure_clocks: Integer, sets number of clock cycles for sensor to integrate over (multiple of 64 + 128*n)
 --			config.length: 			Integer, number of rows to image (512 pixels per row, one row per frame)
+--			config.coadd_rows:		Integer, not used here; rows are co-added on their way to the SDRAM subsystem by swir_row_coadder.vhd
+--			config.cds:				'1' for correlated double sampling (see below)
 --		control:		Control signals. Consists of:
 --			control.volt_conv: 		Sets enable signal (active high) for voltage regulators
 --
 --		do_imaging: 	[Pulse] Starts imaging process given current configuration settings (triggers imaging of n rows)
+--		imaging_done:	[Pulse] Indicates the last of the n rows has been imaged, and do_imaging can be pulsed again
 --		pixel_available:[Pulse] Indicates one pixel of data is valid to be read by SDRAM subsystem
 --		pixel: 			16 bit logic array containing data for one pixel
+--		samples_dropped:Number of ADC samples lost since reset, seen as gaps in the sequence tags of each ADC's samples.
+--							Saturates at its maximum. A gap of 16 samples or more in a row is undercounted, as the tags
+--							wrap around. Samples thrown away to get back in phase at the start of a row are
+--							counted too
 --		
---		sdi:			Serial Data Input. Control signal for ADC (refer to ADAQ7980 datasheet)
---		sdo:			Serial Data Output. Digital data outputted on sdo (refer to ADAQ7980 datasheet)
---		sck:			Serial Data Clock Input. Serial Data is clocked out according to speed of sck
---		cnv:			Convert Input. Control signal for ADC (refer to ADAQ7980 datasheet)
+--		sdi_even/odd:	Serial Data Input. Control signal for even/odd pixel ADC (refer to ADAQ7980 datasheet)
+--		sdo_even/odd:	Serial Data Output. Digital data outputted on sdo by even/odd pixel ADC (refer to ADAQ7980 datasheet)
+--		sck:			Serial Data Clock Input, shared by both ADCs. Serial Data is clocked out according to speed of sck
+--		cnv_even/odd:	Convert Input. Control signal for even/odd pixel ADC (refer to ADAQ7980 datasheet)
 --
 --		sensor_clock_even:	Clock sent to SWIR sensor, and controls speed of analog data outputted (controls even numbered pixels)
 --		sensor_clock_odd:	Clock sent to SWIR sensor, and controls speed of analog data outputted (controls odd numbered pixels)
@@ -75,6 +91,19 @@
 --		config.exposure_clocks: 64 to 17856 inclusive. Must be a multiple of 64 + 128*n
 --		config.length: 1 to 5000 inclusive
 
+-- Correlated double sampling (CDS):
+--		When config.cds is set, each ADC samples every pixel twice: its signal level in the SWIR clock cycle the pixel is
+--		read out in, as usual, and its reset level in the next cycle, while the pixel on the other output is being sampled.
+--		pixel is the signal level minus the reset level, clamped at 0, which removes the offset of each sensor output and
+--		its drift over time, so no dark frame has to be taken for it. This relies on each output holding a reset level
+--		in the second half of each of its pixels, which is assumed rather than measured: the sensor testbench only
+--		outputs signal levels, so testbenches/tb_cds.vhd models it. The two samples of a pixel are read from its ADC one
+--		after the other, and pixel_available is only pulsed once both are in.
+--		Throughput: each ADC then converts on every cycle of the 0.78125 MHz SWIR clock (every 1.28 us, against the
+--		ADAQ7980's minimum cycle time of 1.2 us) instead of every other one, so a row is still read out in 512 SWIR clock
+--		cycles (655.36 us, 781250 pixels/s) plus one for the last reset level. CDS uses up the headroom of having two
+--		ADCs, though, so the SWIR clock can't be sped up with it on. This is measured by testbenches/tb_cds.vhd
+
 
 library ieee;
 use ieee.std_logic_1164.all;
@@ -94,16 +123,23 @@ entity swir_subsystem is
         control         	: in swir_control_t;
 		
         do_imaging      	: in std_logic;
+		imaging_done		: out std_logic;
 	
 		-- Signals to SDRAM subsystem
         pixel           	: out swir_pixel_t;
         pixel_available 	: out std_logic;
 		
-		-- Signals to ADC
-		sdi					: out std_logic;
-		sdo					: in std_logic;
+		-- Status
+		samples_dropped		: out unsigned(15 downto 0);
+		
+		-- Signals to ADCs
+		sdi_even			: out std_logic;
+		sdo_even			: in std_logic;
+		cnv_even			: out std_logic;
+		sdi_odd				: out std_logic;
+		sdo_odd				: in std_logic;
+		cnv_odd				: out std_logic;
 		sck					: out std_logic;
-		cnv					: out std_logic;
 		
 		-- Signals to SWIR sensor
         sensor_clock_even   : out std_logic;
@@ -152,8 +188,10 @@ architecture rtl of swir_subsystem is
         integration_time    : in unsigned(9 downto 0);
 		
 		ce					: in std_logic; 
+		cds					: in std_logic;
 		adc_trigger			: out std_logic;
-		adc_start			: out std_logic;
+		adc_start_odd		: out std_logic;
+		adc_start_even		: out std_logic;
 		sensor_begin      	: in std_logic; 
 		sensor_done			: out std_logic;
 		
@@ -175,8 +213,6 @@ architecture rtl of swir_subsystem is
 		clock_main			: in std_logic;  
         reset_n         	: in std_logic;
 		
-        output_done		   	: out std_logic;
-		
 		-- Signals from sensor code
 		adc_trigger			: in std_logic;
 		adc_start			: in std_logic;
@@ -189,7 +225,9 @@ architecture rtl of swir_subsystem is
 		-- FIFO signals for higher level file to read from
 		fifo_rdreq			: in std_logic;
 		fifo_rdempty		: out std_logic;
-		fifo_data_read		: out std_logic_vector(15 downto 0)
+		fifo_data_read		: out std_logic_vector(15 downto 0);
+		fifo_sequence		: out unsigned(3 downto 0);
+		fifo_clear			: in std_logic
     );
 	end component swir_adc;
 	
@@ -198,15 +236,33 @@ architecture rtl of swir_subsystem is
 	signal sensor_begin			: std_logic;
 	signal sensor_done			: std_logic;
 	signal sensor_adc_trigger	: std_logic;
-	signal sensor_adc_start		: std_logic;
+	signal sensor_adc_start_odd	: std_logic;
+	signal sensor_adc_start_even : std_logic;
 	signal swir_clock			: std_logic;
 	signal sensor_clock_odd_and_mux : std_logic;
 	
 	signal adc_clock			: std_logic;
-	signal adc_done				: std_logic;
-	signal adc_fifo_rd			: std_logic;
-	signal adc_fifo_empty		: std_logic;
-	signal read_counter			: unsigned(7 downto 0);
+	signal adc_fifo_rd_odd		: std_logic;
+	signal adc_fifo_rd_even		: std_logic;
+	signal adc_fifo_empty_odd	: std_logic;
+	signal adc_fifo_empty_even	: std_logic;
+	signal adc_sequence_odd		: unsigned(3 downto 0);
+	signal adc_sequence_even	: unsigned(3 downto 0);
+	signal expected_sequence_odd : unsigned(3 downto 0);
+	signal expected_sequence_even : unsigned(3 downto 0);
+	signal samples_dropped_i	: unsigned(15 downto 0);
+	signal read_odd				: std_logic;  -- Next pixel is read from the odd pixel ADC
+	signal read_reset			: std_logic;  -- Next sample is the reset level of a pixel (CDS mode)
+	signal sample_available		: std_logic;
+	signal sample_odd			: std_logic;  -- sample_vector is from the odd pixel ADC
+	signal sample_reset			: std_logic;  -- sample_vector is the reset level of a pixel (CDS mode)
+	signal signal_level			: unsigned(15 downto 0);  -- Signal level of the pixel whose reset level is next (CDS mode)
+	constant realign_delay		: integer := 200;
+	signal realign_counter		: integer range 0 to realign_delay;
+	signal realign				: std_logic;  -- Put the FIFO reads back in phase for the next row
+	signal row_pixel			: integer range 0 to swir_row_width-1;  -- Pixels of the current row sent on so far
+	signal pad_pixels			: integer range 0 to swir_row_width;  -- Pixels still to send to fill out a short row
+	signal pad_wait				: std_logic;
 	
 	signal row_counter			: unsigned(9 downto 0);
 	signal clocks_per_frame_temp : integer range -1 to 100000;
@@ -215,6 +271,8 @@ architecture rtl of swir_subsystem is
 	signal clocks_per_exposure	: integer range 0 to 17920;
 	signal number_of_rows_temp	: integer range 0 to 5000;
 	signal number_of_rows		: integer range 0 to 5000;
+	signal cds_temp				: std_logic;
+	signal cds					: std_logic;
 	signal config_wait			: std_logic;
 	
 	signal counter_sensor_begin : integer range 0 to 1001;
@@ -228,10 +286,6 @@ architecture rtl of swir_subsystem is
 	signal sensor_done2			: std_logic;
 	signal sensor_done3			: std_logic;
 	signal sensor_done_local	: std_logic;
-	signal output_done1			: std_logic;
-	signal output_done2			: std_logic;
-	signal output_done3			: std_logic;
-	signal output_done_local	: std_logic;
 	signal reset_n1				: std_logic;
 	signal reset_n2				: std_logic;
 	signal reset_n3				: std_logic;
@@ -243,6 +297,9 @@ architecture rtl of swir_subsystem is
 	signal pll_locked			: std_logic;
 	
 	signal pixel_vector			: std_logic_vector(15 downto 0);
+	signal sample_vector		: std_logic_vector(15 downto 0);
+	signal pixel_vector_odd		: std_logic_vector(15 downto 0);
+	signal pixel_vector_even	: std_logic_vector(15 downto 0);
 	
 	constant hold_time			: integer := 70;
 begin	
@@ -280,8 +337,10 @@ begin
         integration_time    =>	sensor_integration,
 		
 		ce					=>	sensor_ce,
+		cds					=>	cds,
 		adc_trigger			=>	sensor_adc_trigger,
-		adc_start			=>	sensor_adc_start,
+		adc_start_odd		=>	sensor_adc_start_odd,
+		adc_start_even		=>	sensor_adc_start_even,
 		sensor_begin   		=>	sensor_begin,
 		sensor_done			=>	sensor_done,
 	
@@ -296,24 +355,46 @@ begin
 		AD_trig_odd			=>	AD_trig_odd
     );
 
-	adc_control_circuit : component swir_adc
+	-- ADC for the odd pixels, which are outputted first
+	adc_odd_control_circuit : component swir_adc
 	port map (
         clock_adc			=>	adc_clock,
 		clock_main			=>	clock,
 		reset_n     		=>	reset_n_synchronous,
         
-		output_done			=>	adc_done,  -- Indicate that one pixel has been received
+		adc_trigger			=>	sensor_adc_trigger,
+		adc_start			=>	sensor_adc_start_odd,
+		
+		sdi					=>	sdi_odd,
+		cnv					=>	cnv_odd,
+		sdo					=>	sdo_odd,
+		
+		fifo_rdreq			=>	adc_fifo_rd_odd,
+		fifo_rdempty		=>	adc_fifo_empty_odd,
+		fifo_data_read		=>	pixel_vector_odd,
+		fifo_sequence		=>	adc_sequence_odd,
+		fifo_clear			=>	realign
+	);
+
+	-- ADC for the even pixels
+	adc_even_control_circuit : component swir_adc
+	port map (
+        clock_adc			=>	adc_clock,
+		clock_main			=>	clock,
+		reset_n     		=>	reset_n_synchronous,
         
 		adc_trigger			=>	sensor_adc_trigger,
-		adc_start			=>	sensor_adc_start,
+		adc_start			=>	sensor_adc_start_even,
 		
-		sdi					=>	sdi,
-		cnv					=>	cnv,
-		sdo					=>	sdo,
+		sdi					=>	sdi_even,
+		cnv					=>	cnv_even,
+		sdo					=>	sdo_even,
 		
-		fifo_rdreq			=>	adc_fifo_rd,
-		fifo_rdempty		=>	adc_fifo_empty,
-		fifo_data_read		=>	pixel_vector
+		fifo_rdreq			=>	adc_fifo_rd_even,
+		fifo_rdempty		=>	adc_fifo_empty_even,
+		fifo_data_read		=>	pixel_vector_even,
+		fifo_sequence		=>	adc_sequence_even,
+		fifo_clear			=>	realign
 	);
 
 	-- Synchronize the asynchronous reset
@@ -367,23 +448,6 @@ begin
 		end if;
 	end process;
 	
-	-- output_done indicates ADC has output serial data for one pixel
-	process(clock) is
-	begin
-		if rising_edge(clock) then
-			output_done1		<= adc_done;
-			output_done2		<= output_done1;
-			output_done3		<= output_done2;
-			
-			-- Register rising edge of signals
-			if (output_done3 = '0' and output_done2 = '1') then
-				output_done_local <= '1';
-			else
-				output_done_local <= '0';
-			end if;
-		end if;
-	end process;
-	
 	-- Process to stretch sensor_begin signal to send to swir clock domain of 0.78125 MHz
 	process(clock, reset_n_synchronous, circuit_on)
 	begin
@@ -397,6 +461,29 @@ begin
 			end if;
 		end if;
 	end process;
+	
+	-- Pulse realign realign_delay clock cycles after each row is started, to put the FIFO reads back in phase
+	-- By then the last sample of the previous row has been written to its FIFO: sensor_begin_local comes at least
+	--  about 7 clock cycles after the SWIR clock cycle of the last adc_start, and a conversion and readout take under
+	--  100 clock cycles. The first sample of the new row is at least 6 SWIR clock cycles (384 clock cycles) of
+	--  integration after sensor_begin_local, so none of it is lost
+	process(clock, reset_n_synchronous, circuit_on)
+	begin
+		if reset_n_synchronous = '0' or circuit_on /= '1' then
+			realign_counter <= 0;
+			realign <= '0';
+		elsif rising_edge(clock) then
+			realign <= '0';
+			if sensor_begin_local = '1' then
+				realign_counter <= realign_delay;
+			elsif realign_counter > 0 then
+				realign_counter <= realign_counter - 1;
+				if realign_counter = 1 then
+					realign <= '1';
+				end if;
+			end if;
+		end if;
+	end process;
 
 	-- Register configuration signals
 	process(clock, reset_n_synchronous, circuit_on)
@@ -405,11 +492,13 @@ begin
 			number_of_rows_temp <= 0;
 			clocks_per_frame_temp <= -1;
 			clocks_per_exposure_temp <= 64;
+			cds_temp <= '0';
 		elsif rising_edge(clock) then
 			if start_config = '1' then
 				clocks_per_frame_temp <= config.frame_clocks;
 				clocks_per_exposure_temp <= config.exposure_clocks;
 				number_of_rows_temp <= config.length;	
+				cds_temp <= config.cds;
 			end if;
 		end if;
 	end process;
@@ -422,11 +511,13 @@ begin
 			number_of_rows <= 0;
 			clocks_per_frame <= -1;
 			clocks_per_exposure <= 64;
+			cds <= '0';
 		elsif rising_edge(clock) then
 			if row_counter = 0 then
 				clocks_per_frame <= clocks_per_frame_temp;
 				clocks_per_exposure <= clocks_per_exposure_temp;
 				number_of_rows <= number_of_rows_temp;
+				cds <= cds_temp;
 			end if;
 		end if;
 	end process;
@@ -516,66 +607,173 @@ begin
 	begin
 		if reset_n_synchronous = '0' or circuit_on /= '1' then
 			row_counter <= (others=>'0');
+			imaging_done <= '0';
 		elsif rising_edge(clock) then
+			imaging_done <= '0';
 			if frame_counter = 1 then -- frame_counter = 1 near the start of each row - use it to increment row_counter
 				row_counter <= row_counter + 1;
 			-- If row_counter equals configuration setting for number of rows to image, and the frame is done, reset the counter
 			elsif row_counter = number_of_rows and ((sensor_done_local = '1' and frame_counter >= clocks_per_frame) 
 				or (frame_counter >= clocks_per_frame and frame_counter >= min_one_frame_len)) then
 				row_counter <= (others=>'0');
+				imaging_done <= '1';
 			else
 				row_counter <= row_counter;
 			end if;
 		end if;
 	end process;
 	
-	-- Count number of data writes to FIFO to be read out
+	-- Read data out of FIFOs
+	-- Only complete samples are written to them, so each one can be read as soon as it is there
+	-- Pixels are read from the odd and even pixel ADCs in turn, starting with odd, to restore pixel order.
+	--  In CDS mode, two samples (signal level, then reset level) are read from an ADC before moving on to the other one
+	-- A sample lost on one ADC would swap odd and even pixels from then on, so the reads are put back in phase between
+	--  rows on realign: whatever is left in the FIFOs is thrown away, the next read is the signal level of an odd pixel,
+	--  and a short row is filled out with zero pixels so the circuits downstream still see whole rows
+	adc_fifo_rd_odd <= '1' when read_odd = '1' and adc_fifo_empty_odd = '0' and realign = '0' and pad_pixels = 0
+		and reset_n_synchronous = '1' and circuit_on = '1' else '0';
+	adc_fifo_rd_even <= '1' when read_odd = '0' and adc_fifo_empty_even = '0' and realign = '0' and pad_pixels = 0
+		and reset_n_synchronous = '1' and circuit_on = '1' else '0';
+	
 	process(clock, reset_n_synchronous, circuit_on)
 	begin
 		if reset_n_synchronous = '0' or circuit_on /= '1' then
-			read_counter <= (others => '0');
+			read_odd <= '1';
+			read_reset <= '0';
 		elsif rising_edge(clock) then
-			if read_counter > 0 and adc_fifo_empty = '0' then
-				read_counter <= read_counter - 1;
-			end if;
-			
-			if output_done_local = '1' then
-				read_counter <= read_counter + 1;
-			elsif read_counter >= 128 then  -- FIFO width is 128
-				read_counter <= (others => '0');
+			if realign = '1' then
+				read_odd <= '1';
+				read_reset <= '0';
+			elsif adc_fifo_rd_odd = '1' or adc_fifo_rd_even = '1' then
+				if cds = '1' and read_reset = '0' then
+					read_reset <= '1';
+				else
+					read_reset <= '0';
+					read_odd <= not read_odd;
+				end if;
 			end if;
 		end if;
 	end process;
 	
-	-- Read data out of FIFO
+	-- Want sample_available to lag adc_fifo_rd_odd/even by 1 clock cycle
+	--  Because FIFO read data will only be valid after 1 clock cycle
 	process(clock, reset_n_synchronous, circuit_on)
 	begin
 		if reset_n_synchronous = '0' or circuit_on /= '1' then
-			adc_fifo_rd <= '0';
+			sample_available <= '0';
+			sample_odd <= '0';
+			sample_reset <= '0';
 		elsif rising_edge(clock) then
-			if read_counter > 0 and adc_fifo_empty = '0' then
-				adc_fifo_rd <= '1';
+			if adc_fifo_rd_odd = '1' or adc_fifo_rd_even = '1' then
+				sample_available <= '1';
 			else
-				adc_fifo_rd <= '0';
+				sample_available <= '0';
 			end if;
+			sample_odd <= adc_fifo_rd_odd;
+			sample_reset <= read_reset;
 		end if;
 	end process;
 	
-	-- Want pixel_available to lag adc_fifo_rd by 1 clock cycle
-	--  Because FIFO read data will only be valid after 1 clock cycle
+	-- Output one pixel per sample, or in CDS mode, hold on to the signal level and output the difference
+	--  once the reset level comes in. The reset level is above the signal level only through noise, so clamp at 0
+	-- On realign, the sample read in the same clock cycle is out of phase and is thrown away, and if the row is short,
+	--  zero pixels are sent every other clock cycle until it is whole
 	process(clock, reset_n_synchronous, circuit_on)
+		variable pixel_out : std_logic;
 	begin
 		if reset_n_synchronous = '0' or circuit_on /= '1' then
 			pixel_available <= '0';
+			pixel_vector <= (others => '0');
+			signal_level <= (others => '0');
+			row_pixel <= 0;
+			pad_pixels <= 0;
+			pad_wait <= '0';
 		elsif rising_edge(clock) then
-			if adc_fifo_rd = '1' then
-				pixel_available <= '1';
+			pixel_out := '0';
+			if realign = '1' then
+				if row_pixel /= 0 then
+					pad_pixels <= swir_row_width - row_pixel;
+					assert false report "SWIR row short by " & integer'image(swir_row_width - row_pixel) & " pixels" severity warning;
+				end if;
+				pad_wait <= '0';
+			elsif pad_pixels > 0 then
+				if pad_wait = '0' then
+					pixel_vector <= (others => '0');
+					pixel_out := '1';
+					pad_pixels <= pad_pixels - 1;
+				end if;
+				pad_wait <= not pad_wait;
+			elsif sample_available = '1' then
+				if cds = '1' and sample_reset = '0' then
+					signal_level <= unsigned(sample_vector);
+				elsif cds = '1' then
+					if signal_level > unsigned(sample_vector) then
+						pixel_vector <= std_logic_vector(signal_level - unsigned(sample_vector));
+					else
+						pixel_vector <= (others => '0');
+					end if;
+					pixel_out := '1';
+				else
+					pixel_vector <= sample_vector;
+					pixel_out := '1';
+				end if;
+			end if;
+			
+			pixel_available <= pixel_out;
+			if pixel_out = '1' then
+				if row_pixel = swir_row_width-1 then
+					row_pixel <= 0;
+				else
+					row_pixel <= row_pixel + 1;
+				end if;
+			end if;
+		end if;
+	end process;
+	
+	-- Check the sequence tag of each sample, to count the samples dropped by the ADC circuits
+	--  samples_dropped_i is only cleared by reset, so the MCU can tell if any were dropped during an image
+	process(clock, reset_n)
+		variable gap : unsigned(3 downto 0);
+		constant max_dropped : unsigned(15 downto 0) := (others => '1');
+	begin
+		if reset_n = '0' then
+			samples_dropped_i <= (others => '0');
+		elsif rising_edge(clock) then
+			gap := (others => '0');
+			if sample_available = '1' and sample_odd = '1' then
+				gap := adc_sequence_odd - expected_sequence_odd;
+				assert gap = 0 report "SWIR odd pixel ADC samples were dropped" severity warning;
+			elsif sample_available = '1' then
+				gap := adc_sequence_even - expected_sequence_even;
+				assert gap = 0 report "SWIR even pixel ADC samples were dropped" severity warning;
+			end if;
+			
+			if samples_dropped_i > max_dropped - gap then
+				samples_dropped_i <= (others => '1');
 			else
-				pixel_available <= '0';
+				samples_dropped_i <= samples_dropped_i + gap;
+			end if;
+		end if;
+	end process;
+	
+	process(clock, reset_n_synchronous, circuit_on)
+	begin
+		if reset_n_synchronous = '0' or circuit_on /= '1' then
+			expected_sequence_odd <= (others => '0');
+			expected_sequence_even <= (others => '0');
+		elsif rising_edge(clock) then
+			if sample_available = '1' and sample_odd = '1' then
+				expected_sequence_odd <= adc_sequence_odd + 1;
+			elsif sample_available = '1' then
+				expected_sequence_even <= adc_sequence_even + 1;
 			end if;
 		end if;
 	end process;
 	
+	samples_dropped <= samples_dropped_i;
+	
+	sample_vector <= pixel_vector_odd when sample_odd = '1' else pixel_vector_even;
+	
 	-- Sensor conversion efficiency - 0 (low) or 1 (high)
 	sensor_ce <= '1';
 
@@ -23,6 +23,8 @@ package swir_types is
         frame_clocks	: integer;
         exposure_clocks : integer;
 		length			: integer;
+		coadd_rows		: integer;  -- rows co-added into each output row (see `swir_row_coadder`), 1 to turn it off
+		cds				: std_logic;  -- '1' to subtract each pixel's reset level from its signal level (see `swir_subsystem`)
     end record swir_config_t;
 
     type swir_control_t is record
@@ -32,4 +34,39 @@ package swir_types is
     constant swir_pixel_bits : integer := 16;
     constant swir_row_width : integer := 512;
     type swir_pixel_t is array(0 to swir_pixel_bits-1) of std_logic;
+
+    -- Up to swir_max_coadd_rows rows can be co-added, so their sums take swir_coadd_sum_bits bits
+    constant swir_max_coadd_rows : integer := 16;
+    constant swir_coadd_sum_bits : integer := swir_pixel_bits + 4;
+
+    -- Divides n by a co-add count d, rounding down, by multiplying with d's reciprocal (see
+    -- `reciprocal_divide` in pixel_integrator_pkg). Exact for n < 2**swir_coadd_sum_bits
+    pure function coadd_divide(n : unsigned; d : integer range 1 to swir_max_coadd_rows) return unsigned;
 end package swir_types;
+
+package body swir_types is
+
+    constant coadd_shift : integer := swir_coadd_sum_bits + 4;
+
+    type coadd_reciprocal_a is array (1 to swir_max_coadd_rows) of unsigned(coadd_shift downto 0);
+
+    -- ceil(2**coadd_shift / d) for each co-add count d
+    pure function coadd_reciprocals return coadd_reciprocal_a is
+        variable re : coadd_reciprocal_a;
+    begin
+        for d in re'range loop
+            re(d) := to_unsigned((2 ** coadd_shift + d - 1) / d, coadd_shift + 1);
+        end loop;
+        return re;
+    end function coadd_reciprocals;
+
+    constant coadd_reciprocal : coadd_reciprocal_a := coadd_reciprocals;
+
+    pure function coadd_divide(n : unsigned; d : integer range 1 to swir_max_coadd_rows) return unsigned is
+        variable product : unsigned(n'length + coadd_shift downto 0);
+    begin
+        product := n * coadd_reciprocal(d);
+        return resize(shift_right(product, coadd_shift), n'length);
+    end function coadd_divide;
+
+end package body swir_types;
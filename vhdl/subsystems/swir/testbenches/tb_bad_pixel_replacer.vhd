@@ -0,0 +1,228 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+-- Testbench for swir_bad_pixel_replacer
+-- Images ROWS rows with a first bad column map, then rewrites the map and images ROWS more rows, checking
+--  every pixel out against a model of the replacement
+--
+-- The first map marks a column in the middle of the row, the first and last columns (which only have one
+--  neighbour) and two columns side by side (each only replaced with its other neighbour). The second map clears
+--  those and marks a column that was good, so the columns replaced in the first image have to come out unchanged
+-- The first image is sent a pixel per clock cycle and the second with gaps between pixels, so the last pixel of
+--  a row is sent out both with and without the next row's first pixel coming in on the same cycle
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.swir_types.all;
+
+entity tb_bad_pixel_replacer is 
+end entity;
+
+architecture sim of tb_bad_pixel_replacer is 
+	component swir_bad_pixel_replacer is
+	port (
+		clock               : in std_logic;
+		reset_n             : in std_logic;
+
+		map_column          : in integer range 0 to swir_row_width-1;
+		map_bad             : in std_logic;
+		map_write           : in std_logic;
+
+		pixel_in            : in swir_pixel_t;
+		pixel_in_available  : in std_logic;
+		pixel_out           : out swir_pixel_t;
+		pixel_out_available : out std_logic
+	);
+	end component swir_bad_pixel_replacer;
+	
+	constant ClockPeriod			:	time := 20 ns;
+	constant ROWS					:	integer := 2;
+	constant N_MAPS					:	integer := 2;
+	
+	type column_array is array(natural range <>) of integer;
+	constant MAP_0					:	column_array := (100, 0, swir_row_width-1, 300, 301);
+	constant MAP_1					:	column_array := (0 => 200);
+	
+	signal clock					:	std_logic := '0';
+	signal reset_n					:	std_logic := '0';
+	signal map_column				:	integer range 0 to swir_row_width-1 := 0;
+	signal map_bad					:	std_logic := '0';
+	signal map_write				:	std_logic := '0';
+	signal pixel_in					:	swir_pixel_t;
+	signal pixel_in_available		:	std_logic := '0';
+	signal pixel_out				:	swir_pixel_t;
+	signal pixel_out_available		:	std_logic;
+	signal done						:	boolean := false;
+	
+	pure function is_bad(map_n : integer; column : integer) return boolean is
+	begin
+		if map_n = 0 then
+			for i in MAP_0'range loop
+				if MAP_0(i) = column then
+					return true;
+				end if;
+			end loop;
+		else
+			for i in MAP_1'range loop
+				if MAP_1(i) = column then
+					return true;
+				end if;
+			end loop;
+		end if;
+		return false;
+	end function is_bad;
+	
+	-- Input pixel of the given column of row `row` (counting from the first image)
+	pure function input(row : integer; column : integer) return integer is
+	begin
+		return (column * 37 + row * 1009) mod 60000 + 100;
+	end function input;
+	
+	pure function expected(map_n : integer; row : integer; column : integer) return integer is
+		variable left_good		: boolean;
+		variable right_good		: boolean;
+	begin
+		if not is_bad(map_n, column) then
+			return input(row, column);
+		end if;
+		left_good := column > 0 and not is_bad(map_n, column - 1);
+		right_good := column < swir_row_width-1 and not is_bad(map_n, column + 1);
+		if left_good and right_good then
+			return (input(row, column - 1) + input(row, column + 1) + 1) / 2;
+		elsif left_good then
+			return input(row, column - 1);
+		elsif right_good then
+			return input(row, column + 1);
+		end if;
+		return input(row, column);
+	end function expected;
+	
+	pure function to_pixel(value : integer) return swir_pixel_t is
+		variable bits			: unsigned(swir_pixel_bits-1 downto 0);
+		variable pixel			: swir_pixel_t;
+	begin
+		bits := to_unsigned(value, swir_pixel_bits);
+		for i in pixel'range loop
+			pixel(i) := bits(i);
+		end loop;
+		return pixel;
+	end function to_pixel;
+	
+	pure function to_integer(pixel : swir_pixel_t) return integer is
+		variable bits			: unsigned(swir_pixel_bits-1 downto 0);
+	begin
+		for i in pixel'range loop
+			bits(i) := pixel(i);
+		end loop;
+		return to_integer(bits);
+	end function to_integer;
+	
+begin
+	
+	clock <= not clock after ClockPeriod / 2;
+	
+	dut : component swir_bad_pixel_replacer  -- Code to be tested
+	port map (
+		clock => clock,
+		reset_n => reset_n,
+		map_column => map_column,
+		map_bad => map_bad,
+		map_write => map_write,
+		pixel_in => pixel_in,
+		pixel_in_available => pixel_in_available,
+		pixel_out => pixel_out,
+		pixel_out_available => pixel_out_available
+	);
+	
+	stimulus : process
+	begin
+		wait until rising_edge(clock);
+		reset_n <= '1';
+		wait until rising_edge(clock);
+		
+		for map_n in 0 to N_MAPS-1 loop
+			-- Clear the previous map's columns, then mark this one's
+			map_write <= '1';
+			if map_n > 0 then
+				map_bad <= '0';
+				for i in MAP_0'range loop
+					map_column <= MAP_0(i);
+					wait until rising_edge(clock);
+				end loop;
+			end if;
+			map_bad <= '1';
+			for i in 0 to swir_row_width-1 loop
+				if is_bad(map_n, i) then
+					map_column <= i;
+					wait until rising_edge(clock);
+				end if;
+			end loop;
+			map_write <= '0';
+			wait until rising_edge(clock);
+			
+			for row in map_n * ROWS to (map_n + 1) * ROWS - 1 loop
+				for column in 0 to swir_row_width-1 loop
+					pixel_in <= to_pixel(input(row, column));
+					pixel_in_available <= '1';
+					wait until rising_edge(clock);
+					if map_n > 0 then
+						pixel_in_available <= '0';
+						wait until rising_edge(clock);
+						wait until rising_edge(clock);
+					end if;
+				end loop;
+			end loop;
+			pixel_in_available <= '0';
+			-- Let the last pixel out before the map changes
+			for i in 0 to 3 loop
+				wait until rising_edge(clock);
+			end loop;
+		end loop;
+		done <= true;
+		wait;
+	end process stimulus;
+	
+	check_output : process
+		variable pixels			: integer := 0;
+		variable row			: integer;
+		variable column			: integer;
+	begin
+		wait until rising_edge(clock);
+		if pixel_out_available = '1' then
+			row := pixels / swir_row_width;
+			column := pixels mod swir_row_width;
+			assert to_integer(pixel_out) = expected(row / ROWS, row, column)
+				report "Row " & integer'image(row) & ", column " & integer'image(column) & " is " &
+					   integer'image(to_integer(pixel_out)) & ", expected " & integer'image(expected(row / ROWS, row, column))
+				severity error;
+			pixels := pixels + 1;
+		end if;
+		if done then
+			assert pixels = N_MAPS * ROWS * swir_row_width
+				report "Expected " & integer'image(N_MAPS * ROWS * swir_row_width) & " pixels, got " & integer'image(pixels)
+				severity error;
+			stop;
+		end if;
+	end process check_output;
+	
+end architecture sim;
@@ -0,0 +1,419 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+-- Testbench for correlated double sampling (CDS) mode, which connects the SWIR subsystem to the sensor and ADC testbenches
+-- Images ROWS rows back to back with config.cds set, checks every pixel, and measures the CDS throughput
+--
+-- The sensor testbench only outputs signal levels, so here each output is modelled with an offset that drifts from
+--  pixel to pixel, added to its signal level while its sensor clock is low, and a reset level of just the offset
+--  while its sensor clock is high (the second half of each of its pixels). This is an assumption about the sensor,
+--  not something this testbench can show. Each output is sampled on the rising edge of cnv, as on the ADAQ7980
+-- Each pixel has to be the sensor testbench's signal level with the offset taken out, which only happens if its ADC
+--  sampled the signal level and then the reset level of that same pixel, and the two were subtracted
+-- Reports the readout time and pixel rate of each row, and the period and rate of the rows over the whole image
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.swir_types.all;
+
+entity tb_cds is 
+end entity;
+
+architecture sim of tb_cds is 
+	component swir_subsystem is
+	port (
+		clock           	: in std_logic;
+        reset_n         	: in std_logic;
+		
+		start_config		: in std_logic;
+		config_done			: out std_logic;
+        config          	: in swir_config_t;
+        control         	: in swir_control_t;
+			
+        do_imaging      	: in std_logic;
+	
+		-- Signals to SDRAM subsystem
+        pixel           	: out swir_pixel_t;
+        pixel_available 	: out std_logic;
+		
+		-- Signals to ADCs
+		sdi_even			: out std_logic;
+		sdo_even			: in std_logic;
+		cnv_even			: out std_logic;
+		sdi_odd				: out std_logic;
+		sdo_odd				: in std_logic;
+		cnv_odd				: out std_logic;
+		sck					: out std_logic;
+		
+		-- Signals to SWIR sensor
+        sensor_clock_even   : out std_logic;
+		sensor_clock_odd    : out std_logic;
+        sensor_reset_even   : out std_logic;
+		sensor_reset_odd    : out std_logic;
+		Cf_select1			: out std_logic;
+		Cf_select2			: out std_logic;
+		AD_sp_even			: in std_logic;
+		AD_sp_odd			: in std_logic;
+		AD_trig_even		: in std_logic;
+		AD_trig_odd			: in std_logic;
+		
+		-- SWIR Voltage control
+		SWIR_4V0			: out std_logic;	
+		SWIR_1V2			: out std_logic;
+				
+		-- Signals to SWIR Switch
+		sensor_clock		: out std_logic
+	);
+	end component swir_subsystem;
+	
+	component tb_swir_sensor is
+	port (
+		sensor_clock_even   : in std_logic;
+	    sensor_clock_odd    : in std_logic;
+	    sensor_reset_even   : in std_logic;
+	    sensor_reset_odd    : in std_logic;
+	    Cf_select1			: in std_logic;
+	    Cf_select2			: in std_logic;
+	    
+	    AD_sp_even			: out std_logic;
+	    AD_sp_odd			: out std_logic;
+	    AD_trig_even		: out std_logic;
+	    AD_trig_odd			: out std_logic;
+	    
+	    video_even			: out integer;
+	    video_odd			: out integer
+	);
+	end component tb_swir_sensor;
+	
+	component tb_adc is
+	port (
+		sdi				: in std_logic;
+	    sck				: in std_logic;
+	    cnv				: in std_logic;
+	    sdo				: out std_logic;
+	    
+	    video_in		: in integer
+	);
+	end component tb_adc;
+	
+	constant ClockPeriod			:	time := 20 ns;
+	constant ROWS					:	integer := 3;
+	constant RESET_LEVEL			:	integer := 1000;		-- Offset of the first pixel
+	constant DRIFT					:	integer := 97;			-- Change in offset from one pixel to the next
+	
+	-- Samples taken by each ADC, two (signal, then reset level) per pixel: the offset of the pixel each was taken in,
+	--  and for a signal level, the signal level without the offset (-1 for a reset level)
+	type sample_array is array(0 to ROWS*swir_row_width-1) of integer;
+	signal offsets_even				:	sample_array;
+	signal offsets_odd				:	sample_array;
+	signal signals_even				:	sample_array;
+	signal signals_odd				:	sample_array;
+	signal offset_even				:	integer := RESET_LEVEL;
+	signal offset_odd				:	integer := RESET_LEVEL;
+	signal n_samples_even			:	integer := 0;
+	signal n_samples_odd			:	integer := 0;
+	
+	signal fpga_clk					:	std_logic := '0';
+	signal fpga_reset_n				:	std_logic := '0';
+	signal fpga_do_imaging			:	std_logic := '0';
+	signal fpga_pixel				:	swir_pixel_t;
+	signal fpga_pixel_available		:	std_logic;
+	signal fpga_config				:	swir_config_t;
+	signal fpga_control				:   swir_control_t;
+	signal fpga_start_config		:	std_logic := '0';
+	signal fpga_config_done			:   std_logic;
+	
+	signal adc_sdi_even				:	std_logic;
+	signal adc_cnv_even				:	std_logic;
+	signal adc_sdo_even				:	std_logic;
+	signal adc_sdi_odd				:	std_logic;
+	signal adc_cnv_odd				:	std_logic;
+	signal adc_sdo_odd				:	std_logic;
+	signal adc_sck					:	std_logic;
+	signal adc_video_even			:	integer := 0;
+	signal adc_video_odd			:	integer := 0;
+	
+	signal swir_sensor_clock_even	:	std_logic;
+	signal swir_sensor_clock_odd	:	std_logic;
+	signal swir_sensor_reset_even	:	std_logic;
+	signal swir_sensor_reset_odd	:	std_logic;
+	signal swir_Cf_select1			:	std_logic;
+	signal swir_Cf_select2			:	std_logic;
+	signal swir_AD_sp_even			:	std_logic;
+	signal swir_AD_sp_odd			:	std_logic;
+	signal swir_AD_trig_even		:	std_logic;
+	signal swir_AD_trig_odd			:	std_logic;
+	signal swir_video_even			:	integer;
+	signal swir_video_odd			:	integer;
+	signal swir_voltage_4V0			:	std_logic;
+	signal swir_voltage_1V2			:	std_logic;
+	signal swir_select				:	std_logic;
+	
+	pure function to_integer(p : swir_pixel_t) return integer is
+		variable re : integer := 0;
+	begin
+		for i in p'range loop
+			if p(i) = '1' then
+				re := re + 2**i;
+			end if;
+		end loop;
+		return re;
+	end function to_integer;
+	
+	pure function to_seconds(t : time) return real is
+	begin
+		return real(t / 1 ps) * 1.0e-12;
+	end function to_seconds;
+	
+begin
+	
+	fpga_clk <= not fpga_clk after ClockPeriod/2;
+	
+	main_circuit : component swir_subsystem  -- Code to be tested
+	port map (
+		clock           	=>	fpga_clk,
+        reset_n         	=>  fpga_reset_n,
+        
+		start_config		=>	fpga_start_config,
+		config_done			=>	fpga_config_done,
+        config          	=>	fpga_config,
+        control         	=>	fpga_control,
+        
+        do_imaging      	=>	fpga_do_imaging,
+
+        pixel             	=>	fpga_pixel,
+        pixel_available   	=>	fpga_pixel_available,
+		
+		-- Signals to ADCs
+		sdi_even			=>	adc_sdi_even,
+		sdo_even			=>	adc_sdo_even,
+		cnv_even			=>	adc_cnv_even,
+		sdi_odd				=>	adc_sdi_odd,
+		sdo_odd				=>	adc_sdo_odd,
+		cnv_odd				=>	adc_cnv_odd,
+		sck					=>	adc_sck,
+		
+		-- Signals to SWIR sensor
+        sensor_clock_even   =>	swir_sensor_clock_even,
+		sensor_clock_odd    =>  swir_sensor_clock_odd,
+        sensor_reset_even   =>  swir_sensor_reset_even,
+		sensor_reset_odd    =>  swir_sensor_reset_odd,
+		Cf_select1			=>  swir_Cf_select1,
+		Cf_select2			=>  swir_Cf_select2,
+		AD_sp_even			=>	swir_AD_sp_even,
+		AD_sp_odd			=>	swir_AD_sp_odd,
+		AD_trig_even		=>	swir_AD_trig_even,
+		AD_trig_odd			=>	swir_AD_trig_odd,
+		
+		SWIR_4V0			=>	swir_voltage_4V0,
+		SWIR_1V2			=>	swir_voltage_1V2,
+		
+		sensor_clock		=>	swir_select
+	);
+	
+	g11508 : component tb_swir_sensor  -- Testbench
+	port map(
+		sensor_clock_even   =>	swir_sensor_clock_even,
+	    sensor_clock_odd    =>	swir_sensor_clock_odd,
+	    sensor_reset_even   =>	swir_sensor_reset_even,
+	    sensor_reset_odd    =>	swir_sensor_reset_odd,
+	    Cf_select1			=>	swir_Cf_select1,
+	    Cf_select2			=>	swir_Cf_select2,
+	    
+	    AD_sp_even			=>	swir_AD_sp_even,
+	    AD_sp_odd			=>  swir_AD_sp_odd,
+	    AD_trig_even		=>  swir_AD_trig_even,
+	    AD_trig_odd			=>  swir_AD_trig_odd,
+		
+	    video_even			=>	swir_video_even,
+	    video_odd			=>  swir_video_odd
+	);
+	
+	adaq7980_even : component tb_adc	 -- Testbench
+	port map(
+		sdi					=>	adc_sdi_even,
+	    sck					=>  adc_sck,	
+	    cnv					=>  adc_cnv_even,	
+	    sdo					=>  adc_sdo_even,	
+		                        
+	    video_in			=>	adc_video_even
+	);
+	
+	adaq7980_odd : component tb_adc	 -- Testbench
+	port map(
+		sdi					=>	adc_sdi_odd,
+	    sck					=>  adc_sck,	
+	    cnv					=>  adc_cnv_odd,	
+	    sdo					=>  adc_sdo_odd,	
+		                        
+	    video_in			=>	adc_video_odd
+	);
+	
+	-- Each output's offset changes at the start of each of its pixels, on the falling edge of its sensor clock
+	process(swir_sensor_clock_even) is
+		variable pixels : integer := 0;
+	begin
+		if falling_edge(swir_sensor_clock_even) then
+			pixels := pixels + 1;
+			offset_even <= RESET_LEVEL + DRIFT * (pixels mod 32);
+		end if;
+	end process;
+	
+	process(swir_sensor_clock_odd) is
+		variable pixels : integer := 0;
+	begin
+		if falling_edge(swir_sensor_clock_odd) then
+			pixels := pixels + 1;
+			offset_odd <= RESET_LEVEL + DRIFT * (pixels mod 32);
+		end if;
+	end process;
+	
+	-- Sample each output on the rising edge of cnv (signal level plus offset while its sensor clock is low, offset
+	-- alone while high) and record the sample for the pixel check
+	process(adc_cnv_even) is
+		variable video : integer;
+	begin
+		if rising_edge(adc_cnv_even) and adc_sdi_even = '1' then
+			if swir_sensor_clock_even = '0' then
+				video := minimum(swir_video_even + offset_even, 65535);
+			else
+				video := offset_even;
+			end if;
+			adc_video_even <= video;
+			if n_samples_even < offsets_even'length then
+				offsets_even(n_samples_even) <= offset_even;
+				signals_even(n_samples_even) <= video - offset_even when swir_sensor_clock_even = '0' else -1;
+			end if;
+			n_samples_even <= n_samples_even + 1;
+		end if;
+	end process;
+	
+	process(adc_cnv_odd) is
+		variable video : integer;
+	begin
+		if rising_edge(adc_cnv_odd) and adc_sdi_odd = '1' then
+			if swir_sensor_clock_odd = '0' then
+				video := minimum(swir_video_odd + offset_odd, 65535);
+			else
+				video := offset_odd;
+			end if;
+			adc_video_odd <= video;
+			if n_samples_odd < offsets_odd'length then
+				offsets_odd(n_samples_odd) <= offset_odd;
+				signals_odd(n_samples_odd) <= video - offset_odd when swir_sensor_clock_odd = '0' else -1;
+			end if;
+			n_samples_odd <= n_samples_odd + 1;
+		end if;
+	end process;
+	
+	-- Stimulus, as in tb_fpga.vhd: reset, configure for back to back frames with CDS on, then image
+	process is
+	begin
+		fpga_control.volt_conv <= '1';
+		fpga_config <= (frame_clocks => -1, exposure_clocks => 64*7, length => ROWS, coadd_rows => 1, cds => '1');
+		
+		-- Take the DUT out of reset
+		fpga_reset_n <= '1';
+		wait for 13 ns;
+		fpga_reset_n <= '0';
+		wait for 2500 ns;
+		fpga_reset_n <= '1';
+		
+		wait until rising_edge(fpga_clk);
+		wait for ClockPeriod*100;
+		wait until rising_edge(fpga_clk);
+		fpga_start_config <= '1';
+		wait until rising_edge(fpga_clk);
+		fpga_start_config <= '0';
+		
+		wait for ClockPeriod*50;
+		wait until rising_edge(fpga_clk);
+		fpga_do_imaging <= '1';
+		wait until rising_edge(fpga_clk);
+		fpga_do_imaging <= '0';
+		wait;
+	end process;
+	
+	-- Check each pixel and measure throughput
+	-- Pixel n of the image is odd when n is even (the first pixel is odd), and is the (n/2)th pixel of its ADC
+	process is
+		variable n_pixels		: integer := 0;
+		variable sample			: integer;
+		variable expected		: integer;
+		variable reset_sample	: integer;
+		variable signal_offset	: integer;
+		variable reset_offset	: integer;
+		variable row_start		: time;
+		variable image_start	: time;
+		variable row_time		: time;
+		variable row_period		: time;
+	begin
+		wait until rising_edge(fpga_clk);
+		if fpga_pixel_available = '1' then
+			sample := 2 * (n_pixels / 2);
+			if n_pixels mod 2 = 0 then
+				expected := signals_odd(sample);
+				reset_sample := signals_odd(sample + 1);
+				signal_offset := offsets_odd(sample);
+				reset_offset := offsets_odd(sample + 1);
+			else
+				expected := signals_even(sample);
+				reset_sample := signals_even(sample + 1);
+				signal_offset := offsets_even(sample);
+				reset_offset := offsets_even(sample + 1);
+			end if;
+			
+			assert expected >= 0 and reset_sample = -1
+				report "Pixel " & integer'image(n_pixels) & " was not sampled at its signal level and then its reset level"
+				severity error;
+			assert signal_offset = reset_offset
+				report "Pixel " & integer'image(n_pixels) & "'s reset level was sampled in another pixel" severity error;
+			assert to_integer(fpga_pixel) = expected
+				report "Pixel " & integer'image(n_pixels) & " is " & integer'image(to_integer(fpga_pixel)) &
+					   ", expected " & integer'image(expected) severity error;
+			
+			if n_pixels mod swir_row_width = 0 then
+				row_start := now;
+				if n_pixels = 0 then
+					image_start := now;
+				end if;
+			elsif n_pixels mod swir_row_width = swir_row_width - 1 then
+				row_time := now - row_start;
+				report "Row " & integer'image(n_pixels / swir_row_width) & " read out in " & time'image(row_time) &
+					   " (" & real'image(real(swir_row_width) / to_seconds(row_time)) & " pixels/s)";
+			end if;
+			n_pixels := n_pixels + 1;
+			
+			if n_pixels = ROWS * swir_row_width then
+				assert n_samples_odd = ROWS * swir_row_width and n_samples_even = ROWS * swir_row_width
+					report "Expected " & integer'image(ROWS * swir_row_width) & " samples from each ADC, got " &
+						   integer'image(n_samples_odd) & " odd and " & integer'image(n_samples_even) & " even" severity error;
+				row_period := (row_start - image_start) / (ROWS - 1);
+				report integer'image(ROWS) & " rows imaged in " & time'image(now - image_start) & ", row period " &
+					   time'image(row_period) & " (" & real'image(1.0 / to_seconds(row_period)) & " rows/s, " &
+					   real'image(real(swir_row_width) / to_seconds(row_period)) & " pixels/s)";
+				stop;
+			end if;
+		end if;
+	end process;
+	
+end architecture;
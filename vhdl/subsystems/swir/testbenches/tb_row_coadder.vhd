@@ -0,0 +1,203 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+-- Testbench for swir_row_coadder
+-- Sends each image in IMAGES, pulsing start before it, and checks that each group of coadd_rows rows comes out as
+--  one row of the column averages (rounded down), in order, and that nothing else does:
+--		The first image has a row left over, which has to be discarded, and the next image has to start a new
+--			group anyway rather than adding its first rows to it
+--		A group of swir_max_coadd_rows rows of pixels near full scale, whose sums need every bit
+--		coadd_rows = 1, where rows have to be passed through unchanged
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.swir_types.all;
+
+entity tb_row_coadder is
+end entity;
+
+architecture sim of tb_row_coadder is
+	component swir_row_coadder is
+	port (
+		clock               : in std_logic;
+		reset_n             : in std_logic;
+
+		coadd_rows          : in integer range 1 to swir_max_coadd_rows;
+		start               : in std_logic;
+
+		pixel_in            : in swir_pixel_t;
+		pixel_in_available  : in std_logic;
+		pixel_out           : out swir_pixel_t;
+		pixel_out_available : out std_logic
+	);
+	end component swir_row_coadder;
+
+	constant ClockPeriod			:	time := 20 ns;
+
+	-- Rows co-added into each one, and rows sent, of each image
+	type image_t is record
+		coadd					:	integer;
+		rows					:	integer;
+	end record image_t;
+	type image_array is array(natural range <>) of image_t;
+	constant IMAGES					:	image_array := (
+		(coadd => 3, rows => 7),
+		(coadd => 4, rows => 4),
+		(coadd => swir_max_coadd_rows, rows => swir_max_coadd_rows),
+		(coadd => 1, rows => 2)
+	);
+
+	signal clock					:	std_logic := '0';
+	signal reset_n					:	std_logic := '0';
+	signal coadd_rows				:	integer range 1 to swir_max_coadd_rows := 1;
+	signal start					:	std_logic := '0';
+	signal pixel_in					:	swir_pixel_t;
+	signal pixel_in_available		:	std_logic := '0';
+	signal pixel_out				:	swir_pixel_t;
+	signal pixel_out_available		:	std_logic;
+	signal pixels_out				:	integer := 0;
+	signal checked					:	boolean := false;
+
+	-- Near full scale, so the sums of a full group overflow 16 bits
+	pure function input(image : integer; row : integer; column : integer) return integer is
+	begin
+		return 65535 - (row * 4099 + column * 131 + image * 17) mod 8192;
+	end function input;
+
+	-- Average of a group's column, rounded down
+	pure function average(image : integer; group : integer; column : integer) return integer is
+		variable sum			: integer := 0;
+	begin
+		for row in group * IMAGES(image).coadd to (group + 1) * IMAGES(image).coadd - 1 loop
+			sum := sum + input(image, row, column);
+		end loop;
+		return sum / IMAGES(image).coadd;
+	end function average;
+
+	pure function total_pixels return integer is
+		variable pixels			: integer := 0;
+	begin
+		for i in IMAGES'range loop
+			pixels := pixels + IMAGES(i).rows / IMAGES(i).coadd * swir_row_width;
+		end loop;
+		return pixels;
+	end function total_pixels;
+
+	pure function to_pixel(value : integer) return swir_pixel_t is
+		variable bits			: unsigned(swir_pixel_bits-1 downto 0);
+		variable pixel			: swir_pixel_t;
+	begin
+		bits := to_unsigned(value, swir_pixel_bits);
+		for i in pixel'range loop
+			pixel(i) := bits(i);
+		end loop;
+		return pixel;
+	end function to_pixel;
+
+	pure function to_integer(pixel : swir_pixel_t) return integer is
+		variable bits			: unsigned(swir_pixel_bits-1 downto 0);
+	begin
+		for i in pixel'range loop
+			bits(i) := pixel(i);
+		end loop;
+		return to_integer(bits);
+	end function to_integer;
+
+begin
+
+	clock <= not clock after ClockPeriod / 2;
+
+	dut : component swir_row_coadder  -- Code to be tested
+	port map (
+		clock => clock,
+		reset_n => reset_n,
+		coadd_rows => coadd_rows,
+		start => start,
+		pixel_in => pixel_in,
+		pixel_in_available => pixel_in_available,
+		pixel_out => pixel_out,
+		pixel_out_available => pixel_out_available
+	);
+
+	stimulus : process
+	begin
+		wait until rising_edge(clock);
+		reset_n <= '1';
+		wait until rising_edge(clock);
+
+		for i in IMAGES'range loop
+			coadd_rows <= IMAGES(i).coadd;
+			start <= '1';
+			wait until rising_edge(clock);
+			start <= '0';
+			wait until rising_edge(clock);
+			-- Pixels come in every other clock cycle, as from the SWIR subsystem
+			for row in 0 to IMAGES(i).rows-1 loop
+				for column in 0 to swir_row_width-1 loop
+					pixel_in <= to_pixel(input(i, row, column));
+					pixel_in_available <= '1';
+					wait until rising_edge(clock);
+					pixel_in_available <= '0';
+					wait until rising_edge(clock);
+				end loop;
+			end loop;
+			for j in 1 to 10 loop
+				wait until rising_edge(clock);
+			end loop;
+		end loop;
+
+		assert checked report "Not every co-added row came out" severity error;
+		assert pixels_out = total_pixels
+			report integer'image(pixels_out) & " pixels came out, expected " & integer'image(total_pixels)
+			severity error;
+		report "Co-adder test done";
+		stop;
+	end process stimulus;
+
+	count_output : process
+	begin
+		wait until rising_edge(clock);
+		if pixel_out_available = '1' then
+			pixels_out <= pixels_out + 1;
+		end if;
+	end process count_output;
+
+	check_output : process
+	begin
+		for i in IMAGES'range loop
+			for group in 0 to IMAGES(i).rows / IMAGES(i).coadd - 1 loop
+				for column in 0 to swir_row_width-1 loop
+					wait until rising_edge(clock) and pixel_out_available = '1';
+					assert to_integer(pixel_out) = average(i, group, column)
+						report "Image " & integer'image(i) & ", row " & integer'image(group) & ": pixel " &
+							   integer'image(column) & " is " & integer'image(to_integer(pixel_out)) & ", expected " &
+							   integer'image(average(i, group, column))
+						severity error;
+				end loop;
+			end loop;
+		end loop;
+		checked <= true;
+		wait;
+	end process check_output;
+
+end architecture sim;
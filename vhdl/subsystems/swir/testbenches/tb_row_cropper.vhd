@@ -0,0 +1,174 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+-- Testbench for swir_row_cropper
+-- Sends a row with each crop in CROPS, starting on and off SDRAM word boundaries and ending on the last column of
+--  the row, then a row with the whole row kept, and checks that exactly the cropped columns are passed on, in order
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.swir_types.all;
+
+entity tb_row_cropper is 
+end entity;
+
+architecture sim of tb_row_cropper is 
+	component swir_row_cropper is
+	port (
+		clock               : in std_logic;
+		reset_n             : in std_logic;
+
+		crop_start          : in integer range 0 to swir_row_width-1;
+		crop_width          : in integer range 0 to swir_row_width;
+
+		pixel_in            : in swir_pixel_t;
+		pixel_in_available  : in std_logic;
+		pixel_out           : out swir_pixel_t;
+		pixel_out_available : out std_logic
+	);
+	end component swir_row_cropper;
+	
+	constant ClockPeriod			:	time := 20 ns;
+	
+	-- Start and width of the crop of each row
+	type crop_t is record
+		start					:	integer;
+		width					:	integer;
+	end record crop_t;
+	type crop_array is array(natural range <>) of crop_t;
+	constant CROPS					:	crop_array := (
+		(start => 16, width => 64),
+		(start => 3, width => 40),
+		(start => swir_row_width - 43, width => 40),
+		(start => swir_row_width - 8, width => 8),
+		(start => 0, width => swir_row_width)
+	);
+	
+	signal clock					:	std_logic := '0';
+	signal reset_n					:	std_logic := '0';
+	signal crop_start				:	integer range 0 to swir_row_width-1 := 0;
+	signal crop_width				:	integer range 0 to swir_row_width := swir_row_width;
+	signal pixel_in					:	swir_pixel_t;
+	signal pixel_in_available		:	std_logic := '0';
+	signal pixel_out				:	swir_pixel_t;
+	signal pixel_out_available		:	std_logic;
+	signal row						:	integer := 0;
+	signal row_done					:	boolean := false;
+	signal done						:	boolean := false;
+	
+	pure function input(row : integer; column : integer) return integer is
+	begin
+		return row * swir_row_width + column;
+	end function input;
+	
+	pure function to_pixel(value : integer) return swir_pixel_t is
+		variable bits			: unsigned(swir_pixel_bits-1 downto 0);
+		variable pixel			: swir_pixel_t;
+	begin
+		bits := to_unsigned(value, swir_pixel_bits);
+		for i in pixel'range loop
+			pixel(i) := bits(i);
+		end loop;
+		return pixel;
+	end function to_pixel;
+	
+	pure function to_integer(pixel : swir_pixel_t) return integer is
+		variable bits			: unsigned(swir_pixel_bits-1 downto 0);
+	begin
+		for i in pixel'range loop
+			bits(i) := pixel(i);
+		end loop;
+		return to_integer(bits);
+	end function to_integer;
+	
+begin
+	
+	clock <= not clock after ClockPeriod / 2;
+	
+	dut : component swir_row_cropper  -- Code to be tested
+	port map (
+		clock => clock,
+		reset_n => reset_n,
+		crop_start => crop_start,
+		crop_width => crop_width,
+		pixel_in => pixel_in,
+		pixel_in_available => pixel_in_available,
+		pixel_out => pixel_out,
+		pixel_out_available => pixel_out_available
+	);
+	
+	stimulus : process
+	begin
+		wait until rising_edge(clock);
+		reset_n <= '1';
+		wait until rising_edge(clock);
+		
+		for r in CROPS'range loop
+			row <= r;
+			crop_start <= CROPS(r).start;
+			crop_width <= CROPS(r).width;
+			wait until rising_edge(clock);
+			-- Pixels come in every other clock cycle, as from the SWIR subsystem
+			for column in 0 to swir_row_width-1 loop
+				pixel_in <= to_pixel(input(r, column));
+				pixel_in_available <= '1';
+				wait until rising_edge(clock);
+				pixel_in_available <= '0';
+				wait until rising_edge(clock);
+			end loop;
+			wait until rising_edge(clock);
+			row_done <= true;
+			wait until rising_edge(clock);
+			row_done <= false;
+		end loop;
+		done <= true;
+		wait;
+	end process stimulus;
+	
+	check_output : process
+		variable pixels			: integer := 0;
+	begin
+		wait until rising_edge(clock);
+		if pixel_out_available = '1' then
+			assert pixels < CROPS(row).width
+				report "Row " & integer'image(row) & ": more than " & integer'image(CROPS(row).width) & " pixels"
+				severity error;
+			assert to_integer(pixel_out) = input(row, CROPS(row).start + pixels)
+				report "Row " & integer'image(row) & ": pixel " & integer'image(pixels) & " is " &
+					   integer'image(to_integer(pixel_out)) & ", expected " & integer'image(input(row, CROPS(row).start + pixels))
+				severity error;
+			pixels := pixels + 1;
+		end if;
+		if row_done then
+			assert pixels = CROPS(row).width
+				report "Row " & integer'image(row) & ": expected " & integer'image(CROPS(row).width) & " pixels, got " &
+					   integer'image(pixels)
+				severity error;
+			pixels := 0;
+		end if;
+		if done then
+			stop;
+		end if;
+	end process check_output;
+	
+end architecture sim;
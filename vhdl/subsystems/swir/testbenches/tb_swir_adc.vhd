@@ -0,0 +1,238 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+-- Testbench for the deserializer of swir_adc.vhd, which connects it to the ADC testbench
+-- Converts a different value on each adc_start pulse and checks every sample read out of the FIFO against it,
+--  along with its sequence tag, in three parts:
+--		Samples started well apart, read as soon as they are in the FIFO
+--		Pairs of adc_start pulses, the second coming in while the first sample is still being converted or read
+--			out, so it has to be remembered and start the next conversion once the readout is done
+--		A burst of samples while the FIFO isn't read, so it fills up and the last ones are dropped. The samples
+--			that fit have to come out in order, and the first one after them has to show the dropped ones as a
+--			gap in the sequence tags
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+entity tb_swir_adc is
+end entity;
+
+architecture sim of tb_swir_adc is
+	component swir_adc is
+	port (
+		clock_adc	      	: in std_logic;
+		clock_main			: in std_logic;
+        reset_n         	: in std_logic;
+
+		adc_trigger			: in std_logic;
+		adc_start			: in std_logic;
+
+		sdi					: out std_logic;
+		cnv					: out std_logic;
+		sdo					: in std_logic;
+
+		fifo_rdreq			: in std_logic;
+		fifo_rdempty		: out std_logic;
+		fifo_data_read		: out std_logic_vector(15 downto 0);
+		fifo_sequence		: out unsigned(3 downto 0)
+    );
+	end component swir_adc;
+
+	component tb_adc is
+	port (
+		sdi				: in std_logic;
+	    sck				: in std_logic;
+	    cnv				: in std_logic;
+	    sdo				: out std_logic;
+
+	    video_in		: in integer
+	);
+	end component tb_adc;
+
+	constant ClockPeriod			:	time := 20 ns;			-- 50 MHz main clock
+	constant AdcClockPeriod			:	time := 22.857 ns;		-- 43.75 MHz ADC clock
+	constant SamplePeriod			:	time := 1600 ns;		-- Longer than a conversion and readout
+	constant PairGap				:	time := 900 ns;			-- Shorter than a conversion and readout
+
+	constant SPACED_SAMPLES			:	integer := 20;
+	constant PAIRS					:	integer := 10;
+	constant BURST_SAMPLES			:	integer := 20;			-- More than the FIFO holds, fewer than 16 more
+	constant TOTAL_SAMPLES			:	integer := SPACED_SAMPLES + 2*PAIRS + BURST_SAMPLES + 1;
+
+	-- Value converted on each adc_start pulse
+	type sample_array is array(0 to TOTAL_SAMPLES-1) of integer;
+	signal sent						:	sample_array;
+	signal n_sent					:	integer := 0;
+
+	signal clock_main				:	std_logic := '0';
+	signal clock_adc				:	std_logic := '0';
+	signal reset_n					:	std_logic := '0';
+	signal adc_start				:	std_logic := '0';
+	signal sdi						:	std_logic;
+	signal cnv						:	std_logic;
+	signal sdo						:	std_logic;
+	signal video					:	integer := 0;
+
+	signal fifo_rdreq				:	std_logic;
+	signal fifo_rdempty				:	std_logic;
+	signal fifo_data_read			:	std_logic_vector(15 downto 0);
+	signal fifo_sequence			:	unsigned(3 downto 0);
+	signal reading					:	std_logic := '1';		-- The FIFO is read as soon as it isn't empty
+	signal sample_valid				:	std_logic := '0';
+
+	signal n_read					:	integer := 0;			-- Index of the next sample expected out of the FIFO
+	signal n_received				:	integer := 0;
+	signal n_dropped				:	integer := 0;
+
+	-- A different value for each sample, with both high and low bits changing
+	pure function sample_value(n : integer) return integer is
+	begin
+		return (n * 40503 + 12345) mod 65536;
+	end function sample_value;
+
+begin
+
+	clock_main <= not clock_main after ClockPeriod/2;
+	clock_adc <= not clock_adc after AdcClockPeriod/2;
+
+	uut : component swir_adc  -- Code to be tested
+	port map (
+		clock_adc			=>	clock_adc,
+		clock_main			=>	clock_main,
+		reset_n				=>	reset_n,
+
+		adc_trigger			=>	'0',
+		adc_start			=>	adc_start,
+
+		sdi					=>	sdi,
+		cnv					=>	cnv,
+		sdo					=>	sdo,
+
+		fifo_rdreq			=>	fifo_rdreq,
+		fifo_rdempty		=>	fifo_rdempty,
+		fifo_data_read		=>	fifo_data_read,
+		fifo_sequence		=>	fifo_sequence
+	);
+
+	adaq7980 : component tb_adc	 -- Testbench
+	port map(
+		sdi					=>	sdi,
+	    sck					=>  clock_adc,
+	    cnv					=>  cnv,
+	    sdo					=>  sdo,
+
+	    video_in			=>	video
+	);
+
+	-- Read the FIFO the way swir_subsystem.vhd does: whenever it isn't empty, with the data valid a clock cycle later
+	fifo_rdreq <= '1' when reading = '1' and fifo_rdempty = '0' and reset_n = '1' else '0';
+
+	process(clock_main) is
+		variable index		: integer;
+	begin
+		if rising_edge(clock_main) then
+			sample_valid <= fifo_rdreq;
+
+			if sample_valid = '1' then
+				-- The sequence tag counts every sample modulo 16, so a gap in it is the number of samples dropped
+				index := n_read + to_integer(fifo_sequence - to_unsigned(n_read mod 16, 4));
+
+				assert index < n_sent report "Sample " & integer'image(index) & " read out before it was started" severity failure;
+				assert to_integer(unsigned(fifo_data_read)) = sent(index)
+					report "Sample " & integer'image(index) & " read as " & integer'image(to_integer(unsigned(fifo_data_read)))
+						& " instead of " & integer'image(sent(index))
+					severity error;
+
+				n_dropped <= n_dropped + index - n_read;
+				n_received <= n_received + 1;
+				n_read <= index + 1;
+			end if;
+		end if;
+	end process;
+
+	process is
+		-- Set the value to convert and pulse adc_start, which is synchronised to the ADC clock like the sensor's is
+		procedure start_sample is
+		begin
+			sent(n_sent) <= sample_value(n_sent);
+			video <= sample_value(n_sent);
+			n_sent <= n_sent + 1;
+			adc_start <= '1';
+			wait for ClockPeriod * 10;
+			adc_start <= '0';
+		end procedure start_sample;
+	begin
+		reset_n <= '0';
+		wait for ClockPeriod * 20;
+		reset_n <= '1';
+		wait for ClockPeriod * 20;
+
+		-- Samples well apart
+		for i in 1 to SPACED_SAMPLES loop
+			start_sample;
+			wait for SamplePeriod - ClockPeriod * 10;
+		end loop;
+		wait for SamplePeriod;
+		assert n_received = SPACED_SAMPLES and n_dropped = 0
+			report "Only " & integer'image(n_received) & " of " & integer'image(SPACED_SAMPLES) & " spaced samples came out"
+			severity error;
+
+		-- Pairs of samples, the second one started during the first one's conversion or readout. Both are
+		--  converted from the same value, as the ADC testbench only holds one
+		for i in 1 to PAIRS loop
+			start_sample;
+			wait for PairGap - ClockPeriod * 10;
+			sent(n_sent) <= video;
+			n_sent <= n_sent + 1;
+			adc_start <= '1';
+			wait for ClockPeriod * 10;
+			adc_start <= '0';
+			wait for 2 * SamplePeriod;
+		end loop;
+		assert n_received = SPACED_SAMPLES + 2*PAIRS and n_dropped = 0
+			report "A sample started during the previous one's readout was lost" severity error;
+
+		-- A burst while the FIFO isn't read
+		reading <= '0';
+		for i in 1 to BURST_SAMPLES loop
+			start_sample;
+			wait for SamplePeriod - ClockPeriod * 10;
+		end loop;
+		wait for SamplePeriod;
+		reading <= '1';
+		wait for SamplePeriod;
+
+		-- One more sample, whose tag has to show the gap
+		start_sample;
+		wait for 2 * SamplePeriod;
+
+		assert n_dropped > 0 report "The FIFO never filled up" severity error;
+		assert n_read = TOTAL_SAMPLES report "The last sample wasn't read out" severity error;
+		assert n_received + n_dropped = TOTAL_SAMPLES
+			report integer'image(n_received) & " samples came out and " & integer'image(n_dropped) & " were dropped, out of "
+				& integer'image(TOTAL_SAMPLES)
+			severity error;
+		report integer'image(n_dropped) & " of " & integer'image(BURST_SAMPLES) & " burst samples were dropped while the FIFO was full";
+
+		report "Deserializer test done";
+		stop;
+	end process;
+
+end architecture;
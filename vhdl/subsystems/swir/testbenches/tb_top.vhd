@@ -42,11 +42,14 @@ architecture sim of tb_top is
         pixel           	: out swir_pixel_t;
         pixel_available 	: out std_logic;
 		
-		-- Signals to ADC
-		sdi					: out std_logic;
-		sdo					: in std_logic;
+		-- Signals to ADCs
+		sdi_even			: out std_logic;
+		sdo_even			: in std_logic;
+		cnv_even			: out std_logic;
+		sdi_odd				: out std_logic;
+		sdo_odd				: in std_logic;
+		cnv_odd				: out std_logic;
 		sck					: out std_logic;
-		cnv					: out std_logic;
 		
 		-- Signals to SWIR sensor
         sensor_clock_even   : out std_logic;
@@ -116,15 +119,6 @@ architecture sim of tb_top is
 	);
 	end component tb_fpga;
 	
-	component tb_switch is
-	port (
-		s1					: in integer;
-		s2					: in integer;
-        in_pin			  	: in std_logic;
-		d				    : out integer
-    );
-	end component tb_switch;
-	
 	signal fpga_clk					:	std_logic;
 	signal fpga_reset_n				:	std_logic;
 	signal fpga_do_imaging			:	std_logic;
@@ -135,10 +129,13 @@ architecture sim of tb_top is
 	signal fpga_start_config		:	std_logic;
 	signal fpga_config_done			:   std_logic;
 	
-	signal adc_sdi					:	std_logic;
+	signal adc_sdi_even				:	std_logic;
+	signal adc_cnv_even				:	std_logic;
+	signal adc_sdo_even				:	std_logic;
+	signal adc_sdi_odd				:	std_logic;
+	signal adc_cnv_odd				:	std_logic;
+	signal adc_sdo_odd				:	std_logic;
 	signal adc_sck					:	std_logic;
-	signal adc_cnv					:	std_logic;
-	signal adc_sdo					:	std_logic;
 	
 	signal swir_sensor_clock_even	:	std_logic;
 	signal swir_sensor_clock_odd	:	std_logic;
@@ -155,7 +152,6 @@ architecture sim of tb_top is
 	signal swir_voltage_4V0			:	std_logic;
 	signal swir_voltage_1V2			:	std_logic;
 	signal swir_select				:	std_logic;
-	signal swir_video				:	integer;
 	
 begin
 	
@@ -174,11 +170,14 @@ begin
         pixel             	=>	fpga_pixel,
         pixel_available   	=>	fpga_pixel_available,
 		
-		-- Signals to ADC
-		sdi					=>	adc_sdi,
-		sdo					=>	adc_sdo,
+		-- Signals to ADCs
+		sdi_even			=>	adc_sdi_even,
+		sdo_even			=>	adc_sdo_even,
+		cnv_even			=>	adc_cnv_even,
+		sdi_odd				=>	adc_sdi_odd,
+		sdo_odd				=>	adc_sdo_odd,
+		cnv_odd				=>	adc_cnv_odd,
 		sck					=>	adc_sck,
-		cnv					=>	adc_cnv,
 		
 		-- Signals to SWIR sensor
         sensor_clock_even   =>	swir_sensor_clock_even,
@@ -216,14 +215,24 @@ begin
 	    video_odd			=>  swir_video_odd
 	);
 	
-	adaq7980 : component tb_adc	 -- Testbench
+	adaq7980_even : component tb_adc	 -- Testbench
 	port map(
-		sdi					=>	adc_sdi,
+		sdi					=>	adc_sdi_even,
 	    sck					=>  adc_sck,	
-	    cnv					=>  adc_cnv,	
-	    sdo					=>  adc_sdo,	
+	    cnv					=>  adc_cnv_even,	
+	    sdo					=>  adc_sdo_even,	
 		                        
-	    video_in			=>	swir_video
+	    video_in			=>	swir_video_even
+	);
+	
+	adaq7980_odd : component tb_adc	 -- Testbench
+	port map(
+		sdi					=>	adc_sdi_odd,
+	    sck					=>  adc_sck,	
+	    cnv					=>  adc_cnv_odd,	
+	    sdo					=>  adc_sdo_odd,	
+		                        
+	    video_in			=>	swir_video_odd
 	);
 	
 	fpga_to_swir_subsystem : component tb_fpga  -- Testbench
@@ -242,13 +251,5 @@ begin
         pixel_available   	=>  fpga_pixel_available
 	);
 
-	adg719brmz : component tb_switch
-	port map(
-		s1					=> swir_video_odd,
-		s2					=> swir_video_even,
-        in_pin			  	=> swir_select,
-		d				    => swir_video
-    );
-
 
 end architecture;
\ No newline at end of file
@@ -0,0 +1,273 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+-- Replaces the pixels of defective columns with the mean of their
+-- neighbours, in the fragment stream emitted by `pixel_integrator`.
+--
+-- A bitmap of bad columns is kept for each window (band). Since
+-- fragment f holds pixels f, f + FRAGMENTS_PER_ROW, ... (one pixel
+-- from each of the sensor's LVDS channels), the bitmap is stored as
+-- one FRAGMENT_WIDTH-bit mask per fragment, with bit i of the mask of
+-- fragment f set when column f + i*FRAGMENTS_PER_ROW is bad. A mask is
+-- written by setting `map_window`, `map_index` and `map_mask`, and
+-- asserting `map_write` for a single clock cycle. The bitmaps aren't
+-- initialized, so every mask must be written before `enable` is set.
+--
+-- The neighbours of column x = f + i*FRAGMENTS_PER_ROW are lane i of
+-- fragments f-1 and f+1, so each fragment is held until the next one
+-- comes in. A bad pixel is replaced with the mean of whichever of its
+-- neighbours are available and not bad themselves, or left as is if
+-- neither is. The left neighbour of the pixels of fragment 0 (and the
+-- right neighbour of those of the last fragment) is in another
+-- fragment at the other end of the row, so only the other neighbour is
+-- used for them. The last fragment of a row is sent out as soon as it
+-- has been looked up, without waiting for the next row.
+--
+-- Fragments are input and output through the same signals as
+-- `radiometric_corrector`. A fragment can be input on every clock
+-- cycle. When `enable` is '0', fragments are passed through unchanged.
+entity bad_pixel_replacer is
+generic (
+    ROW_WIDTH           : integer;
+    FRAGMENT_WIDTH      : integer;
+    ROW_PIXEL_BITS      : integer;
+    N_WINDOWS           : integer
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    enable              : in std_logic;
+
+    map_window          : in integer;
+    map_index           : in integer;
+    map_mask            : in std_logic_vector(FRAGMENT_WIDTH-1 downto 0);
+    map_write           : in std_logic;
+
+    fragment            : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    fragment_index      : in integer;
+    fragment_window     : in integer;
+
+    row_fragment        : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_fragment_index  : out integer;
+    row_fragment_window : out integer
+);
+end entity bad_pixel_replacer;
+
+
+architecture rtl of bad_pixel_replacer is
+
+    component pixel_integrator_fifo is
+    generic (
+        WORD_SIZE       : integer;
+        ADDRESS_SIZE    : integer
+    );
+    port (
+        clock           : in std_logic;
+        read_data       : out std_logic_vector;
+        read_address    : in std_logic_vector;
+        read_enable     : in std_logic;
+        write_data      : in std_logic_vector;
+        write_address   : in std_logic_vector;
+        write_enable    : in std_logic
+    );
+    end component pixel_integrator_fifo;
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant ADDRESS_BITS : integer := integer(ceil(log2(real(N_WINDOWS * FRAGMENTS_PER_ROW))));
+
+    subtype fragment_t is pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    subtype mask_t is std_logic_vector(FRAGMENT_WIDTH-1 downto 0);
+
+    pure function to_address(window : integer; i_fragment : integer) return std_logic_vector is
+    begin
+        return std_logic_vector(to_unsigned(FRAGMENTS_PER_ROW * window + i_fragment, ADDRESS_BITS));
+    end function to_address;
+
+    -- Replaces the bad pixels of `pixels` with the mean of their good
+    -- neighbours. A neighbour can be used when its fragment is
+    -- available and its own bit in the mask is clear.
+    pure function replace(
+        pixels      : fragment_t;
+        mask        : mask_t;
+        left        : fragment_t;
+        left_good   : mask_t;
+        right       : fragment_t;
+        right_good  : mask_t
+    ) return fragment_t is
+        variable re : fragment_t;
+        variable sum : unsigned(ROW_PIXEL_BITS downto 0);
+    begin
+        re := pixels;
+        for i in pixels'range loop
+            if mask(i) = '1' then
+                if left_good(i) = '1' and right_good(i) = '1' then
+                    sum := resize(left(i), ROW_PIXEL_BITS+1) + right(i) + 1;
+                    re(i) := sum(ROW_PIXEL_BITS downto 1);
+                elsif left_good(i) = '1' then
+                    re(i) := left(i);
+                elsif right_good(i) = '1' then
+                    re(i) := right(i);
+                end if;
+            end if;
+        end loop;
+        return re;
+    end function replace;
+
+    -- RAM signals
+    signal read_data        : std_logic_vector(FRAGMENT_WIDTH-1 downto 0);
+    signal read_address     : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal read_enable      : std_logic;
+    signal write_data       : std_logic_vector(FRAGMENT_WIDTH-1 downto 0);
+    signal write_address    : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal write_enable     : std_logic;
+
+    -- Pipeline stage 0 output
+    signal fragment_c0      : fragment_t;
+    signal index_c0         : integer;
+    signal window_c0        : integer;
+    -- Pipeline stage 1 output
+    signal fragment_c1      : fragment_t;
+    signal index_c1         : integer;
+    signal window_c1        : integer;
+
+    -- Fragment waiting on its right neighbour (cur), and the one before it (prev)
+    signal cur_fragment     : fragment_t;
+    signal cur_mask         : mask_t;
+    signal cur_index        : integer;
+    signal cur_window       : integer;
+    signal prev_fragment    : fragment_t;
+    signal prev_mask        : mask_t;
+    signal prev_index       : integer;
+    signal prev_window      : integer;
+
+begin
+
+    map_process : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            write_enable <= '0';
+        elsif rising_edge(clock) then
+            write_enable <= map_write;
+            write_address <= to_address(map_window, map_index);
+            write_data <= map_mask;
+        end if;
+    end process map_process;
+
+    -- Pipeline stage 0: request the fragment's mask
+    c0 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            window_c0 <= -1;
+            read_enable <= '0';
+            read_address <= (others => '0');
+        elsif rising_edge(clock) then
+            read_enable <= '0';
+            window_c0 <= fragment_window;
+            if fragment_window /= -1 then
+                read_address <= to_address(fragment_window, fragment_index);
+                read_enable <= '1';
+                fragment_c0 <= fragment;
+                index_c0 <= fragment_index;
+            end if;
+        end if;
+    end process c0;
+
+    -- Pipeline stage 1: delay until the mask is ready
+    c1 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            window_c1 <= -1;
+        elsif rising_edge(clock) then
+            window_c1 <= window_c0;
+            fragment_c1 <= fragment_c0;
+            index_c1 <= index_c0;
+        end if;
+    end process c1;
+
+    -- Pipeline stage 2: send out the held fragment once its right
+    -- neighbour has come in (or straight away if it's the last of its
+    -- row), then hold on to the new fragment
+    c2 : process (clock, reset_n)
+        variable mask       : mask_t;
+        variable left_good  : mask_t;
+        variable right_good : mask_t;
+        variable send       : boolean;
+    begin
+        if reset_n = '0' then
+            cur_window <= -1;
+            prev_window <= -1;
+            row_fragment_window <= -1;
+        elsif rising_edge(clock) then
+            row_fragment_window <= -1;
+
+            send := cur_window /= -1 and (window_c1 /= -1 or cur_index = FRAGMENTS_PER_ROW-1);
+            if send then
+                mask := (others => '0');
+                if enable = '1' then
+                    mask := cur_mask;
+                end if;
+                left_good := (others => '0');
+                if prev_window = cur_window and prev_index = cur_index - 1 then
+                    left_good := not prev_mask;
+                end if;
+                right_good := (others => '0');
+                if window_c1 = cur_window and index_c1 = cur_index + 1 then
+                    right_good := not read_data;
+                end if;
+                row_fragment <= replace(cur_fragment, mask, prev_fragment, left_good, fragment_c1, right_good);
+                row_fragment_index <= cur_index;
+                row_fragment_window <= cur_window;
+
+                prev_fragment <= cur_fragment;
+                prev_mask <= cur_mask;
+                prev_index <= cur_index;
+                prev_window <= cur_window;
+                cur_window <= -1;
+            end if;
+
+            if window_c1 /= -1 then
+                cur_fragment <= fragment_c1;
+                cur_mask <= read_data;
+                cur_index <= index_c1;
+                cur_window <= window_c1;
+            end if;
+        end if;
+    end process c2;
+
+    ram : pixel_integrator_fifo generic map (
+        WORD_SIZE => FRAGMENT_WIDTH,
+        ADDRESS_SIZE => ADDRESS_BITS
+    ) port map (
+        clock => clock,
+        read_data => read_data,
+        read_address => read_address,
+        read_enable => read_enable,
+        write_data => write_data,
+        write_address => write_address,
+        write_enable => write_enable
+    );
+
+end architecture rtl;
@@ -61,6 +61,27 @@ use work.pixel_integrator_pkg.all;
 -- recieved by the `pixel_integrator`, they are collected into rows and
 -- emitted out the `row` output.
 --
+-- The summed (or averaged) fragments are also emitted one at a time
+-- through the `row_fragment` output as soon as they are ready, with
+-- `row_fragment_index` set to the fragment's index in its row and
+-- `row_fragment_window` set to its window (or -1 when there is no
+-- fragment). This lets downstream components stream rows out without
+-- waiting for `row` to fill up. When only the fragments are needed,
+-- set EMIT_ROWS to false so that the (ROW_WIDTH * ROW_PIXEL_BITS)-bit
+-- `row` register isn't built; `row_window` is still emitted.
+--
+-- With FRAGMENT_LANES > 1, each input fragment is that many consecutive
+-- sensor fragments side by side, lane l (pixels l * FRAGMENT_WIDTH /
+-- FRAGMENT_LANES and up) holding the one l after the first. They are
+-- summed together, and put in their places in `row` (see
+-- `pixel_integrator_dual`).
+--
+-- With METHOD = "AVERAGE", each sum is divided by its window's size
+-- by multiplying it with the size's reciprocal, which is looked up
+-- when the config is read, in a pipeline stage of its own (see
+-- `reciprocal_divide`). The result is the floor of the exact quotient,
+-- for any window size up to MAX_WINDOW_SIZE.
+--
 -- `pixel_integrator` is able to figure out which fragments correspond to
 -- the same locations on the ground by assuming the satallite ground
 -- speed and the sensor's imaging speed satisfy:
@@ -80,7 +101,9 @@ generic (
     ROW_PIXEL_BITS      : integer;
     N_WINDOWS           : integer range 1 to MAX_N_WINDOWS;
     METHOD              : string;
-    MAX_WINDOW_SIZE     : integer
+    MAX_WINDOW_SIZE     : integer;
+    EMIT_ROWS           : boolean := true;
+    FRAGMENT_LANES      : integer := 1
 );
 port (
     clock               : in std_logic;
@@ -98,6 +121,10 @@ port (
     row                 : out pixel_vector_t(ROW_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
     row_window          : out integer;
 
+    row_fragment        : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_fragment_index  : out integer;
+    row_fragment_window : out integer;
+
     status              : out status_t
 );
 end entity pixel_integrator;
@@ -122,6 +149,9 @@ architecture rtl of pixel_integrator is
     end component pixel_integrator_fifo;
 
     constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    -- Pixels in each lane of a fragment, and fragments of that width per row
+    constant LANE_WIDTH : integer := FRAGMENT_WIDTH / FRAGMENT_LANES;
+    constant LANE_FRAGMENTS_PER_ROW : integer := ROW_WIDTH / LANE_WIDTH;
     -- Number of bits needed to ensure pixel summing doesn't overflow.
     -- In the worst case, we sum together n m-bit pixels, with
     -- n=MAX_WINDOW_SIZE and m=PIXEL_BITS
@@ -129,6 +159,10 @@ architecture rtl of pixel_integrator is
     -- Number of bits needed to ensure all intermediate sums may be
     -- stored in RAM
     constant ADDRESS_BITS : integer := integer(ceil(log2(real(ROW_WIDTH / FRAGMENT_WIDTH) * real(N_WINDOWS) * real(MAX_WINDOW_SIZE))));
+    -- Reciprocals of the window sizes, scaled by 2**RECIPROCAL_SHIFT
+    constant RECIPROCAL_SHIFT : integer := reciprocal_shift(SUM_BITS, MAX_WINDOW_SIZE);
+    constant SIZE_RECIPROCALS : pixel_vector_t(1 to MAX_WINDOW_SIZE)(RECIPROCAL_SHIFT downto 0) :=
+        reciprocals(MAX_WINDOW_SIZE, RECIPROCAL_SHIFT);
 
     -- Gets the address in RAM of a particular fragment, according to
     --
@@ -155,14 +189,20 @@ architecture rtl of pixel_integrator is
     signal fragment_p1  : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
     signal index_p1     : fragment_idx_t;
     signal p1_done      : std_logic;
+    signal fragments_filtered : unsigned(31 downto 0);
     -- Pipeline stage 2 output
     signal fragment_p2  : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
     signal index_p2     : fragment_idx_t;
     signal p2_done      : std_logic;
     -- Pipeline stage 3 output
-    signal fragment_p3  : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal fragment_p3  : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(SUM_BITS-1 downto 0);
+    signal reciprocal_p3 : unsigned(RECIPROCAL_SHIFT downto 0);
     signal index_p3     : fragment_idx_t;
     signal p3_done      : std_logic;
+    -- Pipeline stage 4 output
+    signal fragment_p4  : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal index_p4     : fragment_idx_t;
+    signal p4_done      : std_logic;
 
     -- RAM signals
     signal read_data        : lpixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(SUM_BITS-1 downto 0);
@@ -174,14 +214,20 @@ architecture rtl of pixel_integrator is
 
     -- Config registers
     signal windows : window_vector_t(N_WINDOWS-1 downto 0);
+    signal window_reciprocals : pixel_vector_t(N_WINDOWS-1 downto 0)(RECIPROCAL_SHIFT downto 0);
     signal length : integer;
 
 begin
 
+    assert FRAGMENTS_PER_ROW > 2 and FRAGMENT_WIDTH mod FRAGMENT_LANES = 0
+        report "pixel_integrator needs more than two fragments per row, each a whole number of lanes"
+        severity failure;
+
     config_process : process (clock, reset_n)
     begin
         if reset_n = '0' then
             windows <= (others => (others => 0));
+            window_reciprocals <= (others => (others => '0'));
             length <= 0;
         elsif rising_edge(clock) then
             if read_config = '1' then
@@ -193,6 +239,10 @@ begin
                 end loop;
                 
                 windows <= config.windows(N_WINDOWS-1 downto 0);
+                for i in 0 to N_WINDOWS-1 loop
+                    assert size(config.windows(i)) <= MAX_WINDOW_SIZE;
+                    window_reciprocals(i) <= SIZE_RECIPROCALS(size(config.windows(i)));
+                end loop;
                 length <= config.length;
             end if;
         end if;
@@ -239,13 +289,17 @@ begin
     end process p0;
 
     -- Pipeline stage 1: Filter out-of-bounds fragments, request stored sum values of
-    -- previous fragments overlapping with the input fragment
+    -- previous fragments overlapping with the input fragment. The sums of the two fragments
+    -- ahead haven't been written back yet, which is fine since an address only comes up
+    -- again on the next row of its window; this is checked in simulation
     p1 : process (clock, reset_n)
+        variable address : std_logic_vector(ADDRESS_BITS-1 downto 0);
     begin
         if reset_n = '0' then
             p1_done <= '0';
             read_enable <= '0';
             read_address <= (others => '0');
+            fragments_filtered <= (others => '0');
         elsif rising_edge(clock) then
             p1_done <= '0';
             read_enable <= '0';
@@ -253,18 +307,26 @@ begin
                 if 0 <= index_p0.x and index_p0.x < length then
                     -- Make previous sum available for next pipeline stage
                     if not index_p0.is_leading then
-                        read_address <= to_address(index_p0, windows);
+                        address := to_address(index_p0, windows);
+                        assert not (p1_done = '1' and address = to_address(index_p1, windows)) and
+                               not (p2_done = '1' and address = to_address(index_p2, windows))
+                            report "Sum read before it was written back" severity failure;
+                        read_address <= address;
                         read_enable <= '1';
                     end if;
                     -- Advance to next pipeline stage
                     fragment_p1 <= fragment_p0;
                     index_p1 <= index_p0;
                     p1_done <= '1';
+                else
+                    fragments_filtered <= fragments_filtered + FRAGMENT_LANES;
                 end if;
             end if;
         end if;
     end process p1;
 
+    status.fragments_filtered <= fragments_filtered;
+
     -- Pipeline stage 2: delay until the sum is ready
     p2 : process (clock, reset_n)
     begin
@@ -280,8 +342,8 @@ begin
     end process p2;
 
     -- Pipeline stage 3: read in the sum requested in pipeline stage 1, and update it
-    -- by adding this fragment to it. Write the result back into RAM. Possibly compute the
-    -- average from the sum and export it to the next pipeline stage.
+    -- by adding this fragment to it. Write the result back into RAM. Possibly export the
+    -- sum to the next pipeline stage.
     p3 : process (clock, reset_n)
         variable sum : pixel_vector_t(fragment_p1'range)(SUM_BITS-1 downto 0);
     begin
@@ -306,19 +368,11 @@ begin
                 write_enable <= '1';
 
                 -- If this fragment is on the lagging edge of a window, we have done all the
-                -- passes we can on the fragments with its index, so emit the summed/averaged
-                -- fragment.
+                -- passes we can on the fragments with its index, so emit the summed
+                -- fragment, along with its window's reciprocal for averaging.
                 if index_p2.is_lagging then
-                    if METHOD = "SUM" then
-                        fragment_p3 <= resize_pixels(sum, ROW_PIXEL_BITS);
-                    elsif METHOD = "AVERAGE" then
-                        fragment_p3 <= resize_pixels(
-                            shift_divide(sum, to_unsigned(size(windows(index_p2.i_window)), 11)),
-                            ROW_PIXEL_BITS
-                        );
-                    else
-                        report "Unrecognized METHOD" severity failure;
-                    end if;
+                    fragment_p3 <= sum;
+                    reciprocal_p3 <= window_reciprocals(index_p2.i_window);
                     index_p3 <= index_p2;
                     p3_done <= '1';
                 end if;
@@ -326,31 +380,63 @@ begin
         end if;
     end process p3;
 
-    -- Pipeline stage 4: collect the summed/averaged fragments from the previous pipeline stage
-    -- into rows.
+    -- Pipeline stage 4: compute the average from the sum, if averaging
     p4 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            p4_done <= '0';
+        elsif rising_edge(clock) then
+            p4_done <= p3_done;
+            if p3_done = '1' then
+                if METHOD = "SUM" then
+                    fragment_p4 <= resize_pixels(fragment_p3, ROW_PIXEL_BITS);
+                elsif METHOD = "AVERAGE" then
+                    fragment_p4 <= resize_pixels(
+                        reciprocal_divide(fragment_p3, reciprocal_p3, RECIPROCAL_SHIFT),
+                        ROW_PIXEL_BITS
+                    );
+                else
+                    report "Unrecognized METHOD" severity failure;
+                end if;
+                index_p4 <= index_p3;
+            end if;
+        end if;
+    end process p4;
+
+    -- Pipeline stage 5: collect the summed/averaged fragments from the previous pipeline stage
+    -- into rows.
+    p5 : process (clock, reset_n)
         variable i_frame : integer;
     begin
         if reset_n = '0' then
             row_window <= -1;
+            row_fragment_window <= -1;
             done <= '0';
         elsif rising_edge(clock) then
             row_window <= -1;
+            row_fragment_window <= -1;
             done <= '0';
 
             if start = '1' then
                 i_frame := 0;
-            elsif p3_done = '1' then
+            elsif p4_done = '1' then
+                -- Emit fragment on its own
+                row_fragment <= fragment_p4;
+                row_fragment_index <= index_p4.i_fragment;
+                row_fragment_window <= index_p4.i_window;
                 -- Insert fragment into row
-                for i in fragment_p3'range loop
-                    row(index_p3.i_fragment + i * FRAGMENTS_PER_ROW) <= fragment_p3(i);
-                end loop;
+                if EMIT_ROWS then
+                    for i in fragment_p4'range loop
+                        row(FRAGMENT_LANES * index_p4.i_fragment + i / LANE_WIDTH +
+                            (i mod LANE_WIDTH) * LANE_FRAGMENTS_PER_ROW) <= fragment_p4(i);
+                    end loop;
+                end if;
                 -- If this is the last fragment of the row, emit the row
-                if index_p3.i_fragment = FRAGMENTS_PER_ROW-1 then
+                if index_p4.i_fragment = FRAGMENTS_PER_ROW-1 then
                     -- Emit row
-                    row_window <= index_p3.i_window;
+                    row_window <= index_p4.i_window;
                     -- If this is the last window, we have finished processing a frame
-                    if index_p3.i_window = N_WINDOWS-1 then
+                    if index_p4.i_window = N_WINDOWS-1 then
                         -- If this is the last frame, we are done
                         if i_frame = length-1 then
                             done <= '1';
@@ -360,7 +446,7 @@ begin
                 end if;
             end if;
         end if;
-    end process p4;
+    end process p5;
 
     -- Use multiple RAMs in parallel, so that reading or writing a fragment
     -- takes a single clock cycle
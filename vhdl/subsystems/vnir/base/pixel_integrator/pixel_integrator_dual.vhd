@@ -0,0 +1,135 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+-- A variant of `pixel_integrator` that takes in two fragments per
+-- clock cycle, so that it can keep up with the LVDS decoder at the
+-- sensor's maximum frame rate while running at half the main clock.
+--
+-- It is configured, started and finished in the same way as
+-- `pixel_integrator`, and sums (or averages) the same fragments. The
+-- fragments of each row are input in pairs: fragment 2k through
+-- `fragment_even` and fragment 2k+1 through `fragment_odd`, with
+-- `fragment_available` set to '1' on every clock cycle on which a pair
+-- is input. FRAGMENTS_PER_ROW = ROW_WIDTH / FRAGMENT_WIDTH must be
+-- even.
+--
+-- Each pair goes through `pixel_integrator` as a single fragment of
+-- two lanes, so the running sums of both fragments are at the same
+-- address, and each RAM still only needs a single read and a single
+-- write per clock cycle. A pair's sums are read before the sums of the
+-- two pairs ahead of it have been written back, which is fine as long
+-- as a row has more than four fragments (see `pixel_integrator`).
+--
+-- The summed (or averaged) pairs are emitted through `row_fragment_even`
+-- and `row_fragment_odd`, with `row_fragment_index` set to the index of
+-- the even fragment and `row_fragment_window` set to their window (or
+-- -1 when there is no pair). `row` and `row_window` are emitted as in
+-- `pixel_integrator`.
+entity pixel_integrator_dual is
+generic (
+    ROW_WIDTH           : integer;
+    FRAGMENT_WIDTH      : integer;
+    PIXEL_BITS          : integer;
+    ROW_PIXEL_BITS      : integer;
+    N_WINDOWS           : integer range 1 to MAX_N_WINDOWS;
+    METHOD              : string;
+    MAX_WINDOW_SIZE     : integer;
+    EMIT_ROWS           : boolean := true
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    config              : in config_t;
+    read_config         : in std_logic;
+
+    start               : in std_logic;
+    done                : out std_logic;
+
+    fragment_even       : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    fragment_odd        : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    fragment_available  : in std_logic;
+
+    row                 : out pixel_vector_t(ROW_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_window          : out integer;
+
+    row_fragment_even   : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_fragment_odd    : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_fragment_index  : out integer;
+    row_fragment_window : out integer;
+
+    status              : out status_t
+);
+end entity pixel_integrator_dual;
+
+
+architecture rtl of pixel_integrator_dual is
+
+    -- Pairs, with the even fragment in lane 0 and the odd one in lane 1
+    signal pair             : pixel_vector_t(2*FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    signal row_pair         : pixel_vector_t(2*FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal row_pair_index   : integer;
+
+begin
+
+    assert (ROW_WIDTH / FRAGMENT_WIDTH) mod 2 = 0
+        report "pixel_integrator_dual needs an even number of fragments per row"
+        severity failure;
+
+    pair(FRAGMENT_WIDTH-1 downto 0) <= fragment_even;
+    pair(2*FRAGMENT_WIDTH-1 downto FRAGMENT_WIDTH) <= fragment_odd;
+
+    integrator : entity work.pixel_integrator generic map (
+        ROW_WIDTH => ROW_WIDTH,
+        FRAGMENT_WIDTH => 2 * FRAGMENT_WIDTH,
+        PIXEL_BITS => PIXEL_BITS,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS,
+        N_WINDOWS => N_WINDOWS,
+        METHOD => METHOD,
+        MAX_WINDOW_SIZE => MAX_WINDOW_SIZE,
+        EMIT_ROWS => EMIT_ROWS,
+        FRAGMENT_LANES => 2
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        config => config,
+        read_config => read_config,
+        start => start,
+        done => done,
+        fragment => pair,
+        fragment_available => fragment_available,
+        row => row,
+        row_window => row_window,
+        row_fragment => row_pair,
+        row_fragment_index => row_pair_index,
+        row_fragment_window => row_fragment_window,
+        status => status
+    );
+
+    row_fragment_even <= row_pair(FRAGMENT_WIDTH-1 downto 0);
+    row_fragment_odd <= row_pair(2*FRAGMENT_WIDTH-1 downto FRAGMENT_WIDTH);
+    row_fragment_index <= 2 * row_pair_index;
+
+end architecture rtl;
@@ -43,6 +43,7 @@ package pixel_integrator_pkg is
     type status_t is record
         fragment_available  : std_logic;
         fragment_x          : integer;
+        fragments_filtered  : unsigned(31 downto 0);  -- out-of-bounds fragments dropped since reset
     end record status_t;
 
     -- Like pixel_vector_t, but stores std_logic_vectors
@@ -69,6 +70,24 @@ package pixel_integrator_pkg is
     -- Divides a pixel vector by a power of 2
     pure function shift_divide(lhs : pixel_vector_t; rhs : unsigned) return pixel_vector_t;
 
+    -- Division by any window size is done by multiplying with a
+    -- reciprocal instead, as
+    --
+    --       floor(n / d) = (n * ceil(2**shift / d)) >> shift
+    --
+    -- which is exact for every n < 2**sum_bits and d <= max_window_size
+    -- when shift = sum_bits + ceil(log2(max_window_size)).
+    pure function reciprocal_shift(sum_bits : integer; max_window_size : integer) return integer;
+    -- ceil(2**shift / d) for d = 1 to max_window_size, shift+1 bits each
+    pure function reciprocals(max_window_size : integer; shift : integer) return pixel_vector_t;
+    -- Divides a pixel vector by the window size whose reciprocal is given
+    pure function reciprocal_divide(lhs : pixel_vector_t; reciprocal : unsigned; shift : integer) return pixel_vector_t;
+
+    -- SDRAM addresses (16 b each) `pixel_integrator_spill` keeps its
+    -- running sums in, packed into words of word_bits bits
+    pure function spill_scratch_addresses(row_width : integer; fragment_width : integer; pixel_bits : integer;
+                                          n_windows : integer; max_window_size : integer; word_bits : integer) return integer;
+
 end package pixel_integrator_pkg;
 
 package body pixel_integrator_pkg is
@@ -151,4 +170,47 @@ package body pixel_integrator_pkg is
         return quotient;
     end function shift_divide;
 
+    pure function reciprocal_shift(sum_bits : integer; max_window_size : integer) return integer is
+        variable size_bits : integer;
+    begin
+        size_bits := 0;
+        while 2 ** size_bits < max_window_size loop
+            size_bits := size_bits + 1;
+        end loop;
+        return sum_bits + size_bits;
+    end function reciprocal_shift;
+
+    pure function reciprocals(max_window_size : integer; shift : integer) return pixel_vector_t is
+        variable re : pixel_vector_t(1 to max_window_size)(shift downto 0);
+        variable one : unsigned(shift downto 0);
+    begin
+        one := shift_left(to_unsigned(1, shift+1), shift);
+        for d in re'range loop
+            re(d) := (one + d - 1) / to_unsigned(d, shift+1);
+        end loop;
+        return re;
+    end function reciprocals;
+
+    pure function reciprocal_divide(lhs : pixel_vector_t; reciprocal : unsigned; shift : integer) return pixel_vector_t is
+        variable quotient : pixel_vector_t(lhs'range)(lhs(0)'range);
+        variable product : unsigned(lhs(0)'length + reciprocal'length - 1 downto 0);
+    begin
+        for i in lhs'range loop
+            product := lhs(i) * reciprocal;
+            quotient(i) := resize(shift_right(product, shift), lhs(0)'length);
+        end loop;
+        return quotient;
+    end function reciprocal_divide;
+
+    pure function spill_scratch_addresses(row_width : integer; fragment_width : integer; pixel_bits : integer;
+                                          n_windows : integer; max_window_size : integer; word_bits : integer) return integer is
+        variable sum_bits : integer := pixel_bits;  -- ceil(log2(2**pixel_bits * max_window_size))
+    begin
+        while 2 ** (sum_bits - pixel_bits) < max_window_size loop
+            sum_bits := sum_bits + 1;
+        end loop;
+        return n_windows * max_window_size * (row_width / fragment_width)
+               * ((fragment_width * sum_bits + word_bits - 1) / word_bits) * (word_bits / 16);
+    end function spill_scratch_addresses;
+
 end package body pixel_integrator_pkg;
@@ -0,0 +1,611 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+use work.integer_types.all;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+use work.sdram;
+use work.img_buffer_pkg.all;
+use work.custom_master_pkg.all;
+
+-- Variant of `pixel_integrator` that keeps its running sums in SDRAM
+-- instead of on-chip RAM, for integration windows too large for the
+-- M10K blocks (up to MAX_WINDOW_SIZE rows, 128 by default).
+--
+-- It is configured, started and fed like `pixel_integrator`, and emits
+-- the summed (or averaged) fragments through `row_fragment`,
+-- `row_fragment_index` and `row_fragment_window` in the same way (it
+-- has no `row` output).
+--
+-- Rows are handled one at a time. Each incoming row is stored in one
+-- of two on-chip row buffers. For each buffered row that is in bounds,
+-- the running sums of its location are burst-read from the scratch
+-- region through the read master (unless the row is on the leading
+-- edge of its window), the row is added to them, and the new sums are
+-- burst-written back through the write master (unless the row is on the
+-- lagging edge of its window, in which case they are emitted instead).
+-- The sums of location x of window w are kept at
+--
+--       scratch_base + (w * MAX_WINDOW_SIZE + x % MAX_WINDOW_SIZE) * ROW_SUM_ADDRESSES
+--
+-- with each fragment's FRAGMENT_WIDTH sums packed into SUM_WORDS
+-- 128-bit words. `scratch_base` is the base of a region of SDRAM that
+-- must hold N_WINDOWS * MAX_WINDOW_SIZE * ROW_SUM_ADDRESSES addresses
+-- (see `spill_scratch_addresses`). `vnir_subsystem` uses this entity
+-- when its INTEGRATOR generic is "SPILL", and the memory map then sets
+-- the region aside below the catalog (see its SCRATCH_ADDRESSES
+-- generic). A row's read isn't started until the write master is
+-- idle, so the sums written for one row are in SDRAM before the next
+-- row's are read (this assumes the SDRAM controller doesn't reorder a
+-- completed write from one port past a later read from another).
+--
+-- Every fragment costs SUM_WORDS words read and SUM_WORDS words
+-- written, so the engine consumes a row in about 2 * SUM_WORDS times as
+-- many clock cycles as the sensor takes to send it, and the frame rate
+-- has to be lowered accordingly. A row that comes in while both row
+-- buffers are still full is dropped and counted in `rows_dropped`; the
+-- sums of its location are then missing a pass (or, for a leading row,
+-- are left over from an earlier location), so such an image should be
+-- discarded.
+entity pixel_integrator_spill is
+generic (
+    ROW_WIDTH           : integer;
+    FRAGMENT_WIDTH      : integer;
+    PIXEL_BITS          : integer;
+    ROW_PIXEL_BITS      : integer;
+    N_WINDOWS           : integer range 1 to MAX_N_WINDOWS;
+    METHOD              : string;
+    MAX_WINDOW_SIZE     : integer := 128
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    config              : in config_t;
+    read_config         : in std_logic;
+
+    start               : in std_logic;
+    done                : out std_logic;
+
+    scratch_base        : in sdram.address_t;
+
+    fragment            : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    fragment_available  : in std_logic;
+
+    row_fragment        : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_fragment_index  : out integer;
+    row_fragment_window : out integer;
+
+    status              : out status_t;
+    rows_dropped        : out unsigned(31 downto 0);
+
+    read_master_in      : in from_read_master_t;
+    read_master_out     : out to_read_master_t;
+    write_master_in     : in from_master_t;
+    write_master_out    : out to_master_t
+);
+end entity pixel_integrator_spill;
+
+
+architecture rtl of pixel_integrator_spill is
+
+    component pixel_integrator_fifo is
+    generic (
+        WORD_SIZE       : integer;
+        ADDRESS_SIZE    : integer
+    );
+    port (
+        clock           : in std_logic;
+        read_data       : out std_logic_vector;
+        read_address    : in std_logic_vector;
+        read_enable     : in std_logic;
+        write_data      : in std_logic_vector;
+        write_address   : in std_logic_vector;
+        write_enable    : in std_logic
+    );
+    end component pixel_integrator_fifo;
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    -- Same as in `pixel_integrator`
+    constant SUM_BITS : integer := integer(ceil(log2(real(2) ** real(PIXEL_BITS) * real(MAX_WINDOW_SIZE))));
+    constant RECIPROCAL_SHIFT : integer := reciprocal_shift(SUM_BITS, MAX_WINDOW_SIZE);
+    constant SIZE_RECIPROCALS : pixel_vector_t(1 to MAX_WINDOW_SIZE)(RECIPROCAL_SHIFT downto 0) :=
+        reciprocals(MAX_WINDOW_SIZE, RECIPROCAL_SHIFT);
+    -- Words of a fragment's sums, and bytes and addresses (16 b each) of a row's
+    constant SUM_WORDS : integer := (FRAGMENT_WIDTH * SUM_BITS + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH;
+    constant ROW_SUM_BYTES : integer := FRAGMENTS_PER_ROW * SUM_WORDS * FIFO_WORD_BYTES;
+    constant ROW_SUM_ADDRESSES : integer := ROW_SUM_BYTES / 2;
+    -- Two row buffers, of FRAGMENTS_PER_ROW fragments each
+    constant INPUT_ADDRESS_BITS : integer := integer(ceil(log2(real(2 * FRAGMENTS_PER_ROW))));
+    -- Words of the write-back FIFO. Words are only taken from the read
+    -- master once room for the whole fragment's sums has been reserved
+    constant OUT_FIFO_WORDS : integer := 32;
+
+    subtype sum_t is pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(SUM_BITS-1 downto 0);
+    subtype packed_t is std_logic_vector(SUM_WORDS * FIFO_WORD_LENGTH - 1 downto 0);
+    subtype word_t is std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+
+    type row_vector_t is array (0 to 1) of fragment_idx_t;
+    type state_t is (S_IDLE, S_GO, S_STREAM);
+
+    -- Lane i of a fragment's sums is kept in bits (i+1)*SUM_BITS-1 downto i*SUM_BITS,
+    -- with word 0 the lowest
+    pure function pack(sum : sum_t) return packed_t is
+        variable re : packed_t;
+    begin
+        re := (others => '0');
+        for i in sum'range loop
+            re((i+1) * SUM_BITS - 1 downto i * SUM_BITS) := std_logic_vector(sum(i));
+        end loop;
+        return re;
+    end function pack;
+
+    pure function unpack(packed : packed_t) return sum_t is
+        variable re : sum_t;
+    begin
+        for i in re'range loop
+            re(i) := unsigned(packed((i+1) * SUM_BITS - 1 downto i * SUM_BITS));
+        end loop;
+        return re;
+    end function unpack;
+
+    pure function to_slv(pixels : pixel_vector_t) return std_logic_vector is
+        variable re : std_logic_vector(FRAGMENT_WIDTH * PIXEL_BITS - 1 downto 0);
+    begin
+        for i in pixels'range loop
+            re((i+1) * PIXEL_BITS - 1 downto i * PIXEL_BITS) := std_logic_vector(pixels(i));
+        end loop;
+        return re;
+    end function to_slv;
+
+    pure function to_sum(slv : std_logic_vector) return sum_t is
+        variable re : sum_t;
+    begin
+        for i in re'range loop
+            re(i) := resize(unsigned(slv((i+1) * PIXEL_BITS - 1 downto i * PIXEL_BITS)), SUM_BITS);
+        end loop;
+        return re;
+    end function to_sum;
+
+    pure function to_address(slot : integer; i_fragment : integer) return std_logic_vector is
+    begin
+        return std_logic_vector(to_unsigned(slot * FRAGMENTS_PER_ROW + i_fragment, INPUT_ADDRESS_BITS));
+    end function to_address;
+
+    -- Config registers
+    signal windows : window_vector_t(N_WINDOWS-1 downto 0);
+    signal window_reciprocals : pixel_vector_t(N_WINDOWS-1 downto 0)(RECIPROCAL_SHIFT downto 0);
+    signal length : integer;
+
+    -- Row buffers: rows(i) describes the row in buffer i. Rows are
+    -- buffered in order, rows_in counting those buffered and rows_done
+    -- those the engine has finished with
+    signal rows                 : row_vector_t;
+    signal rows_in              : natural;
+    signal rows_done            : natural;
+    signal rows_dropped_i       : unsigned(31 downto 0);
+    signal fragments_filtered   : unsigned(31 downto 0);
+    signal input_read_data      : std_logic_vector(FRAGMENT_WIDTH * PIXEL_BITS - 1 downto 0);
+    signal input_read_address   : std_logic_vector(INPUT_ADDRESS_BITS-1 downto 0);
+    signal input_read_enable    : std_logic;
+    signal input_write_data     : std_logic_vector(FRAGMENT_WIDTH * PIXEL_BITS - 1 downto 0);
+    signal input_write_address  : std_logic_vector(INPUT_ADDRESS_BITS-1 downto 0);
+    signal input_write_enable   : std_logic;
+
+    -- Engine
+    signal state                : state_t;
+    signal cur_row              : fragment_idx_t;
+    signal cur_slot             : integer range 0 to 1;
+    signal sum_base             : sdram.address_t;
+    signal read_go              : std_logic;
+    signal write_go             : std_logic;
+    signal take                 : std_logic;
+    signal src_words            : integer range 0 to SUM_WORDS-1;
+    signal src_fragments        : integer range 0 to FRAGMENTS_PER_ROW;
+    signal sums_done            : integer range 0 to FRAGMENTS_PER_ROW;
+    signal out_reserved         : integer range 0 to OUT_FIFO_WORDS;
+    signal gather               : packed_t;
+    signal gather_done          : std_logic;
+    signal gather_index         : integer;
+
+    -- Pipeline stage 0 output
+    signal sum_e0       : sum_t;
+    signal index_e0     : fragment_idx_t;
+    signal e0_done      : std_logic;
+    -- Pipeline stage 1 output
+    signal sum_e1       : sum_t;
+    signal index_e1     : fragment_idx_t;
+    signal e1_done      : std_logic;
+    -- Pipeline stage 2 output
+    signal sum_e2       : sum_t;
+    signal reciprocal_e2 : unsigned(RECIPROCAL_SHIFT downto 0);
+    signal index_e2     : fragment_idx_t;
+    signal e2_done      : std_logic;
+    signal e2_emit      : std_logic;
+
+    -- Write-back
+    signal scatter          : packed_t;
+    signal scatter_words    : integer range 0 to SUM_WORDS;
+    signal out_data         : word_t;
+    signal out_write        : std_logic;
+    signal out_read         : std_logic;
+    signal out_empty        : std_logic;
+    signal out_q            : word_t;
+    signal out_clear        : std_logic;
+
+begin
+
+    config_process : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            windows <= (others => (others => 0));
+            window_reciprocals <= (others => (others => '0'));
+            length <= 0;
+        elsif rising_edge(clock) then
+            if read_config = '1' then
+                for i in 0 to N_WINDOWS-2 loop
+                    assert 0 <= config.windows(i).lo;
+                    assert config.windows(i).lo <= config.windows(i).hi;
+                    assert config.windows(i).hi < config.windows(i+1).hi;
+                    assert config.windows(i+1).hi < 2048;
+                end loop;
+
+                windows <= config.windows(N_WINDOWS-1 downto 0);
+                for i in 0 to N_WINDOWS-1 loop
+                    assert size(config.windows(i)) <= MAX_WINDOW_SIZE;
+                    window_reciprocals(i) <= SIZE_RECIPROCALS(size(config.windows(i)));
+                end loop;
+                length <= config.length;
+            end if;
+        end if;
+    end process config_process;
+
+    -- Tags each row with its index and stores it in a free row buffer,
+    -- or drops it if there isn't one
+    input_process : process (clock, reset_n)
+        variable i_fragment : integer;
+        variable i_row      : integer;
+        variable i_window   : integer;
+        variable i_frame    : integer;
+        variable rollover   : boolean;
+        variable accept     : boolean;
+        variable x          : integer;
+    begin
+        if reset_n = '0' then
+            rows_in <= 0;
+            rows_dropped_i <= (others => '0');
+            input_write_enable <= '0';
+            input_write_address <= (others => '0');
+        elsif rising_edge(clock) then
+            input_write_enable <= '0';
+            status.fragment_available <= fragment_available;
+            if start = '1' then
+                i_fragment := 0;
+                i_row := 0;
+                i_window := 0;
+                i_frame := 0;
+                rows_in <= 0;
+            elsif fragment_available = '1' then
+                x := i_frame - windows(i_window).lo - i_row;
+                status.fragment_x <= x;
+                if i_fragment = 0 then
+                    accept := rows_in - rows_done < 2;
+                    if not accept then
+                        rows_dropped_i <= rows_dropped_i + 1;
+                    end if;
+                end if;
+                if accept then
+                    input_write_address <= to_address(rows_in mod 2, i_fragment);
+                    input_write_data <= to_slv(fragment);
+                    input_write_enable <= '1';
+                    if i_fragment = FRAGMENTS_PER_ROW-1 then
+                        rows(rows_in mod 2) <= (
+                            x => x,
+                            i_fragment => 0,
+                            i_window => i_window,
+                            is_leading => i_row = 0,
+                            is_lagging => i_row = size(windows(i_window))-1
+                        );
+                        rows_in <= rows_in + 1;
+                    end if;
+                end if;
+                increment_rollover(i_fragment, FRAGMENTS_PER_ROW, true, rollover);
+                increment_rollover(i_row, size(windows(i_window)), rollover, rollover);
+                increment_rollover(i_window, N_WINDOWS, rollover, rollover);
+                increment(i_frame, rollover);
+            end if;
+        end if;
+    end process input_process;
+
+    status.fragments_filtered <= fragments_filtered;
+    rows_dropped <= rows_dropped_i;
+
+    -- A word of sums is taken from the read master (or, for a leading
+    -- row, made up of zeros) once there is room in the write-back FIFO
+    -- for the fragment it starts
+    take <= '1' when state = S_STREAM and src_fragments < FRAGMENTS_PER_ROW and
+                     (src_words /= 0 or cur_row.is_lagging or out_reserved <= OUT_FIFO_WORDS - SUM_WORDS) and
+                     (cur_row.is_leading or read_master_in.user_data_available = '1') else '0';
+
+    -- Issues the burst read and write of each buffered row's sums, and
+    -- gathers the words read into fragments
+    engine : process (clock, reset_n)
+        variable row : fragment_idx_t;
+        variable word : word_t;
+        variable reserved : integer;
+    begin
+        if reset_n = '0' then
+            state <= S_IDLE;
+            rows_done <= 0;
+            read_go <= '0';
+            write_go <= '0';
+            gather_done <= '0';
+            src_words <= 0;
+            src_fragments <= 0;
+            sums_done <= 0;
+            out_reserved <= 0;
+            fragments_filtered <= (others => '0');
+        elsif rising_edge(clock) then
+            read_go <= '0';
+            write_go <= '0';
+            gather_done <= '0';
+
+            reserved := out_reserved;
+            if out_read = '1' then
+                reserved := reserved - 1;
+            end if;
+
+            if start = '1' then
+                rows_done <= 0;
+                state <= S_IDLE;
+            else
+                case state is
+                    when S_IDLE =>
+                        if rows_in /= rows_done then
+                            row := rows(rows_done mod 2);
+                            if 0 <= row.x and row.x < length then
+                                cur_row <= row;
+                                cur_slot <= rows_done mod 2;
+                                sum_base <= scratch_base +
+                                    (row.i_window * MAX_WINDOW_SIZE + row.x rem MAX_WINDOW_SIZE) * ROW_SUM_ADDRESSES;
+                                state <= S_GO;
+                            else
+                                fragments_filtered <= fragments_filtered + FRAGMENTS_PER_ROW;
+                                rows_done <= rows_done + 1;
+                            end if;
+                        end if;
+
+                    when S_GO =>
+                        if (cur_row.is_leading or (read_master_in.control_done = '1' and read_go = '0')) and
+                           write_master_in.control_done = '1' and write_go = '0' then
+                            if not cur_row.is_leading then
+                                read_go <= '1';
+                            end if;
+                            if not cur_row.is_lagging then
+                                write_go <= '1';
+                            end if;
+                            src_words <= 0;
+                            src_fragments <= 0;
+                            sums_done <= 0;
+                            state <= S_STREAM;
+                        end if;
+
+                    when S_STREAM =>
+                        if take = '1' then
+                            word := (others => '0');
+                            if not cur_row.is_leading then
+                                word := read_master_in.user_buffer_data;
+                            end if;
+                            gather <= word & gather(gather'high downto FIFO_WORD_LENGTH);
+                            if src_words = 0 and not cur_row.is_lagging then
+                                reserved := reserved + SUM_WORDS;
+                            end if;
+                            if src_words = SUM_WORDS-1 then
+                                src_words <= 0;
+                                gather_done <= '1';
+                                gather_index <= src_fragments;
+                                src_fragments <= src_fragments + 1;
+                            else
+                                src_words <= src_words + 1;
+                            end if;
+                        end if;
+
+                        if e2_done = '1' then
+                            if sums_done = FRAGMENTS_PER_ROW-1 then
+                                rows_done <= rows_done + 1;
+                                state <= S_IDLE;
+                            end if;
+                            sums_done <= sums_done + 1;
+                        end if;
+                end case;
+            end if;
+
+            out_reserved <= reserved;
+        end if;
+    end process engine;
+
+    -- Pipeline stage 0: request the buffered fragment the gathered sums belong to
+    e0 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            e0_done <= '0';
+            input_read_enable <= '0';
+            input_read_address <= (others => '0');
+        elsif rising_edge(clock) then
+            e0_done <= gather_done;
+            input_read_enable <= '0';
+            if gather_done = '1' then
+                input_read_address <= to_address(cur_slot, gather_index);
+                input_read_enable <= '1';
+                sum_e0 <= unpack(gather);
+                index_e0 <= (
+                    x => cur_row.x,
+                    i_fragment => gather_index,
+                    i_window => cur_row.i_window,
+                    is_leading => cur_row.is_leading,
+                    is_lagging => cur_row.is_lagging
+                );
+            end if;
+        end if;
+    end process e0;
+
+    -- Pipeline stage 1: delay until the fragment is ready
+    e1 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            e1_done <= '0';
+        elsif rising_edge(clock) then
+            e1_done <= e0_done;
+            if e0_done = '1' then
+                sum_e1 <= sum_e0;
+                index_e1 <= index_e0;
+            end if;
+        end if;
+    end process e1;
+
+    -- Pipeline stage 2: add the fragment to its sums, then either emit
+    -- them (lagging rows) or queue them to be written back. Words are
+    -- shifted out of `scatter` into the write-back FIFO one per clock
+    -- cycle, which keeps up since a fragment takes at least SUM_WORDS
+    -- cycles to gather
+    e2 : process (clock, reset_n)
+        variable sum : sum_t;
+    begin
+        if reset_n = '0' then
+            e2_done <= '0';
+            e2_emit <= '0';
+            scatter_words <= 0;
+            out_write <= '0';
+        elsif rising_edge(clock) then
+            e2_done <= '0';
+            e2_emit <= '0';
+            out_write <= '0';
+
+            if scatter_words /= 0 then
+                out_data <= scatter(FIFO_WORD_LENGTH-1 downto 0);
+                out_write <= '1';
+                scatter <= std_logic_vector(shift_right(unsigned(scatter), FIFO_WORD_LENGTH));
+                scatter_words <= scatter_words - 1;
+            end if;
+
+            if e1_done = '1' then
+                sum := sum_e1 + to_sum(input_read_data);
+                if index_e1.is_lagging then
+                    sum_e2 <= sum;
+                    reciprocal_e2 <= window_reciprocals(index_e1.i_window);
+                    index_e2 <= index_e1;
+                    e2_emit <= '1';
+                else
+                    scatter <= pack(sum);
+                    scatter_words <= SUM_WORDS;
+                end if;
+                e2_done <= '1';
+            end if;
+        end if;
+    end process e2;
+
+    -- Pipeline stage 3: compute the average from the sum, if averaging,
+    -- and emit it
+    e3 : process (clock, reset_n)
+        variable i_frame : integer;
+    begin
+        if reset_n = '0' then
+            row_fragment_window <= -1;
+            done <= '0';
+        elsif rising_edge(clock) then
+            row_fragment_window <= -1;
+            done <= '0';
+
+            if start = '1' then
+                i_frame := 0;
+            elsif e2_emit = '1' then
+                if METHOD = "SUM" then
+                    row_fragment <= resize_pixels(sum_e2, ROW_PIXEL_BITS);
+                elsif METHOD = "AVERAGE" then
+                    row_fragment <= resize_pixels(
+                        reciprocal_divide(sum_e2, reciprocal_e2, RECIPROCAL_SHIFT),
+                        ROW_PIXEL_BITS
+                    );
+                else
+                    report "Unrecognized METHOD" severity failure;
+                end if;
+                row_fragment_index <= index_e2.i_fragment;
+                row_fragment_window <= index_e2.i_window;
+                if index_e2.i_fragment = FRAGMENTS_PER_ROW-1 and index_e2.i_window = N_WINDOWS-1 then
+                    if i_frame = length-1 then
+                        done <= '1';
+                    end if;
+                    i_frame := i_frame + 1;
+                end if;
+            end if;
+        end if;
+    end process e3;
+
+    out_read <= '1' when out_empty = '0' and write_master_in.user_buffer_full = '0' else '0';
+
+    read_master_out.control_fixed_location <= '0';
+    read_master_out.control_go <= read_go;
+    read_master_out.control_read_base <= std_logic_vector(sum_base);
+    read_master_out.control_read_length <= std_logic_vector(to_unsigned(ROW_SUM_BYTES, sdram.ADDRESS_LENGTH));
+    read_master_out.user_read_buffer <= take when not cur_row.is_leading else '0';
+
+    write_master_out.control_fixed_location <= '0';
+    write_master_out.control_go <= write_go;
+    write_master_out.control_write_base <= std_logic_vector(sum_base);
+    write_master_out.control_write_length <= std_logic_vector(to_unsigned(ROW_SUM_BYTES, sdram.ADDRESS_LENGTH));
+    write_master_out.user_write_buffer <= out_read;
+    write_master_out.user_buffer_data <= out_q;
+
+    input_ram : pixel_integrator_fifo generic map (
+        WORD_SIZE => FRAGMENT_WIDTH * PIXEL_BITS,
+        ADDRESS_SIZE => INPUT_ADDRESS_BITS
+    ) port map (
+        clock => clock,
+        read_data => input_read_data,
+        read_address => input_read_address,
+        read_enable => input_read_enable,
+        write_data => input_write_data,
+        write_address => input_write_address,
+        write_enable => input_write_enable
+    );
+
+    out_clear <= not reset_n;
+
+    out_fifo : entity work.row_fifo generic map (
+        WORD_SIZE => FIFO_WORD_LENGTH,
+        NUM_WORDS => OUT_FIFO_WORDS,
+        SHOWAHEAD => "ON"
+    ) port map (
+        aclr => out_clear,
+        clock => clock,
+        data => out_data,
+        rdreq => out_read,
+        wrreq => out_write,
+        empty => out_empty,
+        full => open,
+        q => out_q
+    );
+
+end architecture rtl;
@@ -0,0 +1,249 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+-- Applies a flat-field and dark-frame correction to the fragments
+-- emitted by `pixel_integrator`, computing
+--
+--     out = (in - dark[x]) * gain[x]
+--
+-- for every pixel, where x is the pixel's column and dark and gain are
+-- taken from a table kept for each window (band). Differences below
+-- zero are clamped to zero, and results above the largest
+-- ROW_PIXEL_BITS-bit value are saturated. gain is an unsigned
+-- fixed-point value with GAIN_FRACTION_BITS fractional bits, so a gain
+-- of 1.0 is 2**GAIN_FRACTION_BITS. The result is rounded to the
+-- nearest integer.
+--
+-- Fragments are input through `fragment`, `fragment_index` and
+-- `fragment_window`, as emitted by `pixel_integrator` (fragment f
+-- holds pixels f, f + FRAGMENTS_PER_ROW, ...), and are output through
+-- `row_fragment`, `row_fragment_index` and `row_fragment_window` four
+-- clock cycles later. A fragment can be input on every clock cycle.
+-- When `enable` is '0', fragments are passed through unchanged, with
+-- the same latency.
+--
+-- The tables are held in FRAGMENT_WIDTH RAM banks, with bank i
+-- holding the columns of lane i, so that a whole fragment's entries
+-- can be read in a single clock cycle. An entry is written by setting
+-- `table_window`, `table_column`, `table_dark` and `table_gain`, and
+-- asserting `table_write` for a single clock cycle. The tables aren't
+-- initialized, so they must be written before `enable` is set.
+entity radiometric_corrector is
+generic (
+    ROW_WIDTH           : integer;
+    FRAGMENT_WIDTH      : integer;
+    ROW_PIXEL_BITS      : integer;
+    N_WINDOWS           : integer;
+    GAIN_BITS           : integer := 16;
+    GAIN_FRACTION_BITS  : integer := 14
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    enable              : in std_logic;
+
+    table_window        : in integer;
+    table_column        : in integer;
+    table_dark          : in unsigned(ROW_PIXEL_BITS-1 downto 0);
+    table_gain          : in unsigned(GAIN_BITS-1 downto 0);
+    table_write         : in std_logic;
+
+    fragment            : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    fragment_index      : in integer;
+    fragment_window     : in integer;
+
+    row_fragment        : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    row_fragment_index  : out integer;
+    row_fragment_window : out integer
+);
+end entity radiometric_corrector;
+
+
+architecture rtl of radiometric_corrector is
+
+    component pixel_integrator_fifo is
+    generic (
+        WORD_SIZE       : integer;
+        ADDRESS_SIZE    : integer
+    );
+    port (
+        clock           : in std_logic;
+        read_data       : out std_logic_vector;
+        read_address    : in std_logic_vector;
+        read_enable     : in std_logic;
+        write_data      : in std_logic_vector;
+        write_address   : in std_logic_vector;
+        write_enable    : in std_logic
+    );
+    end component pixel_integrator_fifo;
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant ADDRESS_BITS : integer := integer(ceil(log2(real(N_WINDOWS * FRAGMENTS_PER_ROW))));
+    -- Each table entry holds {dark, gain}
+    constant ENTRY_BITS : integer := ROW_PIXEL_BITS + GAIN_BITS;
+    constant PRODUCT_BITS : integer := ROW_PIXEL_BITS + GAIN_BITS;
+    constant MAX_PIXEL : unsigned(PRODUCT_BITS-1 downto 0) := to_unsigned(2 ** ROW_PIXEL_BITS - 1, PRODUCT_BITS);
+    constant ROUNDING : unsigned(PRODUCT_BITS-1 downto 0) := to_unsigned(2 ** GAIN_FRACTION_BITS / 2, PRODUCT_BITS);
+
+    type gain_vector_t is array(integer range <>) of unsigned(GAIN_BITS-1 downto 0);
+
+    pure function to_address(window : integer; i_fragment : integer) return std_logic_vector is
+    begin
+        return std_logic_vector(to_unsigned(FRAGMENTS_PER_ROW * window + i_fragment, ADDRESS_BITS));
+    end function to_address;
+
+    -- RAM signals
+    signal read_data        : lpixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ENTRY_BITS-1 downto 0);
+    signal read_address     : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal read_enable      : std_logic;
+    signal write_data       : std_logic_vector(ENTRY_BITS-1 downto 0);
+    signal write_address    : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal write_enable     : std_logic_vector(FRAGMENT_WIDTH-1 downto 0);
+
+    -- Pipeline stage 0 output
+    signal fragment_c0      : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal index_c0         : integer;
+    signal window_c0        : integer;
+    -- Pipeline stage 1 output
+    signal fragment_c1      : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal index_c1         : integer;
+    signal window_c1        : integer;
+    -- Pipeline stage 2 output
+    signal fragment_c2      : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal difference_c2    : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal gain_c2          : gain_vector_t(FRAGMENT_WIDTH-1 downto 0);
+    signal index_c2         : integer;
+    signal window_c2        : integer;
+
+begin
+
+    -- Registering table writes, so the RAM's write port doesn't
+    -- depend on the controller's registers combinationally
+    table_process : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            write_enable <= (others => '0');
+        elsif rising_edge(clock) then
+            write_enable <= (others => '0');
+            if table_write = '1' then
+                write_address <= to_address(table_window, table_column mod FRAGMENTS_PER_ROW);
+                write_data <= std_logic_vector(table_dark) & std_logic_vector(table_gain);
+                write_enable(table_column / FRAGMENTS_PER_ROW) <= '1';
+            end if;
+        end if;
+    end process table_process;
+
+    -- Pipeline stage 0: request the fragment's table entries
+    c0 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            window_c0 <= -1;
+            read_enable <= '0';
+            read_address <= (others => '0');
+        elsif rising_edge(clock) then
+            read_enable <= '0';
+            window_c0 <= fragment_window;
+            if fragment_window /= -1 then
+                read_address <= to_address(fragment_window, fragment_index);
+                read_enable <= '1';
+                fragment_c0 <= fragment;
+                index_c0 <= fragment_index;
+            end if;
+        end if;
+    end process c0;
+
+    -- Pipeline stage 1: delay until the entries are ready
+    c1 : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            window_c1 <= -1;
+        elsif rising_edge(clock) then
+            window_c1 <= window_c0;
+            fragment_c1 <= fragment_c0;
+            index_c1 <= index_c0;
+        end if;
+    end process c1;
+
+    -- Pipeline stage 2: subtract the dark frame
+    c2 : process (clock, reset_n)
+        variable dark : unsigned(ROW_PIXEL_BITS-1 downto 0);
+    begin
+        if reset_n = '0' then
+            window_c2 <= -1;
+        elsif rising_edge(clock) then
+            window_c2 <= window_c1;
+            fragment_c2 <= fragment_c1;
+            index_c2 <= index_c1;
+            for i in fragment_c1'range loop
+                dark := unsigned(read_data(i)(ENTRY_BITS-1 downto GAIN_BITS));
+                if fragment_c1(i) > dark then
+                    difference_c2(i) <= fragment_c1(i) - dark;
+                else
+                    difference_c2(i) <= (others => '0');
+                end if;
+                gain_c2(i) <= unsigned(read_data(i)(GAIN_BITS-1 downto 0));
+            end loop;
+        end if;
+    end process c2;
+
+    -- Pipeline stage 3: apply the gain
+    c3 : process (clock, reset_n)
+        variable product : unsigned(PRODUCT_BITS-1 downto 0);
+    begin
+        if reset_n = '0' then
+            row_fragment_window <= -1;
+        elsif rising_edge(clock) then
+            row_fragment_window <= window_c2;
+            row_fragment_index <= index_c2;
+            for i in fragment_c2'range loop
+                product := shift_right(difference_c2(i) * gain_c2(i) + ROUNDING, GAIN_FRACTION_BITS);
+                if enable = '0' then
+                    row_fragment(i) <= fragment_c2(i);
+                elsif product > MAX_PIXEL then
+                    row_fragment(i) <= MAX_PIXEL(ROW_PIXEL_BITS-1 downto 0);
+                else
+                    row_fragment(i) <= product(ROW_PIXEL_BITS-1 downto 0);
+                end if;
+            end loop;
+        end if;
+    end process c3;
+
+    RAM_GEN : for i in 0 to FRAGMENT_WIDTH-1 generate
+        ram : pixel_integrator_fifo generic map (
+            WORD_SIZE => ENTRY_BITS,
+            ADDRESS_SIZE => ADDRESS_BITS
+        ) port map (
+            clock => clock,
+            read_data => read_data(i),
+            read_address => read_address,
+            read_enable => read_enable,
+            write_data => write_data,
+            write_address => write_address,
+            write_enable => write_enable(i)
+        );
+    end generate RAM_GEN;
+
+end architecture rtl;
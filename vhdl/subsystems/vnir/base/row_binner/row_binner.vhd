@@ -0,0 +1,189 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.vnir_base.all;
+
+-- Bins the rows emitted by `row_collator` across-track, combining
+-- each run of `binning` (1, 2 or 4) adjacent pixels into one.
+--
+-- With METHOD = "AVERAGE" a binned pixel is the mean of its pixels
+-- (rounded down, as in `pixel_integrator`), and with METHOD = "SUM" it
+-- is their sum, saturated to ROW_PIXEL_BITS bits. Since a fragment
+-- holds consecutive pixels, `binning` input fragments are packed into
+-- a single output fragment, so a binned row is ROW_WIDTH / `binning`
+-- pixels wide and has `binning` times fewer fragments. Any other value
+-- of `binning` is treated as 1, which passes the rows through
+-- unchanged. `binning` is read at the start of each row.
+--
+-- The input and output are Avalon-ST streams with the same signals as
+-- `row_collator`'s output, with the window as the channel and each row
+-- as a packet. The output fragment is registered, and the input is
+-- only stalled while it is held up by `binned_ready`.
+entity row_binner is
+generic (
+    FRAGMENT_WIDTH      : integer;
+    ROW_PIXEL_BITS      : integer;
+    METHOD              : string
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    binning             : in integer;
+
+    pixels              : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    pixels_window       : in integer;
+    pixels_first        : in std_logic;
+    pixels_last         : in std_logic;
+    pixels_ready        : out std_logic;
+
+    binned              : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    binned_window       : out integer;
+    binned_first        : out std_logic;
+    binned_last         : out std_logic;
+    binned_ready        : in std_logic
+);
+end entity row_binner;
+
+
+architecture rtl of row_binner is
+
+    constant MAX_BINNING : integer := 4;
+
+    -- The first FRAGMENT_WIDTH / factor pixels of the fragment, binned
+    pure function bin_pixels(p : pixel_vector_t; factor : integer) return pixel_vector_t is
+        variable re     : pixel_vector_t(FRAGMENT_WIDTH/factor-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+        variable sum    : unsigned(ROW_PIXEL_BITS+1 downto 0);
+        variable shift  : integer;
+    begin
+        if factor = 4 then
+            shift := 2;
+        elsif factor = 2 then
+            shift := 1;
+        else
+            shift := 0;
+        end if;
+
+        for j in re'range loop
+            sum := (others => '0');
+            for k in 0 to factor-1 loop
+                sum := sum + p(j*factor + k);
+            end loop;
+
+            if METHOD = "SUM" then
+                if sum > 2**ROW_PIXEL_BITS - 1 then
+                    re(j) := (others => '1');
+                else
+                    re(j) := resize(sum, ROW_PIXEL_BITS);
+                end if;
+            elsif METHOD = "AVERAGE" then
+                re(j) := resize(shift_right(sum, shift), ROW_PIXEL_BITS);
+            else
+                report "Unrecognized METHOD" severity failure;
+            end if;
+        end loop;
+        return re;
+    end function bin_pixels;
+
+    signal factor           : integer range 1 to MAX_BINNING;
+    signal count            : integer range 0 to MAX_BINNING-1;
+    signal packed           : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal packed_first     : std_logic;
+    signal window_out       : integer;
+    signal ready            : std_logic;
+
+begin
+
+    assert FRAGMENT_WIDTH mod MAX_BINNING = 0
+        report "row_binner requires MAX_BINNING to divide FRAGMENT_WIDTH" severity failure;
+
+    ready <= '1' when window_out = -1 or binned_ready = '1' else '0';
+    pixels_ready <= ready;
+
+    -- Binned pixels are shifted in from the top of `packed`, so once
+    -- `factor` fragments have come in, the first one's pixels are at
+    -- the bottom
+    bin_process : process (clock, reset_n)
+        variable factor_v   : integer range 1 to MAX_BINNING;
+        variable count_v    : integer range 0 to MAX_BINNING-1;
+        variable packed_v   : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+        variable first_v    : std_logic;
+    begin
+        if reset_n = '0' then
+            factor <= 1;
+            count <= 0;
+            packed_first <= '0';
+            window_out <= -1;
+            binned_first <= '0';
+            binned_last <= '0';
+        elsif rising_edge(clock) then
+            if binned_ready = '1' then
+                window_out <= -1;
+                binned_first <= '0';
+                binned_last <= '0';
+            end if;
+
+            if pixels_window >= 0 and ready = '1' then
+                factor_v := factor;
+                count_v := count;
+                first_v := packed_first;
+                if pixels_first = '1' then
+                    if binning = 2 or binning = 4 then
+                        factor_v := binning;
+                    else
+                        factor_v := 1;
+                    end if;
+                    count_v := 0;
+                end if;
+                if count_v = 0 then
+                    first_v := pixels_first;
+                end if;
+
+                case factor_v is
+                when 4 =>
+                    packed_v := bin_pixels(pixels, 4) & packed(FRAGMENT_WIDTH-1 downto FRAGMENT_WIDTH/4);
+                when 2 =>
+                    packed_v := bin_pixels(pixels, 2) & packed(FRAGMENT_WIDTH-1 downto FRAGMENT_WIDTH/2);
+                when others =>
+                    packed_v := pixels;
+                end case;
+
+                if count_v = factor_v-1 or pixels_last = '1' then
+                    binned <= packed_v;
+                    window_out <= pixels_window;
+                    binned_first <= first_v;
+                    binned_last <= pixels_last;
+                    count_v := 0;
+                else
+                    count_v := count_v + 1;
+                end if;
+
+                factor <= factor_v;
+                count <= count_v;
+                packed <= packed_v;
+                packed_first <= first_v;
+            end if;
+        end if;
+    end process bin_process;
+
+    binned_window <= window_out;
+
+end architecture rtl;
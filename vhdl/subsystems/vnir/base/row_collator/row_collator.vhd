@@ -0,0 +1,325 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+-- Puts the fragments emitted by `pixel_integrator` back into pixel
+-- order, one fragment at a time.
+--
+-- `pixel_integrator` emits a row as FRAGMENTS_PER_ROW fragments, with
+-- fragment f holding pixels
+--
+--     f, f + FRAGMENTS_PER_ROW, f + 2*FRAGMENTS_PER_ROW, ...
+--
+-- (one pixel from each of the sensor's LVDS channels).
+-- `row_collator` re-emits the row as FRAGMENTS_PER_ROW fragments of
+-- consecutive pixels, with fragment g holding pixels
+--
+--     FRAGMENT_WIDTH*g, FRAGMENT_WIDTH*g + 1, ..., FRAGMENT_WIDTH*g + FRAGMENT_WIDTH-1
+--
+-- so that they can be packed straight into memory words, without
+-- having to collect the whole row into registers first.
+--
+-- Since the last fragment of a row holds the last pixel of every
+-- channel, no output fragment can be emitted before the whole row has
+-- been recieved. Rows are stored in a ring of N_ROWS rows held in
+-- FRAGMENT_WIDTH RAM banks. Lane i of input fragment f is stored in
+-- bank (i + f) mod FRAGMENT_WIDTH, so that both a whole input fragment
+-- can be written, and a whole output fragment can be read, in a single
+-- clock cycle.
+--
+-- Fragments are input through `fragment`, `fragment_index` (the index
+-- of the fragment in its row) and `fragment_window` (the window the
+-- row belongs to, or -1 if `fragment` isn't valid). Fragments of a row
+-- must be input in order, but not necessarily on consecutive clock
+-- cycles. Once a row has been recieved, it is output through `pixels`
+-- with `pixels_window` set to the row's window (or -1 when `pixels`
+-- isn't valid), and `pixels_first` and `pixels_last` set on the first
+-- and last fragment of the row.
+--
+-- The output follows Avalon-ST ready/valid semantics with a
+-- readyLatency of 0: a fragment is accepted on each clock cycle on
+-- which `pixels_window` /= -1 and `pixels_ready` = '1', and is held
+-- until it has been accepted. The input can't be stalled (the sensor
+-- keeps sending frames), so the ring of N_ROWS rows is what absorbs
+-- backpressure. If a row starts arriving while the ring is full, the
+-- whole row is dropped and `overflow` is held high for a single clock
+-- cycle.
+entity row_collator is
+generic (
+    ROW_WIDTH           : integer;
+    FRAGMENT_WIDTH      : integer;
+    ROW_PIXEL_BITS      : integer;
+    N_ROWS              : integer := 4
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    fragment            : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    fragment_index      : in integer;
+    fragment_window     : in integer;
+
+    pixels              : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    pixels_window       : out integer;
+    pixels_first        : out std_logic;
+    pixels_last         : out std_logic;
+    pixels_ready        : in std_logic;
+
+    overflow            : out std_logic
+);
+end entity row_collator;
+
+
+architecture rtl of row_collator is
+
+    component pixel_integrator_fifo is
+    generic (
+        WORD_SIZE       : integer;
+        ADDRESS_SIZE    : integer
+    );
+    port (
+        clock           : in std_logic;
+        read_data       : out std_logic_vector;
+        read_address    : in std_logic_vector;
+        read_enable     : in std_logic;
+        write_data      : in std_logic_vector;
+        write_address   : in std_logic_vector;
+        write_enable    : in std_logic
+    );
+    end component pixel_integrator_fifo;
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    -- Number of output fragments taken from each channel
+    constant FRAGMENTS_PER_LANE : integer := FRAGMENTS_PER_ROW / FRAGMENT_WIDTH;
+    constant ADDRESS_BITS : integer := integer(ceil(log2(real(N_ROWS * FRAGMENTS_PER_ROW))));
+
+    type address_vector_t is array(integer range <>) of std_logic_vector(ADDRESS_BITS-1 downto 0);
+    type window_ring_t is array(0 to N_ROWS-1) of integer;
+
+    -- RAM signals
+    signal read_data        : lpixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal read_address     : std_logic_vector(ADDRESS_BITS-1 downto 0);
+    signal read_enable      : std_logic;
+    signal write_data       : lpixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal write_address    : address_vector_t(FRAGMENT_WIDTH-1 downto 0);
+    signal write_enable     : std_logic;
+
+    -- Ring of stored rows
+    signal windows          : window_ring_t;
+    signal write_row        : integer range 0 to N_ROWS-1;
+    signal rows_stored      : integer range 0 to N_ROWS;
+    signal row_done         : std_logic;
+
+    -- Read pipeline. Every stage only advances when the output stage is
+    -- empty or its fragment is being accepted.
+    signal advance          : std_logic;
+    signal lane_p0          : integer range 0 to FRAGMENT_WIDTH-1;
+    signal window_p0        : integer;
+    signal first_p0         : std_logic;
+    signal last_p0          : std_logic;
+    signal lane_p1          : integer range 0 to FRAGMENT_WIDTH-1;
+    signal window_p1        : integer;
+    signal first_p1         : std_logic;
+    signal last_p1          : std_logic;
+    signal window_p2        : integer;
+
+begin
+
+    assert FRAGMENTS_PER_ROW mod FRAGMENT_WIDTH = 0
+        report "row_collator requires FRAGMENT_WIDTH to divide ROW_WIDTH / FRAGMENT_WIDTH" severity failure;
+
+    -- Write stage: rotate the fragment so that lane i lands in bank (i + f) mod FRAGMENT_WIDTH
+    write_process : process (clock, reset_n)
+        variable lane       : integer;
+        variable occupied   : integer range 0 to N_ROWS+2;
+        variable dropping   : boolean;
+    begin
+        if reset_n = '0' then
+            write_enable <= '0';
+            write_row <= 0;
+            row_done <= '0';
+            overflow <= '0';
+            windows <= (others => -1);
+            dropping := false;
+        elsif rising_edge(clock) then
+            write_enable <= '0';
+            row_done <= '0';
+            overflow <= '0';
+            if fragment_window >= 0 then
+                -- A row's slot stays occupied until its last address has
+                -- left read stage 0
+                occupied := rows_stored;
+                if row_done = '1' then
+                    occupied := occupied + 1;
+                end if;
+                if window_p0 >= 0 and last_p0 = '1' then
+                    occupied := occupied + 1;
+                end if;
+                if fragment_index = 0 then
+                    dropping := occupied >= N_ROWS;
+                    if dropping then
+                        overflow <= '1';
+                    end if;
+                end if;
+
+                if not dropping then
+                    for bank in 0 to FRAGMENT_WIDTH-1 loop
+                        lane := (bank - fragment_index) mod FRAGMENT_WIDTH;
+                        write_data(bank) <= std_logic_vector(fragment(lane));
+                        write_address(bank) <= std_logic_vector(to_unsigned(
+                            FRAGMENTS_PER_ROW * write_row + FRAGMENTS_PER_LANE * lane + fragment_index / FRAGMENT_WIDTH,
+                            ADDRESS_BITS
+                        ));
+                    end loop;
+                    write_enable <= '1';
+                    windows(write_row) <= fragment_window;
+
+                    if fragment_index = FRAGMENTS_PER_ROW-1 then
+                        row_done <= '1';
+                        write_row <= (write_row + 1) mod N_ROWS;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process write_process;
+
+    advance <= '0' when window_p2 >= 0 and pixels_ready = '0' else '1';
+    -- The RAMs hold their output while read_enable is low, which stalls
+    -- read stage 1 along with the rest of the pipeline
+    read_enable <= advance;
+
+    -- Read stage 0: read out a stored row, one output fragment per clock cycle
+    read_process : process (clock, reset_n)
+        variable read_row   : integer range 0 to N_ROWS-1;
+        variable i_out      : integer range 0 to FRAGMENTS_PER_ROW-1;
+        variable reading    : boolean;
+        variable stored     : integer range 0 to N_ROWS;
+        variable lane       : integer;
+    begin
+        if reset_n = '0' then
+            read_address <= (others => '0');
+            window_p0 <= -1;
+            first_p0 <= '0';
+            last_p0 <= '0';
+            rows_stored <= 0;
+            read_row := 0;
+            i_out := 0;
+            reading := false;
+        elsif rising_edge(clock) then
+            stored := rows_stored;
+            if row_done = '1' then
+                stored := stored + 1;
+            end if;
+
+            if advance = '1' then
+                window_p0 <= -1;
+                first_p0 <= '0';
+                last_p0 <= '0';
+
+                if not reading and stored > 0 then
+                    reading := true;
+                    i_out := 0;
+                end if;
+
+                if reading then
+                    lane := i_out / FRAGMENTS_PER_LANE;
+                    read_address <= std_logic_vector(to_unsigned(
+                        FRAGMENTS_PER_ROW * read_row + i_out, ADDRESS_BITS
+                    ));
+                    lane_p0 <= lane;
+                    window_p0 <= windows(read_row);
+                    if i_out = 0 then
+                        first_p0 <= '1';
+                    end if;
+
+                    if i_out = FRAGMENTS_PER_ROW-1 then
+                        last_p0 <= '1';
+                        reading := false;
+                        stored := stored - 1;
+                        read_row := (read_row + 1) mod N_ROWS;
+                    else
+                        i_out := i_out + 1;
+                    end if;
+                end if;
+            end if;
+
+            rows_stored <= stored;
+        end if;
+    end process read_process;
+
+    -- Read stage 1: delay until the read data is ready
+    delay_process : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            window_p1 <= -1;
+            first_p1 <= '0';
+            last_p1 <= '0';
+        elsif rising_edge(clock) then
+            if advance = '1' then
+                lane_p1 <= lane_p0;
+                window_p1 <= window_p0;
+                first_p1 <= first_p0;
+                last_p1 <= last_p0;
+            end if;
+        end if;
+    end process delay_process;
+
+    -- Read stage 2: rotate the banks back into pixel order
+    output_process : process (clock, reset_n)
+    begin
+        if reset_n = '0' then
+            window_p2 <= -1;
+            pixels_first <= '0';
+            pixels_last <= '0';
+        elsif rising_edge(clock) then
+            if advance = '1' then
+                for k in 0 to FRAGMENT_WIDTH-1 loop
+                    pixels(k) <= unsigned(read_data((lane_p1 + k) mod FRAGMENT_WIDTH));
+                end loop;
+                window_p2 <= window_p1;
+                pixels_first <= first_p1;
+                pixels_last <= last_p1;
+            end if;
+        end if;
+    end process output_process;
+
+    pixels_window <= window_p2;
+
+    generate_RAM : for i in 0 to FRAGMENT_WIDTH-1 generate
+
+        RAM : pixel_integrator_fifo generic map (
+            WORD_SIZE => ROW_PIXEL_BITS,
+            ADDRESS_SIZE => ADDRESS_BITS
+        ) port map (
+            clock => clock,
+            read_data => read_data(i),
+            read_address => read_address,
+            read_enable => read_enable,
+            write_data => write_data(i),
+            write_address => write_address(i),
+            write_enable => write_enable
+        );
+
+    end generate;
+
+end architecture rtl;
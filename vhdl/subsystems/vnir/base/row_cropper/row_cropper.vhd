@@ -0,0 +1,176 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+use work.vnir_base.all;
+
+-- Crops the rows emitted by `row_binner` across-track, keeping
+-- `crop_widths(w)` pixels starting from pixel `crop_starts(w)` of each
+-- row of window w. Each window has its own start, so that the bands
+-- can be lined up with each other (e.g. to compensate for keystone),
+-- and its own width. A width of 0 passes the window's rows through
+-- unchanged.
+--
+-- The widths must be multiples of FRAGMENT_WIDTH, and the cropped
+-- columns must lie within the (binned) row. The start needn't be a
+-- multiple of FRAGMENT_WIDTH: each output fragment is then taken from
+-- two consecutive input fragments, so the previous input fragment is
+-- held and the pair is shifted down by `crop_starts(w)` mod
+-- FRAGMENT_WIDTH pixels. The crop is read at the start of each row.
+--
+-- The input and output are Avalon-ST streams with the same signals as
+-- `row_collator`'s output. Input fragments outside of the crop are
+-- accepted and dropped.
+entity row_cropper is
+generic (
+    FRAGMENT_WIDTH      : integer;
+    ROW_PIXEL_BITS      : integer
+);
+port (
+    clock               : in std_logic;
+    reset_n             : in std_logic;
+
+    crop_starts         : in integer_vector;
+    crop_widths         : in integer_vector;
+
+    pixels              : in pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    pixels_window       : in integer;
+    pixels_first        : in std_logic;
+    pixels_last         : in std_logic;
+    pixels_ready        : out std_logic;
+
+    cropped             : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    cropped_window      : out integer;
+    cropped_first       : out std_logic;
+    cropped_last        : out std_logic;
+    cropped_ready       : in std_logic
+);
+end entity row_cropper;
+
+
+architecture rtl of row_cropper is
+
+    -- Input fragment count, and crop of the current row, in fragments
+    -- except for the shift
+    signal index            : integer;
+    signal skip             : integer;
+    signal shift            : integer range 0 to FRAGMENT_WIDTH-1;
+    signal n_out            : integer;
+    signal out_count        : integer;
+    signal previous         : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+
+    signal window_out       : integer;
+    signal ready            : std_logic;
+
+begin
+
+    ready <= '1' when window_out = -1 or cropped_ready = '1' else '0';
+    pixels_ready <= ready;
+
+    crop_process : process (clock, reset_n)
+        variable index_v    : integer;
+        variable skip_v     : integer;
+        variable shift_v    : integer range 0 to FRAGMENT_WIDTH-1;
+        variable n_out_v    : integer;
+        variable count_v    : integer;
+        variable emit       : boolean;
+        variable shifted    : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    begin
+        if reset_n = '0' then
+            index <= 0;
+            skip <= 0;
+            shift <= 0;
+            n_out <= 0;
+            out_count <= 0;
+            window_out <= -1;
+            cropped_first <= '0';
+            cropped_last <= '0';
+        elsif rising_edge(clock) then
+            if cropped_ready = '1' then
+                window_out <= -1;
+                cropped_first <= '0';
+                cropped_last <= '0';
+            end if;
+
+            if pixels_window >= 0 and ready = '1' then
+                index_v := index;
+                skip_v := skip;
+                shift_v := shift;
+                n_out_v := n_out;
+                count_v := out_count;
+                if pixels_first = '1' then
+                    index_v := 0;
+                    count_v := 0;
+                    if crop_widths(pixels_window) > 0 then
+                        skip_v := crop_starts(pixels_window) / FRAGMENT_WIDTH;
+                        shift_v := crop_starts(pixels_window) mod FRAGMENT_WIDTH;
+                        n_out_v := crop_widths(pixels_window) / FRAGMENT_WIDTH;
+                    else
+                        skip_v := 0;
+                        shift_v := 0;
+                        n_out_v := -1;
+                    end if;
+                end if;
+
+                -- Output fragment j is made of input fragments skip + j and,
+                -- if shifted, skip + j + 1
+                for k in 0 to FRAGMENT_WIDTH-1 loop
+                    if k + shift_v < FRAGMENT_WIDTH then
+                        shifted(k) := previous(k + shift_v);
+                    else
+                        shifted(k) := pixels(k + shift_v - FRAGMENT_WIDTH);
+                    end if;
+                end loop;
+
+                if n_out_v < 0 then
+                    emit := true;
+                    cropped <= pixels;
+                    cropped_first <= pixels_first;
+                    cropped_last <= pixels_last;
+                elsif shift_v = 0 then
+                    emit := index_v >= skip_v and count_v < n_out_v;
+                    cropped <= pixels;
+                else
+                    emit := index_v > skip_v and count_v < n_out_v;
+                    cropped <= shifted;
+                end if;
+
+                if emit then
+                    window_out <= pixels_window;
+                    if n_out_v >= 0 then
+                        cropped_first <= '1' when count_v = 0 else '0';
+                        cropped_last <= '1' when count_v = n_out_v-1 else '0';
+                        count_v := count_v + 1;
+                    end if;
+                end if;
+
+                index <= index_v + 1;
+                skip <= skip_v;
+                shift <= shift_v;
+                n_out <= n_out_v;
+                out_count <= count_v;
+                previous <= pixels;
+            end if;
+        end if;
+    end process crop_process;
+
+    cropped_window <= window_out;
+
+end architecture rtl;
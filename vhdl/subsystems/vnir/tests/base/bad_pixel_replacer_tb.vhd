@@ -0,0 +1,214 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir_base.all;
+
+use work.vnir.ROW_WIDTH;
+use work.vnir.FRAGMENT_WIDTH;
+use work.vnir.ROW_PIXEL_BITS;
+use work.vnir.N_WINDOWS;
+
+
+-- Takes two images of ROWS rows each through window 1, writing a
+-- different bad column map before each, and checks every pixel out.
+--
+-- The first map has a bad column in the middle of the row, the first
+-- and last columns of the row, a column in the first fragment and one
+-- in the last fragment (whose left or right neighbour is in a fragment
+-- at the other end of the row, so isn't used), and two bad columns
+-- side by side (each only replaced with its other neighbour). The
+-- second map only has a column that was good in the first one, so the
+-- columns replaced in the first image have to come out unchanged.
+entity bad_pixel_replacer_tb is
+end entity bad_pixel_replacer_tb;
+
+architecture tests of bad_pixel_replacer_tb is
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant WINDOW : integer := 1;
+    constant ROWS : integer := 2;
+    constant N_MAPS : integer := 2;
+
+    type column_a is array (natural range <>) of integer;
+    constant MAP_0 : column_a := (
+        5 + 3 * FRAGMENTS_PER_ROW,                                  -- middle of the row
+        0,                                                          -- first column
+        ROW_WIDTH - 1,                                              -- last column
+        2 * FRAGMENTS_PER_ROW,                                      -- first fragment
+        FRAGMENTS_PER_ROW - 1 + 4 * FRAGMENTS_PER_ROW,              -- last fragment
+        10 + 6 * FRAGMENTS_PER_ROW, 11 + 6 * FRAGMENTS_PER_ROW      -- side by side
+    );
+    constant MAP_1 : column_a := (0 => 20 + 8 * FRAGMENTS_PER_ROW);
+
+    signal clock                : std_logic := '0';
+    signal reset_n              : std_logic := '0';
+    signal map_index            : integer := 0;
+    signal map_mask             : std_logic_vector(FRAGMENT_WIDTH-1 downto 0) := (others => '0');
+    signal map_write            : std_logic := '0';
+    signal fragment             : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal fragment_index       : integer := 0;
+    signal fragment_window      : integer := -1;
+    signal row_fragment         : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal row_fragment_index   : integer;
+    signal row_fragment_window  : integer;
+    signal done                 : boolean := false;
+
+    pure function is_bad(map_n : integer; column : integer) return boolean is
+    begin
+        if map_n = 0 then
+            for i in MAP_0'range loop
+                if MAP_0(i) = column then
+                    return true;
+                end if;
+            end loop;
+        else
+            for i in MAP_1'range loop
+                if MAP_1(i) = column then
+                    return true;
+                end if;
+            end loop;
+        end if;
+        return false;
+    end function is_bad;
+
+    -- Input pixel of the given column of row `row` (counting from the first image)
+    pure function input(row : integer; column : integer) return integer is
+    begin
+        return (column * 7 + row * 13) mod 900 + 50;
+    end function input;
+
+    -- The neighbours of a column are in the same lane of the fragments
+    -- before and after its own, if its fragment isn't the row's first or last
+    pure function expected(map_n : integer; row : integer; column : integer) return integer is
+        variable left_good  : boolean;
+        variable right_good : boolean;
+    begin
+        if not is_bad(map_n, column) then
+            return input(row, column);
+        end if;
+        left_good := column mod FRAGMENTS_PER_ROW /= 0 and not is_bad(map_n, column - 1);
+        right_good := column mod FRAGMENTS_PER_ROW /= FRAGMENTS_PER_ROW-1 and not is_bad(map_n, column + 1);
+        if left_good and right_good then
+            return (input(row, column - 1) + input(row, column + 1) + 1) / 2;
+        elsif left_good then
+            return input(row, column - 1);
+        elsif right_good then
+            return input(row, column + 1);
+        end if;
+        return input(row, column);
+    end function expected;
+
+begin
+
+    clock <= not clock after 10 ns;
+
+    dut : entity work.bad_pixel_replacer generic map (
+        ROW_WIDTH => ROW_WIDTH,
+        FRAGMENT_WIDTH => FRAGMENT_WIDTH,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS,
+        N_WINDOWS => N_WINDOWS
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        enable => '1',
+        map_window => WINDOW,
+        map_index => map_index,
+        map_mask => map_mask,
+        map_write => map_write,
+        fragment => fragment,
+        fragment_index => fragment_index,
+        fragment_window => fragment_window,
+        row_fragment => row_fragment,
+        row_fragment_index => row_fragment_index,
+        row_fragment_window => row_fragment_window
+    );
+
+    stimulus : process
+    begin
+        wait until rising_edge(clock);
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        for map_n in 0 to N_MAPS-1 loop
+            -- Every mask of the window is written before the image
+            for i in 0 to FRAGMENTS_PER_ROW-1 loop
+                for lane in 0 to FRAGMENT_WIDTH-1 loop
+                    map_mask(lane) <= '1' when is_bad(map_n, i + lane * FRAGMENTS_PER_ROW) else '0';
+                end loop;
+                map_index <= i;
+                map_write <= '1';
+                wait until rising_edge(clock);
+            end loop;
+            map_write <= '0';
+            wait until rising_edge(clock);
+
+            for row in map_n * ROWS to (map_n + 1) * ROWS - 1 loop
+                for i in 0 to FRAGMENTS_PER_ROW-1 loop
+                    for lane in 0 to FRAGMENT_WIDTH-1 loop
+                        fragment(lane) <= to_unsigned(input(row, i + lane * FRAGMENTS_PER_ROW), ROW_PIXEL_BITS);
+                    end loop;
+                    fragment_index <= i;
+                    fragment_window <= WINDOW;
+                    wait until rising_edge(clock);
+                end loop;
+            end loop;
+            fragment_window <= -1;
+            -- Let the pipeline drain before the map changes
+            for i in 0 to 7 loop
+                wait until rising_edge(clock);
+            end loop;
+        end loop;
+        done <= true;
+        wait;
+    end process stimulus;
+
+    check_output : process
+        variable fragments : integer := 0;
+        variable row : integer;
+        variable column : integer;
+    begin
+        wait until rising_edge(clock);
+        if row_fragment_window /= -1 then
+            row := fragments / FRAGMENTS_PER_ROW;
+            assert row_fragment_window = WINDOW report "Unexpected window" severity error;
+            assert row_fragment_index = fragments mod FRAGMENTS_PER_ROW report "Fragment out of order" severity error;
+            for lane in 0 to FRAGMENT_WIDTH-1 loop
+                column := row_fragment_index + lane * FRAGMENTS_PER_ROW;
+                assert to_integer(row_fragment(lane)) = expected(row / ROWS, row, column)
+                    report "Row " & integer'image(row) & ", column " & integer'image(column) & " is " &
+                           integer'image(to_integer(row_fragment(lane))) & ", expected " &
+                           integer'image(expected(row / ROWS, row, column))
+                    severity error;
+            end loop;
+            fragments := fragments + 1;
+        end if;
+        if done then
+            assert fragments = N_MAPS * ROWS * FRAGMENTS_PER_ROW
+                report "Expected " & integer'image(N_MAPS * ROWS * FRAGMENTS_PER_ROW) & " fragments, got " & integer'image(fragments)
+                severity error;
+            stop;
+        end if;
+    end process check_output;
+
+end architecture tests;
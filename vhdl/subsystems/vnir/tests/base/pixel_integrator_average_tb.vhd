@@ -17,6 +17,7 @@
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
+use ieee.math_real.all;
 use std.textio.all;
 
 library std;
@@ -72,6 +73,9 @@ architecture tests of pixel_integrator_average_tb is
         fragment_available  : in std_logic;
         row                 : out pixel_vector_t;
         row_window          : out integer;
+        row_fragment        : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer;
         status              : out status_t
     );
     end component pixel_integrator;
@@ -110,6 +114,9 @@ architecture tests of pixel_integrator_average_tb is
 
     constant OUT_DIR : string := "../subsystems/vnir/tests/out/pixel_integrator/";
 
+    -- As in `pixel_integrator`
+    constant SUM_BITS : integer := integer(ceil(log2(real(2) ** real(PIXEL_BITS) * real(MAX_WINDOW_SIZE))));
+
 begin
 
 	-- Generate main clock signal
@@ -152,6 +159,28 @@ begin
         
     end process;
 
+    -- The rows from datagen/pixel_integrator.py only cover some sums, so
+    -- also check the reciprocal division against integer division for
+    -- every sum and window size
+    check_reciprocals : process
+        constant SHIFT : integer := reciprocal_shift(SUM_BITS, MAX_WINDOW_SIZE);
+        constant RECIPROCALS : pixel_vector_t(1 to MAX_WINDOW_SIZE)(SHIFT downto 0) := reciprocals(MAX_WINDOW_SIZE, SHIFT);
+        variable sum : pixel_vector_t(0 downto 0)(SUM_BITS-1 downto 0);
+        variable quotient : pixel_vector_t(0 downto 0)(SUM_BITS-1 downto 0);
+    begin
+        for d in 1 to MAX_WINDOW_SIZE loop
+            for n in 0 to 2 ** SUM_BITS - 1 loop
+                sum(0) := to_unsigned(n, SUM_BITS);
+                quotient := reciprocal_divide(sum, RECIPROCALS(d), SHIFT);
+                assert to_integer(quotient(0)) = n / d
+                    report integer'image(n) & " / " & integer'image(d) & " gave " & integer'image(to_integer(quotient(0)))
+                    severity error;
+            end loop;
+        end loop;
+        report "Reciprocal division checked";
+        wait;
+    end process check_reciprocals;
+
     gen_input : process
         constant N_FRAGMENTS : integer := ROW_WIDTH / FRAGMENT_WIDTH;
         variable tests_passed : boolean := true;
@@ -0,0 +1,226 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+use work.vnir.ROW_WIDTH;
+use work.vnir.FRAGMENT_WIDTH;
+use work.vnir.PIXEL_BITS;
+use work.vnir.ROW_PIXEL_BITS;
+use work.vnir.MAX_WINDOW_SIZE;
+
+
+-- Streams a pair of fragments into `pixel_integrator_dual` on every
+-- clock cycle for a whole image, with every pixel of fragment f set to
+-- f mod 8 + 1, so each summed pixel should be that times its window's
+-- size. Checks every pair that comes out, and reports the sustained
+-- throughput: the fragments put in over the clock cycles from the first
+-- pair in to `done`. It should be close to 2 fragments per cycle.
+--
+-- Then takes a second image through it with the stream stalled, as it
+-- is when whatever it's read from is held up (the integrator has no
+-- ready output, so backpressure only ever reaches it as gaps in
+-- `fragment_available`): the stream stops for a few clock cycles every
+-- few pairs and at the end of every row, with the fragments zeroed
+-- while it's stopped. The sums must come out the same.
+entity pixel_integrator_dual_tb is
+end entity pixel_integrator_dual_tb;
+
+architecture tests of pixel_integrator_dual_tb is
+
+    constant N_WINDOWS : integer := 3;
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant IMAGE_LENGTH : integer := 4;
+    constant WINDOWS : window_vector_t(N_WINDOWS-1 downto 0) := (
+        0 => (lo => 0, hi => 1),
+        1 => (lo => 3, hi => 5),
+        2 => (lo => 7, hi => 10)
+    );
+    constant N_FRAMES : integer := IMAGE_LENGTH + WINDOWS(N_WINDOWS-1).hi;
+    constant CLOCK_PERIOD : time := 20 ns;
+
+    signal clock                : std_logic := '0';
+    signal reset_n              : std_logic := '0';
+    signal config               : config_t;
+    signal read_config          : std_logic := '0';
+    signal start                : std_logic := '0';
+    signal done                 : std_logic;
+    signal fragment_even        : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    signal fragment_odd         : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    signal fragment_available   : std_logic := '0';
+    signal row_fragment_even    : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal row_fragment_odd     : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal row_fragment_index   : integer;
+    signal row_fragment_window  : integer;
+    signal status               : status_t;
+
+    signal first_pair_time      : time := 0 ns;
+    signal fragments_in         : integer := 0;
+
+    pure function pixel(i_fragment : integer) return integer is
+    begin
+        return i_fragment mod 8 + 1;
+    end function pixel;
+
+begin
+
+    clock <= not clock after CLOCK_PERIOD / 2;
+
+    dut : entity work.pixel_integrator_dual generic map (
+        ROW_WIDTH => ROW_WIDTH,
+        FRAGMENT_WIDTH => FRAGMENT_WIDTH,
+        PIXEL_BITS => PIXEL_BITS,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS,
+        N_WINDOWS => N_WINDOWS,
+        METHOD => "SUM",
+        MAX_WINDOW_SIZE => MAX_WINDOW_SIZE,
+        EMIT_ROWS => false
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        config => config,
+        read_config => read_config,
+        start => start,
+        done => done,
+        fragment_even => fragment_even,
+        fragment_odd => fragment_odd,
+        fragment_available => fragment_available,
+        row => open,
+        row_window => open,
+        row_fragment_even => row_fragment_even,
+        row_fragment_odd => row_fragment_odd,
+        row_fragment_index => row_fragment_index,
+        row_fragment_window => row_fragment_window,
+        status => status
+    );
+
+    stimulus : process
+        variable config_v : config_t;
+
+        -- Stops the stream for the given number of clock cycles
+        procedure stall(cycles : integer) is
+        begin
+            fragment_available <= '0';
+            fragment_even <= (others => (others => '0'));
+            fragment_odd <= (others => (others => '0'));
+            for i in 1 to cycles loop
+                wait until rising_edge(clock);
+            end loop;
+        end procedure stall;
+    begin
+        wait until rising_edge(clock);
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        config_v.windows := (others => (others => 0));
+        for w in 0 to N_WINDOWS-1 loop
+            config_v.windows(w) := WINDOWS(w);
+        end loop;
+        config_v.length := IMAGE_LENGTH;
+        config <= config_v;
+        read_config <= '1';
+        wait until rising_edge(clock);
+        read_config <= '0';
+
+        for stalled in boolean loop
+            start <= '1';
+            wait until rising_edge(clock);
+            start <= '0';
+            fragments_in <= 0;
+
+            fragment_available <= '1';
+            for frame in 0 to N_FRAMES-1 loop
+                for w in 0 to N_WINDOWS-1 loop
+                    for r in 0 to size(WINDOWS(w))-1 loop
+                        for pair in 0 to FRAGMENTS_PER_ROW/2-1 loop
+                            for lane in 0 to FRAGMENT_WIDTH-1 loop
+                                fragment_even(lane) <= to_unsigned(pixel(2*pair), PIXEL_BITS);
+                                fragment_odd(lane) <= to_unsigned(pixel(2*pair+1), PIXEL_BITS);
+                            end loop;
+                            fragment_available <= '1';
+                            wait until rising_edge(clock);
+                            if fragments_in = 0 then
+                                first_pair_time <= now;
+                            end if;
+                            fragments_in <= fragments_in + 2;
+                            if stalled and pair mod 3 = 2 then
+                                stall(pair mod 5 + 1);
+                            end if;
+                        end loop;
+                        if stalled then
+                            stall(7);
+                        end if;
+                    end loop;
+                end loop;
+            end loop;
+            fragment_available <= '0';
+            wait until rising_edge(clock) and done = '1';
+        end loop;
+        wait;
+    end process stimulus;
+
+    check_output : process
+        variable cycles : integer;
+        variable pairs : integer;
+        variable size_v : integer;
+    begin
+        wait until rising_edge(clock) and reset_n = '1';
+        for stalled in boolean loop
+            pairs := 0;
+            loop
+                wait until rising_edge(clock);
+                if row_fragment_window /= -1 then
+                    assert row_fragment_index mod 2 = 0 report "Odd pair index" severity error;
+                    size_v := size(WINDOWS(row_fragment_window));
+                    for lane in 0 to FRAGMENT_WIDTH-1 loop
+                        assert to_integer(row_fragment_even(lane)) = size_v * pixel(row_fragment_index) and
+                               to_integer(row_fragment_odd(lane)) = size_v * pixel(row_fragment_index + 1)
+                            report "Wrong sum in window " & integer'image(row_fragment_window) &
+                                   ", fragment " & integer'image(row_fragment_index) &
+                                   " (stalled: " & boolean'image(stalled) & ")"
+                            severity error;
+                    end loop;
+                    pairs := pairs + 1;
+                end if;
+                exit when done = '1';
+            end loop;
+
+            assert pairs = N_WINDOWS * IMAGE_LENGTH * FRAGMENTS_PER_ROW / 2
+                report "Expected " & integer'image(N_WINDOWS * IMAGE_LENGTH * FRAGMENTS_PER_ROW / 2) &
+                       " pairs, got " & integer'image(pairs) & " (stalled: " & boolean'image(stalled) & ")"
+                severity error;
+            if not stalled then
+                cycles := (now - first_pair_time) / CLOCK_PERIOD;
+                report "Sustained throughput: " & integer'image(fragments_in) & " fragments in " &
+                       integer'image(cycles) & " cycles";
+                assert real(fragments_in) / real(cycles) > 1.9
+                    report "Throughput below 1.9 fragments per cycle" severity error;
+            end if;
+        end loop;
+        stop;
+    end process check_output;
+
+end architecture tests;
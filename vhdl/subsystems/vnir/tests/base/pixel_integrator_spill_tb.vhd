@@ -0,0 +1,315 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.math_real.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir_base.all;
+use work.pixel_integrator_pkg.all;
+
+use work.sdram;
+use work.img_buffer_pkg.all;
+use work.custom_master_pkg.all;
+
+use work.vnir.ROW_WIDTH;
+use work.vnir.FRAGMENT_WIDTH;
+use work.vnir.PIXEL_BITS;
+use work.vnir.ROW_PIXEL_BITS;
+
+
+-- Sums an image in `pixel_integrator_spill`, with its scratch space in
+-- a memory shared by models of the custom read and write masters. The
+-- read master only starts fetching READ_LATENCY clock cycles after its
+-- command, and holds a few words at most; the write master only gets
+-- words into memory a few clock cycles after they're written to it,
+-- through a buffer it holds `user_buffer_full` high on when it's full.
+-- Both are held up by the bus on some clock cycles, so neither moves a
+-- word on every clock cycle. Every pixel of fragment f is set to
+-- f mod 8 + 1, so each summed pixel should be that times its window's
+-- size. Rows are spaced out enough for none to be dropped.
+entity pixel_integrator_spill_tb is
+end entity pixel_integrator_spill_tb;
+
+architecture tests of pixel_integrator_spill_tb is
+
+    constant N_WINDOWS : integer := 3;
+    constant MAX_WINDOW_SIZE : integer := 16;
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant IMAGE_LENGTH : integer := 3;
+    constant WINDOWS : window_vector_t(N_WINDOWS-1 downto 0) := (
+        0 => (lo => 0, hi => 1),
+        1 => (lo => 3, hi => 5),
+        2 => (lo => 7, hi => 10)
+    );
+    constant N_FRAMES : integer := IMAGE_LENGTH + WINDOWS(N_WINDOWS-1).hi;
+    -- Clock cycles between rows, long enough for the engine to keep up
+    -- with the masters held up
+    constant ROW_GAP : integer := 8 * FRAGMENTS_PER_ROW;
+    constant CLOCK_PERIOD : time := 20 ns;
+
+    -- Scratch space, in 16-bit addresses and 128-bit words
+    constant SCRATCH_BASE : integer := 16#1000#;
+    constant SUM_BITS : integer := integer(ceil(log2(real(2) ** real(PIXEL_BITS) * real(MAX_WINDOW_SIZE))));
+    constant SUM_WORDS : integer := (FRAGMENT_WIDTH * SUM_BITS + FIFO_WORD_LENGTH - 1) / FIFO_WORD_LENGTH;
+    constant SCRATCH_WORDS : integer := N_WINDOWS * MAX_WINDOW_SIZE * FRAGMENTS_PER_ROW * SUM_WORDS;
+    constant WORD_ADDRESSES : integer := FIFO_WORD_BYTES / 2;
+
+    type memory_t is array (0 to SCRATCH_WORDS-1) of std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+
+    -- Master models: clock cycles from the read command to the first word
+    -- fetched, words the read master's fifo and the write master's buffer
+    -- hold, and the clock cycles on which the bus holds each of them up
+    constant READ_LATENCY : integer := 6;
+    constant READ_FIFO_DEPTH : integer := 4;
+    constant WRITE_BUFFER_DEPTH : integer := 4;
+    constant WRITE_LATENCY : integer := 3;
+
+    pure function read_held(cycle : integer) return boolean is
+    begin
+        return cycle mod 7 < 3;
+    end function read_held;
+
+    pure function write_held(cycle : integer) return boolean is
+    begin
+        return cycle mod 5 < 2;
+    end function write_held;
+
+    type buffer_words_t is array (0 to WRITE_BUFFER_DEPTH-1) of integer;
+    type buffer_data_t is array (0 to WRITE_BUFFER_DEPTH-1) of std_logic_vector(FIFO_WORD_LENGTH-1 downto 0);
+
+    signal clock                : std_logic := '0';
+    signal reset_n              : std_logic := '0';
+    signal config               : config_t;
+    signal read_config          : std_logic := '0';
+    signal start                : std_logic := '0';
+    signal done                 : std_logic;
+    signal fragment             : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(PIXEL_BITS-1 downto 0);
+    signal fragment_available   : std_logic := '0';
+    signal row_fragment         : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal row_fragment_index   : integer;
+    signal row_fragment_window  : integer;
+    signal status               : status_t;
+    signal rows_dropped         : unsigned(31 downto 0);
+
+    signal read_master_in       : from_read_master_t;
+    signal read_master_out      : to_read_master_t;
+    signal write_master_in      : from_master_t;
+    signal write_master_out     : to_master_t;
+    signal read_words_left      : integer := 0;     -- words left to fetch in the read master's command
+    signal read_fifo_words      : integer := 0;     -- words fetched and not yet taken
+    signal write_words_left     : integer := 0;     -- words left to write in the write master's command
+    signal write_buffer_words   : integer := 0;     -- words written and not yet in memory
+
+    pure function pixel(i_fragment : integer) return integer is
+    begin
+        return i_fragment mod 8 + 1;
+    end function pixel;
+
+begin
+
+    clock <= not clock after CLOCK_PERIOD / 2;
+
+    dut : entity work.pixel_integrator_spill generic map (
+        ROW_WIDTH => ROW_WIDTH,
+        FRAGMENT_WIDTH => FRAGMENT_WIDTH,
+        PIXEL_BITS => PIXEL_BITS,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS,
+        N_WINDOWS => N_WINDOWS,
+        METHOD => "SUM",
+        MAX_WINDOW_SIZE => MAX_WINDOW_SIZE
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        config => config,
+        read_config => read_config,
+        start => start,
+        done => done,
+        scratch_base => to_signed(SCRATCH_BASE, sdram.ADDRESS_LENGTH),
+        fragment => fragment,
+        fragment_available => fragment_available,
+        row_fragment => row_fragment,
+        row_fragment_index => row_fragment_index,
+        row_fragment_window => row_fragment_window,
+        status => status,
+        rows_dropped => rows_dropped,
+        read_master_in => read_master_in,
+        read_master_out => read_master_out,
+        write_master_in => write_master_in,
+        write_master_out => write_master_out
+    );
+
+    -- Custom read and write master models, sharing the scratch memory.
+    -- The read master's fifo shows its first word ahead. A word written to
+    -- the write master gets into memory once it has been in the buffer for
+    -- WRITE_LATENCY clock cycles and the bus isn't holding the write master
+    -- up, so the write master isn't done with its command until then
+    master_process : process
+        variable memory         : memory_t := (others => (others => 'U'));
+        variable cycle          : integer := 0;
+        variable fifo           : integer := 0;
+        variable next_word      : integer := 0;     -- word of the next fetch
+        variable head_word      : integer := 0;     -- word at the head of the read fifo
+        variable latency_left   : integer := 0;     -- clock cycles until the read master starts fetching
+        variable write_word     : integer := 0;     -- word of the next write
+        variable buffered       : integer := 0;
+        variable buffer_words   : buffer_words_t;
+        variable buffer_data    : buffer_data_t;
+        variable buffer_ages    : buffer_words_t;
+    begin
+        wait until rising_edge(clock);
+        cycle := cycle + 1;
+
+        -- Write master: the oldest word goes to memory, then the word written is buffered
+        for i in 0 to buffered-1 loop
+            buffer_ages(i) := buffer_ages(i) + 1;
+        end loop;
+        if buffered > 0 and buffer_ages(0) >= WRITE_LATENCY and not write_held(cycle) then
+            memory(buffer_words(0)) := buffer_data(0);
+            for i in 1 to buffered-1 loop
+                buffer_words(i-1) := buffer_words(i);
+                buffer_data(i-1) := buffer_data(i);
+                buffer_ages(i-1) := buffer_ages(i);
+            end loop;
+            buffered := buffered - 1;
+        end if;
+        if write_master_out.user_write_buffer = '1' then
+            assert write_words_left > 0 report "Wrote past the end of the write command" severity failure;
+            assert write_buffer_words < WRITE_BUFFER_DEPTH report "Wrote to the write master while it was full" severity failure;
+            buffer_words(buffered) := write_word;
+            buffer_data(buffered) := write_master_out.user_buffer_data;
+            buffer_ages(buffered) := 0;
+            buffered := buffered + 1;
+            write_word := write_word + 1;
+            write_words_left <= write_words_left - 1;
+        end if;
+        if write_master_out.control_go = '1' then
+            assert write_words_left = 0 and buffered = 0 report "control_go while the write master is busy" severity failure;
+            write_word := (to_integer(signed(write_master_out.control_write_base)) - SCRATCH_BASE) / WORD_ADDRESSES;
+            write_words_left <= to_integer(unsigned(write_master_out.control_write_length)) / FIFO_WORD_BYTES;
+        end if;
+        write_buffer_words <= buffered;
+
+        -- Read master: fetches a word whenever it has started, has room and isn't held up
+        fifo := read_fifo_words;
+        if read_master_out.user_read_buffer = '1' then
+            assert fifo > 0 report "Read from an empty master fifo" severity failure;
+            fifo := fifo - 1;
+            head_word := head_word + 1;
+        end if;
+        if read_master_out.control_go = '1' then
+            assert read_words_left = 0 and fifo = 0 report "control_go while the read master is busy" severity failure;
+            next_word := (to_integer(signed(read_master_out.control_read_base)) - SCRATCH_BASE) / WORD_ADDRESSES;
+            head_word := next_word;
+            latency_left := READ_LATENCY;
+            read_words_left <= to_integer(unsigned(read_master_out.control_read_length)) / FIFO_WORD_BYTES;
+        elsif latency_left > 0 then
+            latency_left := latency_left - 1;
+        elsif read_words_left > 0 and fifo < READ_FIFO_DEPTH and not read_held(cycle) then
+            fifo := fifo + 1;
+            next_word := next_word + 1;
+            read_words_left <= read_words_left - 1;
+        end if;
+
+        read_fifo_words <= fifo;
+        if head_word < SCRATCH_WORDS then
+            read_master_in.user_buffer_data <= memory(head_word);
+        end if;
+    end process master_process;
+
+    read_master_in.control_done <= '1' when read_words_left = 0 and read_master_out.control_go = '0' else '0';
+    read_master_in.user_data_available <= '1' when read_fifo_words > 0 else '0';
+    write_master_in.control_done <= '1' when write_words_left = 0 and write_buffer_words = 0 and
+                                             write_master_out.control_go = '0' else '0';
+    write_master_in.user_buffer_full <= '1' when write_buffer_words >= WRITE_BUFFER_DEPTH else '0';
+
+    stimulus : process
+        variable config_v : config_t;
+    begin
+        wait until rising_edge(clock);
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        config_v.windows := (others => (others => 0));
+        for w in 0 to N_WINDOWS-1 loop
+            config_v.windows(w) := WINDOWS(w);
+        end loop;
+        config_v.length := IMAGE_LENGTH;
+        config <= config_v;
+        read_config <= '1';
+        wait until rising_edge(clock);
+        read_config <= '0';
+        start <= '1';
+        wait until rising_edge(clock);
+        start <= '0';
+
+        for frame in 0 to N_FRAMES-1 loop
+            for w in 0 to N_WINDOWS-1 loop
+                for r in 0 to size(WINDOWS(w))-1 loop
+                    fragment_available <= '1';
+                    for i in 0 to FRAGMENTS_PER_ROW-1 loop
+                        for lane in 0 to FRAGMENT_WIDTH-1 loop
+                            fragment(lane) <= to_unsigned(pixel(i), PIXEL_BITS);
+                        end loop;
+                        wait until rising_edge(clock);
+                    end loop;
+                    fragment_available <= '0';
+                    for i in 0 to ROW_GAP-1 loop
+                        wait until rising_edge(clock);
+                    end loop;
+                end loop;
+            end loop;
+        end loop;
+        wait;
+    end process stimulus;
+
+    check_output : process
+        variable fragments : integer := 0;
+        variable size_v : integer;
+    begin
+        wait until rising_edge(clock) and reset_n = '1';
+        loop
+            wait until rising_edge(clock);
+            if row_fragment_window /= -1 then
+                size_v := size(WINDOWS(row_fragment_window));
+                for lane in 0 to FRAGMENT_WIDTH-1 loop
+                    assert to_integer(row_fragment(lane)) = size_v * pixel(row_fragment_index)
+                        report "Wrong sum in window " & integer'image(row_fragment_window) &
+                               ", fragment " & integer'image(row_fragment_index) & ": " &
+                               integer'image(to_integer(row_fragment(lane))) & ", expected " &
+                               integer'image(size_v * pixel(row_fragment_index))
+                        severity error;
+                end loop;
+                fragments := fragments + 1;
+            end if;
+            exit when done = '1';
+        end loop;
+
+        assert fragments = N_WINDOWS * IMAGE_LENGTH * FRAGMENTS_PER_ROW
+            report "Expected " & integer'image(N_WINDOWS * IMAGE_LENGTH * FRAGMENTS_PER_ROW) &
+                   " fragments, got " & integer'image(fragments)
+            severity error;
+        assert rows_dropped = 0 report integer'image(to_integer(rows_dropped)) & " rows dropped" severity error;
+        stop;
+    end process check_output;
+
+end architecture tests;
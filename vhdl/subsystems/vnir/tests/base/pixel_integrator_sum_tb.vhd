@@ -73,6 +73,9 @@ architecture tests of pixel_integrator_sum_tb is
         fragment_available  : in std_logic;
         row                 : out pixel_vector_t;
         row_window          : out integer;
+        row_fragment        : out pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer;
         status              : out status_t
     );
     end component pixel_integrator;
@@ -0,0 +1,180 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir_base.all;
+
+use work.vnir.ROW_WIDTH;
+use work.vnir.FRAGMENT_WIDTH;
+use work.vnir.ROW_PIXEL_BITS;
+use work.vnir.N_WINDOWS;
+use work.vnir.GAIN_BITS;
+use work.vnir.GAIN_FRACTION_BITS;
+
+
+-- Loads the tables of window 1 with dark[x] = x mod 8 and a gain of
+-- 1.5, then checks a row with every pixel at 100 + lane, a row of
+-- zeros (clamped) and a row of 1000s (saturated), and finally that the
+-- row is passed through unchanged once `enable` is cleared.
+entity radiometric_corrector_tb is
+end entity radiometric_corrector_tb;
+
+architecture tests of radiometric_corrector_tb is
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant WINDOW : integer := 1;
+    constant GAIN : integer := 3 * 2 ** (GAIN_FRACTION_BITS - 1);
+    constant MAX_PIXEL : integer := 2 ** ROW_PIXEL_BITS - 1;
+
+    type test_t is (OFFSET, ZERO, SATURATED, BYPASS);
+
+    signal clock                : std_logic := '0';
+    signal reset_n              : std_logic := '0';
+    signal enable               : std_logic := '0';
+    signal table_column         : integer := 0;
+    signal table_dark           : unsigned(ROW_PIXEL_BITS-1 downto 0) := (others => '0');
+    signal table_write          : std_logic := '0';
+    signal fragment             : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal fragment_index       : integer := 0;
+    signal fragment_window      : integer := -1;
+    signal row_fragment         : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal row_fragment_index   : integer;
+    signal row_fragment_window  : integer;
+    signal test                 : test_t := OFFSET;
+    signal done                 : boolean := false;
+
+    -- Input pixel of the given lane in each test
+    pure function input(t : test_t; lane : integer) return integer is
+    begin
+        case t is
+            when OFFSET | BYPASS => return 100 + lane;
+            when ZERO => return 0;
+            when SATURATED => return 1000;
+        end case;
+    end function input;
+
+    pure function expected(t : test_t; lane : integer; column : integer) return integer is
+        variable difference : integer;
+    begin
+        if t = BYPASS then
+            return input(t, lane);
+        end if;
+        difference := input(t, lane) - column mod 8;
+        if difference < 0 then
+            return 0;
+        end if;
+        return minimum((difference * GAIN + 2 ** (GAIN_FRACTION_BITS - 1)) / 2 ** GAIN_FRACTION_BITS, MAX_PIXEL);
+    end function expected;
+
+begin
+
+    clock <= not clock after 10 ns;
+
+    dut : entity work.radiometric_corrector generic map (
+        ROW_WIDTH => ROW_WIDTH,
+        FRAGMENT_WIDTH => FRAGMENT_WIDTH,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS,
+        N_WINDOWS => N_WINDOWS,
+        GAIN_BITS => GAIN_BITS,
+        GAIN_FRACTION_BITS => GAIN_FRACTION_BITS
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        enable => enable,
+        table_window => WINDOW,
+        table_column => table_column,
+        table_dark => table_dark,
+        table_gain => to_unsigned(GAIN, GAIN_BITS),
+        table_write => table_write,
+        fragment => fragment,
+        fragment_index => fragment_index,
+        fragment_window => fragment_window,
+        row_fragment => row_fragment,
+        row_fragment_index => row_fragment_index,
+        row_fragment_window => row_fragment_window
+    );
+
+    stimulus : process
+    begin
+        wait until rising_edge(clock);
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        for column in 0 to ROW_WIDTH-1 loop
+            table_column <= column;
+            table_dark <= to_unsigned(column mod 8, ROW_PIXEL_BITS);
+            table_write <= '1';
+            wait until rising_edge(clock);
+        end loop;
+        table_write <= '0';
+        enable <= '1';
+
+        for t in test_t loop
+            test <= t;
+            if t = BYPASS then
+                enable <= '0';
+            end if;
+            for i in 0 to FRAGMENTS_PER_ROW-1 loop
+                for lane in 0 to FRAGMENT_WIDTH-1 loop
+                    fragment(lane) <= to_unsigned(input(t, lane), ROW_PIXEL_BITS);
+                end loop;
+                fragment_index <= i;
+                fragment_window <= WINDOW;
+                wait until rising_edge(clock);
+            end loop;
+            fragment_window <= -1;
+            -- Let the pipeline drain, so the test being checked is known
+            for i in 0 to 7 loop
+                wait until rising_edge(clock);
+            end loop;
+        end loop;
+        done <= true;
+        wait;
+    end process stimulus;
+
+    check_output : process
+        variable fragments : integer := 0;
+        variable column : integer;
+    begin
+        wait until rising_edge(clock);
+        if row_fragment_window /= -1 then
+            assert row_fragment_window = WINDOW report "Unexpected window" severity error;
+            for lane in 0 to FRAGMENT_WIDTH-1 loop
+                column := row_fragment_index + lane * FRAGMENTS_PER_ROW;
+                assert to_integer(row_fragment(lane)) = expected(test, lane, column)
+                    report test_t'image(test) & ": column " & integer'image(column) & " is " &
+                           integer'image(to_integer(row_fragment(lane))) & ", expected " &
+                           integer'image(expected(test, lane, column))
+                    severity error;
+            end loop;
+            fragments := fragments + 1;
+        end if;
+        if done then
+            assert fragments = 4 * FRAGMENTS_PER_ROW
+                report "Expected " & integer'image(4 * FRAGMENTS_PER_ROW) & " fragments, got " & integer'image(fragments)
+                severity error;
+            stop;
+        end if;
+    end process check_output;
+
+end architecture tests;
@@ -0,0 +1,167 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir_base.all;
+
+use work.vnir.ROW_WIDTH;
+use work.vnir.FRAGMENT_WIDTH;
+use work.vnir.ROW_PIXEL_BITS;
+
+
+-- Sends a row with pixel x set to x / 2 through the binner with each
+-- binning factor, with the output stalled on every third clock cycle,
+-- and checks that each binned pixel is the mean of its pixels and that
+-- each binned row has the right number of fragments.
+entity row_binner_tb is
+end entity row_binner_tb;
+
+architecture tests of row_binner_tb is
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant WINDOW : integer := 2;
+
+    type factor_a is array (0 to 2) of integer;
+    constant FACTORS : factor_a := (1, 2, 4);
+
+    signal clock            : std_logic := '0';
+    signal reset_n          : std_logic := '0';
+    signal binning          : integer := 1;
+    signal pixels           : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal pixels_window    : integer := -1;
+    signal pixels_first     : std_logic := '0';
+    signal pixels_last      : std_logic := '0';
+    signal pixels_ready     : std_logic;
+    signal binned           : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal binned_window    : integer;
+    signal binned_first     : std_logic;
+    signal binned_last      : std_logic;
+    signal binned_ready     : std_logic := '0';
+    signal row              : integer := 0;
+    signal done             : boolean := false;
+
+    pure function expected(factor : integer; x : integer) return integer is
+        variable sum : integer := 0;
+    begin
+        for k in 0 to factor-1 loop
+            sum := sum + (x*factor + k) / 2;
+        end loop;
+        return sum / factor;
+    end function expected;
+
+begin
+
+    clock <= not clock after 10 ns;
+
+    dut : entity work.row_binner generic map (
+        FRAGMENT_WIDTH => FRAGMENT_WIDTH,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS,
+        METHOD => "AVERAGE"
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        binning => binning,
+        pixels => pixels,
+        pixels_window => pixels_window,
+        pixels_first => pixels_first,
+        pixels_last => pixels_last,
+        pixels_ready => pixels_ready,
+        binned => binned,
+        binned_window => binned_window,
+        binned_first => binned_first,
+        binned_last => binned_last,
+        binned_ready => binned_ready
+    );
+
+    stall : process
+    begin
+        wait until rising_edge(clock);
+        binned_ready <= '1';
+        wait until rising_edge(clock);
+        wait until rising_edge(clock);
+        binned_ready <= '0';
+    end process stall;
+
+    stimulus : process
+    begin
+        wait until rising_edge(clock);
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        for r in FACTORS'range loop
+            row <= r;
+            binning <= FACTORS(r);
+            for i in 0 to FRAGMENTS_PER_ROW-1 loop
+                for k in 0 to FRAGMENT_WIDTH-1 loop
+                    pixels(k) <= to_unsigned((i*FRAGMENT_WIDTH + k) / 2, ROW_PIXEL_BITS);
+                end loop;
+                pixels_window <= WINDOW;
+                pixels_first <= '1' when i = 0 else '0';
+                pixels_last <= '1' when i = FRAGMENTS_PER_ROW-1 else '0';
+                loop
+                    wait until rising_edge(clock);
+                    exit when pixels_ready = '1';
+                end loop;
+            end loop;
+            pixels_window <= -1;
+            pixels_first <= '0';
+            pixels_last <= '0';
+            -- Let the last fragment out, so the row being checked is known
+            for i in 0 to 7 loop
+                wait until rising_edge(clock);
+            end loop;
+        end loop;
+        done <= true;
+        wait;
+    end process stimulus;
+
+    check_output : process
+        variable fragments : integer := 0;
+        variable x : integer;
+    begin
+        wait until rising_edge(clock);
+        if binned_window /= -1 and binned_ready = '1' then
+            assert binned_window = WINDOW report "Unexpected window" severity error;
+            assert (binned_first = '1') = (fragments = 0) report "Unexpected first flag" severity error;
+            assert (binned_last = '1') = (fragments = FRAGMENTS_PER_ROW / FACTORS(row) - 1)
+                report "Unexpected last flag" severity error;
+            for k in 0 to FRAGMENT_WIDTH-1 loop
+                x := fragments * FRAGMENT_WIDTH + k;
+                assert to_integer(binned(k)) = expected(FACTORS(row), x)
+                    report integer'image(FACTORS(row)) & "x: pixel " & integer'image(x) & " is " &
+                           integer'image(to_integer(binned(k))) & ", expected " &
+                           integer'image(expected(FACTORS(row), x))
+                    severity error;
+            end loop;
+            fragments := fragments + 1;
+            if binned_last = '1' then
+                fragments := 0;
+            end if;
+        end if;
+        if done then
+            assert fragments = 0 report "Incomplete binned row" severity error;
+            stop;
+        end if;
+    end process check_output;
+
+end architecture tests;
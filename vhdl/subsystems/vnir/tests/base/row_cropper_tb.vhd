@@ -0,0 +1,189 @@
+----------------------------------------------------------------
+-- Copyright 2020 University of Alberta
+
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+
+--     http://www.apache.org/licenses/LICENSE-2.0
+
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+----------------------------------------------------------------
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.env.stop;
+
+use work.vnir_base.all;
+
+use work.vnir.ROW_WIDTH;
+use work.vnir.FRAGMENT_WIDTH;
+use work.vnir.ROW_PIXEL_BITS;
+
+
+-- Sends a row with pixel x set to x through the cropper for each of
+-- red, NIR and blue, whose crops have different widths and start on a
+-- fragment boundary, 5 pixels into the first fragment, and 3 pixels
+-- before the end of the row less the crop width, then a row with
+-- cropping off. The output is stalled
+-- on every third clock cycle. Checks every output pixel and that each
+-- cropped row has the right number of fragments.
+entity row_cropper_tb is
+end entity row_cropper_tb;
+
+architecture tests of row_cropper_tb is
+
+    constant FRAGMENTS_PER_ROW : integer := ROW_WIDTH / FRAGMENT_WIDTH;
+    constant CROP_WIDTHS : integer_vector(0 to 2) := (32 * FRAGMENT_WIDTH, 16 * FRAGMENT_WIDTH, 8 * FRAGMENT_WIDTH);
+    constant CROP_STARTS : integer_vector(0 to 2) := (FRAGMENT_WIDTH, 5, ROW_WIDTH - CROP_WIDTHS(2) - 3);
+
+    type row_a is array (0 to 3) of integer;
+    constant WINDOWS : row_a := (0, 1, 2, 1);
+    constant CROPPED : boolean_vector(0 to 3) := (true, true, true, false);
+
+    signal clock            : std_logic := '0';
+    signal reset_n          : std_logic := '0';
+    signal crop_widths      : integer_vector(0 to 2) := (others => 0);
+    signal pixels           : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal pixels_window    : integer := -1;
+    signal pixels_first     : std_logic := '0';
+    signal pixels_last      : std_logic := '0';
+    signal pixels_ready     : std_logic;
+    signal cropped          : pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    signal cropped_window   : integer;
+    signal cropped_first    : std_logic;
+    signal cropped_last     : std_logic;
+    signal cropped_ready    : std_logic := '0';
+    signal row              : integer := 0;
+    signal done             : boolean := false;
+
+    -- Pixel x of row r's output
+    pure function expected(r : integer; x : integer) return integer is
+    begin
+        if not CROPPED(r) then
+            return x mod 2**ROW_PIXEL_BITS;
+        end if;
+        return (CROP_STARTS(WINDOWS(r)) + x) mod 2**ROW_PIXEL_BITS;
+    end function expected;
+
+    pure function out_fragments(r : integer) return integer is
+    begin
+        if not CROPPED(r) then
+            return FRAGMENTS_PER_ROW;
+        end if;
+        return CROP_WIDTHS(WINDOWS(r)) / FRAGMENT_WIDTH;
+    end function out_fragments;
+
+begin
+
+    clock <= not clock after 10 ns;
+
+    dut : entity work.row_cropper generic map (
+        FRAGMENT_WIDTH => FRAGMENT_WIDTH,
+        ROW_PIXEL_BITS => ROW_PIXEL_BITS
+    ) port map (
+        clock => clock,
+        reset_n => reset_n,
+        crop_starts => CROP_STARTS,
+        crop_widths => crop_widths,
+        pixels => pixels,
+        pixels_window => pixels_window,
+        pixels_first => pixels_first,
+        pixels_last => pixels_last,
+        pixels_ready => pixels_ready,
+        cropped => cropped,
+        cropped_window => cropped_window,
+        cropped_first => cropped_first,
+        cropped_last => cropped_last,
+        cropped_ready => cropped_ready
+    );
+
+    stall : process
+    begin
+        wait until rising_edge(clock);
+        cropped_ready <= '1';
+        wait until rising_edge(clock);
+        wait until rising_edge(clock);
+        cropped_ready <= '0';
+    end process stall;
+
+    stimulus : process
+    begin
+        wait until rising_edge(clock);
+        reset_n <= '1';
+        wait until rising_edge(clock);
+
+        for r in WINDOWS'range loop
+            row <= r;
+            if CROPPED(r) then
+                crop_widths <= CROP_WIDTHS;
+            else
+                crop_widths <= (others => 0);
+            end if;
+            for i in 0 to FRAGMENTS_PER_ROW-1 loop
+                for k in 0 to FRAGMENT_WIDTH-1 loop
+                    pixels(k) <= to_unsigned((i*FRAGMENT_WIDTH + k) mod 2**ROW_PIXEL_BITS, ROW_PIXEL_BITS);
+                end loop;
+                pixels_window <= WINDOWS(r);
+                pixels_first <= '1' when i = 0 else '0';
+                pixels_last <= '1' when i = FRAGMENTS_PER_ROW-1 else '0';
+                loop
+                    wait until rising_edge(clock);
+                    exit when pixels_ready = '1';
+                end loop;
+            end loop;
+            pixels_window <= -1;
+            pixels_first <= '0';
+            pixels_last <= '0';
+            -- Let the last fragment out, so the row being checked is known
+            for i in 0 to 7 loop
+                wait until rising_edge(clock);
+            end loop;
+        end loop;
+        done <= true;
+        wait;
+    end process stimulus;
+
+    check_output : process
+        variable fragments : integer := 0;
+        variable rows : integer := 0;
+        variable x : integer;
+    begin
+        wait until rising_edge(clock);
+        if cropped_window /= -1 and cropped_ready = '1' then
+            assert cropped_window = WINDOWS(row) report "Unexpected window" severity error;
+            assert (cropped_first = '1') = (fragments = 0) report "Unexpected first flag" severity error;
+            assert (cropped_last = '1') = (fragments = out_fragments(row) - 1)
+                report "Unexpected last flag" severity error;
+            for k in 0 to FRAGMENT_WIDTH-1 loop
+                x := fragments * FRAGMENT_WIDTH + k;
+                assert to_integer(cropped(k)) = expected(row, x)
+                    report "Row " & integer'image(row) & ": pixel " & integer'image(x) & " is " &
+                           integer'image(to_integer(cropped(k))) & ", expected " &
+                           integer'image(expected(row, x))
+                    severity error;
+            end loop;
+            fragments := fragments + 1;
+            if cropped_last = '1' then
+                fragments := 0;
+                rows := rows + 1;
+            end if;
+        end if;
+        if done then
+            assert fragments = 0 report "Incomplete cropped row" severity error;
+            assert rows = WINDOWS'length report "Expected " & integer'image(WINDOWS'length) & " rows, got " & integer'image(rows)
+                severity error;
+            stop;
+        end if;
+    end process check_output;
+
+end architecture tests;
@@ -31,7 +31,9 @@ class Window:
 
 # WINDOWS = [Window(0, 0), Window(1, 1), Window(2, 2)]
 # WINDOWS = [Window(0, 1), Window(2, 3), Window(4, 5)]
-WINDOWS = [Window(10, 17), Window(24, 39), Window(51, 52)]
+# WINDOWS = [Window(10, 17), Window(24, 39), Window(51, 52)]
+# Window sizes that aren't powers of 2, to check the reciprocal division
+WINDOWS = [Window(10, 16), Window(24, 35), Window(51, 53)]
 ROW_WIDTH = 2048
 BITS = 10
 IMAGE_LENGTH = 10
@@ -54,6 +54,11 @@ architecture tests of vnir_subsystem_tb is
     signal num_rows             : integer;
     signal row                  : row_t;
     signal row_available        : row_type_t;
+    signal row_fragment         : row_fragment_t;
+    signal row_fragment_available : row_type_t;
+    signal row_fragment_first   : std_logic;
+    signal row_fragment_last    : std_logic;
+    signal row_fragment_ready   : std_logic := '0';
     signal spi                  : spi_t;
     signal frame_request        : std_logic;
     signal exposure_start       : std_logic;
@@ -89,6 +94,11 @@ architecture tests of vnir_subsystem_tb is
         imaging_done        : out std_logic;
         row                 : out row_t;
         row_available       : out row_type_t;
+        row_fragment        : out row_fragment_t;
+        row_fragment_available : out row_type_t;
+        row_fragment_first  : out std_logic;
+        row_fragment_last   : out std_logic;
+        row_fragment_ready  : in std_logic;
         spi_out             : out spi_from_master_t;
         spi_in              : in spi_to_master_t;
         frame_request       : out std_logic;
@@ -131,6 +141,7 @@ architecture tests of vnir_subsystem_tb is
         readline(f, f_line);
         read(f_line, config.window_blue.lo);
         read(f_line, config.window_blue.hi);
+        config.extra_windows := (others => (lo => 0, hi => 0));
     end procedure read;
 
     procedure read(file f : text; i : out integer) is
@@ -222,6 +233,37 @@ begin
         stop;
     end process;
 
+    -- Checks that each row also comes out of `row_fragment`, in pixel order.
+    -- `row_fragment_ready` is held low one clock cycle in three, to check
+    -- that fragments are held until they are accepted
+    fragment_reciever : process
+        type row_vector_t is array(row_type_t) of row_t;
+        variable rows : row_vector_t;
+        variable i_fragment : integer := 0;
+        variable i_clock : integer := 0;
+    begin
+        wait until rising_edge(clock);
+        if row_available /= ROW_NONE then
+            rows(row_available) := row;
+        end if;
+        if row_fragment_available /= ROW_NONE and row_fragment_ready = '1' then
+            assert (row_fragment_first = '1') = (i_fragment = 0) report "Misplaced start of row" severity failure;
+            for i in 0 to FRAGMENT_WIDTH-1 loop
+                assert row_fragment(i) = rows(row_fragment_available)(FRAGMENT_WIDTH * i_fragment + i)
+                    report "Received mismatched row fragment" severity failure;
+            end loop;
+            if row_fragment_last = '1' then
+                assert i_fragment = ROW_WIDTH / FRAGMENT_WIDTH - 1 report "Received short row" severity failure;
+                i_fragment := 0;
+            else
+                i_fragment := i_fragment + 1;
+            end if;
+        end if;
+        assert status.row_overflow = '0' report "Row collator overflowed" severity failure;
+        i_clock := i_clock + 1;
+        row_fragment_ready <= '0' when i_clock mod 3 = 0 else '1';
+    end process fragment_reciever;
+
     clock_gen : process
         constant CLOCK_PERIOD : time := 20 ns;
 	begin
@@ -312,7 +354,8 @@ begin
         start_config <= '1'; wait until rising_edge(clock); start_config <= '0'; 
         wait until rising_edge(clock) and config_done = '1';
 
-        image_config <= (length => 2, frame_clocks => 3000, exposure_clocks => 2000);
+        image_config <= (length => 2, frame_clocks => 3000, exposure_clocks => 2000, binning => 1,
+                         crop_widths => (others => 0), crop_starts => (others => 0));
         start_image_config <= '1';  wait until rising_edge(clock); start_image_config <= '0'; 
         wait until rising_edge(clock) and num_rows /= 0;
         assert image_length_v = num_rows;
@@ -341,6 +384,11 @@ begin
         num_rows => num_rows,
         row => row,
         row_available => row_available,
+        row_fragment => row_fragment,
+        row_fragment_available => row_fragment_available,
+        row_fragment_first => row_fragment_first,
+        row_fragment_last => row_fragment_last,
+        row_fragment_ready => row_fragment_ready,
         spi_out => spi.from_master,
         spi_in => spi.to_master,
         frame_request => frame_request,
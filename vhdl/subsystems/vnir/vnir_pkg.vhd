@@ -34,31 +34,87 @@ package vnir is
     constant FRAGMENT_WIDTH : integer := 16;
     constant PIXEL_BITS : integer := 10;
     constant ROW_PIXEL_BITS : integer := 10;  -- Increase this to prevent overflow if using method = SUM
-    constant N_WINDOWS : integer := 3;
+    constant N_WINDOWS : integer := 3;  -- Between 3 and MAX_WINDOWS
+    constant MAX_WINDOWS : integer := 8;  -- Most windows (bands) the VNIR->SDRAM path can carry
     constant MAX_WINDOW_SIZE : integer := 16;
+    constant SPILL_MAX_WINDOW_SIZE : integer := 128;  -- MAX_WINDOW_SIZE when the running sums are kept in SDRAM
     constant METHOD : string := "AVERAGE";  -- "AVERAGE" or "SUM"
+    constant GAIN_BITS : integer := 16;
+    constant GAIN_FRACTION_BITS : integer := 14;  -- A gain of 1.0 is 2**GAIN_FRACTION_BITS
 
     subtype pixel_t is vnir_base.pixel_t(PIXEL_BITS-1 downto 0);
     subtype row_t is vnir_base.pixel_vector_t(ROW_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
+    subtype row_fragment_t is vnir_base.pixel_vector_t(FRAGMENT_WIDTH-1 downto 0)(ROW_PIXEL_BITS-1 downto 0);
     
     subtype window_t is vnir_base.window_t;
     subtype calibration_t is vnir_base.calibration_t;
 
+    -- Windows 0 to 2 are red, NIR and blue. Windows 3 to N_WINDOWS-1
+    -- are taken from extra_windows (the rest of extra_windows is
+    -- ignored), for imaging more, narrower bands.
     type config_t is record
         window_red       : window_t;
         window_nir       : window_t;
         window_blue      : window_t;
+        extra_windows    : vnir_base.window_vector_t(3 to MAX_WINDOWS-1);
         flip             : flip_t;
         calibration      : calibration_t;
     end record config_t;
 
+    subtype crop_starts_t is integer_vector(0 to N_WINDOWS-1);
+    subtype crop_widths_t is integer_vector(0 to N_WINDOWS-1);
+
+    -- binning is the number of adjacent pixels combined into one
+    -- across-track (1, 2 or 4, see `row_binner`). The binned rows of
+    -- window w are then cropped to crop_widths(w) pixels starting from
+    -- pixel crop_starts(w), or left whole if crop_widths(w) is 0 (see
+    -- `row_cropper`). Narrowing some of the windows bounds the
+    -- bandwidth taken by the rows when there are many of them.
     type image_config_t is record
         length          : integer;
         frame_clocks    : integer;
         exposure_clocks : integer;
+        binning         : integer;
+        crop_widths     : crop_widths_t;
+        crop_starts     : crop_starts_t;
     end record image_config_t;
 
-    type row_type_t is (ROW_NONE, ROW_NIR, ROW_BLUE, ROW_RED);
+    -- Crop start and width as `row_cropper` can take them, for a crop
+    -- written as start and width: the width is a whole number of
+    -- fragments, at least one, and the crop lies within the binned row,
+    -- so the row cropper always reaches the end of the crop. A width of
+    -- 0 (no crop) is kept
+    pure function crop_start(start : integer; width : integer; binning : integer) return integer;
+    pure function crop_width(start : integer; width : integer; binning : integer) return integer;
+
+    -- Pixels per output row of each window of an image with the given
+    -- configuration
+    pure function row_widths(image_config : image_config_t) return crop_widths_t;
+
+    -- An entry of the flat-field and dark-frame correction tables (see
+    -- `radiometric_corrector`). window is 0 for red, 1 for NIR, 2 for
+    -- blue and w for extra window w.
+    type correction_entry_t is record
+        window          : integer;
+        column          : integer;
+        dark            : unsigned(ROW_PIXEL_BITS-1 downto 0);
+        gain            : unsigned(GAIN_BITS-1 downto 0);
+    end record correction_entry_t;
+
+    -- A mask of the bad-pixel bitmaps (see `bad_pixel_replacer`). Bit i
+    -- of the mask of fragment `index` is set when column
+    -- index + i*ROW_WIDTH/FRAGMENT_WIDTH is bad.
+    type bad_pixel_entry_t is record
+        window          : integer;
+        index           : integer;
+        mask            : std_logic_vector(FRAGMENT_WIDTH-1 downto 0);
+    end record bad_pixel_entry_t;
+
+    type row_type_t is (ROW_NONE, ROW_NIR, ROW_BLUE, ROW_RED,
+                        ROW_BAND3, ROW_BAND4, ROW_BAND5, ROW_BAND6, ROW_BAND7);
+
+    -- Row type of the rows of the given window, or ROW_NONE if it's -1
+    pure function row_type(window : integer) return row_type_t;
     
     type lvds_t is record
         clock   : std_logic;
@@ -74,6 +130,63 @@ package vnir is
         lvds_decoder        : lvds_decoder_pkg.status_t;
         pixel_integrator       : pixel_integrator_pkg.status_t;
         sensor_configurer   : sensor_configurer_pkg.status_t;
+        row_overflow        : std_logic;
+        integrator_rows_dropped : unsigned(31 downto 0);  -- rows `pixel_integrator_spill` couldn't keep up with
     end record status_t;
 
 end package vnir;
+
+package body vnir is
+
+    pure function row_type(window : integer) return row_type_t is
+    begin
+        case window is
+            when 0      => return ROW_RED;
+            when 1      => return ROW_NIR;
+            when 2      => return ROW_BLUE;
+            when 3      => return ROW_BAND3;
+            when 4      => return ROW_BAND4;
+            when 5      => return ROW_BAND5;
+            when 6      => return ROW_BAND6;
+            when 7      => return ROW_BAND7;
+            when others => return ROW_NONE;
+        end case;
+    end function row_type;
+
+    pure function crop_start(start : integer; width : integer; binning : integer) return integer is
+        constant binned : integer := ROW_WIDTH / maximum(binning, 1);
+    begin
+        if width <= 0 then
+            return 0;
+        end if;
+        return minimum(maximum(start, 0), binned - FRAGMENT_WIDTH);
+    end function crop_start;
+
+    pure function crop_width(start : integer; width : integer; binning : integer) return integer is
+        constant binned : integer := ROW_WIDTH / maximum(binning, 1);
+        constant start_v : integer := crop_start(start, width, binning);
+        -- An unaligned crop also takes in the fragment after its last one
+        constant room : integer := binned - (start_v + FRAGMENT_WIDTH - 1) / FRAGMENT_WIDTH * FRAGMENT_WIDTH;
+    begin
+        if width <= 0 then
+            return 0;
+        end if;
+        return minimum(maximum(width, FRAGMENT_WIDTH), room) / FRAGMENT_WIDTH * FRAGMENT_WIDTH;
+    end function crop_width;
+
+    pure function row_widths(image_config : image_config_t) return crop_widths_t is
+        variable widths : crop_widths_t;
+    begin
+        for w in widths'range loop
+            if image_config.crop_widths(w) > 0 then
+                widths(w) := crop_width(image_config.crop_starts(w), image_config.crop_widths(w), image_config.binning);
+            elsif image_config.binning > 1 then
+                widths(w) := ROW_WIDTH / image_config.binning;
+            else
+                widths(w) := ROW_WIDTH;
+            end if;
+        end loop;
+        return widths;
+    end function row_widths;
+
+end package body vnir;
@@ -28,6 +28,8 @@ use work.sensor_configurer_defaults;
 use work.lvds_decoder_pkg;
 use work.frame_requester_pkg;
 use work.vnir;
+use work.sdram;
+use work.custom_master_pkg.all;
 
 
 -- Top-level VNIR sensor subsystem component
@@ -35,6 +37,15 @@ use work.vnir;
 -- Along with the `vnir` package, provides the interface through which
 -- external subsystems interact with the VNIR subsystem.
 --
+-- The rows are integrated by `pixel_integrator`, which keeps its
+-- running sums on chip, unless the INTEGRATOR generic is "SPILL". Then
+-- `pixel_integrator_spill` keeps them in SDRAM instead, allowing
+-- windows of up to vnir.SPILL_MAX_WINDOW_SIZE rows. It has no
+-- parallel-row output, so `row` isn't built, and the frame rate has to
+-- be lowered to what it can keep up with. With "DUAL",
+-- `pixel_integrator_dual` sums the fragments of each row two at a
+-- time, and its sums are handed on one fragment at a time as before.
+--
 -- Parameters
 -- ----------
 -- clock [in]
@@ -63,7 +74,8 @@ use work.vnir;
 --
 -- config [in]
 --     Configuration values. Allows setting the positions and widths of
---     the red, blue and NIR windows, and the sensor calibration values.
+--     the red, blue and NIR windows (and of the extra windows when
+--     vnir.N_WINDOWS > 3), and the sensor calibration values.
 --
 -- start_config [in]
 --     Hold at '1' for a single clock cycle to begin configuring, which
@@ -79,7 +91,9 @@ use work.vnir;
 --
 -- image_config [in]
 --     Image-configuration values. Allows setting per-image
---     configuration values: duration, fps, and exposure time.
+--     configuration values: duration, fps, exposure time, and the
+--     across-track binning and cropping of `row_fragment` (see
+--     `row_binner` and `row_cropper`).
 --
 -- start_image_config [in]
 --     Hold high for a single clock cycle to begin initializing per-
@@ -97,6 +111,11 @@ use work.vnir;
 --     (calculated from the fps and imaging duration). Set to 0 for all
 --     other clock cycles.
 --
+-- row_widths [out]
+--     Number of pixels in each row of each window of `row_fragment`
+--     with the last per-image configuration (see `vnir.row_widths`).
+--     Tells the SDRAM subsystem how long the rows are.
+--
 -- do_imaging [in]
 --     Hold high for a single clock cycle to enter imaging mode (after
 --     doing both general and per-image configuration). `vnir_subsystem`
@@ -110,12 +129,76 @@ use work.vnir;
 --
 -- row [out]
 --     When in imaging mode, will yield the output image row by row.
+--     Only built when the PARALLEL_ROW generic is true and INTEGRATOR
+--     isn't "SPILL".
 --
 -- row_available [out]
 --     When set to something other than ROW_NONE, indicates that the
 --     `row` output contains valid data to be read. Indicates which
---     window the row in question belongs to (red, blue or NIR).
+--     window the row in question belongs to (red, blue, NIR or one of
+--     the extra bands).
 --     Will be set to non-ROW_NONE values for only single clock cycles.
+--     Held at ROW_NONE when the PARALLEL_ROW generic is false.
+--
+-- correction_enable [in]
+--     Hold at '1' to apply the flat-field and dark-frame correction
+--     (see `radiometric_corrector`) to `row_fragment`. The `row`
+--     output is never corrected.
+--
+-- correction_entry [in]
+--     Entry of the correction tables to write, for the window and
+--     column it holds.
+--
+-- write_correction [in]
+--     Hold high for a single clock cycle to write `correction_entry`
+--     to the correction tables. Every entry must be written before
+--     `correction_enable` is set.
+--
+-- bad_pixel_enable [in]
+--     Hold at '1' to replace the bad pixels of `row_fragment` with the
+--     mean of their neighbours (see `bad_pixel_replacer`). This is done
+--     after the flat-field and dark-frame correction.
+--
+-- bad_pixel_entry [in]
+--     Mask of the bad-pixel bitmaps to write.
+--
+-- write_bad_pixel [in]
+--     Hold high for a single clock cycle to write `bad_pixel_entry` to
+--     the bad-pixel bitmaps. Every mask must be written before
+--     `bad_pixel_enable` is set.
+--
+-- row_fragment [out]
+--     When in imaging mode, will yield the output image FRAGMENT_WIDTH
+--     consecutive pixels at a time, starting from the first pixel of
+--     each row. Rows of window w are `row_widths(w)` pixels wide:
+--     ROW_WIDTH / `image_config.binning`, or
+--     `image_config.crop_widths(w)` if they are cropped. Together with `row_fragment_available`,
+--     `row_fragment_first`, `row_fragment_last` and `row_fragment_ready`,
+--     forms an Avalon-ST source with a readyLatency of 0, with the
+--     window as its channel and each row as a packet.
+--
+-- row_fragment_available [out]
+--     When set to something other than ROW_NONE, indicates that
+--     `row_fragment` contains valid data to be read, and which window
+--     the fragment belongs to. The fragment is held until it is
+--     accepted through `row_fragment_ready`.
+--
+-- row_fragment_first [out]
+--     Held high along with the first fragment of each row.
+--
+-- row_fragment_last [out]
+--     Held high along with the last fragment of each row.
+--
+-- row_fragment_ready [in]
+--     Hold at '1' on the clock cycles on which the fragment on
+--     `row_fragment` may be accepted. Up to four rows are buffered
+--     internally while `row_fragment_ready` is held low; rows arriving
+--     while the buffer is full are dropped, and `status.row_overflow`
+--     is pulsed.
+--     Backpressure stops at that buffer: the stages ahead of it (the
+--     integrator, the radiometric corrector and the bad-pixel replacer)
+--     run at the sensor's rate and have no ready input, since the
+--     sensor can't be held off.
 --
 -- spi_out [out]
 --     SPI output signals to the VNIR sensor
@@ -136,6 +219,14 @@ use work.vnir;
 --     LVDS input from the sensor. This is how the sensor gives the
 --     `vnir_subsystem` image data.
 --
+-- scratch_base [in]
+--     Start of the SDRAM scratch space the running sums are kept in
+--     when INTEGRATOR is "SPILL" (see `pixel_integrator_spill`).
+--
+-- read_master_in, read_master_out, write_master_in, write_master_out
+--     Custom masters through which the running sums are read and
+--     written when INTEGRATOR is "SPILL". Held idle otherwise.
+--
 -- status
 --     Status register, for debugging
 entity vnir_subsystem is
@@ -145,7 +236,10 @@ generic (
     POWER_ON_DELAY_us   : integer := sensor_configurer_defaults.POWER_ON_DELAY_us;
     CLOCK_ON_DELAY_us   : integer := sensor_configurer_defaults.CLOCK_ON_DELAY_us;
     RESET_OFF_DELAY_us  : integer := sensor_configurer_defaults.RESET_OFF_DELAY_us;
-    SPI_SETTLE_us       : integer := sensor_configurer_defaults.SPI_SETTLE_us
+    SPI_SETTLE_us       : integer := sensor_configurer_defaults.SPI_SETTLE_us;
+
+    PARALLEL_ROW        : boolean := true;
+    INTEGRATOR          : string := "SINGLE"    -- "SINGLE", "DUAL" or "SPILL"
 );
 port (
     clock               : in std_logic;
@@ -164,12 +258,27 @@ port (
     start_image_config  : in std_logic;
     image_config_done   : out std_logic;
     num_rows            : out integer;
+    row_widths          : out vnir.crop_widths_t;
     
     do_imaging          : in std_logic;
     imaging_done        : out std_logic;
 
     row                 : out vnir.row_t;
     row_available       : out vnir.row_type_t;
+
+    correction_enable   : in std_logic := '0';
+    correction_entry    : in vnir.correction_entry_t := (window => 0, column => 0, dark => (others => '0'), gain => (others => '0'));
+    write_correction    : in std_logic := '0';
+
+    bad_pixel_enable    : in std_logic := '0';
+    bad_pixel_entry     : in vnir.bad_pixel_entry_t := (window => 0, index => 0, mask => (others => '0'));
+    write_bad_pixel     : in std_logic := '0';
+
+    row_fragment            : out vnir.row_fragment_t;
+    row_fragment_available  : out vnir.row_type_t;
+    row_fragment_first      : out std_logic;
+    row_fragment_last       : out std_logic;
+    row_fragment_ready      : in std_logic := '1';
     
     spi_out             : out spi_from_master_t;
     spi_in              : in spi_to_master_t;
@@ -178,6 +287,12 @@ port (
     exposure_start      : out std_logic;
     lvds                : in vnir.lvds_t;
 
+    scratch_base        : in sdram.address_t := (others => '0');
+    read_master_in      : in from_read_master_t := FROM_READ_MASTER_IDLE;
+    read_master_out     : out to_read_master_t;
+    write_master_in     : in from_master_t := FROM_MASTER_IDLE;
+    write_master_out    : out to_master_t;
+
     status              : out vnir.status_t
 );
 end entity vnir_subsystem;
@@ -259,7 +374,8 @@ architecture rtl of vnir_subsystem is
         ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS;
         N_WINDOWS           : integer range 1 to pixel_integrator_pkg.MAX_N_WINDOWS := vnir.N_WINDOWS;
         METHOD              : string := vnir.METHOD;
-        MAX_WINDOW_SIZE     : integer := vnir.MAX_WINDOW_SIZE
+        MAX_WINDOW_SIZE     : integer := vnir.MAX_WINDOW_SIZE;
+        EMIT_ROWS           : boolean := PARALLEL_ROW
     );
     port (
         clock               : in std_logic;
@@ -272,12 +388,196 @@ architecture rtl of vnir_subsystem is
         fragment_available  : in std_logic;
         row                 : out pixel_vector_t;
         row_window          : out integer;
+        row_fragment        : out pixel_vector_t;
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer;
         status              : out pixel_integrator_pkg.status_t
     );
     end component pixel_integrator;
 
+    component pixel_integrator_dual is
+    generic (
+        ROW_WIDTH           : integer := vnir.ROW_WIDTH;
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        PIXEL_BITS          : integer := vnir.PIXEL_BITS;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS;
+        N_WINDOWS           : integer range 1 to pixel_integrator_pkg.MAX_N_WINDOWS := vnir.N_WINDOWS;
+        METHOD              : string := vnir.METHOD;
+        MAX_WINDOW_SIZE     : integer := vnir.MAX_WINDOW_SIZE;
+        EMIT_ROWS           : boolean := PARALLEL_ROW
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        config              : in pixel_integrator_pkg.config_t;
+        read_config         : in std_logic;
+        start               : in std_logic;
+        done                : out std_logic;
+        fragment_even       : in pixel_vector_t;
+        fragment_odd        : in pixel_vector_t;
+        fragment_available  : in std_logic;
+        row                 : out pixel_vector_t;
+        row_window          : out integer;
+        row_fragment_even   : out pixel_vector_t;
+        row_fragment_odd    : out pixel_vector_t;
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer;
+        status              : out pixel_integrator_pkg.status_t
+    );
+    end component pixel_integrator_dual;
+
+    component pixel_integrator_spill is
+    generic (
+        ROW_WIDTH           : integer := vnir.ROW_WIDTH;
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        PIXEL_BITS          : integer := vnir.PIXEL_BITS;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS;
+        N_WINDOWS           : integer range 1 to pixel_integrator_pkg.MAX_N_WINDOWS := vnir.N_WINDOWS;
+        METHOD              : string := vnir.METHOD;
+        MAX_WINDOW_SIZE     : integer := vnir.SPILL_MAX_WINDOW_SIZE
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        config              : in pixel_integrator_pkg.config_t;
+        read_config         : in std_logic;
+        start               : in std_logic;
+        done                : out std_logic;
+        scratch_base        : in sdram.address_t;
+        fragment            : in pixel_vector_t;
+        fragment_available  : in std_logic;
+        row_fragment        : out pixel_vector_t;
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer;
+        status              : out pixel_integrator_pkg.status_t;
+        rows_dropped        : out unsigned(31 downto 0);
+        read_master_in      : in from_read_master_t;
+        read_master_out     : out to_read_master_t;
+        write_master_in     : in from_master_t;
+        write_master_out    : out to_master_t
+    );
+    end component pixel_integrator_spill;
+
+    component radiometric_corrector is
+    generic (
+        ROW_WIDTH           : integer := vnir.ROW_WIDTH;
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS;
+        N_WINDOWS           : integer := vnir.N_WINDOWS;
+        GAIN_BITS           : integer := vnir.GAIN_BITS;
+        GAIN_FRACTION_BITS  : integer := vnir.GAIN_FRACTION_BITS
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        enable              : in std_logic;
+        table_window        : in integer;
+        table_column        : in integer;
+        table_dark          : in unsigned;
+        table_gain          : in unsigned;
+        table_write         : in std_logic;
+        fragment            : in pixel_vector_t;
+        fragment_index      : in integer;
+        fragment_window     : in integer;
+        row_fragment        : out pixel_vector_t;
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer
+    );
+    end component radiometric_corrector;
+
+    component bad_pixel_replacer is
+    generic (
+        ROW_WIDTH           : integer := vnir.ROW_WIDTH;
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS;
+        N_WINDOWS           : integer := vnir.N_WINDOWS
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        enable              : in std_logic;
+        map_window          : in integer;
+        map_index           : in integer;
+        map_mask            : in std_logic_vector;
+        map_write           : in std_logic;
+        fragment            : in pixel_vector_t;
+        fragment_index      : in integer;
+        fragment_window     : in integer;
+        row_fragment        : out pixel_vector_t;
+        row_fragment_index  : out integer;
+        row_fragment_window : out integer
+    );
+    end component bad_pixel_replacer;
+
+    component row_collator is
+    generic (
+        ROW_WIDTH           : integer := vnir.ROW_WIDTH;
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        fragment            : in pixel_vector_t;
+        fragment_index      : in integer;
+        fragment_window     : in integer;
+        pixels              : out pixel_vector_t;
+        pixels_window       : out integer;
+        pixels_first        : out std_logic;
+        pixels_last         : out std_logic;
+        pixels_ready        : in std_logic;
+        overflow            : out std_logic
+    );
+    end component row_collator;
+
+    component row_binner is
+    generic (
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS;
+        METHOD              : string := vnir.METHOD
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        binning             : in integer;
+        pixels              : in pixel_vector_t;
+        pixels_window       : in integer;
+        pixels_first        : in std_logic;
+        pixels_last         : in std_logic;
+        pixels_ready        : out std_logic;
+        binned              : out pixel_vector_t;
+        binned_window       : out integer;
+        binned_first        : out std_logic;
+        binned_last         : out std_logic;
+        binned_ready        : in std_logic
+    );
+    end component row_binner;
+
+    component row_cropper is
+    generic (
+        FRAGMENT_WIDTH      : integer := vnir.FRAGMENT_WIDTH;
+        ROW_PIXEL_BITS      : integer := vnir.ROW_PIXEL_BITS
+    );
+    port (
+        clock               : in std_logic;
+        reset_n             : in std_logic;
+        crop_starts         : in integer_vector;
+        crop_widths         : in integer_vector;
+        pixels              : in pixel_vector_t;
+        pixels_window       : in integer;
+        pixels_first        : in std_logic;
+        pixels_last         : in std_logic;
+        pixels_ready        : out std_logic;
+        cropped             : out pixel_vector_t;
+        cropped_window      : out integer;
+        cropped_first       : out std_logic;
+        cropped_last        : out std_logic;
+        cropped_ready       : in std_logic
+    );
+    end component row_cropper;
+
     signal config_reg       : vnir.config_t;
-    signal image_config_reg : vnir.image_config_t := (others => 0);
+    signal image_config_reg : vnir.image_config_t := (crop_starts => (others => 0), others => 0);
 
     signal imaging_done_s : std_logic;
 
@@ -302,7 +602,71 @@ architecture rtl of vnir_subsystem is
 
     signal row_window   : integer;
 
+    -- Only used when INTEGRATOR is "DUAL"
+    signal pair_odd                 : std_logic;
+    signal pair_even                : pixel_vector_t(vnir.FRAGMENT_WIDTH-1 downto 0)(vnir.PIXEL_BITS-1 downto 0);
+    signal pair_available           : std_logic;
+    signal summed_even              : vnir.row_fragment_t;
+    signal summed_odd               : vnir.row_fragment_t;
+    signal summed_index             : integer;
+    signal summed_window            : integer;
+    signal held_odd                 : vnir.row_fragment_t;
+    signal held_odd_index           : integer;
+    signal held_odd_window          : integer;
+
+    signal integrated_fragment          : vnir.row_fragment_t;
+    signal integrated_fragment_index    : integer;
+    signal integrated_fragment_window   : integer;
+    signal corrected_fragment           : vnir.row_fragment_t;
+    signal corrected_fragment_index     : integer;
+    signal corrected_fragment_window    : integer;
+    signal replaced_fragment            : vnir.row_fragment_t;
+    signal replaced_fragment_index      : integer;
+    signal replaced_fragment_window     : integer;
+    signal collated_fragment            : vnir.row_fragment_t;
+    signal collated_window              : integer;
+    signal collated_first               : std_logic;
+    signal collated_last                : std_logic;
+    signal collated_ready               : std_logic;
+    signal binned_fragment              : vnir.row_fragment_t;
+    signal binned_window                : integer;
+    signal binned_first                 : std_logic;
+    signal binned_last                  : std_logic;
+    signal binned_ready                 : std_logic;
+    signal cropped_window               : integer;
+
+    -- Windows 0 to N_WINDOWS-1 of `config`, as the sensor configurer
+    -- and the pixel integrator take them
+    pure function windows(config : vnir.config_t) return window_vector_t is
+        variable re : window_vector_t(pixel_integrator_pkg.MAX_N_WINDOWS-1 downto 0);
+    begin
+        re := (others => (others => 0));
+        re(0) := config.window_red;
+        re(1) := config.window_nir;
+        re(2) := config.window_blue;
+        for i in 3 to vnir.N_WINDOWS-1 loop
+            re(i) := config.extra_windows(i);
+        end loop;
+        return re;
+    end function windows;
+
+    -- Last sensor row read out in any window
+    pure function last_row(config : vnir.config_t) return integer is
+        variable w : window_vector_t(pixel_integrator_pkg.MAX_N_WINDOWS-1 downto 0);
+        variable re : integer;
+    begin
+        w := windows(config);
+        re := 0;
+        for i in 0 to vnir.N_WINDOWS-1 loop
+            re := maximum(re, w(i).hi);
+        end loop;
+        return re;
+    end function last_row;
+
 begin
+
+    assert vnir.N_WINDOWS >= 3 and vnir.N_WINDOWS <= vnir.MAX_WINDOWS
+        report "vnir.N_WINDOWS must be between 3 and vnir.MAX_WINDOWS" severity failure;
     
     -- General config sequence is:
     -- Configure sensor (power on, initialize, etc.) => align LVDS
@@ -312,6 +676,8 @@ begin
     -- Calculate image length => Configure frame-requester (calculate
     -- exposure-start/frame-request scheduling, etc.)
 
+    row_widths <= vnir.row_widths(image_config_reg);
+
     fsm : process (clock, reset_n)
         variable state : vnir.state_t;
     begin
@@ -438,49 +804,214 @@ begin
         status => status.lvds_decoder
     );
 
-    pixel_integrator_component : pixel_integrator port map (
+    assert INTEGRATOR = "SINGLE" or INTEGRATOR = "DUAL" or INTEGRATOR = "SPILL"
+        report "Unrecognized INTEGRATOR" severity failure;
+
+    INTEGRATOR_GEN : if INTEGRATOR = "SPILL" generate
+        pixel_integrator_component : pixel_integrator_spill port map (
+            clock => clock,
+            reset_n => reset_n,
+            config => pixel_integrator_config,
+            read_config => start_frame_requester_config,
+            start => do_imaging,
+            done => imaging_done_s,
+            scratch_base => scratch_base,
+            fragment => fragment,
+            fragment_available => fragment_available and fragment_control.dval,
+            row_fragment => integrated_fragment,
+            row_fragment_index => integrated_fragment_index,
+            row_fragment_window => integrated_fragment_window,
+            status => status.pixel_integrator,
+            rows_dropped => status.integrator_rows_dropped,
+            read_master_in => read_master_in,
+            read_master_out => read_master_out,
+            write_master_in => write_master_in,
+            write_master_out => write_master_out
+        );
+        row <= (others => (others => '0'));
+        row_window <= -1;
+    elsif INTEGRATOR = "DUAL" generate
+        -- Hold on to the even fragment of each pair until the odd one
+        -- arrives. Rows have an even number of fragments, so pairs
+        -- never straddle two rows
+        pair_fragments : process (clock)
+        begin
+            if rising_edge(clock) then
+                if reset_n = '0' or do_imaging = '1' then
+                    pair_odd <= '0';
+                elsif fragment_available = '1' and fragment_control.dval = '1' then
+                    if pair_odd = '0' then
+                        pair_even <= fragment;
+                    end if;
+                    pair_odd <= not pair_odd;
+                end if;
+            end if;
+        end process pair_fragments;
+        pair_available <= fragment_available and fragment_control.dval and pair_odd;
+
+        pixel_integrator_component : pixel_integrator_dual port map (
+            clock => clock,
+            reset_n => reset_n,
+            config => pixel_integrator_config,
+            read_config => start_frame_requester_config,
+            start => do_imaging,
+            done => imaging_done_s,
+            fragment_even => pair_even,
+            fragment_odd => fragment,
+            fragment_available => pair_available,
+            row => row,
+            row_window => row_window,
+            row_fragment_even => summed_even,
+            row_fragment_odd => summed_odd,
+            row_fragment_index => summed_index,
+            row_fragment_window => summed_window,
+            status => status.pixel_integrator
+        );
+
+        -- Pass the even sums on straight away and the odd ones on the
+        -- next clock cycle. A pair takes two input fragments, so pairs
+        -- come out at least two clock cycles apart
+        unpair_fragments : process (clock)
+        begin
+            if rising_edge(clock) then
+                if reset_n = '0' then
+                    held_odd_window <= -1;
+                else
+                    held_odd_window <= summed_window;
+                end if;
+                if summed_window /= -1 then
+                    held_odd <= summed_odd;
+                    held_odd_index <= summed_index + 1;
+                end if;
+            end if;
+        end process unpair_fragments;
+        integrated_fragment <= summed_even when summed_window /= -1 else held_odd;
+        integrated_fragment_index <= summed_index when summed_window /= -1 else held_odd_index;
+        integrated_fragment_window <= summed_window when summed_window /= -1 else held_odd_window;
+
+        status.integrator_rows_dropped <= (others => '0');
+        read_master_out <= TO_READ_MASTER_IDLE;
+        write_master_out <= TO_MASTER_IDLE;
+    else generate
+        pixel_integrator_component : pixel_integrator port map (
+            clock => clock,
+            reset_n => reset_n,
+            config => pixel_integrator_config,
+            read_config => start_frame_requester_config,
+            start => do_imaging,
+            done => imaging_done_s,
+            fragment => fragment,
+            fragment_available => fragment_available and fragment_control.dval,
+            row => row,
+            row_window => row_window,
+            row_fragment => integrated_fragment,
+            row_fragment_index => integrated_fragment_index,
+            row_fragment_window => integrated_fragment_window,
+            status => status.pixel_integrator
+        );
+        status.integrator_rows_dropped <= (others => '0');
+        read_master_out <= TO_READ_MASTER_IDLE;
+        write_master_out <= TO_MASTER_IDLE;
+    end generate INTEGRATOR_GEN;
+
+    radiometric_corrector_component : radiometric_corrector port map (
         clock => clock,
         reset_n => reset_n,
-        config => pixel_integrator_config,
-        read_config => start_frame_requester_config,
-        start => do_imaging,
-        done => imaging_done_s,
-        fragment => fragment,
-        fragment_available => fragment_available and fragment_control.dval,
-        row => row,
-        row_window => row_window,
-        status => status.pixel_integrator
+        enable => correction_enable,
+        table_window => correction_entry.window,
+        table_column => correction_entry.column,
+        table_dark => correction_entry.dark,
+        table_gain => correction_entry.gain,
+        table_write => write_correction,
+        fragment => integrated_fragment,
+        fragment_index => integrated_fragment_index,
+        fragment_window => integrated_fragment_window,
+        row_fragment => corrected_fragment,
+        row_fragment_index => corrected_fragment_index,
+        row_fragment_window => corrected_fragment_window
+    );
+
+    bad_pixel_replacer_component : bad_pixel_replacer port map (
+        clock => clock,
+        reset_n => reset_n,
+        enable => bad_pixel_enable,
+        map_window => bad_pixel_entry.window,
+        map_index => bad_pixel_entry.index,
+        map_mask => bad_pixel_entry.mask,
+        map_write => write_bad_pixel,
+        fragment => corrected_fragment,
+        fragment_index => corrected_fragment_index,
+        fragment_window => corrected_fragment_window,
+        row_fragment => replaced_fragment,
+        row_fragment_index => replaced_fragment_index,
+        row_fragment_window => replaced_fragment_window
+    );
+
+    row_collator_component : row_collator port map (
+        clock => clock,
+        reset_n => reset_n,
+        fragment => replaced_fragment,
+        fragment_index => replaced_fragment_index,
+        fragment_window => replaced_fragment_window,
+        pixels => collated_fragment,
+        pixels_window => collated_window,
+        pixels_first => collated_first,
+        pixels_last => collated_last,
+        pixels_ready => collated_ready,
+        overflow => status.row_overflow
+    );
+
+    row_binner_component : row_binner port map (
+        clock => clock,
+        reset_n => reset_n,
+        binning => image_config_reg.binning,
+        pixels => collated_fragment,
+        pixels_window => collated_window,
+        pixels_first => collated_first,
+        pixels_last => collated_last,
+        pixels_ready => collated_ready,
+        binned => binned_fragment,
+        binned_window => binned_window,
+        binned_first => binned_first,
+        binned_last => binned_last,
+        binned_ready => binned_ready
+    );
+
+    row_cropper_component : row_cropper port map (
+        clock => clock,
+        reset_n => reset_n,
+        crop_starts => image_config_reg.crop_starts,
+        crop_widths => image_config_reg.crop_widths,
+        pixels => binned_fragment,
+        pixels_window => binned_window,
+        pixels_first => binned_first,
+        pixels_last => binned_last,
+        pixels_ready => binned_ready,
+        cropped => row_fragment,
+        cropped_window => cropped_window,
+        cropped_first => row_fragment_first,
+        cropped_last => row_fragment_last,
+        cropped_ready => row_fragment_ready
     );
     imaging_done <= imaging_done_s;
 
     sensor_configurer_config <= (
         flip => config_reg.flip,
         calibration => config_reg.calibration,
-        windows => (
-            0 => config_reg.window_red,
-            1 => config_reg.window_nir,
-            2 => config_reg.window_blue,
-            others => (others => 0)
-        )
+        windows => windows(config_reg)
     );
     frame_requester_config <= (
-        num_frames => image_config_reg.length + config_reg.window_blue.hi,
+        num_frames => image_config_reg.length + last_row(config_reg),
         frame_clocks => image_config_reg.frame_clocks,
         exposure_clocks => image_config_reg.exposure_clocks
     );
     pixel_integrator_config <= (
         length => image_config_reg.length,
-        windows => (
-            0 => config_reg.window_red,
-            1 => config_reg.window_nir,
-            2 => config_reg.window_blue,
-            others => (others => 0)
-        )
-    );
-
-    row_available <= vnir.ROW_RED when row_window = 0 else
-                     vnir.ROW_NIR when row_window = 1 else
-                     vnir.ROW_BLUE when row_window = 2 else
-                     vnir.ROW_NONE;
+        windows => windows(config_reg)
+    );
+
+    row_available <= vnir.row_type(row_window) when PARALLEL_ROW else vnir.ROW_NONE;
+
+    row_fragment_available <= vnir.row_type(cropped_window);
 
 end architecture rtl;
\ No newline at end of file